@@ -4,6 +4,37 @@ target_link_libraries(aseba_conf INTERFACE cpp_features)
 target_compile_definitions(aseba_conf INTERFACE -DASEBA_ASSERT)
 target_include_directories(aseba_conf INTERFACE ${PROJECT_SOURCE_DIR}/aseba ${PROJECT_SOURCE_DIR})
 
+# pre-decoded threaded execution engine for the VM in host builds (simulators, tests)
+option(ASEBA_VM_THREADED "Use the pre-decoded threaded execution engine in host builds of the VM" ON)
+if (ASEBA_VM_THREADED)
+    target_compile_definitions(aseba_conf INTERFACE -DASEBA_VM_THREADED)
+endif()
+
+# sorted event lookup table instead of scanning the event vector for every event and packet
+option(ASEBA_VM_EVENT_TABLE "Use a sorted event lookup table in host builds of the VM" ON)
+if (ASEBA_VM_EVENT_TABLE)
+    target_compile_definitions(aseba_conf INTERFACE -DASEBA_VM_EVENT_TABLE)
+endif()
+
+# SSE2/AVX2/NEON kernels for the standard vector natives in host builds of the VM
+option(ASEBA_VM_SIMD "Use SIMD kernels for the standard vector natives in host builds of the VM" ON)
+if (ASEBA_VM_SIMD)
+    target_compile_definitions(aseba_conf INTERFACE -DASEBA_VM_SIMD)
+endif()
+
+# bitmap of written variables, so that changed variables are found without diffing all of them
+option(ASEBA_VM_DIRTY_TRACKING "Track written variables in a bitmap in host builds of the VM" ON)
+if (ASEBA_VM_DIRTY_TRACKING)
+    target_compile_definitions(aseba_conf INTERFACE -DASEBA_VM_DIRTY_TRACKING)
+endif()
+
+# variables pushed to the subscribers set by ASEBA_MESSAGE_SUBSCRIBE_VARIABLES, see AsebaPushSubscribedVariables;
+# the VM acknowledges subscriptions, so the glue must then push
+option(ASEBA_VM_SUBSCRIPTIONS "Push subscribed variables in host builds of the VM" ON)
+if (ASEBA_VM_SUBSCRIPTIONS)
+    target_compile_definitions(aseba_conf INTERFACE -DASEBA_VM_SUBSCRIPTIONS)
+endif()
+
 # reduce the amount of recursive include trash on Windows
 if (WIN32)
     target_compile_definitions(aseba_conf INTERFACE -DWIN32_LEAN_AND_MEAN -DNOMINMAX)
@@ -31,7 +31,14 @@ extern const char*  ASEBA_VERSION;
 extern const char*  ASEBA_REVISION;
 
 /*! version of aseba protocol, including bytecodes types and constants */
-#define ASEBA_PROTOCOL_VERSION 9
+#define ASEBA_PROTOCOL_VERSION 11
+
+/*! minimal protocol version of targets executing superinstructions */
+#define ASEBA_SUPERINSTRUCTIONS_PROTOCOL_VERSION 10
+
+/*! minimal protocol version of targets understanding ASEBA_MESSAGE_SUBSCRIBE_VARIABLES; those which push the
+    subscribed variables answer with ASEBA_MESSAGE_VARIABLES_SUBSCRIBED, the others must be polled */
+#define ASEBA_SUBSCRIBE_VARIABLES_PROTOCOL_VERSION 11
 
 /*! minimal accepted protocol version in targets */
 #define ASEBA_MIN_TARGET_PROTOCOL_VERSION 4
@@ -75,9 +82,26 @@ typedef enum
 	ASEBA_BYTECODE_EMIT = 0xB,
 	ASEBA_BYTECODE_NATIVE_CALL = 0xC,
 	ASEBA_BYTECODE_SUB_CALL = 0xD,
-	ASEBA_BYTECODE_SUB_RET = 0xE
+	ASEBA_BYTECODE_SUB_RET = 0xE,
+	ASEBA_BYTECODE_SUPERINSTRUCTION = 0xF
 } AsebaBytecodeId;
 
+/*! List of superinstructions, each replacing a common sequence of bytecodes.
+	The opcode holds the superinstruction in bits 10-11, the when flags in bits 8-9
+	for branches, and the binary operator in bits 0-7; operands follow in the next words. */
+typedef enum
+{
+	ASEBA_SUPERINSTRUCTION_LOAD_OP_STORE = 0x0,		// load a, load b, op, store c; words: a, b, c
+	ASEBA_SUPERINSTRUCTION_IMMEDIATE_OP_IN_PLACE = 0x1,	// load a, immediate v, op, store a; words: a, v
+	ASEBA_SUPERINSTRUCTION_LOAD_BRANCH = 0x2,		// load a, load b, conditional branch; words: a, b, disp
+	ASEBA_SUPERINSTRUCTION_IMMEDIATE_BRANCH = 0x3		// load a, immediate v, conditional branch; words: a, v, disp
+} AsebaSuperinstructionId;
+
+/*! Position of the superinstruction identifier inside its opcode */
+#define ASEBA_SUPERINSTRUCTION_SHIFT 10
+/*! Mask of the superinstruction identifier once shifted */
+#define ASEBA_SUPERINSTRUCTION_MASK 0x3
+
 /*! List of binary operators */
 typedef enum
 {
@@ -176,6 +200,7 @@ typedef enum
 	ASEBA_MESSAGE_NODE_PRESENT,
 	ASEBA_MESSAGE_DEVICE_INFO,
 	ASEBA_MESSAGE_CHANGED_VARIABLES,
+	ASEBA_MESSAGE_VARIABLES_SUBSCRIBED, // v11
 
 	/* from IDE to all nodes */
 	ASEBA_MESSAGE_GET_DESCRIPTION = 0xA000,
@@ -207,6 +232,7 @@ typedef enum
 	ASEBA_MESSAGE_SET_DEVICE_INFO,  // v6
 	ASEBA_MESSAGE_GET_CHANGED_VARIABLES, // v7
 	ASEBA_MESSAGE_GET_NODE_DESCRIPTION_FRAGMENT, //v8
+	ASEBA_MESSAGE_SUBSCRIBE_VARIABLES, // v11
 
 	ASEBA_MESSAGE_INVALID = 0xFFFF
 } AsebaSystemMessagesTypes;
@@ -20,6 +20,8 @@
 #ifndef ASEBA_ENDIAN
 #define ASEBA_ENDIAN
 
+#include <cstring>
+
 namespace Aseba {
 /** \addtogroup msg */
 /*@{*/
@@ -91,6 +93,15 @@ template <typename T>
 void swapEndian(T& v) {
     ByteSwapper::swap<T>(v);
 }
+//! Copy count 16-bit words from src to dest, swapping their bytes
+inline void copyWordsSwapEndian(void* dest, const void* src, size_t count) {
+    const auto* s = static_cast<const uint8_t*>(src);
+    auto* d = static_cast<uint8_t*>(dest);
+    for(size_t i = 0; i < count; ++i) {
+        d[2 * i] = s[2 * i + 1];
+        d[2 * i + 1] = s[2 * i];
+    }
+}
 
 #else
 
@@ -101,6 +112,11 @@ T swapEndianCopy(const T& v) {
 template <typename T>
 void swapEndian(T&) { /* do nothing */
 }
+//! Copy count 16-bit words from src to dest
+inline void copyWordsSwapEndian(void* dest, const void* src, size_t count) {
+    if(count != 0)
+        std::memcpy(dest, src, count * 2);
+}
 
 #endif
 
@@ -56,6 +56,7 @@ public:
         registerMessageType<Disconnected>(ASEBA_MESSAGE_DISCONNECTED);
         registerMessageType<Variables>(ASEBA_MESSAGE_VARIABLES);
         registerMessageType<ChangedVariables>(ASEBA_MESSAGE_CHANGED_VARIABLES);
+        registerMessageType<VariablesSubscribed>(ASEBA_MESSAGE_VARIABLES_SUBSCRIBED);
         registerMessageType<ArrayAccessOutOfBounds>(ASEBA_MESSAGE_ARRAY_ACCESS_OUT_OF_BOUNDS);
         registerMessageType<DivisionByZero>(ASEBA_MESSAGE_DIVISION_BY_ZERO);
         registerMessageType<EventExecutionKilled>(ASEBA_MESSAGE_EVENT_EXECUTION_KILLED);
@@ -81,6 +82,7 @@ public:
         registerMessageType<GetVariables>(ASEBA_MESSAGE_GET_VARIABLES);
         registerMessageType<SetVariables>(ASEBA_MESSAGE_SET_VARIABLES);
         registerMessageType<GetChangedVariables>(ASEBA_MESSAGE_GET_CHANGED_VARIABLES);
+        registerMessageType<SubscribeVariables>(ASEBA_MESSAGE_SUBSCRIBE_VARIABLES);
         registerMessageType<SetVariables>(ASEBA_MESSAGE_SET_VARIABLES);
         registerMessageType<WriteBytecode>(ASEBA_MESSAGE_WRITE_BYTECODE);
         registerMessageType<Reboot>(ASEBA_MESSAGE_REBOOT);
@@ -245,6 +247,41 @@ T Message::SerializationBuffer::get() {
     return val;
 }
 
+// the scalar accessors are used by clients, instantiate them even if this file does not use some of them
+template void Message::SerializationBuffer::add(const uint8_t& val);
+template void Message::SerializationBuffer::add(const uint16_t& val);
+template void Message::SerializationBuffer::add(const int16_t& val);
+template uint8_t Message::SerializationBuffer::get();
+template uint16_t Message::SerializationBuffer::get();
+template int16_t Message::SerializationBuffer::get();
+
+void Message::SerializationBuffer::add(const uint16_t* words, size_t count) {
+    const size_t pos = rawData.size();
+    rawData.resize(pos + count * sizeof(uint16_t));
+    copyWordsSwapEndian(rawData.data() + pos, words, count);
+}
+
+void Message::SerializationBuffer::add(const int16_t* words, size_t count) {
+    add(reinterpret_cast<const uint16_t*>(words), count);
+}
+
+void Message::SerializationBuffer::get(uint16_t* words, size_t count) {
+    if(readPos + count * sizeof(uint16_t) > rawData.size()) {
+        cerr << "Message::SerializationBuffer::get() : fatal error: attempt to overread.\n";
+        cerr << "readPos: " << readPos << ", rawData size: " << rawData.size() << ", words count: " << count;
+        cerr << endl;
+        dump(wcerr);
+        throw std::runtime_error("deserialization error");
+    }
+
+    copyWordsSwapEndian(words, rawData.data() + readPos, count);
+    readPos += count * sizeof(uint16_t);
+}
+
+void Message::SerializationBuffer::get(int16_t* words, size_t count) {
+    get(reinterpret_cast<uint16_t*>(words), count);
+}
+
 template <>
 string Message::SerializationBuffer::get() {
     string s;
@@ -269,8 +306,7 @@ UserMessage::UserMessage(uint16_t type, const int16_t* data, const size_t length
 }
 
 void UserMessage::serializeSpecific(SerializationBuffer& buffer) const {
-    for(const auto word : data)
-        buffer.add(word);
+    buffer.add(data.data(), data.size());
 }
 
 void UserMessage::deserializeSpecific(SerializationBuffer& buffer) {
@@ -282,9 +318,7 @@ void UserMessage::deserializeSpecific(SerializationBuffer& buffer) {
         throw std::runtime_error("deserialization error");
     }
     data.resize(buffer.rawData.size() / 2);
-
-    for(auto& word : data)
-        word = buffer.get<int16_t>();
+    buffer.get(data.data(), data.size());
 }
 
 void UserMessage::dumpSpecific(wostream& stream) const {
@@ -644,15 +678,13 @@ bool operator==(const Disconnected& lhs, const Disconnected& rhs) {
 
 void Variables::serializeSpecific(SerializationBuffer& buffer) const {
     buffer.add(start);
-    for(const auto variable : variables)
-        buffer.add(variable);
+    buffer.add(variables.data(), variables.size());
 }
 
 void Variables::deserializeSpecific(SerializationBuffer& buffer) {
     start = buffer.get<uint16_t>();
     variables.resize((buffer.rawData.size() - buffer.readPos) / 2);
-    for(auto& variable : variables)
-        variable = buffer.get<int16_t>();
+    buffer.get(variables.data(), variables.size());
 }
 
 void Variables::dumpSpecific(wostream& stream) const {
@@ -683,12 +715,9 @@ void ChangedVariables::deserializeSpecific(SerializationBuffer& buffer) {
         if((buffer.rawData.size() - buffer.readPos) < size * sizeof(int16_t))
             return;
 
-        VariablesDataVector v;
-        v.reserve(size);
-        for(int i = 0; i < size; i++) {
-            v.push_back(buffer.get<int16_t>());
-        }
-        variables.emplace_back(start, v);
+        VariablesDataVector v(size);
+        buffer.get(v.data(), v.size());
+        variables.emplace_back(start, std::move(v));
     }
 }
 
@@ -703,6 +732,34 @@ void ChangedVariables::dumpSpecific(wostream& stream) const {
 
 //
 
+void VariablesSubscribed::serializeSpecific(SerializationBuffer& buffer) const {
+    buffer.add(period);
+    for(const auto& range : ranges) {
+        buffer.add(range.first);
+        buffer.add(range.second);
+    }
+}
+
+void VariablesSubscribed::deserializeSpecific(SerializationBuffer& buffer) {
+    period = buffer.get<uint16_t>();
+    ranges.resize((buffer.rawData.size() - buffer.readPos) / 4);
+    for(auto& range : ranges) {
+        range.first = buffer.get<uint16_t>();
+        range.second = buffer.get<uint16_t>();
+    }
+}
+
+void VariablesSubscribed::dumpSpecific(wostream& stream) const {
+    stream << "period " << period << " ms, " << ranges.size() << " ranges";
+}
+
+bool operator==(const VariablesSubscribed& lhs, const VariablesSubscribed& rhs) {
+    return static_cast<const Message&>(lhs) == static_cast<const Message&>(rhs) && lhs.period == rhs.period &&
+        lhs.ranges == rhs.ranges;
+}
+
+//
+
 void ArrayAccessOutOfBounds::serializeSpecific(SerializationBuffer& buffer) const {
     buffer.add(pc);
     buffer.add(size);
@@ -916,8 +973,7 @@ void SetBytecode::serializeSpecific(SerializationBuffer& buffer) const {
     CmdMessage::serializeSpecific(buffer);
 
     buffer.add(start);
-    for(const auto word : bytecode)
-        buffer.add(word);
+    buffer.add(bytecode.data(), bytecode.size());
 }
 
 void SetBytecode::deserializeSpecific(SerializationBuffer& buffer) {
@@ -925,8 +981,7 @@ void SetBytecode::deserializeSpecific(SerializationBuffer& buffer) {
 
     start = buffer.get<uint16_t>();
     bytecode.resize((buffer.rawData.size() - buffer.readPos) / 2);
-    for(auto& word : bytecode)
-        word = buffer.get<uint16_t>();
+    buffer.get(bytecode.data(), bytecode.size());
 }
 
 void SetBytecode::dumpSpecific(wostream& stream) const {
@@ -990,6 +1045,36 @@ void sendBytecode(std::vector<std::shared_ptr<Message> >& messagesVector, uint16
     }
 }
 
+bool sendBytecodeChanges(std::vector<std::shared_ptr<Message> >& messagesVector, uint16_t dest,
+                         const std::vector<uint16_t>& previous, const std::vector<uint16_t>& bytecode) {
+    const unsigned bytecodePayloadSize = ASEBA_MAX_EVENT_ARG_COUNT - 2;
+    // unchanged words between two changes are sent as well if it is cheaper than a new message header
+    const size_t maxUnchangedRun = 3;
+    const auto differs = [&](size_t i) { return i >= previous.size() || previous[i] != bytecode[i]; };
+
+    bool changed = false;
+    size_t start = 0;
+    while(start < bytecode.size()) {
+        if(!differs(start)) {
+            ++start;
+            continue;
+        }
+        size_t lastChange = start;
+        for(size_t i = start + 1; i < bytecode.size() && i - start < bytecodePayloadSize; ++i) {
+            if(differs(i))
+                lastChange = i;
+            else if(i - lastChange > maxUnchangedRun)
+                break;
+        }
+        auto setBytecodeMessage = make_shared<SetBytecode>(dest, uint16_t(start));
+        setBytecodeMessage->bytecode.assign(bytecode.begin() + start, bytecode.begin() + lastChange + 1);
+        messagesVector.push_back(move(setBytecodeMessage));
+        changed = true;
+        start = lastChange + 1;
+    }
+    return changed;
+}
+
 //
 
 bool operator==(const Reset& lhs, const Reset& rhs) {
@@ -1114,6 +1199,43 @@ GetChangedVariables::GetChangedVariables(uint16_t dest) : CmdMessage(ASEBA_MESSA
 
 //
 
+SubscribeVariables::SubscribeVariables(uint16_t dest, uint16_t period, std::vector<Range> ranges)
+    : CmdMessage(ASEBA_MESSAGE_SUBSCRIBE_VARIABLES, dest), period(period), ranges(std::move(ranges)) {}
+
+void SubscribeVariables::serializeSpecific(SerializationBuffer& buffer) const {
+    CmdMessage::serializeSpecific(buffer);
+
+    buffer.add(period);
+    for(const auto& range : ranges) {
+        buffer.add(range.first);
+        buffer.add(range.second);
+    }
+}
+
+void SubscribeVariables::deserializeSpecific(SerializationBuffer& buffer) {
+    CmdMessage::deserializeSpecific(buffer);
+
+    period = buffer.get<uint16_t>();
+    ranges.resize((buffer.rawData.size() - buffer.readPos) / 4);
+    for(auto& range : ranges) {
+        range.first = buffer.get<uint16_t>();
+        range.second = buffer.get<uint16_t>();
+    }
+}
+
+void SubscribeVariables::dumpSpecific(wostream& stream) const {
+    CmdMessage::dumpSpecific(stream);
+
+    stream << "period " << period << " ms, " << ranges.size() << " ranges";
+}
+
+bool operator==(const SubscribeVariables& lhs, const SubscribeVariables& rhs) {
+    return static_cast<const CmdMessage&>(lhs) == static_cast<const CmdMessage&>(rhs) && lhs.period == rhs.period &&
+        lhs.ranges == rhs.ranges;
+}
+
+//
+
 SetVariables::SetVariables(uint16_t dest, uint16_t start, VariablesDataVector variables)
     : CmdMessage(ASEBA_MESSAGE_SET_VARIABLES, dest), start(start), variables(std::move(variables)) {}
 
@@ -1121,8 +1243,7 @@ void SetVariables::serializeSpecific(SerializationBuffer& buffer) const {
     CmdMessage::serializeSpecific(buffer);
 
     buffer.add(start);
-    for(const auto variable : variables)
-        buffer.add(variable);
+    buffer.add(variables.data(), variables.size());
 }
 
 void SetVariables::deserializeSpecific(SerializationBuffer& buffer) {
@@ -1130,8 +1251,7 @@ void SetVariables::deserializeSpecific(SerializationBuffer& buffer) {
 
     start = buffer.get<uint16_t>();
     variables.resize((buffer.rawData.size() - buffer.readPos) / 2);
-    for(auto& variable : variables)
-        variable = buffer.get<int16_t>();
+    buffer.get(variables.data(), variables.size());
 }
 
 void SetVariables::dumpSpecific(wostream& stream) const {
@@ -62,8 +62,14 @@ public:
 
         template <typename T>
         void add(const T& val);
+        //! Append count 16-bit words at once
+        void add(const int16_t* words, size_t count);
+        void add(const uint16_t* words, size_t count);
         template <typename T>
         T get();
+        //! Read count 16-bit words at once, throw if the buffer holds fewer
+        void get(int16_t* words, size_t count);
+        void get(uint16_t* words, size_t count);
         void dump(std::wostream& stream) const;
     };
 
@@ -436,6 +442,29 @@ protected:
 
 bool operator==(const Variables& lhs, const Variables& rhs);
 
+//! Acknowledgement of SubscribeVariables by a node which pushes its changed variables, with the ranges it kept
+class VariablesSubscribed : public Message {
+public:
+    //! start and length of a range of variables
+    using Range = std::pair<uint16_t, uint16_t>;
+
+    uint16_t period;
+    std::vector<Range> ranges;
+
+public:
+    VariablesSubscribed() : Message(ASEBA_MESSAGE_VARIABLES_SUBSCRIBED), period(0) {}
+
+protected:
+    void serializeSpecific(SerializationBuffer& buffer) const override;
+    void deserializeSpecific(SerializationBuffer& buffer) override;
+    void dumpSpecific(std::wostream& stream) const override;
+    operator const char*() const override {
+        return "variables subscribed";
+    }
+};
+
+bool operator==(const VariablesSubscribed& lhs, const VariablesSubscribed& rhs);
+
 //! Exception: an array acces attempted to read past memory
 class ArrayAccessOutOfBounds : public Message {
 public:
@@ -712,6 +741,11 @@ void sendBytecode(std::vector<std::unique_ptr<Message> >& messagesVector, uint16
 void sendBytecode(std::vector<std::shared_ptr<Message> >& messagesVector, uint16_t dest,
                   const std::vector<uint16_t>& bytecode);
 
+//! Call the SetBytecode multiple time in order to send the parts of bytecode which differ from
+//! previous, the bytecode present on the node. Return false, adding no message, if they are the same.
+bool sendBytecodeChanges(std::vector<std::shared_ptr<Message> >& messagesVector, uint16_t dest,
+                         const std::vector<uint16_t>& previous, const std::vector<uint16_t>& bytecode);
+
 //! Reset a node
 class Reset : public CmdMessage {
 public:
@@ -876,6 +910,30 @@ protected:
     }
 };
 
+//! Ask a node to push its changed variables in some ranges, at most once per period; no range unsubscribes
+class SubscribeVariables : public CmdMessage {
+public:
+    //! start and length of a range of variables
+    using Range = std::pair<uint16_t, uint16_t>;
+
+    uint16_t period;
+    std::vector<Range> ranges;
+
+public:
+    SubscribeVariables() : CmdMessage(ASEBA_MESSAGE_SUBSCRIBE_VARIABLES, ASEBA_DEST_INVALID), period(0) {}
+    SubscribeVariables(uint16_t dest, uint16_t period, std::vector<Range> ranges);
+
+protected:
+    void serializeSpecific(SerializationBuffer& buffer) const override;
+    void deserializeSpecific(SerializationBuffer& buffer) override;
+    void dumpSpecific(std::wostream& stream) const override;
+    operator const char*() const override {
+        return "subscribe variables";
+    }
+};
+
+bool operator==(const SubscribeVariables& lhs, const SubscribeVariables& rhs);
+
 //! Set some variables on a node
 class SetVariables : public CmdMessage {
 public:
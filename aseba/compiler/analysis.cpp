@@ -44,14 +44,7 @@ bool Compiler::verifyStackCalls(PreLinkBytecode& preLinkBytecode) {
                     pc += 1;
                 } break;
 
-                case ASEBA_BYTECODE_LARGE_IMMEDIATE:
-                case ASEBA_BYTECODE_LOAD_INDIRECT:
-                case ASEBA_BYTECODE_STORE_INDIRECT:
-                case ASEBA_BYTECODE_CONDITIONAL_BRANCH: pc += 2; break;
-
-                case ASEBA_BYTECODE_EMIT: pc += 3; break;
-
-                default: pc += 1; break;
+                default: pc += bytecode[pc].getWordSize(); break;
             }
         }
     }
@@ -80,14 +73,7 @@ bool Compiler::verifyStackCalls(PreLinkBytecode& preLinkBytecode) {
                         pc += 1;
                     } break;
 
-                    case ASEBA_BYTECODE_LARGE_IMMEDIATE:
-                    case ASEBA_BYTECODE_LOAD_INDIRECT:
-                    case ASEBA_BYTECODE_STORE_INDIRECT:
-                    case ASEBA_BYTECODE_CONDITIONAL_BRANCH: pc += 2; break;
-
-                    case ASEBA_BYTECODE_EMIT: pc += 3; break;
-
-                    default: pc += 1; break;
+                    default: pc += bytecode[pc].getWordSize(); break;
                 }
             }
         }
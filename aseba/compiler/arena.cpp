@@ -0,0 +1,71 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "arena.h"
+
+namespace Aseba {
+/** \addtogroup compiler */
+/*@{*/
+
+static thread_local Arena* currentArena = nullptr;
+
+Arena::Scope::Scope(Arena* arena) : previous(currentArena) {
+    currentArena = arena;
+}
+
+Arena::Scope::~Scope() {
+    currentArena = previous;
+}
+
+void* Arena::allocate(size_t size) {
+    const size_t alignment = alignof(std::max_align_t);
+    size = (size + alignment - 1) & ~(alignment - 1);
+
+    // look for room in the current block, then in the next free ones
+    while(blockIndex < blocks.size()) {
+        Block& block = blocks[blockIndex];
+        if(used + size <= block.size) {
+            void* p = block.data.get() + used;
+            used += size;
+            return p;
+        }
+        ++blockIndex;
+        used = 0;
+    }
+
+    // no room, add a new block, memory from new[] is aligned for any type
+    const size_t newBlockSize = size > blockSize ? size : blockSize;
+    blocks.push_back({std::unique_ptr<char[]>(new char[newBlockSize]), newBlockSize});
+    blockIndex = blocks.size() - 1;
+    used = size;
+    return blocks.back().data.get();
+}
+
+void Arena::reset() {
+    blockIndex = 0;
+    used = 0;
+}
+
+Arena* Arena::current() {
+    return currentArena;
+}
+
+/*@}*/
+}  // namespace Aseba
@@ -0,0 +1,76 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ARENA_H
+#define __ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace Aseba {
+/** \addtogroup compiler */
+/*@{*/
+
+//! Memory arena, allocating by bumping a pointer in large blocks, and releasing all its
+//! allocations at once when reset or destroyed. The blocks are kept when the arena is reset,
+//! so that an arena reused for similar work stops allocating memory from the heap.
+class Arena {
+public:
+    //! Make an arena the current one of this thread for the lifetime of this object,
+    //! nullptr to allocate from the heap
+    class Scope {
+    public:
+        explicit Scope(Arena* arena);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Arena* previous;
+    };
+
+    explicit Arena(size_t blockSize = 64 * 1024) : blockSize(blockSize) {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    //! Return size bytes of memory, aligned for any type
+    void* allocate(size_t size);
+    //! Release all allocations at once, objects allocated in the arena must have been destroyed
+    void reset();
+
+    //! Return the current arena of this thread, nullptr if there is none
+    static Arena* current();
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+    std::vector<Block> blocks;  //!< blocks of memory, the ones after blockIndex are free
+    size_t blockIndex{0};       //!< index of the block being allocated from
+    size_t used{0};             //!< bytes allocated in the block being allocated from
+    const size_t blockSize;     //!< size of blocks, larger allocations get a block of their own
+};
+
+/*@}*/
+}  // namespace Aseba
+
+#endif
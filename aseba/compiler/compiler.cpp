@@ -51,6 +51,11 @@ unsigned BytecodeElement::getWordSize() const {
 			case ASEBA_BYTECODE_EMIT:
 			return 3;
 
+			case ASEBA_BYTECODE_SUPERINSTRUCTION:
+			if (((bytecode >> ASEBA_SUPERINSTRUCTION_SHIFT) & ASEBA_SUPERINSTRUCTION_MASK) == ASEBA_SUPERINSTRUCTION_IMMEDIATE_OP_IN_PLACE)
+				return 3;
+			return 4;
+
 			default:
 			return 1;
 		}
@@ -62,11 +67,18 @@ unsigned BytecodeElement::getWordSize() const {
 Compiler::Compiler() {
     targetDescription = nullptr;
     commonDefinitions = nullptr;
+    superinstructionsEnabled = true;
+    vectorLoweringThreshold = 8;
+    incrementalCompilationEnabled = false;
+    strengthReductionEnabled = true;
+    dataflowOptimizationEnabled = true;
     freeVariableIndex = 0;
     endVariableIndex = 0;
     TranslatableError::setTranslateCB(ErrorMessages::defaultCallback);
 }
 
+Compiler::~Compiler() = default;
+
 //! Set the description of the target as returned by the microcontroller. You must call this
 //! function before any call to compile().
 void Compiler::setTargetDescription(const TargetDescription* description) {
@@ -92,6 +104,10 @@ bool Compiler::compile(std::wistream& source, BytecodeVector& bytecode, unsigned
 
     unsigned indent = 0;
 
+    // the syntax tree of the previous compilation has been destroyed, reuse its memory
+    nodesArena.reset();
+    Arena::Scope arenaScope(&nodesArena);
+
     // we need to build maps at each compilation in case previous ones produced errors and messed
     // maps up
     buildMaps();
@@ -114,6 +130,17 @@ bool Compiler::compile(std::wistream& source, BytecodeVector& bytecode, unsigned
         *dump << "\n\n";
     }
 
+    // incremental compilation, not when dumping as it does not go through all the passes
+    if(incrementalCompilationEnabled && !dump) {
+        std::deque<Token> programTokens;
+        programTokens.swap(tokens);
+        if(compileBlocks(programTokens, bytecode, allocatedVariablesCount))
+            return true;
+        // compile the whole program again for errors to be reported as usual
+        tokens.swap(programTokens);
+        buildMaps();
+    }
+
     // parsing
     std::unique_ptr<Node> program;
     try {
@@ -193,10 +220,16 @@ bool Compiler::compile(std::wistream& source, BytecodeVector& bytecode, unsigned
     }
 
     // optimization
+    unsigned temporariesSize(0);
     try {
         Node* optimizedProgram(program->optimize(dump));
         program.release();
         program.reset(optimizedProgram);
+        if(strengthReductionEnabled)
+            reduceStrength(program.get(), dump);
+        if(dataflowOptimizationEnabled)
+            optimizeDataflow(program.get(), dump);
+        temporariesSize = packTemporaryVariables(program.get(), dump);
     } catch(TranslatableError error) {
         errorDescription = error.toError();
         return false;
@@ -210,7 +243,7 @@ bool Compiler::compile(std::wistream& source, BytecodeVector& bytecode, unsigned
     }
 
     // set the number of allocated variables
-    allocatedVariablesCount = freeVariableIndex;
+    allocatedVariablesCount = freeVariableIndex + temporariesSize;
 
     if(dump) {
         const float fillPercentage = float(allocatedVariablesCount * 100.f) / float(targetDescription->variablesSize);
@@ -226,6 +259,10 @@ bool Compiler::compile(std::wistream& source, BytecodeVector& bytecode, unsigned
     // fix-up (add of missing STOP and RET bytecodes at code generation)
     preLinkBytecode.fixup(subroutineTable);
 
+    // superinstructions (fusion of common sequences of bytecodes), if the target supports them
+    if(superinstructionsEnabled && targetDescription->protocolVersion >= ASEBA_SUPERINSTRUCTIONS_PROTOCOL_VERSION)
+        preLinkBytecode.fuseSuperinstructions();
+
     // stack check
     if(!verifyStackCalls(preLinkBytecode)) {
         errorDescription = TranslatableError(SourcePos(), ASEBA_ERROR_STACK_OVERFLOW).toError();
@@ -478,6 +515,39 @@ void Compiler::disassemble(BytecodeVector& bytecode, const PreLinkBytecode& preL
 				pc++;
 				break;
 
+				case ASEBA_BYTECODE_SUPERINSTRUCTION:
+				{
+					const AsebaBinaryOperator op((AsebaBinaryOperator)(bytecode[pc] & ASEBA_BINARY_OPERATOR_MASK));
+					switch ((bytecode[pc] >> ASEBA_SUPERINSTRUCTION_SHIFT) & ASEBA_SUPERINSTRUCTION_MASK)
+					{
+						case ASEBA_SUPERINSTRUCTION_LOAD_OP_STORE:
+						dump << "LOAD_OP_STORE " << binaryOperatorToString(op);
+						dump << " of " << bytecode[pc+1] << " and " << bytecode[pc+2] << " to " << bytecode[pc+3] << "\n";
+						pc += 4;
+						break;
+
+						case ASEBA_SUPERINSTRUCTION_IMMEDIATE_OP_IN_PLACE:
+						dump << "IMMEDIATE_OP_IN_PLACE " << binaryOperatorToString(op);
+						dump << " " << ((signed short)bytecode[pc+2]) << " at " << bytecode[pc+1] << "\n";
+						pc += 3;
+						break;
+
+						default:
+						if (((bytecode[pc] >> ASEBA_SUPERINSTRUCTION_SHIFT) & ASEBA_SUPERINSTRUCTION_MASK) == ASEBA_SUPERINSTRUCTION_LOAD_BRANCH)
+							dump << "LOAD_BRANCH " << binaryOperatorToString(op) << " of " << bytecode[pc+1] << " and " << bytecode[pc+2];
+						else
+							dump << "IMMEDIATE_BRANCH " << binaryOperatorToString(op) << " of " << bytecode[pc+1] << " and " << ((signed short)bytecode[pc+2]);
+						if (bytecode[pc] & (1 << ASEBA_IF_IS_WHEN_BIT))
+							dump << " (edge), ";
+						else
+							dump << ", ";
+						dump << "skip " << ((signed short)bytecode[pc+3]) << " if false" << "\n";
+						pc += 4;
+						break;
+					}
+				}
+				break;
+
 				default:
 				dump << "?\n";
 				pc++;
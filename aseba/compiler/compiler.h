@@ -28,7 +28,11 @@
 #include <set>
 #include <utility>
 #include <istream>
+#include <functional>
+#include <memory>
+#include <unordered_set>
 
+#include "arena.h"
 #include "errors_code.h"
 #include "common/types.h"
 #include "common/msg/TargetDescription.h"
@@ -80,6 +84,7 @@ struct BytecodeVector : std::deque<BytecodeElement> {
 
     void changeStopToRetSub();
     unsigned short getTypeOfLast() const;
+    void fuseSuperinstructions();
 
     //! A map of event addresses to identifiers
     typedef std::map<unsigned, unsigned> EventAddressesToIdsMap;
@@ -88,6 +93,7 @@ struct BytecodeVector : std::deque<BytecodeElement> {
 
 // predeclaration
 struct PreLinkBytecode;
+struct CompiledBlocks;
 
 //! Position in a source file or string. First is line, second is column
 struct SourcePos {
@@ -261,12 +267,13 @@ public:
             TOKEN_OP_MINUS_MINUS
 
         } type{TOKEN_END_OF_STREAM};  //!< type of this token
-        std::wstring sValue;          //!< string version of the value
+        std::reference_wrapper<const std::wstring> sValue{emptyString};  //!< string version of the value, interned
         int iValue{0};                //!< int version of the value, 0 if not applicable
         SourcePos pos;                //!< position of token in source code
 
         Token() = default;
-        Token(Type type, SourcePos pos = SourcePos(), const std::wstring& value = L"");
+        Token(Type type, SourcePos pos = SourcePos(), const std::wstring& value = emptyString);
+        static const std::wstring emptyString;
         const std::wstring typeName() const;
         std::wstring toWString() const;
         operator Type() const {
@@ -296,9 +303,11 @@ public:
 
     friend struct AssignmentNode;
     friend struct CallSubNode;
+    friend struct WhileNode;
 
 public:
     Compiler();
+    ~Compiler();
     void setTargetDescription(const TargetDescription* description);
     const TargetDescription* getTargetDescription() const {
         return targetDescription;
@@ -310,6 +319,30 @@ public:
         return &subroutineTable;
     }
     void setCommonDefinitions(const CommonDefinitions* definitions);
+    //! Enable or disable the generation of superinstructions for targets supporting them
+    void setSuperinstructionsEnabled(bool enabled) {
+        superinstructionsEnabled = enabled;
+    }
+    //! Set the size from which vectorial assignments are compiled to native calls or loops
+    //! instead of one scalar assignment per element, 0 to always unroll them
+    void setVectorLoweringThreshold(unsigned threshold) {
+        vectorLoweringThreshold = threshold;
+    }
+    unsigned getVectorLoweringThreshold() const {
+        return vectorLoweringThreshold;
+    }
+    //! Enable or disable incremental compilation, which reuses the code of the blocks of the program
+    //! (onevent and sub) which did not change since the previous compilation
+    void setIncrementalCompilationEnabled(bool enabled);
+    //! Enable or disable the propagation of values, the reuse of computed expressions and the removal
+    //! of dead stores across the statements of each event and subroutine
+    void setDataflowOptimizationEnabled(bool enabled) {
+        dataflowOptimizationEnabled = enabled;
+    }
+    //! Enable or disable the rewriting of multiplications, divisions and modulos into cheaper operations
+    void setStrengthReductionEnabled(bool enabled) {
+        strengthReductionEnabled = enabled;
+    }
     bool compile(std::wistream& source, BytecodeVector& bytecode, unsigned& allocatedVariablesCount,
                  Error& errorDescription, std::wostream* dump = nullptr);
     void setTranslateCallback(ErrorMessages::ErrorCallback newCB) {
@@ -353,12 +386,19 @@ protected:
     bool constantExists(const std::wstring& name) const;
     void buildMaps();
     void tokenize(std::wistream& source);
+    const std::wstring& internString(const std::wstring& s);
     wchar_t getNextCharacter(std::wistream& source, SourcePos& pos);
     bool testNextCharacter(std::wistream& source, SourcePos& pos, wchar_t test, Token::Type tokenIfTrue);
     void dumpTokens(std::wostream& dest) const;
+    Node* reduceLoopStrength(Node* loop, std::wostream* dump);
+    void reduceStrength(Node* program, std::wostream* dump);
+    void optimizeDataflow(Node* program, std::wostream* dump);
+    unsigned packTemporaryVariables(Node* program, std::wostream* dump);
     bool verifyStackCalls(PreLinkBytecode& preLinkBytecode);
     bool link(const PreLinkBytecode& preLinkBytecode, BytecodeVector& bytecode);
     void disassemble(BytecodeVector& bytecode, const PreLinkBytecode& preLinkBytecode, std::wostream& dump) const;
+    bool compileBlocks(const std::deque<Token>& programTokens, BytecodeVector& bytecode,
+                       unsigned& allocatedVariablesCount);
 
 protected:
     Node* parseProgram();
@@ -405,6 +445,9 @@ protected:
 
 protected:
     std::deque<Token> tokens;                       //!< parsed tokens
+    std::unordered_set<std::wstring> tokenStrings;  //!< strings of the tokens, kept between compilations
+    std::wstring lexeme;                            //!< string being tokenized, kept to reuse its memory
+    Arena nodesArena;                               //!< memory of the syntax tree, released after each compilation
     VariablesMap variablesMap;                      //!< variables lookup
     ImplementedEvents implementedEvents;            //!< list of implemented events
     FunctionsMap functionsMap;                      //!< functions lookup
@@ -418,6 +461,12 @@ protected:
                                                     //!< variable at the end
     const TargetDescription* targetDescription;     //!< description of the target VM
     const CommonDefinitions* commonDefinitions;     //!< common definitions, such as events or some constants
+    bool superinstructionsEnabled;                  //!< whether superinstructions are generated for targets supporting them
+    unsigned vectorLoweringThreshold;               //!< minimal size of vectorial assignments not to be unrolled
+    bool incrementalCompilationEnabled;             //!< whether the code of unchanged blocks is reused
+    bool strengthReductionEnabled;                  //!< whether arithmetic is rewritten into cheaper operations
+    bool dataflowOptimizationEnabled;               //!< whether values are propagated across statements
+    std::unique_ptr<CompiledBlocks> blocksCache;    //!< blocks of the last program compiled incrementally
 
     ErrorMessages translator;
 };  // Compiler
@@ -437,6 +486,7 @@ struct PreLinkBytecode {
     PreLinkBytecode();
 
     void fixup(const Compiler::SubroutineTable& subroutineTable);
+    void fuseSuperinstructions();
 };
 
 /*@}*/
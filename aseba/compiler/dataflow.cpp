@@ -0,0 +1,621 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tree.h"
+#include <cassert>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Aseba {
+/** \addtogroup compiler */
+/*@{*/
+
+namespace {
+    //! A range of variables, as address and size
+    using Range = std::pair<unsigned, unsigned>;
+
+    bool overlap(const Range& a, const Range& b) {
+        return a.first < b.first + b.second && b.first < a.first + a.second;
+    }
+
+    //! Value of an expression, in terms of the content of the variables before its evaluation
+    struct Value {
+        enum Kind {
+            UNKNOWN,   //!< depends on variables which may change at any time
+            CONSTANT,  //!< known at compile time
+            VARIABLE,  //!< content of a variable
+            EXPRESSION
+        };
+        Kind kind{UNKNOWN};
+        std::wstring text;         //!< canonical form, equal for expressions always giving the same result
+        std::vector<Range> reads;  //!< variables the value depends on
+        int constant{0};           //!< if kind is CONSTANT
+        unsigned addr{0};          //!< if kind is VARIABLE
+
+        static Value fromConstant(int value) {
+            Value v;
+            v.kind = CONSTANT;
+            v.constant = int16_t(value);
+            v.text = L"#" + std::to_wstring(v.constant);
+            return v;
+        }
+        static Value fromVariable(unsigned addr) {
+            Value v;
+            v.kind = VARIABLE;
+            v.addr = addr;
+            v.text = L"@" + std::to_wstring(addr);
+            v.reads.emplace_back(addr, 1);
+            return v;
+        }
+        static Value fromExpression(std::wstring text, const Value& operand) {
+            Value v;
+            v.kind = EXPRESSION;
+            v.text = std::move(text);
+            v.reads = operand.reads;
+            return v;
+        }
+        static Value fromExpression(std::wstring text, const Value& left, const Value& right) {
+            Value v(fromExpression(std::move(text), left));
+            v.reads.insert(v.reads.end(), right.reads.begin(), right.reads.end());
+            return v;
+        }
+
+        bool dependsOn(const Range& range) const {
+            for(const auto& read : reads)
+                if(overlap(read, range))
+                    return true;
+            return false;
+        }
+    };
+
+    //! Evaluate a binary operation as the VM does, return false if it would fail or is not portable
+    bool evaluate(AsebaBinaryOperator op, int16_t a, int16_t b, int& result) {
+        switch(op) {
+            case ASEBA_OP_SHIFT_LEFT:
+                if(b < 0 || b > 15)
+                    return false;
+                result = int16_t(uint16_t(a) << b);
+                return true;
+            case ASEBA_OP_SHIFT_RIGHT:
+                if(b < 0 || b > 15)
+                    return false;
+                result = a >> b;
+                return true;
+            case ASEBA_OP_ADD: result = int16_t(a + b); return true;
+            case ASEBA_OP_SUB: result = int16_t(a - b); return true;
+            case ASEBA_OP_MULT: result = int16_t(a * b); return true;
+            case ASEBA_OP_DIV:
+                if(b == 0)
+                    return false;
+                result = int16_t(a / b);
+                return true;
+            case ASEBA_OP_MOD:
+                if(b == 0)
+                    return false;
+                result = int16_t(a % b);
+                return true;
+            case ASEBA_OP_BIT_OR: result = a | b; return true;
+            case ASEBA_OP_BIT_XOR: result = a ^ b; return true;
+            case ASEBA_OP_BIT_AND: result = a & b; return true;
+            case ASEBA_OP_EQUAL: result = a == b; return true;
+            case ASEBA_OP_NOT_EQUAL: result = a != b; return true;
+            case ASEBA_OP_BIGGER_THAN: result = a > b; return true;
+            case ASEBA_OP_BIGGER_EQUAL_THAN: result = a >= b; return true;
+            case ASEBA_OP_SMALLER_THAN: result = a < b; return true;
+            case ASEBA_OP_SMALLER_EQUAL_THAN: result = a <= b; return true;
+            case ASEBA_OP_OR: result = a || b; return true;
+            case ASEBA_OP_AND: result = a && b; return true;
+            default: return false;
+        }
+    }
+
+    //! Evaluate a unary operation as the VM does
+    bool evaluate(AsebaUnaryOperator op, int16_t a, int& result) {
+        switch(op) {
+            case ASEBA_UNARY_OP_SUB: result = int16_t(-a); return true;
+            case ASEBA_UNARY_OP_ABS: result = int16_t(a >= 0 ? a : -a); return true;
+            case ASEBA_UNARY_OP_BIT_NOT: result = int16_t(~a); return true;
+            default: return false;
+        }
+    }
+
+    //! Return true if the evaluation of expression may stop the VM with an error
+    bool mayFail(const Node* expression) {
+        if(dynamic_cast<const ArrayReadNode*>(expression) || dynamic_cast<const LoadNativeArgNode*>(expression))
+            return true;
+        auto* binary = dynamic_cast<const BinaryArithmeticNode*>(expression);
+        if(binary && (binary->op == ASEBA_OP_DIV || binary->op == ASEBA_OP_MOD)) {
+            auto* divisor = dynamic_cast<const ImmediateNode*>(binary->children[1]);
+            if(!divisor || int16_t(divisor->value) == 0)
+                return true;
+        }
+        for(const Node* child : expression->children)
+            if(child && mayFail(child))
+                return true;
+        return false;
+    }
+
+    //! Known values of the variables at a point of the program
+    class Facts {
+    public:
+        const Value* find(unsigned addr) const {
+            const auto it = values.find(addr);
+            return it == values.end() ? nullptr : &it->second;
+        }
+
+        //! Return the address of a variable holding value, or E_NOVAL
+        unsigned holder(const std::wstring& text) const {
+            const auto it = holders.find(text);
+            return it == holders.end() ? unsigned(Node::E_NOVAL) : it->second;
+        }
+
+        void set(unsigned addr, const Value& value) {
+            kill(Range(addr, 1));
+            values[addr] = value;
+            holders.emplace(value.text, addr);
+        }
+
+        //! Forget what depends on the variables in range
+        void kill(const Range& range) {
+            bool killed = false;
+            for(auto it = values.begin(); it != values.end();) {
+                if(overlap(Range(it->first, 1), range) || it->second.dependsOn(range)) {
+                    it = values.erase(it);
+                    killed = true;
+                } else
+                    ++it;
+            }
+            if(killed)
+                rebuildHolders();
+        }
+
+        void clear() {
+            values.clear();
+            holders.clear();
+        }
+
+        //! Keep only what is known in other as well
+        void intersect(const Facts& other) {
+            for(auto it = values.begin(); it != values.end();) {
+                const Value* value = other.find(it->first);
+                if(!value || value->text != it->second.text)
+                    it = values.erase(it);
+                else
+                    ++it;
+            }
+            rebuildHolders();
+        }
+
+    private:
+        void rebuildHolders() {
+            holders.clear();
+            for(const auto& value : values)
+                holders.emplace(value.second.text, value.first);
+        }
+
+        std::map<unsigned, Value> values;                     //!< values of the variables, by address
+        std::unordered_map<std::wstring, unsigned> holders;  //!< a variable holding each value
+    };
+
+    //! Temporary variables which may be read later, or all of them
+    struct Liveness {
+        bool all{false};
+        std::set<unsigned> temporaries;
+
+        bool operator==(const Liveness& other) const {
+            return all == other.all && temporaries == other.temporaries;
+        }
+        void merge(const Liveness& other) {
+            all = all || other.all;
+            temporaries.insert(other.temporaries.begin(), other.temporaries.end());
+        }
+    };
+
+    //! Optimization of the code of events and subroutines, using the values the statements
+    //! store in variables. The variables of the target may change at any time and are never
+    //! assumed to hold a known value. Temporary variables are only used within the block of code
+    //! where they are allocated.
+    class DataflowOptimizer {
+    public:
+        DataflowOptimizer(unsigned targetVariablesSize, unsigned temporariesStart, const TargetDescription* target,
+                          std::wostream* dump) :
+            targetVariablesSize(targetVariablesSize), temporariesStart(temporariesStart), target(target), dump(dump) {}
+
+        void optimize(BlockNode* program) {
+            Facts facts;
+            propagateBlock(program, facts);
+            Liveness live;
+            removeDeadStoresInBlock(program, live, true);
+        }
+
+    private:
+        bool isVolatile(const Range& range) const {
+            return range.first < targetVariablesSize;
+        }
+        bool isTemporary(unsigned addr) const {
+            return addr >= temporariesStart;
+        }
+
+        void replace(Node*& node, Node* replacement, const wchar_t* message) {
+            if(dump)
+                *dump << node->sourcePos.toWString() << message;
+            delete node;
+            node = replacement;
+        }
+
+        //! Replace expression by a load if a variable already holds its value
+        Value reuse(Node*& expression, const Value& value, const Facts& facts) {
+            const unsigned addr = facts.holder(value.text);
+            if(addr != Node::E_NOVAL)
+                replace(expression, new LoadNode(expression->sourcePos, addr),
+                        L" common subexpression replaced by a variable holding its value\n");
+            return value;
+        }
+
+        Value propagateExpression(Node*& expression, const Facts& facts) {
+            if(auto* immediate = dynamic_cast<ImmediateNode*>(expression))
+                return Value::fromConstant(immediate->value);
+
+            if(auto* load = dynamic_cast<LoadNode*>(expression)) {
+                if(isVolatile(Range(load->varAddr, 1)))
+                    return Value();
+                const Value* known = facts.find(load->varAddr);
+                if(known && (known->kind == Value::CONSTANT || known->kind == Value::VARIABLE)) {
+                    // a temporary read no more can be removed
+                    if(isTemporary(load->varAddr)) {
+                        if(known->kind == Value::CONSTANT)
+                            replace(expression, new ImmediateNode(load->sourcePos, known->constant),
+                                    L" constant propagated into temporary variable access\n");
+                        else
+                            replace(expression, new LoadNode(load->sourcePos, known->addr),
+                                    L" copy propagated into temporary variable access\n");
+                    }
+                    return *known;
+                }
+                return Value::fromVariable(load->varAddr);
+            }
+
+            if(auto* read = dynamic_cast<ArrayReadNode*>(expression)) {
+                const Value index = propagateExpression(read->children[0], facts);
+                if(index.kind == Value::CONSTANT && index.constant >= 0 && unsigned(index.constant) < read->arraySize) {
+                    replace(expression, new LoadNode(read->sourcePos, read->arrayAddr + index.constant),
+                            L" array access with propagated index transformed to single variable access\n");
+                    return propagateExpression(expression, facts);
+                }
+                const Range array(read->arrayAddr, read->arraySize);
+                if(index.kind == Value::UNKNOWN || isVolatile(array))
+                    return Value();
+                Value value = Value::fromExpression(
+                    L"@" + std::to_wstring(array.first) + L":" + std::to_wstring(array.second) + L"[" + index.text + L"]",
+                    index);
+                value.reads.push_back(array);
+                return reuse(expression, value, facts);
+            }
+
+            if(auto* binary = dynamic_cast<BinaryArithmeticNode*>(expression)) {
+                const Value left = propagateExpression(binary->children[0], facts);
+                const Value right = propagateExpression(binary->children[1], facts);
+                int result;
+                if(left.kind == Value::CONSTANT && right.kind == Value::CONSTANT &&
+                   evaluate(binary->op, left.constant, right.constant, result)) {
+                    replace(expression, new ImmediateNode(binary->sourcePos, result),
+                            L" binary arithmetic expression with propagated values simplified\n");
+                    return Value::fromConstant(result);
+                }
+                if(left.kind == Value::UNKNOWN || right.kind == Value::UNKNOWN)
+                    return Value();
+                return reuse(expression,
+                             Value::fromExpression(
+                                 L"(" + left.text + binaryOperatorToString(binary->op) + right.text + L")", left, right),
+                             facts);
+            }
+
+            if(auto* unary = dynamic_cast<UnaryArithmeticNode*>(expression)) {
+                const Value operand = propagateExpression(unary->children[0], facts);
+                int result;
+                if(operand.kind == Value::CONSTANT && evaluate(unary->op, operand.constant, result)) {
+                    replace(expression, new ImmediateNode(unary->sourcePos, result),
+                            L" unary arithmetic expression with propagated value simplified\n");
+                    return Value::fromConstant(result);
+                }
+                if(operand.kind == Value::UNKNOWN)
+                    return Value();
+                return reuse(expression,
+                             Value::fromExpression(unaryOperatorToString(unary->op) + L"(" + operand.text + L")", operand),
+                             facts);
+            }
+
+            if(auto* nativeArg = dynamic_cast<LoadNativeArgNode*>(expression))
+                propagateExpression(nativeArg->children[0], facts);
+            return Value();
+        }
+
+        //! Collect the variables which statement may write to, return false if they are unknown
+        bool collectWrites(const Node* statement, std::vector<Range>& writes) const {
+            if(dynamic_cast<const CallNode*>(statement) || dynamic_cast<const CallSubNode*>(statement))
+                return false;
+            if(auto* store = dynamic_cast<const StoreNode*>(statement))
+                writes.emplace_back(store->varAddr, 1);
+            else if(auto* write = dynamic_cast<const ArrayWriteNode*>(statement))
+                writes.emplace_back(write->arrayAddr, write->arraySize);
+            else if(auto* nativeArg = dynamic_cast<const LoadNativeArgNode*>(statement))
+                writes.emplace_back(nativeArg->tempAddr, 1);
+            for(const Node* child : statement->children)
+                if(child && !collectWrites(child, writes))
+                    return false;
+            return true;
+        }
+
+        void propagateBlock(BlockNode* block, Facts& facts) {
+            for(auto it = block->children.begin(); it != block->children.end();) {
+                propagateStatement(*it, facts);
+                if(*it)
+                    ++it;
+                else
+                    it = block->children.erase(it);
+            }
+        }
+
+        //! Propagate values forward through statement, which may be replaced or removed
+        void propagateStatement(Node*& statement, Facts& facts) {
+            if(auto* block = dynamic_cast<BlockNode*>(statement))
+                propagateBlock(block, facts);
+            else if(auto* assignment = dynamic_cast<AssignmentNode*>(statement))
+                propagateAssignment(statement, assignment, facts);
+            else if(auto* ifWhen = dynamic_cast<FoldedIfWhenNode*>(statement)) {
+                const Value left = propagateExpression(ifWhen->children[0], facts);
+                const Value right = propagateExpression(ifWhen->children[1], facts);
+                int result;
+                if(!ifWhen->edgeSensitive && left.kind == Value::CONSTANT && right.kind == Value::CONSTANT &&
+                   evaluate(ifWhen->op, left.constant, right.constant, result)) {
+                    // keep the block which is always executed
+                    const size_t taken = result ? 2 : 3;
+                    Node* block = taken < ifWhen->children.size() ? ifWhen->children[taken] : nullptr;
+                    if(block)
+                        ifWhen->children[taken] = nullptr;
+                    replace(statement, block, L" if test with propagated values simplified\n");
+                    if(statement)
+                        propagateStatement(statement, facts);
+                    return;
+                }
+                Facts falseFacts(facts);
+                propagateStatement(ifWhen->children[2], facts);
+                if(ifWhen->children.size() > 3)
+                    propagateStatement(ifWhen->children[3], falseFacts);
+                facts.intersect(falseFacts);
+            } else if(auto* whileNode = dynamic_cast<FoldedWhileNode*>(statement)) {
+                // values at the beginning of each iteration are the ones the loop does not change
+                std::vector<Range> writes;
+                if(collectWrites(whileNode->children[2], writes)) {
+                    for(const auto& range : writes)
+                        facts.kill(range);
+                } else
+                    facts.clear();
+                const Value left = propagateExpression(whileNode->children[0], facts);
+                const Value right = propagateExpression(whileNode->children[1], facts);
+                int result;
+                if(left.kind == Value::CONSTANT && right.kind == Value::CONSTANT &&
+                   evaluate(whileNode->op, left.constant, right.constant, result) && !result) {
+                    replace(statement, nullptr, L" while removed because its condition with propagated values is false\n");
+                    return;
+                }
+                Facts bodyFacts(facts);
+                propagateStatement(whileNode->children[2], bodyFacts);
+            } else if(dynamic_cast<EmitNode*>(statement)) {
+                // the computation of the arguments
+                for(auto& child : statement->children)
+                    propagateStatement(child, facts);
+            } else if(auto* call = dynamic_cast<CallNode*>(statement)) {
+                // the computation of the arguments, then the function may write to any of them
+                for(auto& child : call->children) {
+                    if(dynamic_cast<BlockNode*>(child))
+                        propagateStatement(child, facts);
+                    else if(auto* nativeArg = dynamic_cast<LoadNativeArgNode*>(child)) {
+                        propagateExpression(nativeArg->children[0], facts);
+                        facts.kill(Range(nativeArg->tempAddr, 1));
+                    }
+                }
+                facts.clear();
+            } else if(!dynamic_cast<ImmediateNode*>(statement)) {
+                // declarations of events and subroutines, subroutine calls and returns
+                facts.clear();
+            }
+        }
+
+        void propagateAssignment(Node*& statement, AssignmentNode* assignment, Facts& facts) {
+            const Value value = propagateExpression(assignment->children[1], facts);
+
+            if(auto* write = dynamic_cast<ArrayWriteNode*>(assignment->children[0])) {
+                const Value index = propagateExpression(write->children[0], facts);
+                if(index.kind == Value::CONSTANT && index.constant >= 0 &&
+                   unsigned(index.constant) < write->arraySize) {
+                    replace(assignment->children[0], new StoreNode(write->sourcePos, write->arrayAddr + index.constant),
+                            L" array access with propagated index transformed to single variable access\n");
+                } else {
+                    facts.kill(Range(write->arrayAddr, write->arraySize));
+                    return;
+                }
+            }
+
+            auto* store = dynamic_cast<StoreNode*>(assignment->children[0]);
+            assert(store);
+            const Range variable(store->varAddr, 1);
+            if(!isVolatile(variable) && value.kind != Value::UNKNOWN) {
+                const Value* known = facts.find(store->varAddr);
+                if((known && known->text == value.text) ||
+                   (value.kind == Value::VARIABLE && value.addr == store->varAddr)) {
+                    replace(statement, nullptr, L" assignment removed because the variable already holds the value\n");
+                    return;
+                }
+            }
+            facts.kill(variable);
+            if(!isVolatile(variable) && value.kind != Value::UNKNOWN && !value.dependsOn(variable))
+                facts.set(store->varAddr, value);
+        }
+
+        //! Add the temporary variables read by expression to live
+        void addReads(const Node* expression, Liveness& live) const {
+            Range range(0, 0);
+            if(auto* load = dynamic_cast<const LoadNode*>(expression))
+                range = Range(load->varAddr, 1);
+            else if(auto* read = dynamic_cast<const ArrayReadNode*>(expression))
+                range = Range(read->arrayAddr, read->arraySize);
+            else if(auto* nativeArg = dynamic_cast<const LoadNativeArgNode*>(expression))
+                range = Range(nativeArg->arrayAddr, nativeArg->arraySize);
+            for(unsigned addr = range.first; addr < range.first + range.second; ++addr)
+                if(isTemporary(addr))
+                    live.temporaries.insert(addr);
+            for(const Node* child : expression->children)
+                if(child)
+                    addReads(child, live);
+        }
+
+        //! Add the temporary variables a function may read through its argument of the given size to live,
+        //! all of them if the size is not known
+        void addArgument(const Node* argument, unsigned size, Liveness& live) const {
+            unsigned addr;
+            if(auto* immediate = dynamic_cast<const ImmediateNode*>(argument))
+                addr = immediate->value;
+            else if(auto* nativeArg = dynamic_cast<const LoadNativeArgNode*>(argument))
+                addr = nativeArg->arrayAddr;
+            else {
+                live.all = true;
+                return;
+            }
+            if(size == 0 && isTemporary(addr)) {
+                live.all = true;
+                return;
+            }
+            for(unsigned end = addr + size; addr < end; ++addr)
+                if(isTemporary(addr))
+                    live.temporaries.insert(addr);
+        }
+
+        void removeDeadStoresInBlock(BlockNode* block, Liveness& live, bool remove) {
+            for(auto it = block->children.rbegin(); it != block->children.rend(); ++it)
+                removeDeadStores(*it, live, remove);
+            if(remove) {
+                auto& children(block->children);
+                for(auto it = children.begin(); it != children.end();) {
+                    if(*it && dynamic_cast<BlockNode*>(*it) && (*it)->children.empty())
+                        delete *it;
+                    else if(*it) {
+                        ++it;
+                        continue;
+                    }
+                    it = children.erase(it);
+                }
+            }
+        }
+
+        //! Compute backward which temporary variables may be read later, and if remove is true
+        //! remove the stores to temporary variables which are not
+        void removeDeadStores(Node*& statement, Liveness& live, bool remove) {
+            if(auto* block = dynamic_cast<BlockNode*>(statement))
+                removeDeadStoresInBlock(block, live, remove);
+            else if(auto* assignment = dynamic_cast<AssignmentNode*>(statement)) {
+                auto* store = dynamic_cast<StoreNode*>(assignment->children[0]);
+                if(store && isTemporary(store->varAddr) && !live.all && !live.temporaries.count(store->varAddr) &&
+                   !mayFail(assignment->children[1])) {
+                    if(remove)
+                        replace(statement, nullptr, L" store to temporary variable never read removed\n");
+                    return;
+                }
+                if(store)
+                    live.temporaries.erase(store->varAddr);
+                else
+                    addReads(assignment->children[0]->children[0], live);
+                addReads(assignment->children[1], live);
+            } else if(auto* ifWhen = dynamic_cast<FoldedIfWhenNode*>(statement)) {
+                Liveness falseLive(live);
+                removeDeadStores(ifWhen->children[2], live, remove);
+                if(ifWhen->children.size() > 3)
+                    removeDeadStores(ifWhen->children[3], falseLive, remove);
+                live.merge(falseLive);
+                addReads(ifWhen->children[0], live);
+                addReads(ifWhen->children[1], live);
+            } else if(auto* whileNode = dynamic_cast<FoldedWhileNode*>(statement)) {
+                // temporary variables live at the beginning of the loop, iterating until stable
+                Liveness head(live);
+                addReads(whileNode->children[0], head);
+                addReads(whileNode->children[1], head);
+                while(true) {
+                    Liveness next(head);
+                    removeDeadStores(whileNode->children[2], next, false);
+                    next.merge(head);
+                    if(next == head)
+                        break;
+                    head = next;
+                }
+                Liveness body(head);
+                removeDeadStores(whileNode->children[2], body, remove);
+                live = head;
+            } else if(auto* emit = dynamic_cast<EmitNode*>(statement)) {
+                for(unsigned addr = emit->arrayAddr; addr < emit->arrayAddr + emit->arraySize; ++addr)
+                    if(isTemporary(addr))
+                        live.temporaries.insert(addr);
+                for(auto it = statement->children.rbegin(); it != statement->children.rend(); ++it)
+                    removeDeadStores(*it, live, remove);
+            } else if(auto* call = dynamic_cast<CallNode*>(statement)) {
+                // the function reads its arguments, then their computation
+                for(size_t i = call->children.size(); i-- > 0;) {
+                    const unsigned size = call->getArgumentSize(target, i);
+                    if(auto* block = dynamic_cast<BlockNode*>(call->children[i])) {
+                        addArgument(block->children.back(), size, live);
+                        removeDeadStoresInBlock(block, live, remove);
+                    } else {
+                        addArgument(call->children[i], size, live);
+                        addReads(call->children[i], live);
+                    }
+                }
+            } else if(dynamic_cast<EventDeclNode*>(statement) || dynamic_cast<SubDeclNode*>(statement) ||
+                      dynamic_cast<ReturnNode*>(statement)) {
+                // temporary variables are not used outside of the block where they are allocated
+                live = Liveness();
+            } else if(!dynamic_cast<CallSubNode*>(statement) && !dynamic_cast<ImmediateNode*>(statement)) {
+                live.all = true;
+            }
+        }
+
+        const unsigned targetVariablesSize;  //!< size of the variables of the target, at the beginning
+        const unsigned temporariesStart;     //!< address from which variables are temporary
+        const TargetDescription* target;     //!< target, for the sizes of the arguments of native functions
+        std::wostream* const dump;           //!< stream to describe the optimizations to, if any
+    };
+}  // namespace
+
+//! Propagate values, reuse computed expressions and remove dead stores to temporary variables
+//! within the code of each event and subroutine of program
+void Compiler::optimizeDataflow(Node* program, std::wostream* dump) {
+    auto* block = dynamic_cast<BlockNode*>(program);
+    assert(block);
+
+    unsigned targetVariablesSize = 0;
+    for(const auto& variable : targetDescription->namedVariables)
+        targetVariablesSize += variable.size;
+
+    DataflowOptimizer(targetVariablesSize, freeVariableIndex, targetDescription, dump).optimize(block);
+}
+
+/*@}*/
+
+}  // namespace Aseba
@@ -180,6 +180,9 @@ void Compiler::buildMaps() {
     subroutineTable.clear();
     subroutineReverseTable.clear();
 
+    // no temporary variable is allocated yet
+    freeTemporaryMemory();
+
     // fill variables map
     variablesMap = targetDescription->getVariablesMap(freeVariableIndex);
 
@@ -0,0 +1,295 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "compiler.h"
+#include "tree.h"
+#include "common/consts.h"
+#include <algorithm>
+#include <cassert>
+#include <memory>
+
+namespace Aseba {
+/** \addtogroup compiler */
+/*@{*/
+
+// The program is split into blocks: the code before the first onevent or sub, and each onevent
+// or sub up to the next one. Besides its tokens, the code of a block depends only on the target,
+// the common definitions, the variables and constants declared at the beginning of the program,
+// the subroutines of the program, and on the temporary variables allocated when parsing and
+// expanding the blocks before. A block is reused when all of these are the same as in the
+// previous compilation, its syntax tree being expanded again if only the latter changed.
+
+static bool sameTarget(const TargetDescription& a, const TargetDescription& b) {
+    if(a.protocolVersion != b.protocolVersion || a.bytecodeSize != b.bytecodeSize ||
+       a.variablesSize != b.variablesSize || a.stackSize != b.stackSize ||
+       a.namedVariables.size() != b.namedVariables.size() || a.localEvents.size() != b.localEvents.size() ||
+       a.nativeFunctions.size() != b.nativeFunctions.size())
+        return false;
+    for(size_t i = 0; i < a.namedVariables.size(); ++i)
+        if(a.namedVariables[i].name != b.namedVariables[i].name || a.namedVariables[i].size != b.namedVariables[i].size)
+            return false;
+    for(size_t i = 0; i < a.localEvents.size(); ++i)
+        if(a.localEvents[i].name != b.localEvents[i].name)
+            return false;
+    for(size_t i = 0; i < a.nativeFunctions.size(); ++i) {
+        const auto& parametersA = a.nativeFunctions[i].parameters;
+        const auto& parametersB = b.nativeFunctions[i].parameters;
+        if(a.nativeFunctions[i].name != b.nativeFunctions[i].name || parametersA.size() != parametersB.size())
+            return false;
+        for(size_t j = 0; j < parametersA.size(); ++j)
+            if(parametersA[j].name != parametersB[j].name || parametersA[j].size != parametersB[j].size)
+                return false;
+    }
+    return true;
+}
+
+static bool sameValues(const NamedValuesVector& a, const NamedValuesVector& b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const NamedValue& x, const NamedValue& y) {
+               return x.name == y.name && x.value == y.value;
+           });
+}
+
+//! Return the key of the block of tokens [begin, end): their types and strings, and their rows
+//! relative to the first one, as columns do not change the code
+static std::wstring blockKey(const std::deque<Compiler::Token>& tokens, size_t begin, size_t end) {
+    std::wstring key;
+    const unsigned firstRow = begin < end ? tokens[begin].pos.row : 0;
+    for(size_t i = begin; i < end; ++i) {
+        const Compiler::Token& token = tokens[i];
+        const unsigned row = token.pos.row - firstRow;
+        key += wchar_t(token.type);
+        key += wchar_t(row & 0xffff);
+        key += wchar_t(row >> 16);
+        key += token.sValue.get();
+        key += wchar_t(0);
+    }
+    return key;
+}
+
+//! Return a copy of bytecode with its lines moved from row fromRow to row toRow
+static BytecodeVector moveLines(const BytecodeVector& bytecode, unsigned fromRow, unsigned toRow) {
+    BytecodeVector moved(bytecode);
+    if(fromRow != toRow) {
+        for(auto& element : moved)
+            element.line = element.line + toRow - fromRow;
+        moved.lastLine = moved.lastLine + toRow - fromRow;
+    }
+    return moved;
+}
+
+//! Compile the program in programTokens by blocks, reusing the blocks of the previous compilation
+//! which did not change. Return false on error, in which case the program must be compiled whole
+//! for the error to be reported as usual.
+bool Compiler::compileBlocks(const std::deque<Token>& programTokens, BytecodeVector& bytecode,
+                             unsigned& allocatedVariablesCount) {
+    // split the program into blocks, and list its subroutines
+    std::vector<size_t> starts(1, 0);
+    std::vector<std::wstring> subroutines;
+    const size_t endOfStream = programTokens.size() - 1;
+    for(size_t i = 0; i < endOfStream; ++i) {
+        const Token& token = programTokens[i];
+        if(token == Token::TOKEN_STR_onevent || token == Token::TOKEN_STR_sub)
+            starts.push_back(i);
+        if(token == Token::TOKEN_STR_sub) {
+            if(programTokens[i + 1] != Token::TOKEN_STRING_LITERAL)
+                return false;
+            const std::wstring& name = programTokens[i + 1].sValue;
+            if(std::find(subroutines.begin(), subroutines.end(), name) != subroutines.end())
+                return false;
+            subroutines.push_back(name);
+        }
+    }
+    starts.push_back(endOfStream);
+
+    if(!blocksCache)
+        blocksCache.reset(new CompiledBlocks);
+    CompiledBlocks& cache(*blocksCache);
+    const bool sameContext = sameTarget(cache.targetDescription, *targetDescription) &&
+        sameValues(cache.commonDefinitions.events, commonDefinitions->events) &&
+        sameValues(cache.commonDefinitions.constants, commonDefinitions->constants) &&
+        cache.vectorLoweringThreshold == vectorLoweringThreshold &&
+        cache.strengthReductionEnabled == strengthReductionEnabled &&
+        cache.dataflowOptimizationEnabled == dataflowOptimizationEnabled && cache.subroutines == subroutines;
+    bool sameDeclarations = false;
+
+    const size_t blocksCount = starts.size() - 1;
+    std::vector<std::wstring> keys(blocksCount);
+    std::vector<unsigned> rows(blocksCount);
+    std::vector<CompiledBlock> blocks(blocksCount);
+    std::vector<CompiledBlock*> previous(blocksCount, nullptr);
+
+    try {
+        // parse the blocks which changed, on the heap as their trees are kept
+        for(size_t i = 0; i < blocksCount; ++i) {
+            const size_t begin = starts[i];
+            const size_t end = starts[i + 1];
+            CompiledBlock& block(blocks[i]);
+            keys[i] = blockKey(programTokens, begin, end);
+            rows[i] = begin < end ? programTokens[begin].pos.row : 0;
+            block.row = rows[i];
+
+            if(sameContext && (i == 0 || sameDeclarations)) {
+                const auto it = cache.blocks.find(keys[i]);
+                if(it != cache.blocks.end())
+                    previous[i] = &it->second;
+            }
+
+            if(previous[i]) {
+                // replay what parsing the block does to the state of the compiler
+                block.row = previous[i]->row;
+                block.id = previous[i]->id;
+                block.parseEndVariableIndex = previous[i]->parseEndVariableIndex;
+                if(i == 0) {
+                    variablesMap = cache.variablesMap;
+                    constantsMap = cache.constantsMap;
+                    freeVariableIndex = cache.freeVariableIndex;
+                } else if(programTokens[begin] == Token::TOKEN_STR_onevent) {
+                    if(implementedEvents.find(block.id) != implementedEvents.end())
+                        return false;
+                    implementedEvents.insert(block.id);
+                } else {
+                    const std::wstring& name = programTokens[begin + 1].sValue;
+                    subroutineTable.emplace_back(name, 0, rows[i]);
+                    subroutineReverseTable[name] = block.id;
+                }
+                endVariableIndex = block.parseEndVariableIndex;
+            } else {
+                Arena::Scope heap(nullptr);
+                tokens.assign(programTokens.begin() + begin, programTokens.begin() + end);
+                tokens.push_back(programTokens[end]);
+                tokens.back().type = Token::TOKEN_END_OF_STREAM;
+
+                block.tree.reset(parseProgram());
+                block.parseEndVariableIndex = endVariableIndex;
+                if(i != 0) {
+                    assert(!block.tree->children.empty());
+                    if(const auto* eventDecl = dynamic_cast<const EventDeclNode*>(block.tree->children[0]))
+                        block.id = eventDecl->eventId;
+                    else if(const auto* subDecl = dynamic_cast<const SubDeclNode*>(block.tree->children[0]))
+                        block.id = subDecl->subroutineId;
+                }
+
+                block.tree->checkVectorSize();
+                Node* expandedTree(block.tree->expandAbstractNodes(nullptr));
+                block.tree.release();
+                block.tree.reset(expandedTree);
+            }
+
+            if(i == 0)
+                sameDeclarations = variablesMap == cache.variablesMap && constantsMap == cache.constantsMap &&
+                    freeVariableIndex == cache.freeVariableIndex;
+        }
+
+        // expand, check and generate the code of the blocks in order, as they allocate temporary
+        // variables after the ones allocated when parsing the last statement
+        PreLinkBytecode preLinkBytecode;
+        unsigned temporariesSize(0);
+        for(size_t i = 0; i < blocksCount; ++i) {
+            CompiledBlock& block(blocks[i]);
+            block.expandStartVariableIndex = endVariableIndex;
+
+            if(previous[i] && previous[i]->expandStartVariableIndex == endVariableIndex) {
+                block.bytecode = previous[i]->bytecode;
+                block.expandEndVariableIndex = previous[i]->expandEndVariableIndex;
+                block.temporariesSize = previous[i]->temporariesSize;
+                endVariableIndex = block.expandEndVariableIndex;
+            } else {
+                const Node* tree = previous[i] ? previous[i]->tree.get() : block.tree.get();
+                std::unique_ptr<Node> program(tree->deepCopy());
+
+                Node* expandedProgram(program->expandVectorialNodes(nullptr, this));
+                program.release();
+                program.reset(expandedProgram);
+                block.expandEndVariableIndex = endVariableIndex;
+
+                program->typeCheck(this);
+
+                Node* optimizedProgram(program->optimize(nullptr));
+                program.release();
+                program.reset(optimizedProgram);
+                if(strengthReductionEnabled)
+                    reduceStrength(program.get(), nullptr);
+                if(dataflowOptimizationEnabled)
+                    optimizeDataflow(program.get(), nullptr);
+                block.temporariesSize = packTemporaryVariables(program.get(), nullptr);
+
+                PreLinkBytecode blockBytecode;
+                program->emit(blockBytecode);
+                if(i == 0)
+                    block.bytecode = std::move(blockBytecode.events[ASEBA_EVENT_INIT]);
+                else if(programTokens[starts[i]] == Token::TOKEN_STR_onevent)
+                    block.bytecode = std::move(blockBytecode.events[block.id]);
+                else
+                    block.bytecode = std::move(blockBytecode.subroutines[block.id]);
+            }
+
+            // the block may have moved in the program
+            BytecodeVector moved(moveLines(block.bytecode, block.row, rows[i]));
+            if(i == 0)
+                preLinkBytecode.events[ASEBA_EVENT_INIT] = std::move(moved);
+            else if(programTokens[starts[i]] == Token::TOKEN_STR_onevent)
+                preLinkBytecode.events[block.id] = std::move(moved);
+            else
+                preLinkBytecode.subroutines[block.id] = std::move(moved);
+            temporariesSize = std::max(temporariesSize, block.temporariesSize);
+        }
+
+        // a reused block may not fit anymore besides the variables of the program
+        if(freeVariableIndex + temporariesSize > targetDescription->variablesSize)
+            return false;
+        allocatedVariablesCount = freeVariableIndex + temporariesSize;
+
+        preLinkBytecode.fixup(subroutineTable);
+        if(superinstructionsEnabled && targetDescription->protocolVersion >= ASEBA_SUPERINSTRUCTIONS_PROTOCOL_VERSION)
+            preLinkBytecode.fuseSuperinstructions();
+        if(!verifyStackCalls(preLinkBytecode) || !link(preLinkBytecode, bytecode))
+            return false;
+    } catch(TranslatableError&) {
+        return false;
+    }
+
+    // keep the blocks of this program, with what they depend on
+    std::map<std::wstring, CompiledBlock> compiled;
+    for(size_t i = 0; i < blocksCount; ++i) {
+        if(previous[i] && !blocks[i].tree)
+            blocks[i].tree = std::move(previous[i]->tree);
+        compiled.emplace(std::move(keys[i]), std::move(blocks[i]));
+    }
+    cache.blocks.swap(compiled);
+    cache.targetDescription = *targetDescription;
+    cache.commonDefinitions = *commonDefinitions;
+    cache.vectorLoweringThreshold = vectorLoweringThreshold;
+    cache.strengthReductionEnabled = strengthReductionEnabled;
+    cache.dataflowOptimizationEnabled = dataflowOptimizationEnabled;
+    cache.subroutines = std::move(subroutines);
+    cache.variablesMap = variablesMap;
+    cache.constantsMap = constantsMap;
+    cache.freeVariableIndex = freeVariableIndex;
+    return true;
+}
+
+void Compiler::setIncrementalCompilationEnabled(bool enabled) {
+    incrementalCompilationEnabled = enabled;
+    if(!enabled)
+        blocksCache.reset();
+}
+
+/*@}*/
+}  // namespace Aseba
@@ -48,7 +48,9 @@ long int wcstol_fix(const wchar_t* str, wchar_t** endptr, int base) {
 #    define wcstol wcstol_fix
 #endif  // ANDROID
 
-//! Construct a new token of given type and value
+const std::wstring Compiler::Token::emptyString;
+
+//! Construct a new token of given type and value, which must outlive the token
 Compiler::Token::Token(Type type, SourcePos pos, const std::wstring& value) : type(type), sValue(value), pos(pos) {
     if(type == TOKEN_INT_LITERAL) {
         long int decode;
@@ -152,13 +154,16 @@ std::wstring Compiler::Token::toWString() const {
     if(type == TOKEN_INT_LITERAL)
         oss << L" : " << iValue;
     if(type == TOKEN_STRING_LITERAL)
-        oss << L" : " << sValue;
+        oss << L" : " << sValue.get();
     return oss.str();
 }
 //! Parse source and build tokens vector
 //! \param source source code
 void Compiler::tokenize(std::wistream& source) {
     tokens.clear();
+    // keep the strings of previous compilations, as programs are typically recompiled after small changes
+    if(tokenStrings.size() > 4096)
+        tokenStrings.clear();
     SourcePos pos(0, 0, 0);
     const unsigned tabSize = 4;
 
@@ -341,8 +346,8 @@ void Compiler::tokenize(std::wistream& source) {
                     throw TranslatableError(pos, ERROR_INVALID_IDENTIFIER).arg((unsigned)c, 0, 16);
 
                 // get a string
-                std::wstring s;
-                s += c;
+                std::wstring& s = lexeme;
+                s.assign(1, c);
                 wchar_t nextC = source.peek();
                 int posIncrement = 0;
                 while((source.good()) && (is_utf8_alpha_num(nextC) || (nextC == '_') || (nextC == '.'))) {
@@ -374,7 +379,7 @@ void Compiler::tokenize(std::wistream& source) {
                             if(!std::iswdigit(s[i]))
                                 throw TranslatableError(pos, ERROR_IN_NUMBER);
                     }
-                    tokens.emplace_back(Token::TOKEN_INT_LITERAL, pos, s);
+                    tokens.emplace_back(Token::TOKEN_INT_LITERAL, pos, internString(s));
                 } else {
                     // check if it is a known keyword
                     // FIXME: clean-up that with a table
@@ -427,7 +432,7 @@ void Compiler::tokenize(std::wistream& source) {
                     else if(s == L"not")
                         tokens.emplace_back(Token::TOKEN_OP_NOT, pos);
                     else
-                        tokens.emplace_back(Token::TOKEN_STRING_LITERAL, pos, s);
+                        tokens.emplace_back(Token::TOKEN_STRING_LITERAL, pos, internString(s));
                 }
 
                 pos.column += posIncrement;
@@ -439,6 +444,11 @@ void Compiler::tokenize(std::wistream& source) {
     tokens.emplace_back(Token::TOKEN_END_OF_STREAM, pos);
 }
 
+//! Return a copy of s shared by all tokens with this string
+const std::wstring& Compiler::internString(const std::wstring& s) {
+    return *tokenStrings.insert(s).first;
+}
+
 wchar_t Compiler::getNextCharacter(std::wistream& source, SourcePos& pos) {
     pos.column++;
     pos.character++;
@@ -215,13 +215,13 @@ void Compiler::freeTemporaryMemory() {
 }
 
 unsigned Compiler::allocateTemporaryMemory(const SourcePos varPos, const unsigned size) {
-    // allocate space at the end of the variables' memory
-    unsigned endOfMemory = targetDescription->variablesSize - endVariableIndex;
-    unsigned varAddr = endOfMemory - size;
+    // allocate space after the end of the variables' memory, the temporary variables being moved
+    // into it once their lifetimes are known, see packTemporaryVariables()
+    const unsigned varAddr = targetDescription->variablesSize + endVariableIndex;
     endVariableIndex += size;
 
-    // free space check
-    if(freeVariableIndex + endVariableIndex > targetDescription->variablesSize)
+    // the address must remain an immediate value until then
+    if(varAddr + size > 0x8000)
         throw TranslatableError(varPos, ERROR_NOT_ENOUGH_TEMP_SPACE);
 
     return varAddr;
@@ -986,7 +986,7 @@ Node* Compiler::parseUnaryExpression() {
                 // immediate -> negate it, then perform again the switch
                 tokens.pop_front();
                 tokens[0].iValue *= -1;
-                tokens[0].sValue = L"-" + tokens[0].sValue;
+                tokens[0].sValue = internString(L"-" + tokens[0].sValue.get());
                 return parseUnaryExpression();  // recursive call
             } else {
                 tokens.pop_front();
@@ -0,0 +1,202 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "compiler.h"
+#include "common/consts.h"
+#include <cassert>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace Aseba {
+/** \addtogroup compiler */
+/*@{*/
+
+namespace {
+    //! A decoded instruction of a bytecode vector
+    struct Instruction {
+        unsigned address;  //!< address of the instruction in the bytecode vector
+        unsigned type;     //!< type of the bytecode
+        unsigned size;     //!< number of words
+    };
+
+    //! A relative jump to fix once the instructions have moved
+    struct Relocation {
+        unsigned address;        //!< new address of the instruction
+        unsigned operand;        //!< new address of the word holding the displacement
+        unsigned targetAddress;  //!< old address of the destination
+    };
+
+    //! Return the value pushed by an immediate instruction
+    int immediateValue(const BytecodeVector& bytecode, const Instruction& instruction) {
+        if(instruction.type == ASEBA_BYTECODE_SMALL_IMMEDIATE)
+            return (signed short)(bytecode[instruction.address].bytecode << 4) >> 4;
+        return (signed short)bytecode[instruction.address + 1].bytecode;
+    }
+
+    //! Return true if instruction pushes an immediate value
+    bool isImmediate(const Instruction& instruction) {
+        return instruction.type == ASEBA_BYTECODE_SMALL_IMMEDIATE ||
+            instruction.type == ASEBA_BYTECODE_LARGE_IMMEDIATE;
+    }
+}  // namespace
+
+//! Replace common sequences of bytecodes by superinstructions, see AsebaSuperinstructionId.
+//! A sequence is only fused if its instructions come from the same line, so that breakpoints
+//! and step by step execution keep working, and if no jump lands inside it.
+void BytecodeVector::fuseSuperinstructions() {
+    // decode instructions and collect jump destinations
+    std::vector<Instruction> instructions;
+    std::set<unsigned> jumpTargets;
+    for(unsigned pc = 0; pc < size();) {
+        const BytecodeElement& element((*this)[pc]);
+        const unsigned type = element.bytecode >> 12;
+        if(type == ASEBA_BYTECODE_JUMP)
+            jumpTargets.insert(pc + ((signed short)(element.bytecode << 4) >> 4));
+        else if(type == ASEBA_BYTECODE_CONDITIONAL_BRANCH) {
+            jumpTargets.insert(pc + 2);
+            jumpTargets.insert(pc + (signed short)(*this)[pc + 1].bytecode);
+        }
+        instructions.push_back({pc, type, element.getWordSize()});
+        pc += element.getWordSize();
+    }
+
+    // check whether the count instructions starting at i can be fused
+    auto isFusable = [&](size_t i, size_t count) {
+        if(i + count > instructions.size())
+            return false;
+        for(size_t j = i + 1; j < i + count; ++j) {
+            if(jumpTargets.find(instructions[j].address) != jumpTargets.end())
+                return false;
+            if((*this)[instructions[j].address].line != (*this)[instructions[i].address].line)
+                return false;
+        }
+        return true;
+    };
+
+    BytecodeVector fused;
+    fused.maxStackDepth = maxStackDepth;
+    fused.callDepth = callDepth;
+    std::map<unsigned, unsigned> newAddresses;
+    std::vector<Relocation> relocations;
+
+    for(size_t i = 0; i < instructions.size();) {
+        const Instruction& instruction(instructions[i]);
+        const BytecodeElement& element((*this)[instruction.address]);
+        const unsigned short line(element.line);
+        const unsigned newAddress(unsigned(fused.size()));
+        newAddresses[instruction.address] = newAddress;
+
+        if(instruction.type == ASEBA_BYTECODE_LOAD && isFusable(i, 3) &&
+           (instructions[i + 1].type == ASEBA_BYTECODE_LOAD || isImmediate(instructions[i + 1]))) {
+            const Instruction& second(instructions[i + 1]);
+            const Instruction& third(instructions[i + 2]);
+            const BytecodeElement& thirdElement((*this)[third.address]);
+            const bool secondIsLoad(second.type == ASEBA_BYTECODE_LOAD);
+            const unsigned short firstOperand(element.bytecode & 0x0fff);
+            const unsigned short secondOperand(secondIsLoad ? (*this)[second.address].bytecode & 0x0fff
+                                                            : immediateValue(*this, second));
+
+            // load, load or immediate, conditional branch
+            if(third.type == ASEBA_BYTECODE_CONDITIONAL_BRANCH) {
+                const unsigned superinstruction =
+                    secondIsLoad ? ASEBA_SUPERINSTRUCTION_LOAD_BRANCH : ASEBA_SUPERINSTRUCTION_IMMEDIATE_BRANCH;
+                unsigned short bytecode = AsebaBytecodeFromId(ASEBA_BYTECODE_SUPERINSTRUCTION);
+                bytecode |= superinstruction << ASEBA_SUPERINSTRUCTION_SHIFT;
+                bytecode |= thirdElement.bytecode & ((1 << ASEBA_IF_IS_WHEN_BIT) | ASEBA_BINARY_OPERATOR_MASK);
+                fused.push_back(BytecodeElement(bytecode, line));
+                fused.push_back(BytecodeElement(firstOperand, line));
+                fused.push_back(BytecodeElement(secondOperand, line));
+                relocations.push_back(
+                    {newAddress, newAddress + 3, third.address + (signed short)(*this)[third.address + 1].bytecode});
+                fused.push_back(BytecodeElement(0, line));
+                i += 3;
+                continue;
+            }
+
+            if(isFusable(i, 4) && third.type == ASEBA_BYTECODE_BINARY_ARITHMETIC &&
+               instructions[i + 3].type == ASEBA_BYTECODE_STORE) {
+                const unsigned short destination((*this)[instructions[i + 3].address].bytecode & 0x0fff);
+                const unsigned short op(thirdElement.bytecode & ASEBA_BINARY_OPERATOR_MASK);
+
+                // load, load, binary arithmetic, store
+                if(secondIsLoad) {
+                    unsigned short bytecode = AsebaBytecodeFromId(ASEBA_BYTECODE_SUPERINSTRUCTION);
+                    bytecode |= ASEBA_SUPERINSTRUCTION_LOAD_OP_STORE << ASEBA_SUPERINSTRUCTION_SHIFT;
+                    fused.push_back(BytecodeElement(bytecode | op, line));
+                    fused.push_back(BytecodeElement(firstOperand, line));
+                    fused.push_back(BytecodeElement(secondOperand, line));
+                    fused.push_back(BytecodeElement(destination, line));
+                    i += 4;
+                    continue;
+                }
+
+                // load, immediate, binary arithmetic, store in the same variable
+                if(destination == firstOperand) {
+                    unsigned short bytecode = AsebaBytecodeFromId(ASEBA_BYTECODE_SUPERINSTRUCTION);
+                    bytecode |= ASEBA_SUPERINSTRUCTION_IMMEDIATE_OP_IN_PLACE << ASEBA_SUPERINSTRUCTION_SHIFT;
+                    fused.push_back(BytecodeElement(bytecode | op, line));
+                    fused.push_back(BytecodeElement(firstOperand, line));
+                    fused.push_back(BytecodeElement(secondOperand, line));
+                    i += 4;
+                    continue;
+                }
+            }
+        }
+
+        // keep the instruction, and remember its displacement if it jumps
+        if(instruction.type == ASEBA_BYTECODE_JUMP)
+            relocations.push_back(
+                {newAddress, newAddress, instruction.address + ((signed short)(element.bytecode << 4) >> 4)});
+        else if(instruction.type == ASEBA_BYTECODE_CONDITIONAL_BRANCH)
+            relocations.push_back({newAddress, newAddress + 1,
+                                   instruction.address + (signed short)(*this)[instruction.address + 1].bytecode});
+        for(unsigned j = 0; j < instruction.size; ++j)
+            fused.push_back((*this)[instruction.address + j]);
+        ++i;
+    }
+    newAddresses[unsigned(size())] = unsigned(fused.size());
+
+    // fix displacements, which can only shrink as code is never made bigger
+    for(const auto& relocation : relocations) {
+        assert(newAddresses.find(relocation.targetAddress) != newAddresses.end());
+        const int disp = int(newAddresses[relocation.targetAddress]) - int(relocation.address);
+        BytecodeElement& operand(fused[relocation.operand]);
+        if(relocation.operand == relocation.address) {
+            operand.bytecode &= 0xf000;
+            operand.bytecode |= ((unsigned)disp) & 0x0fff;
+        } else
+            operand.bytecode = (unsigned short)disp;
+    }
+
+    fused.lastLine = lastLine;
+    *this = fused;
+}
+
+//! Replace common sequences of bytecodes by superinstructions in every event and subroutine
+void PreLinkBytecode::fuseSuperinstructions() {
+    for(auto& event : events)
+        event.second.fuseSuperinstructions();
+    for(auto& subroutine : subroutines)
+        subroutine.second.fuseSuperinstructions();
+}
+
+/*@}*/
+
+}  // namespace Aseba
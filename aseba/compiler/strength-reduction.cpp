@@ -0,0 +1,438 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tree.h"
+#include "power-of-two.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Aseba {
+/** \addtogroup compiler */
+/*@{*/
+
+namespace {
+    //! Values an expression may take, as VM words
+    struct Interval {
+        int low{-32768};
+        int high{32767};
+
+        //! Return the interval from low to high, or all values if it does not fit in a word
+        static Interval make(int low, int high) {
+            Interval interval;
+            if(low >= -32768 && high <= 32767) {
+                interval.low = low;
+                interval.high = high;
+            }
+            return interval;
+        }
+    };
+
+    //! Return the value of node if it is an immediate, through value
+    bool immediateValue(const Node* node, int& value) {
+        auto* immediate = dynamic_cast<const ImmediateNode*>(node);
+        if(immediate)
+            value = immediate->value;
+        return immediate != nullptr;
+    }
+
+    //! Return whether node is a load of the variable at addr
+    bool isLoad(const Node* node, unsigned addr) {
+        auto* load = dynamic_cast<const LoadNode*>(node);
+        return load && load->varAddr == addr;
+    }
+
+    //! Return whether statement writes to the variable at addr, or may do so
+    bool mayWrite(const Node* statement, unsigned addr) {
+        // native functions may write to any of their arguments
+        if(dynamic_cast<const CallNode*>(statement) || dynamic_cast<const CallSubNode*>(statement))
+            return true;
+        if(auto* store = dynamic_cast<const StoreNode*>(statement))
+            return store->varAddr == addr;
+        if(auto* write = dynamic_cast<const ArrayWriteNode*>(statement)) {
+            if(addr >= write->arrayAddr && addr < write->arrayAddr + write->arraySize)
+                return true;
+        }
+        for(const Node* child : statement->children)
+            if(child && mayWrite(child, addr))
+                return true;
+        return false;
+    }
+
+    //! A variable incremented by a constant at the end of the body of a loop, and only there
+    struct Induction {
+        std::vector<Node*> blocks;  //!< blocks of the body down to the increment, the last child of each
+        Node* increment{nullptr};   //!< assignment incrementing the variable
+        unsigned addr{0};           //!< address of the variable
+        int step{0};                //!< increment
+
+        //! Look for the induction variable of the loop of the given body, return whether there is one.
+        //! The variables of the target below targetVariablesSize may change at any time.
+        bool find(Node* body, unsigned targetVariablesSize) {
+            for(Node* node = body; dynamic_cast<BlockNode*>(node) && !node->children.empty();
+                node = node->children.back())
+                blocks.push_back(node);
+            increment = blocks.empty() ? nullptr : blocks.back()->children.back();
+            auto* assignment = dynamic_cast<AssignmentNode*>(increment);
+            auto* store = assignment ? dynamic_cast<StoreNode*>(assignment->children[0]) : nullptr;
+            auto* sum = assignment ? dynamic_cast<BinaryArithmeticNode*>(assignment->children[1]) : nullptr;
+            if(!store || !sum || (sum->op != ASEBA_OP_ADD && sum->op != ASEBA_OP_SUB) ||
+               !isLoad(sum->children[0], store->varAddr) || !immediateValue(sum->children[1], step) || step == 0 ||
+               store->varAddr < targetVariablesSize)
+                return false;
+            addr = store->varAddr;
+            if(sum->op == ASEBA_OP_SUB)
+                step = -step;
+            bool writtenOnce = true;
+            forEachStatement([&](Node*& statement) { writtenOnce = writtenOnce && !mayWrite(statement, addr); });
+            return writtenOnce;
+        }
+
+        //! Call f on the statements of the body but the increment and the blocks containing it
+        template <typename F>
+        void forEachStatement(F f) {
+            for(Node* block : blocks)
+                for(size_t i = 0; i + 1 < block->children.size(); ++i)
+                    f(block->children[i]);
+        }
+    };
+
+    //! Collect the multiplications by constants of the variable at addr evaluated at each
+    //! execution of node, by constant
+    void collectProducts(Node*& node, unsigned addr, std::map<int, std::vector<Node**>>& products) {
+        if(dynamic_cast<IfWhenNode*>(node)) {
+            // conditional blocks may not be executed
+            collectProducts(node->children[0], addr, products);
+            return;
+        }
+        if(auto* binary = dynamic_cast<BinaryArithmeticNode*>(node)) {
+            int value;
+            if(binary->op == ASEBA_OP_MULT && isLoad(binary->children[0], addr) &&
+               immediateValue(binary->children[1], value)) {
+                products[value].push_back(&node);
+                return;
+            }
+            if(binary->op == ASEBA_OP_MULT && isLoad(binary->children[1], addr) &&
+               immediateValue(binary->children[0], value)) {
+                products[value].push_back(&node);
+                return;
+            }
+            if(binary->op == ASEBA_OP_SHIFT_LEFT && isLoad(binary->children[0], addr) &&
+               immediateValue(binary->children[1], value) && value >= 0 && value <= 15) {
+                products[int16_t(1 << value)].push_back(&node);
+                return;
+            }
+        }
+        for(auto& child : node->children)
+            if(child)
+                collectProducts(child, addr, products);
+    }
+
+    //! Return the last statement writing to the variable at addr within statement, if it does
+    const Node* lastWrite(const Node* statement, unsigned addr) {
+        if(!mayWrite(statement, addr))
+            return nullptr;
+        if(dynamic_cast<const BlockNode*>(statement)) {
+            for(auto it = statement->children.rbegin(); it != statement->children.rend(); ++it)
+                if(*it && mayWrite(*it, addr))
+                    return lastWrite(*it, addr);
+        }
+        return statement;
+    }
+
+    //! Return whether the statements before statement are always executed, in sequence, right before
+    //! the ones following it. Declarations of events and subroutines start another block of code,
+    //! and control flow may skip or repeat statements.
+    bool isStraightLine(const Node* statement) {
+        return statement && !dynamic_cast<const EventDeclNode*>(statement) &&
+            !dynamic_cast<const SubDeclNode*>(statement) && !dynamic_cast<const ReturnNode*>(statement) &&
+            !dynamic_cast<const IfWhenNode*>(statement) && !dynamic_cast<const FoldedIfWhenNode*>(statement) &&
+            !dynamic_cast<const WhileNode*>(statement) && !dynamic_cast<const FoldedWhileNode*>(statement);
+    }
+
+    //! Rewriting of multiplications, divisions and modulos by powers of two into shifts and masks
+    //! when the result is the same. Divisions and modulos are only rewritten for non-negative
+    //! dividends, as the VM rounds towards zero while shifts round towards minus infinity. The
+    //! values of the variables incremented by loops are bounded by the loop conditions.
+    class StrengthReducer {
+    public:
+        StrengthReducer(unsigned targetVariablesSize, std::wostream* dump) :
+            targetVariablesSize(targetVariablesSize), dump(dump) {}
+
+        //! Reduce node and its children
+        void reduce(Node* node) {
+            if(dynamic_cast<BlockNode*>(node)) {
+                const size_t executedCount = executed.size();
+                for(Node* child : node->children) {
+                    if(!child)
+                        continue;
+                    reduce(child);
+                    executed.push_back(child);
+                }
+                executed.resize(executedCount);
+                return;
+            }
+            if(auto* loop = dynamic_cast<FoldedWhileNode*>(node)) {
+                reduceLoop(loop);
+                return;
+            }
+            for(Node* child : node->children)
+                if(child)
+                    reduce(child);
+            if(auto* binary = dynamic_cast<BinaryArithmeticNode*>(node))
+                reduceArithmetic(binary);
+        }
+
+    private:
+        void reduceLoop(FoldedWhileNode* loop) {
+            reduce(loop->children[0]);
+            reduce(loop->children[1]);
+
+            // the range of the induction variable in the body, if it starts from a constant and is
+            // compared to a constant it does not overflow when reaching
+            Induction induction;
+            bool bounded = induction.find(loop->children[2], targetVariablesSize);
+            int start = 0, end = 0;
+            if(bounded) {
+                // the last write before the loop, in the same event or subroutine and with no control
+                // flow in between, so that it is the value the loop starts from
+                const Node* init = nullptr;
+                for(auto it = executed.rbegin(); !init && it != executed.rend() && isStraightLine(*it); ++it)
+                    init = lastWrite(*it, induction.addr);
+                auto* assignment = dynamic_cast<const AssignmentNode*>(init);
+                bounded = assignment && immediateValue(assignment->children[1], start) &&
+                    isLoad(loop->children[0], induction.addr) && immediateValue(loop->children[1], end);
+            }
+            const bool hadRange = inductionRanges.find(induction.addr) != inductionRanges.end();
+            if(bounded && induction.step > 0 &&
+               (loop->op == ASEBA_OP_SMALLER_EQUAL_THAN || loop->op == ASEBA_OP_SMALLER_THAN) &&
+               end + induction.step <= 32767)
+                inductionRanges[induction.addr] = Interval::make(start, end);
+            else if(bounded && induction.step < 0 &&
+                    (loop->op == ASEBA_OP_BIGGER_EQUAL_THAN || loop->op == ASEBA_OP_BIGGER_THAN) &&
+                    end + induction.step >= -32768)
+                inductionRanges[induction.addr] = Interval::make(end, start);
+            else
+                bounded = false;
+
+            // the statements before the loop may not be the last ones executed in the body
+            executed.push_back(nullptr);
+            reduce(loop->children[2]);
+            executed.pop_back();
+            if(bounded && !hadRange)
+                inductionRanges.erase(induction.addr);
+        }
+
+        void log(const Node* node, const wchar_t* message) const {
+            if(dump)
+                *dump << node->sourcePos.toWString() << message;
+        }
+
+        Interval rangeOf(const Node* expression) const {
+            int value;
+            if(immediateValue(expression, value))
+                return Interval::make(value, value);
+
+            if(auto* load = dynamic_cast<const LoadNode*>(expression)) {
+                const auto it = inductionRanges.find(load->varAddr);
+                return it == inductionRanges.end() ? Interval() : it->second;
+            }
+
+            if(auto* unary = dynamic_cast<const UnaryArithmeticNode*>(expression)) {
+                const Interval operand = rangeOf(unary->children[0]);
+                switch(unary->op) {
+                    case ASEBA_UNARY_OP_SUB:
+                        return operand.low > -32768 ? Interval::make(-operand.high, -operand.low) : Interval();
+                    case ASEBA_UNARY_OP_ABS:
+                        if(operand.low == -32768)
+                            return Interval();
+                        if(operand.low >= 0)
+                            return operand;
+                        if(operand.high <= 0)
+                            return Interval::make(-operand.high, -operand.low);
+                        return Interval::make(0, std::max(-operand.low, operand.high));
+                    case ASEBA_UNARY_OP_BIT_NOT: return Interval::make(~operand.high, ~operand.low);
+                    default: return Interval();
+                }
+            }
+
+            auto* binary = dynamic_cast<const BinaryArithmeticNode*>(expression);
+            if(!binary)
+                return Interval();
+            const Interval left = rangeOf(binary->children[0]);
+            const Interval right = rangeOf(binary->children[1]);
+            int constant;
+            const bool constantRight = immediateValue(binary->children[1], constant);
+            switch(binary->op) {
+                case ASEBA_OP_ADD: return Interval::make(left.low + right.low, left.high + right.high);
+                case ASEBA_OP_SUB: return Interval::make(left.low - right.high, left.high - right.low);
+                case ASEBA_OP_MULT: {
+                    const int products[] = {left.low * right.low, left.low * right.high, left.high * right.low,
+                                            left.high * right.high};
+                    return Interval::make(*std::min_element(products, products + 4),
+                                          *std::max_element(products, products + 4));
+                }
+                case ASEBA_OP_SHIFT_LEFT:
+                    if(constantRight && constant >= 0 && constant < 15)
+                        return Interval::make(left.low * (1 << constant), left.high * (1 << constant));
+                    return Interval();
+                case ASEBA_OP_SHIFT_RIGHT:
+                    if(constantRight && constant >= 0 && constant <= 15)
+                        return Interval::make(left.low >> constant, left.high >> constant);
+                    return left.low >= 0 ? Interval::make(0, left.high) : Interval();
+                case ASEBA_OP_DIV:
+                    if(constantRight && constant > 0)
+                        return Interval::make(left.low / constant, left.high / constant);
+                    return Interval();
+                case ASEBA_OP_MOD: {
+                    // the remainder has the sign of the dividend
+                    const int maxRemainder = constantRight && constant != 0 ? std::abs(constant) - 1 : 32767;
+                    if(left.low >= 0)
+                        return Interval::make(0, std::min(left.high, maxRemainder));
+                    if(left.high <= 0)
+                        return Interval::make(std::max(left.low, -maxRemainder), 0);
+                    return Interval::make(-maxRemainder, maxRemainder);
+                }
+                case ASEBA_OP_BIT_AND:
+                    if(left.low >= 0 && right.low >= 0)
+                        return Interval::make(0, std::min(left.high, right.high));
+                    if(left.low >= 0)
+                        return Interval::make(0, left.high);
+                    if(right.low >= 0)
+                        return Interval::make(0, right.high);
+                    return Interval();
+                case ASEBA_OP_BIT_OR:
+                case ASEBA_OP_BIT_XOR: {
+                    if(left.low < 0 || right.low < 0)
+                        return Interval();
+                    int mask = 0;
+                    while(mask < std::max(left.high, right.high))
+                        mask = (mask << 1) | 1;
+                    return Interval::make(0, mask);
+                }
+                default:
+                    // comparisons and logic operations
+                    return Interval::make(0, 1);
+            }
+        }
+
+        //! Rewrite binary into a cheaper operation giving the same result, if any
+        void reduceArithmetic(BinaryArithmeticNode* binary) {
+            int value;
+            if(binary->op == ASEBA_OP_MULT && immediateValue(binary->children[0], value) && isPOT(value)) {
+                std::swap(binary->children[0], binary->children[1]);
+                binary->op = ASEBA_OP_SHIFT_LEFT;
+                dynamic_cast<ImmediateNode*>(binary->children[1])->value = shiftFromPOT(value);
+                log(binary, L" multiplication transformed to left shift\n");
+                return;
+            }
+            if((binary->op != ASEBA_OP_DIV && binary->op != ASEBA_OP_MOD) ||
+               !immediateValue(binary->children[1], value) || !isPOT(value) || rangeOf(binary->children[0]).low < 0)
+                return;
+            auto* divisor = dynamic_cast<ImmediateNode*>(binary->children[1]);
+            if(binary->op == ASEBA_OP_DIV) {
+                binary->op = ASEBA_OP_SHIFT_RIGHT;
+                divisor->value = shiftFromPOT(value);
+                log(binary, L" division of non-negative value transformed to right shift\n");
+            } else {
+                binary->op = ASEBA_OP_BIT_AND;
+                divisor->value = value - 1;
+                log(binary, L" modulo of non-negative value transformed to binary and\n");
+            }
+        }
+
+        const unsigned targetVariablesSize;            //!< size of the variables of the target, at the beginning
+        std::wostream* const dump;                     //!< stream to describe the optimizations to, if any
+        std::vector<const Node*> executed;             //!< statements executed before the current one, nullptr
+                                                       //!< if the ones before may not be
+        std::map<unsigned, Interval> inductionRanges;  //!< values of the loop variables in the loops being reduced
+    };
+}  // namespace
+
+//! Replace the multiplications by constants of the variable a loop increments by constants
+//! by temporary variables incremented along with it, return the loop, in a block initializing them
+//! if any. This is done before typechecking, so that whole programs and single blocks compiled
+//! incrementally allocate the temporary variables in the same order.
+Node* Compiler::reduceLoopStrength(Node* loop, std::wostream* dump) {
+    assert(dynamic_cast<WhileNode*>(loop));
+    if(!strengthReductionEnabled)
+        return loop;
+
+    unsigned targetVariablesSize = 0;
+    for(const auto& variable : targetDescription->namedVariables)
+        targetVariablesSize += variable.size;
+
+    Induction induction;
+    if(!induction.find(loop->children[1], targetVariablesSize))
+        return loop;
+    std::map<int, std::vector<Node**>> products;
+    induction.forEachStatement([&](Node*& statement) { collectProducts(statement, induction.addr, products); });
+
+    std::unique_ptr<BlockNode> block(new BlockNode(loop->sourcePos));
+    std::vector<Node*> updates;
+    const SourcePos& pos(induction.increment->sourcePos);
+    for(const auto& product : products) {
+        // use memory left only
+        if(freeVariableIndex + endVariableIndex >= targetDescription->variablesSize)
+            break;
+        const int factor = product.first;
+        if(factor == 0 || factor == 1)
+            continue;
+        const unsigned temp = allocateTemporaryMemory(loop->sourcePos, 1);
+        for(Node** use : product.second) {
+            if(dump)
+                *dump << (*use)->sourcePos.toWString()
+                      << L" multiplication of loop variable replaced by a variable incremented with it\n";
+            const SourcePos usePos((*use)->sourcePos);
+            delete *use;
+            *use = new LoadNode(usePos, temp);
+        }
+        Node* initial = new BinaryArithmeticNode(pos, ASEBA_OP_MULT, new LoadNode(pos, induction.addr),
+                                                 new ImmediateNode(pos, factor));
+        block->children.push_back(new AssignmentNode(pos, new StoreNode(pos, temp), initial));
+        Node* sum = new BinaryArithmeticNode(pos, ASEBA_OP_ADD, new LoadNode(pos, temp),
+                                             new ImmediateNode(pos, int16_t(induction.step * factor)));
+        updates.push_back(new AssignmentNode(pos, new StoreNode(pos, temp), sum));
+    }
+    // before the increment, so that it stays the last statement of the loop
+    auto& incrementBlock(induction.blocks.back()->children);
+    incrementBlock.insert(incrementBlock.end() - 1, updates.begin(), updates.end());
+    if(block->children.empty())
+        return loop;
+    block->children.push_back(loop);
+    return block.release();
+}
+
+//! Rewrite the multiplications, divisions and modulos of program by powers of two into cheaper
+//! operations when they give the same result
+void Compiler::reduceStrength(Node* program, std::wostream* dump) {
+    unsigned targetVariablesSize = 0;
+    for(const auto& variable : targetDescription->namedVariables)
+        targetVariablesSize += variable.size;
+
+    StrengthReducer(targetVariablesSize, dump).reduce(program);
+}
+
+/*@}*/
+
+}  // namespace Aseba
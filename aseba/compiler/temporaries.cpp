@@ -0,0 +1,284 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tree.h"
+#include "errors_code.h"
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace Aseba {
+/** \addtogroup compiler */
+/*@{*/
+
+namespace {
+    //! Temporary variables which have to stay contiguous, and the statements using them
+    struct Temporary {
+        unsigned addr;    //!< address of the first variable, as allocated when parsing
+        unsigned size;    //!< number of variables
+        unsigned first;   //!< position of the first statement using them
+        unsigned last;    //!< position of the last statement using them
+        SourcePos pos;    //!< source of the first statement using them
+        unsigned offset;  //!< position from the end of memory, once packed
+
+        bool overlaps(const Temporary& other) const {
+            return first <= other.last && other.first <= last;
+        }
+    };
+
+    //! Packing of the temporary variables of each event and subroutine, the ones whose lifetimes do
+    //! not overlap sharing memory at the end of the variables. As when allocating them, temporary
+    //! variables are only used within the code of the event or subroutine where they are allocated,
+    //! and are not live across subroutine calls. Their lifetime spans the statements using them,
+    //! and the whole outermost loop containing any of those.
+    class TemporariesPacker {
+    public:
+        TemporariesPacker(const TargetDescription* target, unsigned freeVariableIndex) :
+            target(target), freeVariableIndex(freeVariableIndex) {}
+
+        //! Pack the temporary variables of program, return the size of memory they use
+        unsigned pack(BlockNode* program) {
+            unsigned size = 0;
+            auto begin = program->children.begin();
+            for(auto it = begin; it != program->children.end(); ++it) {
+                if(it != begin && (dynamic_cast<EventDeclNode*>(*it) || dynamic_cast<SubDeclNode*>(*it))) {
+                    size = std::max(size, packBlock(begin, it));
+                    begin = it;
+                }
+            }
+            return std::max(size, packBlock(begin, program->children.end()));
+        }
+
+    private:
+        //! Pack the temporary variables used in the statements from begin to end
+        unsigned packBlock(std::vector<Node*>::iterator begin, std::vector<Node*>::iterator end) {
+            temporaries.clear();
+            position = 0;
+            for(auto it = begin; it != end; ++it)
+                if(*it)
+                    collect(*it);
+            if(temporaries.empty())
+                return 0;
+
+            // merge the accesses to overlapping variables
+            std::sort(temporaries.begin(), temporaries.end(),
+                      [](const Temporary& a, const Temporary& b) { return a.addr < b.addr; });
+            std::vector<Temporary> merged;
+            for(const auto& temporary : temporaries) {
+                if(merged.empty() || temporary.addr >= merged.back().addr + merged.back().size) {
+                    merged.push_back(temporary);
+                    continue;
+                }
+                Temporary& previous(merged.back());
+                previous.size = std::max(previous.size, temporary.addr + temporary.size - previous.addr);
+                if(temporary.first < previous.first)
+                    previous.pos = temporary.pos;
+                previous.first = std::min(previous.first, temporary.first);
+                previous.last = std::max(previous.last, temporary.last);
+            }
+            temporaries.swap(merged);
+
+            // place them in order of first use, at the lowest offset free during their lifetime
+            std::vector<Temporary*> placed;
+            std::vector<Temporary*> order;
+            for(auto& temporary : temporaries)
+                order.push_back(&temporary);
+            std::stable_sort(order.begin(), order.end(),
+                             [](const Temporary* a, const Temporary* b) { return a->first < b->first; });
+            unsigned size = 0;
+            for(Temporary* temporary : order) {
+                temporary->offset = 0;
+                for(bool moved = true; moved;) {
+                    moved = false;
+                    for(const Temporary* other : placed) {
+                        if(temporary->overlaps(*other) && temporary->offset < other->offset + other->size &&
+                           other->offset < temporary->offset + temporary->size) {
+                            temporary->offset = other->offset + other->size;
+                            moved = true;
+                        }
+                    }
+                }
+                placed.push_back(temporary);
+                size = std::max(size, temporary->offset + temporary->size);
+                if(freeVariableIndex + size > target->variablesSize)
+                    throw TranslatableError(temporary->pos, ERROR_NOT_ENOUGH_TEMP_SPACE);
+            }
+
+            for(auto it = begin; it != end; ++it)
+                if(*it)
+                    relocate(*it);
+            return size;
+        }
+
+        //! Collect the temporary variables used by statement, in execution order
+        void collect(Node* statement) {
+            if(dynamic_cast<BlockNode*>(statement)) {
+                for(Node* child : statement->children)
+                    if(child)
+                        collect(child);
+            } else if(dynamic_cast<FoldedIfWhenNode*>(statement) || dynamic_cast<IfWhenNode*>(statement)) {
+                // the condition, then the blocks
+                const size_t conditionSize = dynamic_cast<FoldedIfWhenNode*>(statement) ? 2 : 1;
+                for(size_t i = 0; i < conditionSize; ++i)
+                    collectAccesses(statement->children[i], statement);
+                ++position;
+                for(size_t i = conditionSize; i < statement->children.size(); ++i)
+                    if(statement->children[i])
+                        collect(statement->children[i]);
+            } else if(dynamic_cast<FoldedWhileNode*>(statement) || dynamic_cast<WhileNode*>(statement)) {
+                // the variables used in a loop are live during all its iterations
+                const bool outermost = loopStart == NO_LOOP;
+                if(outermost) {
+                    loopStart = position;
+                    loopTemporaries = temporaries.size();
+                }
+                const size_t conditionSize = dynamic_cast<FoldedWhileNode*>(statement) ? 2 : 1;
+                for(size_t i = 0; i < conditionSize; ++i)
+                    collectAccesses(statement->children[i], statement);
+                ++position;
+                collect(statement->children[conditionSize]);
+                if(outermost) {
+                    for(size_t i = loopTemporaries; i < temporaries.size(); ++i) {
+                        temporaries[i].first = loopStart;
+                        temporaries[i].last = position - 1;
+                    }
+                    loopStart = NO_LOOP;
+                }
+            } else {
+                collectAccesses(statement, statement);
+                ++position;
+            }
+        }
+
+        //! Collect the temporary variables node and its children use, in statement
+        void collectAccesses(const Node* node, const Node* statement) {
+            if(auto* store = dynamic_cast<const StoreNode*>(node))
+                access(store->varAddr, 1, statement);
+            else if(auto* load = dynamic_cast<const LoadNode*>(node))
+                access(load->varAddr, 1, statement);
+            else if(auto* write = dynamic_cast<const ArrayWriteNode*>(node))
+                access(write->arrayAddr, write->arraySize, statement);
+            else if(auto* read = dynamic_cast<const ArrayReadNode*>(node))
+                access(read->arrayAddr, read->arraySize, statement);
+            else if(auto* nativeArg = dynamic_cast<const LoadNativeArgNode*>(node)) {
+                access(nativeArg->tempAddr, 1, statement);
+                access(nativeArg->arrayAddr, nativeArg->arraySize, statement);
+            } else if(auto* emit = dynamic_cast<const EmitNode*>(node)) {
+                if(emit->arraySize)
+                    access(emit->arrayAddr, emit->arraySize, statement);
+            } else if(auto* call = dynamic_cast<const CallNode*>(node)) {
+                for(size_t i = 0; i < call->children.size(); ++i) {
+                    const unsigned addr = argumentAddress(call->children[i]);
+                    if(addr == Node::E_NOVAL)
+                        continue;
+                    // a function may use the arguments of unknown size up to the last temporary variable
+                    const unsigned size = call->getArgumentSize(target, i);
+                    access(addr, size ? size : 0x8000 - addr, statement);
+                }
+            }
+            for(const Node* child : node->children)
+                if(child)
+                    collectAccesses(child, statement);
+        }
+
+        void access(unsigned addr, unsigned size, const Node* statement) {
+            if(addr < target->variablesSize || size == 0)
+                return;
+            Temporary temporary{addr, size, position, position, statement->sourcePos, 0};
+            if(loopStart != NO_LOOP)
+                temporary.first = loopStart;
+            temporaries.push_back(temporary);
+        }
+
+        //! Return the address of the variable passed as argument to a function, E_NOVAL if computed
+        //! at run time
+        unsigned argumentAddress(const Node* argument) const {
+            if(dynamic_cast<const BlockNode*>(argument))
+                argument = argument->children.back();
+            auto* immediate = dynamic_cast<const ImmediateNode*>(argument);
+            return immediate ? unsigned(immediate->value) : unsigned(Node::E_NOVAL);
+        }
+
+        //! Return the address where the variable at addr is packed
+        unsigned relocated(unsigned addr) const {
+            if(addr < target->variablesSize)
+                return addr;
+            auto it = std::upper_bound(temporaries.begin(), temporaries.end(), addr,
+                                       [](unsigned addr, const Temporary& temporary) { return addr < temporary.addr; });
+            assert(it != temporaries.begin());
+            --it;
+            assert(addr < it->addr + it->size);
+            return target->variablesSize - it->offset - it->size + (addr - it->addr);
+        }
+
+        //! Move the temporary variables node and its children use to where they are packed
+        void relocate(Node* node) {
+            if(auto* store = dynamic_cast<StoreNode*>(node))
+                store->varAddr = relocated(store->varAddr);
+            else if(auto* load = dynamic_cast<LoadNode*>(node))
+                load->varAddr = relocated(load->varAddr);
+            else if(auto* write = dynamic_cast<ArrayWriteNode*>(node))
+                write->arrayAddr = relocated(write->arrayAddr);
+            else if(auto* read = dynamic_cast<ArrayReadNode*>(node))
+                read->arrayAddr = relocated(read->arrayAddr);
+            else if(auto* nativeArg = dynamic_cast<LoadNativeArgNode*>(node)) {
+                nativeArg->tempAddr = relocated(nativeArg->tempAddr);
+                nativeArg->arrayAddr = relocated(nativeArg->arrayAddr);
+            } else if(auto* emit = dynamic_cast<EmitNode*>(node)) {
+                if(emit->arraySize)
+                    emit->arrayAddr = relocated(emit->arrayAddr);
+            } else if(dynamic_cast<CallNode*>(node)) {
+                for(Node* argument : node->children) {
+                    if(dynamic_cast<BlockNode*>(argument))
+                        argument = argument->children.back();
+                    if(auto* immediate = dynamic_cast<ImmediateNode*>(argument))
+                        immediate->value = relocated(immediate->value);
+                }
+            }
+            for(Node* child : node->children)
+                if(child)
+                    relocate(child);
+        }
+
+        static const unsigned NO_LOOP = unsigned(-1);
+
+        const TargetDescription* const target;  //!< target, for the size of its memory and its native functions
+        const unsigned freeVariableIndex;       //!< first variable after the ones of the program
+        std::vector<Temporary> temporaries;     //!< temporary variables of the block being packed
+        unsigned position{0};                   //!< position of the current statement in the block
+        unsigned loopStart{NO_LOOP};            //!< position of the outermost loop, if in one
+        size_t loopTemporaries{0};              //!< number of accesses collected before the outermost loop
+    };
+}  // namespace
+
+//! Move the temporary variables of program to the end of the variables, the ones not used at the same
+//! time sharing memory, and return the size of memory they use
+unsigned Compiler::packTemporaryVariables(Node* program, std::wostream* dump) {
+    auto* block = dynamic_cast<BlockNode*>(program);
+    assert(block);
+
+    const unsigned size = TemporariesPacker(targetDescription, freeVariableIndex).pack(block);
+    if(dump)
+        *dump << "Temporary variables packed in " << size << " words\n";
+    return size;
+}
+
+/*@}*/
+
+}  // namespace Aseba
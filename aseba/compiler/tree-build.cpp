@@ -18,8 +18,12 @@
 */
 
 #include "tree.h"
+#include "arena.h"
+#include <cstddef>
 #include <cstdlib>
 #include <iostream>
+#include <iterator>
+#include <set>
 #include <utility>
 
 
@@ -51,6 +55,25 @@ Node::~Node() {
     }
 }
 
+// nodes are prefixed with the arena they were allocated in, nullptr if allocated on the heap
+static const size_t nodeHeaderSize = alignof(std::max_align_t);
+
+void* Node::operator new(size_t size) {
+    Arena* arena = Arena::current();
+    auto* block = static_cast<char*>(arena ? arena->allocate(nodeHeaderSize + size)
+                                           : ::operator new(nodeHeaderSize + size));
+    *reinterpret_cast<Arena**>(block) = arena;
+    return block + nodeHeaderSize;
+}
+
+void Node::operator delete(void* p) {
+    if(!p)
+        return;
+    char* block = static_cast<char*>(p) - nodeHeaderSize;
+    if(!*reinterpret_cast<Arena**>(block))
+        ::operator delete(block);
+}
+
 Node* Node::deepCopy() const {
     Node* newCopy = shallowCopy();
     for(size_t i = 0; i < children.size(); i++)
@@ -168,6 +191,33 @@ MemoryVectorNode::MemoryVectorNode(const SourcePos& sourcePos, unsigned arrayAdd
 //! Constructor
 CallNode::CallNode(const SourcePos& sourcePos, unsigned funcId) : Node(sourcePos), funcId(funcId) {}
 
+//! Return the size of the argument at index for the functions of target, or 0 if it is not known
+unsigned CallNode::getArgumentSize(const TargetDescription* target, size_t index) const {
+    assert(funcId < target->nativeFunctions.size());
+    const auto& parameters(target->nativeFunctions[funcId].parameters);
+    if(index >= parameters.size())
+        return 0;
+    if(parameters[index].size > 0)
+        return parameters[index].size;
+
+    // templateArgs holds the sizes of the arguments of any size, then the ones of the templates used
+    size_t anySizeBefore = 0;
+    size_t anySizeCount = 0;
+    std::set<int> templates;
+    for(size_t i = 0; i < parameters.size(); ++i) {
+        if(parameters[i].size == 0) {
+            if(i < index)
+                ++anySizeBefore;
+            ++anySizeCount;
+        } else if(parameters[i].size < 0)
+            templates.insert(-parameters[i].size - 1);
+    }
+    size_t templateArg = anySizeBefore;
+    if(parameters[index].size < 0)
+        templateArg = anySizeCount + std::distance(templates.begin(), templates.find(-parameters[index].size - 1));
+    return templateArg < templateArgs.size() ? templateArgs[templateArg] : 0;
+}
+
 //! Constructor
 ArithmeticAssignmentNode::ArithmeticAssignmentNode(const SourcePos& sourcePos, AsebaBinaryOperator op, Node* left,
                                                    Node* right)
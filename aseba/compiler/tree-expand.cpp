@@ -23,6 +23,7 @@
 #include "common/utils/FormatableString.h"
 
 #include <cassert>
+#include <map>
 #include <memory>
 #include <iostream>
 
@@ -182,6 +183,120 @@ static bool matchNameInMemoryVector(const Node* root, std::wstring name) {
     return false;
 }
 
+/*
+ * helper function returning the node as a vector at a static address, or nullptr if it is not
+ */
+static const MemoryVectorNode* staticMemoryVector(const Node* node) {
+    auto* vector = dynamic_cast<const MemoryVectorNode*>(node);
+    if(vector && vector->isAddressStatic() && vector->getVectorAddr() != Node::E_NOVAL)
+        return vector;
+    return nullptr;
+}
+
+/*
+ * helper function to know if a node is a tuple, possibly nested, of identical immediate values,
+ * and get this value
+ */
+static bool isUniformTuple(const Node* node, int& value, bool& found) {
+    auto* immediate = dynamic_cast<const ImmediateNode*>(node);
+    if(immediate) {
+        if(found && immediate->value != value)
+            return false;
+        value = immediate->value;
+        found = true;
+        return true;
+    }
+    if(!dynamic_cast<const TupleVectorNode*>(node))
+        return false;
+    for(const auto child : node->children)
+        if(!isUniformTuple(child, value, found))
+            return false;
+    return found;
+}
+
+static bool isUniformTuple(const Node* node, int& value) {
+    bool found = false;
+    return dynamic_cast<const TupleVectorNode*>(node) && isUniformTuple(node, value, found);
+}
+
+/*
+ * helper function to know if 'root' can be computed element by element while writing the result
+ * into [addr, addr+size): every memory vector it reads must either be disjoint or start at addr
+ */
+static bool isElementWiseSafe(const Node* root, unsigned addr, unsigned size) {
+    auto* vector = dynamic_cast<const MemoryVectorNode*>(root);
+    if(vector) {
+        if(!staticMemoryVector(vector))
+            return false;
+        const unsigned vectorAddr = vector->getVectorAddr();
+        const unsigned vectorSize = vector->getVectorSize();
+        return vectorAddr == addr || vectorAddr + vectorSize <= addr || addr + size <= vectorAddr;
+    }
+
+    for(const auto child : root->children)
+        if(!isElementWiseSafe(child, addr, size))
+            return false;
+    return true;
+}
+
+/*
+ * helper function to know if 'node' is made of arithmetic on whole vectors and uniform tuples only
+ */
+static bool isLoopable(const Node* node) {
+    int value;
+    if(isUniformTuple(node, value) || staticMemoryVector(node))
+        return true;
+    if(!dynamic_cast<const BinaryArithmeticNode*>(node) && !dynamic_cast<const UnaryArithmeticNode*>(node))
+        return false;
+    for(const auto child : node->children)
+        if(!isLoopable(child))
+            return false;
+    return true;
+}
+
+/*
+ * helper function building the scalar expression of the element of a loopable 'node' whose index
+ * is in the variable at counterAddr
+ */
+static Node* loopElement(const Node* node, unsigned counterAddr) {
+    int value;
+    if(isUniformTuple(node, value))
+        return new ImmediateNode(node->sourcePos, value);
+
+    auto* vector = staticMemoryVector(node);
+    if(vector) {
+        // read through an array starting at the first element of the vector
+        auto* read = new ArrayReadNode(vector->sourcePos, vector->getVectorAddr(), vector->getVectorSize(),
+                                       vector->arrayName);
+        read->children.push_back(new LoadNode(vector->sourcePos, counterAddr));
+        return read;
+    }
+
+    Node* element = node->shallowCopy();
+    element->children.clear();
+    for(const auto child : node->children)
+        element->children.push_back(loopElement(child, counterAddr));
+    return element;
+}
+
+/*
+ * helper function to find a native function by name, checking the size of its parameters
+ */
+static bool findNative(const Compiler* compiler, const FunctionsMap& functionsMap, const std::wstring& name,
+                       const std::vector<int>& parameterSizes, unsigned& funcId) {
+    auto it = functionsMap.find(name);
+    if(it == functionsMap.end())
+        return false;
+    funcId = it->second;
+    const auto& parameters = compiler->getTargetDescription()->nativeFunctions[funcId].parameters;
+    if(parameters.size() != parameterSizes.size())
+        return false;
+    for(size_t i = 0; i < parameters.size(); i++)
+        if(parameters[i].size != parameterSizes[i])
+            return false;
+    return true;
+}
+
 //! This is the root node, take in charge the tree creation / deletion
 Node* ProgramNode::expandVectorialNodes(std::wostream* dump, Compiler* compiler, unsigned int index) {
     Node* newMe = Node::expandVectorialNodes(dump, compiler, index);
@@ -216,6 +331,19 @@ Node* AssignmentNode::expandVectorialNodes(std::wostream* dump, Compiler* compil
     // right vector can be anything
     Node* rightVector = children[1];
 
+    // large vectors are computed by a native function or a loop rather than unrolled,
+    // unless we are evaluating a constant expression without compiler
+    const unsigned threshold = compiler ? compiler->getVectorLoweringThreshold() : 0;
+    if(threshold && leftVector->getVectorSize() > 1 && leftVector->getVectorSize() >= threshold &&
+       staticMemoryVector(leftVector) &&
+       isElementWiseSafe(rightVector, leftVector->getVectorAddr(), leftVector->getVectorSize())) {
+        Node* lowered = expandToNativeCall(compiler, leftVector);
+        if(!lowered)
+            lowered = expandToLoop(compiler, leftVector);
+        if(lowered)
+            return lowered;
+    }
+
     // check if the left vector appears somewhere on the right side
     if(matchNameInMemoryVector(rightVector, leftVector->arrayName) && leftVector->getVectorSize() > 1) {
         // in such case, there is a risk of involuntary overwriting the content
@@ -246,6 +374,113 @@ Node* AssignmentNode::expandVectorialNodes(std::wostream* dump, Compiler* compil
     return block.release();
 }
 
+//! Return a call to a native function performing leftVector = children[1] element by element,
+//! or nullptr if there is no such function in the target
+Node* AssignmentNode::expandToNativeCall(Compiler* compiler, const MemoryVectorNode* leftVector) const {
+    static const std::map<AsebaBinaryOperator, std::wstring> binaryNatives = {
+        {ASEBA_OP_ADD, L"math.add"}, {ASEBA_OP_SUB, L"math.sub"}, {ASEBA_OP_MULT, L"math.mul"}};
+
+    const Node* rightVector = children[1];
+    const unsigned size = leftVector->getVectorSize();
+    std::vector<unsigned> arguments(1, leftVector->getVectorAddr());
+    std::unique_ptr<BlockNode> block(new BlockNode(sourcePos));
+    unsigned funcId;
+    int value;
+
+    // store a scalar argument in a temporary variable
+    auto addScalarArgument = [&](int scalar) {
+        const unsigned addr = compiler->allocateTemporaryMemory(sourcePos, 1);
+        block->children.push_back(
+            new AssignmentNode(sourcePos, new StoreNode(sourcePos, addr), new ImmediateNode(sourcePos, scalar)));
+        arguments.push_back(addr);
+    };
+
+    auto* binary = dynamic_cast<const BinaryArithmeticNode*>(rightVector);
+    const MemoryVectorNode* left = binary ? staticMemoryVector(binary->children[0]) : nullptr;
+    const MemoryVectorNode* right = binary ? staticMemoryVector(binary->children[1]) : nullptr;
+
+    if(staticMemoryVector(rightVector) &&
+       findNative(compiler, compiler->functionsMap, L"math.copy", {-1, -1}, funcId)) {
+        // dest = src
+        arguments.push_back(rightVector->getVectorAddr());
+    } else if(isUniformTuple(rightVector, value) &&
+              findNative(compiler, compiler->functionsMap, L"math.fill", {-1, 1}, funcId)) {
+        // dest = [value, ..., value]
+        addScalarArgument(value);
+    } else if(left && right && binaryNatives.find(binary->op) != binaryNatives.end() &&
+              findNative(compiler, compiler->functionsMap, binaryNatives.at(binary->op), {-1, -1, -1}, funcId)) {
+        // dest = src1 (op) src2
+        arguments.push_back(left->getVectorAddr());
+        arguments.push_back(right->getVectorAddr());
+    } else if(binary && (binary->op == ASEBA_OP_ADD || binary->op == ASEBA_OP_SUB) &&
+              findNative(compiler, compiler->functionsMap, L"math.addscalar", {-1, -1, 1}, funcId)) {
+        // dest = src + [value, ..., value] or src - [value, ..., value]
+        if(left && isUniformTuple(binary->children[1], value)) {
+            arguments.push_back(left->getVectorAddr());
+            addScalarArgument(binary->op == ASEBA_OP_ADD ? value : int16_t(-value));
+        } else if(right && binary->op == ASEBA_OP_ADD && isUniformTuple(binary->children[0], value)) {
+            arguments.push_back(right->getVectorAddr());
+            addScalarArgument(value);
+        } else
+            return nullptr;
+    } else
+        return nullptr;
+
+    auto* call = new CallNode(sourcePos, funcId);
+    for(const auto argument : arguments)
+        call->children.push_back(new ImmediateNode(sourcePos, argument));
+    call->templateArgs.push_back(size);
+    block->children.push_back(call);
+    return block.release();
+}
+
+//! Return a loop performing leftVector = children[1] element by element, or nullptr if
+//! children[1] is not made of whole vectors and uniform tuples only
+Node* AssignmentNode::expandToLoop(Compiler* compiler, const MemoryVectorNode* leftVector) const {
+    if(!isLoopable(children[1]))
+        return nullptr;
+
+    const unsigned size = leftVector->getVectorSize();
+    const unsigned counterAddr = compiler->allocateTemporaryMemory(sourcePos, 1);
+
+    /*
+        counter = 0
+        while counter < size do
+            left[counter] = element(counter)
+            counter = counter + 1
+        end
+    */
+    std::unique_ptr<BlockNode> block(new BlockNode(sourcePos));
+    block->children.push_back(
+        new AssignmentNode(sourcePos, new StoreNode(sourcePos, counterAddr), new ImmediateNode(sourcePos, 0)));
+
+    auto* whileNode = new WhileNode(sourcePos);
+    block->children.push_back(whileNode);
+    whileNode->children.push_back(new BinaryArithmeticNode(sourcePos, ASEBA_OP_SMALLER_THAN,
+                                                           new LoadNode(sourcePos, counterAddr),
+                                                           new ImmediateNode(sourcePos, size)));
+    auto* body = new BlockNode(sourcePos);
+    whileNode->children.push_back(body);
+
+    auto* write = new ArrayWriteNode(sourcePos, leftVector->getVectorAddr(), size, leftVector->arrayName);
+    write->children.push_back(new LoadNode(sourcePos, counterAddr));
+    body->children.push_back(new AssignmentNode(sourcePos, write, loopElement(children[1], counterAddr)));
+    body->children.push_back(new AssignmentNode(
+        sourcePos, new StoreNode(sourcePos, counterAddr),
+        new BinaryArithmeticNode(sourcePos, ASEBA_OP_ADD, new LoadNode(sourcePos, counterAddr),
+                                 new ImmediateNode(sourcePos, 1))));
+
+    return block.release();
+}
+
+//! Loops may have the multiplications of their counter replaced by variables incremented along with it
+Node* WhileNode::expandVectorialNodes(std::wostream* dump, Compiler* compiler, unsigned int index) {
+    Node* newMe = Node::expandVectorialNodes(dump, compiler, index);
+    if(compiler)
+        newMe = compiler->reduceLoopStrength(newMe, dump);
+    return newMe;
+}
+
 //! Expand to vector[index]
 Node* TupleVectorNode::expandVectorialNodes(std::wostream* dump, Compiler* compiler, unsigned int index) {
     size_t total = 0;
@@ -343,19 +343,12 @@ Node* BinaryArithmeticNode::optimize(std::wostream* dump) {
         }
     }
 
-    // POT mult/div to shift conversion
-    if(immediateRightChild && isPOT(immediateRightChild->value)) {
-        if(op == ASEBA_OP_MULT) {
-            op = ASEBA_OP_SHIFT_LEFT;
-            immediateRightChild->value = shiftFromPOT(immediateRightChild->value);
-            if(dump)
-                *dump << sourcePos.toWString() << L" multiplication transformed to left shift\n";
-        } else if(op == ASEBA_OP_DIV) {
-            op = ASEBA_OP_SHIFT_RIGHT;
-            immediateRightChild->value = shiftFromPOT(immediateRightChild->value);
-            if(dump)
-                *dump << sourcePos.toWString() << L" division transformed to right shift\n";
-        }
+    // POT mult to shift conversion, divisions round towards zero so are left to strength reduction
+    if(immediateRightChild && isPOT(immediateRightChild->value) && op == ASEBA_OP_MULT) {
+        op = ASEBA_OP_SHIFT_LEFT;
+        immediateRightChild->value = shiftFromPOT(immediateRightChild->value);
+        if(dump)
+            *dump << sourcePos.toWString() << L" multiplication transformed to left shift\n";
     }
 
     // detect static division by zero
@@ -24,6 +24,8 @@
 #include "common/consts.h"
 #include "common/utils/FormatableString.h"
 #include <vector>
+#include <map>
+#include <memory>
 #include <string>
 #include <ostream>
 #include <climits>
@@ -62,6 +64,10 @@ public:
     Node& operator=(Node&& rhs) = delete;
     //! Destructor, delete all children
     virtual ~Node();
+    //! Allocate nodes in the current arena if any, so that the syntax tree is released at once
+    static void* operator new(size_t size);
+    //! Release nodes allocated on the heap, the memory of nodes in an arena is released with it
+    static void operator delete(void* p);
     //! Return a shallow copy of the object (children point to the same objects)
     virtual Node* shallowCopy() const = 0;
     //! Return a deep copy of the object (children are also copied)
@@ -153,6 +159,8 @@ struct AssignmentNode : Node {
 
     void checkVectorSize() const override;
     Node* expandVectorialNodes(std::wostream* dump, Compiler* compiler = nullptr, unsigned int index = 0) override;
+    Node* expandToNativeCall(Compiler* compiler, const MemoryVectorNode* leftVector) const;
+    Node* expandToLoop(Compiler* compiler, const MemoryVectorNode* leftVector) const;
     ReturnType typeCheck(Compiler* compiler) override;
     Node* optimize(std::wostream* dump) override;
     void emit(PreLinkBytecode& bytecodes) const override;
@@ -228,6 +236,7 @@ struct WhileNode : Node {
         return new WhileNode(*this);
     }
 
+    Node* expandVectorialNodes(std::wostream* dump, Compiler* compiler = nullptr, unsigned int index = 0) override;
     void checkVectorSize() const override;
     ReturnType typeCheck(Compiler* compiler) override;
     Node* optimize(std::wostream* dump) override;
@@ -587,6 +596,7 @@ struct CallNode : Node {
     CallNode* shallowCopy() const override {
         return new CallNode(*this);
     }
+    unsigned getArgumentSize(const TargetDescription* target, size_t index) const;
 
     ReturnType typeCheck(Compiler*) override {
         return ReturnType::UNIT;
@@ -769,6 +779,34 @@ struct UnaryArithmeticAssignmentNode : AbstractTreeNode {
     }
 };
 
+//! A block of a program (the code before the first onevent or sub, an onevent or a sub), as kept
+//! by incremental compilation to be reused while the block and what it depends on do not change
+struct CompiledBlock {
+    std::unique_ptr<Node> tree;            //!< syntax tree after the expansion of abstract nodes, on the heap
+    unsigned row{0};                       //!< row of the first token of the block in tree and bytecode
+    unsigned id{0};                        //!< id of the event or of the subroutine
+    unsigned parseEndVariableIndex{0};     //!< temporary memory in use after parsing the block
+    unsigned expandStartVariableIndex{0};  //!< temporary memory in use before expanding the block
+    unsigned expandEndVariableIndex{0};    //!< temporary memory in use after expanding the block
+    unsigned temporariesSize{0};           //!< words of variables the temporary variables of the block use
+    BytecodeVector bytecode;               //!< code of the block, before fixup
+};
+
+//! Blocks of the last program compiled incrementally, and what their code depends on besides
+//! their tokens
+struct CompiledBlocks {
+    TargetDescription targetDescription;           //!< description of the target
+    CommonDefinitions commonDefinitions;           //!< events and constants
+    unsigned vectorLoweringThreshold{0};           //!< minimal size of vectorial assignments not to be unrolled
+    bool strengthReductionEnabled{false};          //!< whether arithmetic was rewritten into cheaper operations
+    bool dataflowOptimizationEnabled{false};       //!< whether values were propagated across statements
+    std::vector<std::wstring> subroutines;         //!< names of the subroutines of the program, in order
+    VariablesMap variablesMap;                     //!< variables, after the declarations of the program
+    Compiler::ConstantsMap constantsMap;           //!< constants, after the declarations of the program
+    unsigned freeVariableIndex{0};                 //!< first free variable after the declarations of the program
+    std::map<std::wstring, CompiledBlock> blocks;  //!< blocks by tokens
+};
+
 /*@}*/
 
 }  // namespace Aseba
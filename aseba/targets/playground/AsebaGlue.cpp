@@ -42,6 +42,17 @@ NamedRobot::NamedRobot(std::string robotName) : robotName(std::move(robotName))
 
 SingleVMNodeGlue::SingleVMNodeGlue(std::string robotName, int16_t nodeId) : NamedRobot(std::move(robotName)) {
     vm.nodeId = nodeId;
+#ifdef ASEBA_VM_THREADED
+    vm.threadedCode = nullptr;
+#endif  // ASEBA_VM_THREADED
+#ifdef ASEBA_VM_EVENT_TABLE
+    vm.eventTable = nullptr;
+    vm.eventTableSize = 0;
+#endif  // ASEBA_VM_EVENT_TABLE
+#ifdef ASEBA_VM_DIRTY_TRACKING
+    // robots write their sensors directly to the variables, so they keep diffing against variablesOld
+    vm.variablesDirty = nullptr;
+#endif  // ASEBA_VM_DIRTY_TRACKING
 }
 
 // RecvBufferNodeConnection
@@ -58,6 +58,12 @@ struct SingleVMNodeGlue : NamedRobot, AbstractNodeGlue {
     AsebaVMState vm;
     std::valarray<unsigned short> bytecode;
     std::valarray<signed short> stack;
+#ifdef ASEBA_VM_THREADED
+    std::valarray<AsebaVMThreadedInstr> threadedCode;
+#endif  // ASEBA_VM_THREADED
+#ifdef ASEBA_VM_EVENT_TABLE
+    std::valarray<AsebaVMEventEntry> eventTable;
+#endif  // ASEBA_VM_EVENT_TABLE
 
     SingleVMNodeGlue(std::string robotName, int16_t nodeId);
 };
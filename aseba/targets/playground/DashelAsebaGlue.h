@@ -22,6 +22,7 @@
 
 #include "AsebaGlue.h"
 #include "EnkiGlue.h"
+#include "transport/buffer/vm-buffer.h"
 #include <qzeroconf.h>
 #include <QTcpServer>
 #include <QTcpSocket>
@@ -78,9 +79,17 @@ public:
     }
 
 public:
-    void externalInputStep(double) {
+    void externalInputStep(double dt) {
         handleSingleMessageData();
+        m_elapsedTime += dt;
+#ifdef ASEBA_VM_SUBSCRIPTIONS
+        // push the variables the device manager subscribed to, the time in ms wraps around
+        AsebaPushSubscribedVariables(&this->vm, uint16_t(uint64_t(m_elapsedTime * 1000.)));
+#endif  // ASEBA_VM_SUBSCRIPTIONS
     }
+
+private:
+    double m_elapsedTime = 0;
 };
 
 
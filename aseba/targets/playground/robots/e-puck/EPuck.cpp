@@ -152,6 +152,15 @@ AsebaFeedableEPuck::AsebaFeedableEPuck(std::string robotName, int16_t nodeId)
     bytecode.resize(1024);
     vm.bytecode = &bytecode[0];
     vm.bytecodeSize = uint16_t(bytecode.size());
+#ifdef ASEBA_VM_THREADED
+    threadedCode.resize(bytecode.size());
+    vm.threadedCode = &threadedCode[0];
+#endif  // ASEBA_VM_THREADED
+#ifdef ASEBA_VM_EVENT_TABLE
+    eventTable.resize(bytecode.size() / 2);
+    vm.eventTable = &eventTable[0];
+    vm.eventTableSize = uint16_t(eventTable.size());
+#endif  // ASEBA_VM_EVENT_TABLE
 
     stack.resize(32);
     vm.stack = &stack[0];
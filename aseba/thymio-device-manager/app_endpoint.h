@@ -14,6 +14,9 @@
 #include "log.h"
 #include "app_token_manager.h"
 #include "system_sleep_manager.h"
+#include "error.h"
+#include "serialized_message_cache.h"
+#include "outbound_message_queue.h"
 #include "utils.h"
 #include <pugixml.hpp>
 
@@ -157,7 +160,7 @@ public:
             [this](boost::system::error_code ec, fb_message_ptr&& msg) { this->handle_handshake(ec, std::move(msg)); });
 
         // Subscribe to node change events
-        start_node_monitoring(registery());
+        start_node_monitoring(registery(), weak_from_this());
     }
 
     template <typename CB>
@@ -171,11 +174,46 @@ public:
     }
 
     void write_message(tagged_detached_flatbuffer&& buffer) {
-        m_queue.emplace(std::move(buffer));
-        if(m_queue.size() > 1 || m_protocol_version == 0)
+        write_message(std::make_shared<const tagged_detached_flatbuffer>(std::move(buffer)));
+    }
+
+    // The message may be shared with other endpoints, it is never modified
+    void write_message(serialized_message_cache::message_ptr message) {
+        if(!accept_message(*message))
             return;
+        m_outbound.push(std::move(message));
+        write_next();
+    }
 
-        base::do_write_message(m_queue.front().buffer);
+    // Write a message which can be coalesced with a pending one from the same source, or dropped
+    void write_telemetry(serialized_message_cache::message_ptr message, const void* source = nullptr) {
+        if(!accept_message(*message))
+            return;
+        m_outbound.push_telemetry(std::move(message), source);
+        write_next();
+    }
+
+    void write_variables(const void* source, serialized_message_cache::message_ptr message,
+                         const variables_map& variables, outbound_message_queue::variables_serializer serialize) {
+        if(!accept_message(*message))
+            return;
+        m_outbound.push_variables(source, std::move(message), variables, std::move(serialize));
+        write_next();
+    }
+
+    // Nothing is sent before the handshake, which is followed by the full list of nodes
+    bool accept_message(const tagged_detached_flatbuffer& message) const {
+        if(m_protocol_version != 0)
+            return true;
+        mLogTrace("Discarding {} sent before the handshake", EnumNameAnyMessage(message.tag));
+        return false;
+    }
+
+    void write_next() {
+        if(m_in_flight || m_outbound.empty())
+            return;
+        m_in_flight = m_outbound.pop();
+        base::do_write_message(m_in_flight->buffer);
     }
 
 
@@ -186,7 +224,6 @@ public:
         }
         read_message();  // queue the next read early
 
-
         mLogTrace("-> {}", EnumNameAnyMessage(msg.message_type()));
         switch(msg.message_type()) {
             case mobsya::fb::AnyMessage::DeviceManagerShutdownRequest: {
@@ -290,14 +327,19 @@ public:
             case mobsya::fb::AnyMessage::EnableThymio2PairingMode: {
                 auto req = msg.as<fb::EnableThymio2PairingMode>();
                 auto& service = boost::asio::use_service<wireless_configurator_service>(this->m_ctx);
-                if(service.is_enabled() == req->enable())
-                    break;
-                if(req->enable()) {
-                    service.wireless_dongles_changed.connect([this] { this->send_list_of_thymio2_dongles(); });
-                    service.enable();
-                } else {
-                    service.disable();
-                }
+                boost::asio::post(service.strand(), [&service, enable = req->enable(), ptr = weak_from_this()] {
+                    if(service.is_enabled() == enable)
+                        return;
+                    if(enable) {
+                        service.wireless_dongles_changed.connect([ptr] {
+                            if(auto that = ptr.lock())
+                                that->send_list_of_thymio2_dongles();
+                        });
+                        service.enable();
+                    } else {
+                        service.disable();
+                    }
+                });
                 break;
             }
 
@@ -306,31 +348,33 @@ public:
     }
 
     void handle_write(boost::system::error_code ec) {
-        mLogTrace("<- {} : {} ", EnumNameAnyMessage(m_queue.front().tag), ec.message());
+        mLogTrace("<- {} : {} ", EnumNameAnyMessage(m_in_flight->tag), ec.message());
         if(ec) {
             mLogError("handle_write : error {}", ec.message());
         }
-        m_queue.pop();
-        if(!m_queue.empty()) {
-            base::do_write_message(m_queue.front().buffer);
-        }
+        m_in_flight.reset();
+        write_next();
     }
 
     ~application_endpoint() {
-        mLogInfo("Stopping app endpoint");
+        mLogInfo("Stopping app endpoint ({} messages coalesced, {} dropped)", m_outbound.coalesced(),
+                 m_outbound.dropped());
 
 
         // Allow the system to go to sleep when no more apps are connected
         boost::asio::use_service<mobsya::system_sleep_manager>(m_ctx).app_disconnected();
 
+        // Slots track the endpoint: none of them is running on another strand once it is destroyed
+
         /* Disconnecting the node monotoring status before unlocking the nodes,
          * otherwise we would receive node status event during destroying the endpoint, leading to a crash */
         node_status_monitor::disconnect();
+        m_watch_nodes.clear();
 
         for(auto& p : m_locked_nodes) {
             auto ptr = p.second.lock();
             if(ptr) {
-                ptr->unlock(this);
+                boost::asio::post(ptr->strand(), [ptr, app = static_cast<void*>(this)] { ptr->unlock(app); });
             }
         }
     }
@@ -342,41 +386,76 @@ public:
         });
     }
 
+    // Variables and events updates are serialized by the first endpoint receiving them and
+    // the resulting buffer is shared with the others watching the same node or group.
+    // An update of 0 is specific to this endpoint and never shared.
+    // These slots are called on the strand of the node or group; what is needed of it is read there,
+    // the strand of the endpoint only queues the messages.
     void node_variables_changed(std::shared_ptr<aseba_node> node, const variables_map& map,
-                                const std::chrono::system_clock::time_point& timestamp) {
-        boost::asio::defer(this->m_strand, [that = this->shared_from_this(), node, map, timestamp]() {
-            that->do_node_variables_changed(node, map, timestamp);
+                                const std::chrono::system_clock::time_point& timestamp, uint64_t update) {
+        if(!node)
+            return;
+        auto message = message_cache().get(node.get(), update, [&] {
+            return serialize_changed_variables(*node, map, timestamp);
+        });
+        boost::asio::defer(this->m_strand, [that = this->shared_from_this(), node, id = node->uuid(), message, map,
+                                            timestamp]() {
+            that->write_variables(node.get(), message, map, [id, timestamp](const variables_map& variables) {
+                return serialize_changed_variables(id, variables, timestamp);
+            });
         });
     }
 
-    void group_variables_changed(std::shared_ptr<group> group, const variables_map& map) {
-        boost::asio::defer(this->m_strand, [that = this->shared_from_this(), group, map]() {
-            that->do_group_variables_changed(group, map);
+    void group_variables_changed(std::shared_ptr<group> group, const variables_map& map, uint64_t update) {
+        if(!group)
+            return;
+        auto message =
+            message_cache().get(group.get(), update, [&] { return serialize_changed_variables(*group, map); });
+        boost::asio::defer(this->m_strand, [that = this->shared_from_this(), group, id = group->uuid(), message,
+                                            map]() {
+            that->write_variables(group.get(), message, map, [id](const variables_map& variables) {
+                return serialize_changed_variables(id, variables);
+            });
         });
     }
 
     void node_emitted_events(std::shared_ptr<aseba_node> node, const variables_map& events,
-                             const std::chrono::system_clock::time_point& timestamp) {
-        boost::asio::defer(this->m_strand, [that = this->shared_from_this(), node, events, timestamp]() {
-            that->do_node_emitted_events(node, events, timestamp);
+                             const std::chrono::system_clock::time_point& timestamp, uint64_t update) {
+        if(!node)
+            return;
+        auto message = message_cache().get(node.get(), update, [&] {
+            return serialize_events(*node, events, timestamp);
+        });
+        boost::asio::defer(this->m_strand, [that = this->shared_from_this(), message]() {
+            that->write_telemetry(message);
         });
     }
 
     void events_description_changed(std::shared_ptr<group> group, const events_table& events) {
-        boost::asio::defer(this->m_strand, [that = this->shared_from_this(), group, events]() {
-            that->do_events_description_changed(group, events);
+        if(!group)
+            return;
+        auto message =
+            std::make_shared<const tagged_detached_flatbuffer>(serialize_events_descriptions(*group, events));
+        boost::asio::defer(this->m_strand, [that = this->shared_from_this(), message]() {
+            that->write_message(message);
         });
     }
 
     void scratchpad_changed(std::shared_ptr<group> group, const group::scratchpad& scratchpad) {
-        boost::asio::defer(this->m_strand, [that = this->shared_from_this(), group, scratchpad]() {
-            that->do_scratchpad_changed(group, scratchpad);
+        if(!group)
+            return;
+        auto message = std::make_shared<const tagged_detached_flatbuffer>(serialize_scratchpad(*group, scratchpad));
+        boost::asio::defer(this->m_strand, [that = this->shared_from_this(), message]() {
+            that->write_message(message);
         });
     }
 
     void node_execution_state_changed(std::shared_ptr<aseba_node> node, const aseba_node::vm_execution_state& state) {
-        boost::asio::defer(this->m_strand, [that = this->shared_from_this(), node, state]() {
-            that->do_node_execution_state_changed(node, state);
+        if(!node)
+            return;
+        auto message = std::make_shared<const tagged_detached_flatbuffer>(serialize_execution_state(*node, state));
+        boost::asio::defer(this->m_strand, [that = this->shared_from_this(), node, message]() {
+            that->write_telemetry(message, node.get());
         });
     }
 
@@ -407,44 +486,12 @@ private:
         }
     }
 
-    void do_node_variables_changed(std::shared_ptr<aseba_node> node, const variables_map& map,
-                                   const std::chrono::system_clock::time_point& timestamp) {
-        if(!node)
-            return;
-        write_message(serialize_changed_variables(*node, map, timestamp));
-    }
-
-    void do_group_variables_changed(std::shared_ptr<group> grp, const variables_map& map) {
-        if(!grp)
-            return;
-        write_message(serialize_changed_variables(*grp, map));
-    }
-
-    void do_node_emitted_events(std::shared_ptr<aseba_node> node, const variables_map& events,
-                                const std::chrono::system_clock::time_point& timestamp) {
-        if(!node)
-            return;
-        write_message(serialize_events(*node, events, timestamp));
-    }
-
-    void do_events_description_changed(std::shared_ptr<group> group, const events_table& events) {
-        write_message(serialize_events_descriptions(*group, events));
-    }
-
-    void do_scratchpad_changed(std::shared_ptr<group> group, const group::scratchpad& scratchpad) {
-        if(!group)
-            return;
-        write_message(serialize_scratchpad(*group, scratchpad));
-    }
-
-    void do_node_execution_state_changed(std::shared_ptr<aseba_node> node,
-                                         const aseba_node::vm_execution_state& state) {
-        if(!node)
-            return;
-        write_message(serialize_execution_state(*node, state));
+    serialized_message_cache& message_cache() {
+        return boost::asio::use_service<serialized_message_cache>(m_ctx);
     }
 
 
+    // Called on the strand of wireless_configurator_service
     void send_list_of_thymio2_dongles() {
         const auto& service = boost::asio::use_service<wireless_configurator_service>(this->m_ctx);
 
@@ -460,7 +507,7 @@ private:
                        });
         auto vecOffset = fb.CreateVector(offsets);
         auto offset = mobsya::fb::CreateThymio2WirelessDonglesChanged(fb, vecOffset);
-        write_message(wrap_fb(fb, offset));
+        post_message(wrap_fb(fb, offset));
     }
 
 
@@ -512,7 +559,9 @@ private:
             // error ?
             return;
         }
-        write_message(serialize_aseba_vm_description(request_id, *node, id));
+        boost::asio::post(node->strand(), [that = shared_from_this(), node, request_id, id] {
+            that->post_message(serialize_aseba_vm_description(request_id, *node, id));
+        });
     }
 
     void rename_node(uint32_t request_id, const aseba_node_registery::node_id& id, const std::string& new_name) {
@@ -522,7 +571,7 @@ private:
             write_message(create_error_response(request_id, fb::ErrorType::unknown_node));
             return;
         }
-        n->rename(new_name);
+        boost::asio::post(n->strand(), [n, new_name] { n->rename(new_name); });
         write_message(create_ack_response(request_id));
     }
 
@@ -532,14 +581,19 @@ private:
             write_message(create_error_response(request_id, fb::ErrorType::unknown_node));
             return;
         }
+        // Known as locked before the node changes its status, see do_node_changed
         m_locked_nodes[id] = node;
-        bool res = node->lock(this);
-        if(!res) {
-            m_locked_nodes.erase(id);
-            write_message(create_error_response(request_id, fb::ErrorType::node_busy));
-        } else {
-            write_message(create_ack_response(request_id));
-        }
+        boost::asio::post(node->strand(), [that = shared_from_this(), node, request_id, id] {
+            const bool res = node->lock(that.get());
+            boost::asio::post(that->m_strand, [that, request_id, id, res] {
+                if(!res) {
+                    that->m_locked_nodes.erase(id);
+                    that->write_message(create_error_response(request_id, fb::ErrorType::node_busy));
+                } else {
+                    that->write_message(create_ack_response(request_id));
+                }
+            });
+        });
     }
 
     void unlock_node(uint32_t request_id, const aseba_node_registery::node_id& id) {
@@ -554,11 +608,13 @@ private:
             write_message(create_error_response(request_id, fb::ErrorType::unknown_node));
             return;
         }
-        if(!node->unlock(this)) {
-            write_message(create_error_response(request_id, fb::ErrorType::node_busy));
-        } else {
-            write_message(create_ack_response(request_id));
-        }
+        boost::asio::post(node->strand(), [that = shared_from_this(), node, request_id] {
+            if(!node->unlock(that.get())) {
+                that->post_message(create_error_response(request_id, fb::ErrorType::node_busy));
+            } else {
+                that->post_message(create_ack_response(request_id));
+            }
+        });
     }
 
     void set_variables(uint32_t request_id, const aseba_node_registery::node_id& id, variables_map m) {
@@ -577,13 +633,15 @@ private:
             write_message(create_error_response(request_id, fb::ErrorType::unknown_node));
             return;
         }
-        auto err = grp->set_shared_variables(m);
-        if(err) {
-            mLogWarn("set_group_variables: invalid variables", id);
-            write_message(create_error_response(request_id, fb::ErrorType::unsupported_variable_type));
-            return;
-        }
-        write_message(create_ack_response(request_id));
+        boost::asio::post(grp->strand(), [that = shared_from_this(), grp, request_id, id, m = std::move(m)] {
+            auto err = grp->set_shared_variables(m);
+            if(err) {
+                mLogWarn("set_group_variables: invalid variables", id);
+                that->post_message(create_error_response(request_id, fb::ErrorType::unsupported_variable_type));
+                return;
+            }
+            that->post_message(create_ack_response(request_id));
+        });
     }
 
     void set_node_variables(uint32_t request_id, const aseba_node_registery::node_id& id, variables_map m) {
@@ -593,11 +651,14 @@ private:
             write_message(create_error_response(request_id, fb::ErrorType::unknown_node));
             return;
         }
-        auto err = n->set_node_variables(m, create_device_write_completion_cb(request_id));
-        if(err) {
-            mLogWarn("set_node_variables: invalid variables", id);
-            write_message(create_error_response(request_id, fb::ErrorType::unsupported_variable_type));
-        }
+        boost::asio::post(n->strand(), [that = shared_from_this(), n, request_id, id, m = std::move(m),
+                                         cb = create_device_write_completion_cb(request_id)]() mutable {
+            auto err = n->set_node_variables(m, std::move(cb));
+            if(err) {
+                mLogWarn("set_node_variables: invalid variables", id);
+                that->post_message(create_error_response(request_id, fb::ErrorType::unsupported_variable_type));
+            }
+        });
     }
 
     void set_events_table(uint32_t request_id, const aseba_node_registery::node_id& id, events_table events) {
@@ -607,13 +668,15 @@ private:
             write_message(create_error_response(request_id, fb::ErrorType::unknown_node));
             return;
         }
-        auto err = g->set_events_table(events);
-        if(err) {
-            mLogWarn("set_node_events_table: invalid events", id);
-            write_message(create_error_response(request_id, fb::ErrorType::unsupported_variable_type));
-        } else {
-            write_message(create_ack_response(request_id));
-        }
+        boost::asio::post(g->strand(), [that = shared_from_this(), g, request_id, id, events = std::move(events)] {
+            auto err = g->set_events_table(events);
+            if(err) {
+                mLogWarn("set_node_events_table: invalid events", id);
+                that->post_message(create_error_response(request_id, fb::ErrorType::unsupported_variable_type));
+            } else {
+                that->post_message(create_ack_response(request_id));
+            }
+        });
     }
 
     void emit_events(uint32_t request_id, const aseba_node_registery::node_id& id, group::properties_map m) {
@@ -623,7 +686,10 @@ private:
             write_message(create_error_response(request_id, fb::ErrorType::unknown_node));
             return;
         }
-        g->emit_events(m, create_device_write_completion_cb(request_id));
+        boost::asio::post(g->strand(),
+                          [g, m = std::move(m), cb = create_device_write_completion_cb(request_id)]() mutable {
+                              g->emit_events(m, std::move(cb));
+                          });
     }
 
     void compile_and_send_program(uint32_t request_id, const aseba_node_registery::node_id& id, vm_language language,
@@ -632,16 +698,18 @@ private:
         if(!n) {
             auto g = get_group(id);
             if(g) {
-                auto ec = g->load_code(program, language);
-                if(ec) {
-                    write_message(create_error_response(request_id, fb::ErrorType::unknown_error));
-                    return;
-                }
-                for(auto&& s : g->scratchpads()) {
-                    do_scratchpad_changed(g, s);
-                }
+                boost::asio::post(g->strand(), [that = shared_from_this(), g, request_id, program, language] {
+                    auto ec = g->load_code(program, language);
+                    if(ec) {
+                        that->post_message(create_error_response(request_id, fb::ErrorType::unknown_error));
+                        return;
+                    }
+                    for(auto&& s : g->scratchpads()) {
+                        that->post_message(serialize_scratchpad(*g, s));
+                    }
 
-                write_message(create_ack_response(request_id));
+                    that->post_message(create_ack_response(request_id));
+                });
                 return;
             }
         }
@@ -656,6 +724,12 @@ private:
                 auto that = ptr.lock();
                 if(!that)
                     return;
+                if(ec == boost::asio::error::operation_aborted ||
+                   ec == make_error_code(error_code::too_many_compilations)) {
+                    // Superseded by a newer request, or too many requests pending
+                    that->write_message(create_error_response(request_id, fb::ErrorType::node_busy));
+                    return;
+                }
                 if(ec) {
                     that->write_message(create_error_response(request_id, fb::ErrorType::unknown_node));
                     return;
@@ -663,11 +737,13 @@ private:
                 that->write_message(create_compilation_result_response(request_id, result));
             });
         };
-        if((int32_t(opts) & int32_t(fb::CompilationOptions::LoadOnTarget))) {
-            n->compile_and_send_program(language, program, callback);
-        } else {
-            n->compile_program(language, program, callback);
-        }
+        boost::asio::post(n->strand(), [n, language, program = std::move(program), callback, opts] {
+            if((int32_t(opts) & int32_t(fb::CompilationOptions::LoadOnTarget))) {
+                n->compile_and_send_program(language, program, callback);
+            } else {
+                n->compile_program(language, program, callback);
+            }
+        });
     }
 
     void set_vm_execution_state(uint32_t request_id, aseba_node_registery::node_id id,
@@ -683,7 +759,9 @@ private:
             write_message(create_error_response(request_id, fb::ErrorType::unknown_node));
             return;
         }
-        n->set_vm_execution_state(cmd, create_device_write_completion_cb(request_id));
+        boost::asio::post(n->strand(), [n, cmd, cb = create_device_write_completion_cb(request_id)]() mutable {
+            n->set_vm_execution_state(cmd, std::move(cb));
+        });
     }
 
     void set_breakpoints(uint32_t request_id, aseba_node_registery::node_id id, std::vector<breakpoint> breakpoints) {
@@ -704,7 +782,9 @@ private:
             });
         };
 
-        n->set_breakpoints(breakpoints, callback);
+        boost::asio::post(n->strand(), [n, breakpoints = std::move(breakpoints), callback]() mutable {
+            n->set_breakpoints(std::move(breakpoints), callback);
+        });
     }
 
     void update_node_scratchpad(uint32_t request_id, node_id id, std::string_view content,
@@ -719,7 +799,9 @@ private:
             write_message(create_error_response(request_id, fb::ErrorType::unknown_node));
             return;
         }
-        g->set_node_scratchpad(id, content, language);
+        boost::asio::post(g->strand(), [g, id, content = std::string(content), language] {
+            g->set_node_scratchpad(id, content, language);
+        });
         write_message(create_ack_response(request_id));
     }
 
@@ -731,8 +813,9 @@ private:
             write_message(create_error_response(request_id, fb::ErrorType::unknown_node));
             return;
         }
-        auto update_started = n->upgrade_firmware(
-            [ptr = shared_from_this(), request_id, id](boost::system::error_code err, double progresss, bool complete) {
+        auto progress = [ptr = shared_from_this(), request_id, id](boost::system::error_code err, double progresss,
+                                                                   bool complete) {
+            boost::asio::post(ptr->m_strand, [ptr, request_id, id, err, progresss, complete]() {
                 if(err) {
                     ptr->write_message(create_error_response(request_id, fb::ErrorType::unknown_error));
                     return;
@@ -746,12 +829,15 @@ private:
                         wrap_fb(builder, fb::CreateFirmwareUpgradeStatus(builder, request_id, node_offset, progresss)));
                 }
             });
-
-        if(!update_started) {
-            write_message(create_error_response(request_id, fb::ErrorType::unknown_error));
-        }
+        };
+        boost::asio::post(n->strand(), [that = shared_from_this(), n, request_id, progress] {
+            if(!n->upgrade_firmware(progress)) {
+                that->post_message(create_error_response(request_id, fb::ErrorType::unknown_error));
+            }
+        });
     }
 
+    // The dongle is configured on the strand of wireless_configurator_service, then the robot on its own
     void pair_thymio2_and_dongle(uint32_t request_id, node_id dongle_id, node_id robot_id, uint16_t network_id,
                                  uint8_t channel) {
 
@@ -762,33 +848,42 @@ private:
             return;
         }
         auto& service = boost::asio::use_service<wireless_configurator_service>(this->m_ctx);
-        tl::expected<std::reference_wrapper<const wireless_configurator_service::dongle>,
-                     wireless_configurator_service::configure_error>
-            res = service.configure_dongle(dongle_id, network_id, channel);
-        if(!res.has_value()) {
-            mLogWarn("pair_thymio2_and_dongle: writing dongle failed", robot_id);
-            write_message(create_error_response(request_id, fb::ErrorType::thymio2_pairing_write_dongle_failed));
-            return;
-        }
-        const auto& dongle = res->get();
+        boost::asio::post(service.strand(), [that = shared_from_this(), &service, node, request_id, dongle_id,
+                                             robot_id, network_id, channel] {
+            tl::expected<std::reference_wrapper<const wireless_configurator_service::dongle>,
+                         wireless_configurator_service::configure_error>
+                res = service.configure_dongle(dongle_id, network_id, channel);
+            if(!res.has_value()) {
+                mLogWarn("pair_thymio2_and_dongle: writing dongle failed", robot_id);
+                that->post_message(
+                    create_error_response(request_id, fb::ErrorType::thymio2_pairing_write_dongle_failed));
+                return;
+            }
+            const auto& dongle = res->get();
 
-        mLogTrace("New wireless settings: node id   = {}, network id = {}, channel: {}", dongle.node_id,
-                  dongle.network_id, dongle.channel);
+            mLogTrace("New wireless settings: node id   = {}, network id = {}, channel: {}", dongle.node_id,
+                      dongle.network_id, dongle.channel);
 
-        if(!node->set_rf_settings(dongle.network_id, node->native_id(), dongle.channel)) {
-            mLogWarn("pair_thymio2_and_dongle: writing robot failed", robot_id);
-            write_message(create_error_response(request_id, fb::ErrorType::thymio2_pairing_write_robot_failed));
-            return;
-        }
-        mLogTrace("New wireless setting for node: node id   = {}, network id = {}, channel = {}", node->native_id(),
-                  dongle.network_id, dongle.channel);
+            boost::asio::post(node->strand(), [that, node, request_id, robot_id, network_id = dongle.network_id,
+                                               channel = dongle.channel] {
+                if(!node->set_rf_settings(network_id, node->native_id(), channel)) {
+                    mLogWarn("pair_thymio2_and_dongle: writing robot failed", robot_id);
+                    that->post_message(
+                        create_error_response(request_id, fb::ErrorType::thymio2_pairing_write_robot_failed));
+                    return;
+                }
+                mLogTrace("New wireless setting for node: node id   = {}, network id = {}, channel = {}",
+                          node->native_id(), network_id, channel);
 
-        flatbuffers::FlatBufferBuilder builder;
-        write_message(wrap_fb(
-            builder,
-            fb::CreateThymio2WirelessDonglePairingResponse(builder, request_id, dongle.network_id, dongle.channel)));
+                flatbuffers::FlatBufferBuilder builder;
+                that->post_message(wrap_fb(
+                    builder, fb::CreateThymio2WirelessDonglePairingResponse(builder, request_id, network_id, channel)));
+            });
+        });
     }
 
+    // The current state is sent and the slots are connected on the strand of the node or of the group,
+    // so that no change is missed in between; the connections are then kept on the strand of the endpoint.
     void watch_node_or_group(uint32_t request_id, const aseba_node_registery::node_id& id, uint32_t flags) {
         auto group = registery().group_from_id(id);
         auto node = registery().node_from_id(id);
@@ -800,81 +895,143 @@ private:
            ((flags & uint32_t(fb::WatchableInfo::SharedVariables)) ||
             (flags & uint32_t(fb::WatchableInfo::SharedEventsDescription)) ||
             (flags & uint32_t(fb::WatchableInfo::Scratchpads)))) {
+            watch_group(id, group, flags);
+        }
+        if(node) {
+            watch_node(id, node, flags);
+        }
 
-            if(flags & uint32_t(fb::WatchableInfo::SharedVariables)) {
-                if(!m_watch_nodes[fb::WatchableInfo::SharedVariables].count(id)) {
-                    auto variables = group->shared_variables();
-                    this->group_variables_changed(group, variables);
-                    m_watch_nodes[fb::WatchableInfo::SharedVariables][id] = group->connect_to_variables_changes(
-                        std::bind(&application_endpoint::group_variables_changed, this, std::placeholders::_1,
-                                  std::placeholders::_2));
-                } else if(group->uuid() == id) {
-                    m_watch_nodes[fb::WatchableInfo::SharedVariables].erase(id);
-                }
-            }
+        write_message(create_ack_response(request_id));
+    }
 
-            if(flags & uint32_t(fb::WatchableInfo::SharedEventsDescription)) {
-                if(!m_watch_nodes[fb::WatchableInfo::SharedEventsDescription].count(id)) {
-                    auto events = group->get_events_table();
-                    this->events_description_changed(group, events);
+    using watch_connections = std::vector<std::pair<fb::WatchableInfo, boost::signals2::connection>>;
 
-                    m_watch_nodes[fb::WatchableInfo::SharedEventsDescription][id] =
-                        group->connect_to_events_description_changes(
-                            std::bind(&application_endpoint::events_description_changed, this, std::placeholders::_1,
-                                      std::placeholders::_2));
-                } else if(group->uuid() == id) {
-                    m_watch_nodes[fb::WatchableInfo::SharedEventsDescription].erase(id);
-                }
+    void watch_group(const aseba_node_registery::node_id& id, std::shared_ptr<group> group, uint32_t flags) {
+        std::vector<fb::WatchableInfo> watched;
+        for(auto info : {fb::WatchableInfo::SharedVariables, fb::WatchableInfo::SharedEventsDescription,
+                         fb::WatchableInfo::Scratchpads}) {
+            if(!(flags & uint32_t(info)))
+                continue;
+            auto& connections = m_watch_nodes[info];
+            if(!connections.count(id)) {
+                // connected by keep_watch_connections
+                connections.try_emplace(id);
+                watched.push_back(info);
+            } else if(group->uuid() == id) {
+                connections.erase(id);
             }
+        }
+        if(watched.empty())
+            return;
 
-            if(flags & uint32_t(fb::WatchableInfo::Scratchpads)) {
-                if(!m_watch_nodes[fb::WatchableInfo::Scratchpads].count(id)) {
-                    m_watch_nodes[fb::WatchableInfo::Scratchpads][id] = group->connect_to_scratchpad_updates(std::bind(
-                        &application_endpoint::scratchpad_changed, this, std::placeholders::_1, std::placeholders::_2));
-
-                    for(auto&& s : group->scratchpads()) {
-                        this->scratchpad_changed(group, s);
-                    }
-
-
-                } else if(group->uuid() == id) {
-                    m_watch_nodes[fb::WatchableInfo::Scratchpads].erase(id);
+        boost::asio::post(group->strand(), [that = shared_from_this(), id, group, watched] {
+            watch_connections connections;
+            for(auto info : watched) {
+                switch(info) {
+                    case fb::WatchableInfo::SharedVariables:
+                        that->group_variables_changed(group, group->shared_variables(), 0);
+                        connections.emplace_back(
+                            info, group->connect_to_variables_changes(
+                                      that->template tracked_slot<mobsya::group::variables_signal_t>(std::bind(
+                                          &application_endpoint::group_variables_changed, that.get(),
+                                          std::placeholders::_1, std::placeholders::_2, std::placeholders::_3))));
+                        break;
+                    case fb::WatchableInfo::SharedEventsDescription:
+                        that->events_description_changed(group, group->get_events_table());
+                        connections.emplace_back(
+                            info, group->connect_to_events_description_changes(
+                                      that->template tracked_slot<mobsya::group::events_signal_t>(
+                                          std::bind(&application_endpoint::events_description_changed, that.get(),
+                                                    std::placeholders::_1, std::placeholders::_2))));
+                        break;
+                    case fb::WatchableInfo::Scratchpads:
+                        connections.emplace_back(
+                            info, group->connect_to_scratchpad_updates(
+                                      that->template tracked_slot<mobsya::group::scratchpad_signal_t>(
+                                          std::bind(&application_endpoint::scratchpad_changed, that.get(),
+                                                    std::placeholders::_1, std::placeholders::_2))));
+                        for(auto&& s : group->scratchpads()) {
+                            that->scratchpad_changed(group, s);
+                        }
+                        break;
+                    default: break;
                 }
             }
+            that->keep_watch_connections(id, std::move(connections));
+        });
+    }
+
+    void watch_node(const aseba_node_registery::node_id& id, std::shared_ptr<aseba_node> node, uint32_t flags) {
+        const bool send_variables =
+            (flags & uint32_t(fb::WatchableInfo::Variables)) && !m_watch_nodes[fb::WatchableInfo::Variables].count(id);
+        for(auto info :
+            {fb::WatchableInfo::Variables, fb::WatchableInfo::Events, fb::WatchableInfo::VMExecutionState}) {
+            if(flags & uint32_t(info)) {
+                // connected, or connected again, by keep_watch_connections
+                m_watch_nodes[info].try_emplace(id);
+            } else {
+                m_watch_nodes[info].erase(id);
+            }
         }
-        if(node) {
+
+        boost::asio::post(node->strand(), [that = shared_from_this(), id, node, flags, send_variables] {
+            watch_connections connections;
             if(flags & uint32_t(fb::WatchableInfo::Variables)) {
-                if(!m_watch_nodes[fb::WatchableInfo::Variables].count(id)) {
-                    auto variables = node->variables();
-                    this->node_variables_changed(node, variables, std::chrono::system_clock::now());
+                if(send_variables) {
+                    that->node_variables_changed(node, node->variables(), std::chrono::system_clock::now(), 0);
                 }
-                m_watch_nodes[fb::WatchableInfo::Variables][id] = node->connect_to_variables_changes(
-                    std::bind(&application_endpoint::node_variables_changed, this, std::placeholders::_1,
-                              std::placeholders::_2, std::placeholders::_3));
-            } else {
-                m_watch_nodes[fb::WatchableInfo::Variables].erase(id);
+                connections.emplace_back(
+                    fb::WatchableInfo::Variables,
+                    node->connect_to_variables_changes(
+                        that->template tracked_slot<aseba_node::variables_watch_signal_t>(
+                            std::bind(&application_endpoint::node_variables_changed, that.get(), std::placeholders::_1,
+                                      std::placeholders::_2, std::placeholders::_3, std::placeholders::_4))));
             }
-
             if(flags & uint32_t(fb::WatchableInfo::Events)) {
-                m_watch_nodes[fb::WatchableInfo::Events][id] = node->connect_to_events(
-                    std::bind(&application_endpoint::node_emitted_events, this, std::placeholders::_1,
-                              std::placeholders::_2, std::placeholders::_3));
-            } else {
-                m_watch_nodes[fb::WatchableInfo::Events].erase(id);
+                connections.emplace_back(
+                    fb::WatchableInfo::Events,
+                    node->connect_to_events(that->template tracked_slot<aseba_node::events_watch_signal_t>(
+                        std::bind(&application_endpoint::node_emitted_events, that.get(), std::placeholders::_1,
+                                  std::placeholders::_2, std::placeholders::_3, std::placeholders::_4))));
             }
-
             if(flags & uint32_t(fb::WatchableInfo::VMExecutionState)) {
-                m_watch_nodes[fb::WatchableInfo::VMExecutionState][id] = node->connect_to_execution_state_changes(
-                    std::bind(&application_endpoint::node_execution_state_changed, this, std::placeholders::_1,
-                              std::placeholders::_2));
-                this->node_execution_state_changed(node, node->execution_state());
+                connections.emplace_back(
+                    fb::WatchableInfo::VMExecutionState,
+                    node->connect_to_execution_state_changes(
+                        that->template tracked_slot<aseba_node::vm_state_watch_signal_t>(
+                            std::bind(&application_endpoint::node_execution_state_changed, that.get(),
+                                      std::placeholders::_1, std::placeholders::_2))));
+                that->node_execution_state_changed(node, node->execution_state());
+            }
+            that->keep_watch_connections(id, std::move(connections));
+        });
+    }
 
-            } else {
-                m_watch_nodes[fb::WatchableInfo::VMExecutionState].erase(id);
+    // Keep the connections made on another strand, unless the watch was removed meanwhile
+    void keep_watch_connections(const aseba_node_registery::node_id& id, watch_connections&& connections) {
+        boost::asio::post(this->m_strand, [that = shared_from_this(), id, connections = std::move(connections)] {
+            for(auto&& [info, connection] : connections) {
+                auto it = that->m_watch_nodes[info].find(id);
+                if(it != that->m_watch_nodes[info].end()) {
+                    it->second = connection;
+                } else {
+                    connection.disconnect();
+                }
             }
-        }
+        });
+    }
 
-        write_message(create_ack_response(request_id));
+    // The slot is called on the strand of the node or group; tracking the endpoint keeps it alive while it runs
+    template <typename Signal, typename F>
+    typename Signal::slot_type tracked_slot(F&& f) {
+        return typename Signal::slot_type(std::forward<F>(f)).track_foreign(this->weak_from_this());
+    }
+
+    // Write a message from another strand
+    void post_message(tagged_detached_flatbuffer&& buffer) {
+        boost::asio::post(this->m_strand, [that = shared_from_this(),
+                                           message = std::make_shared<const tagged_detached_flatbuffer>(
+                                               std::move(buffer))] { that->write_message(message); });
     }
 
     aseba_node_registery& registery() {
@@ -968,15 +1125,16 @@ private:
 
     void start_sending_pings() {
         m_pings_timer.expires_from_now(boost::posix_time::milliseconds(2500));
-        m_pings_timer.async_wait([ptr = weak_from_this()](boost::system::error_code ec) {
-            if(ec)
-                return;
-            if(auto that = ptr.lock()) {
-                flatbuffers::FlatBufferBuilder builder;
-                that->write_message(wrap_fb(builder, fb::CreatePing(builder)));
-                that->start_sending_pings();
-            }
-        });
+        m_pings_timer.async_wait(
+            boost::asio::bind_executor(this->m_strand, [ptr = weak_from_this()](boost::system::error_code ec) {
+                if(ec)
+                    return;
+                if(auto that = ptr.lock()) {
+                    flatbuffers::FlatBufferBuilder builder;
+                    that->write_message(wrap_fb(builder, fb::CreatePing(builder)));
+                    that->start_sending_pings();
+                }
+            }));
     }
 
     std::shared_ptr<application_endpoint<Socket>> shared_from_this() {
@@ -989,7 +1147,8 @@ private:
 
     boost::asio::io_context& m_ctx;
     boost::asio::deadline_timer m_pings_timer;
-    std::queue<tagged_detached_flatbuffer> m_queue;
+    outbound_message_queue m_outbound;
+    serialized_message_cache::message_ptr m_in_flight;
     std::unordered_map<aseba_node_registery::node_id, std::weak_ptr<aseba_node>, boost::hash<boost::uuids::uuid>>
         m_locked_nodes;
     std::unordered_map<fb::WatchableInfo,
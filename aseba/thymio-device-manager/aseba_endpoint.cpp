@@ -3,6 +3,7 @@
 #include "aseba_property.h"
 #include "fw_update_service.h"
 #include "aseba_node_registery.h"
+#include <range/v3/view/transform.hpp>
 
 #ifdef MOBSYA_TDM_ENABLE_SERIAL
 #    include "serialacceptor.h"
@@ -23,8 +24,11 @@ void aseba_endpoint::destroy() {
     if(m_endpoint.is_empty())
         return;
     mLogInfo("Destroying endpoint");
-    std::for_each(std::begin(m_nodes), std::end(m_nodes), [](auto&& node) { node.second.node->disconnect(); });
-    boost::asio::post([ctx = &m_io_context]() {
+    // The last reference to the endpoint may be dropped on another strand, nodes are disconnected on theirs
+    std::for_each(std::begin(m_nodes), std::end(m_nodes), [this](auto&& node) {
+        boost::asio::dispatch(m_strand, [node = node.second.node] { node->disconnect(); });
+    });
+    boost::asio::post(m_io_context, [ctx = &m_io_context]() {
         auto& registery = boost::asio::use_service<aseba_node_registery>(*ctx);
         registery.unregister_expired_endpoints();
     });
@@ -65,7 +69,6 @@ aseba_endpoint::pointer aseba_endpoint::create_for_tcp(boost::asio::io_context&
 
 
 void aseba_endpoint::start() {
-
     auto& registery = boost::asio::use_service<aseba_node_registery>(m_io_context);
     registery.register_endpoint(shared_from_this());
 
@@ -157,90 +160,105 @@ void aseba_endpoint::emit_events(const group::properties_map& map, write_callbac
 
 void aseba_endpoint::read_aseba_message() {
     auto that = shared_from_this();
-    auto cb =
-        boost::asio::bind_executor(m_strand, [that](boost::system::error_code ec, std::shared_ptr<Aseba::Message> msg) {
-            that->handle_read(ec, msg);
-        });
-
-    variant_ns::visit(
-        overloaded{[](variant_ns::monostate&) {},
-                   [&cb](auto& underlying) { mobsya::async_read_aseba_message(underlying, std::move(cb)); }},
-        m_endpoint.ep());
+    auto cb = boost::asio::bind_executor(
+        m_strand, [that](boost::system::error_code ec, aseba_message_view msg) { that->handle_read(ec, msg); });
+
+    variant_ns::visit(overloaded{[](variant_ns::monostate&) {},
+                                 [this, &cb](auto& underlying) {
+                                     mobsya::async_read_aseba_message(underlying, m_read_buffer, std::move(cb));
+                                 }},
+                      m_endpoint.ep());
 }
 
-void aseba_endpoint::handle_read(boost::system::error_code ec, std::shared_ptr<Aseba::Message> msg) {
-    if(ec || !msg) {
-        if(!ec && !msg && !m_upgrading_firmware)
-            read_aseba_message();
-
-        mLogError("Error while reading aseba message {}", ec ? ec.message() : "Message corrupted");
+// msg is only valid until the next call to read_aseba_message
+void aseba_endpoint::handle_read(boost::system::error_code ec, const aseba_message_view& msg) {
+    if(ec) {
+        mLogError("Error while reading aseba message {}", ec.message());
         return;
     }
-    mLogTrace("Message received : '{}' {}", msg->message_name(), ec.message());
+    mLogTrace("Message received : {:#x} from {}", msg.type, msg.source);
 
-    auto node_id = msg->source;
+    auto node_id = msg.source;
     auto it = m_nodes.find(node_id);
     auto node = it == std::end(m_nodes) ? std::shared_ptr<aseba_node>{} : it->second.node;
 
-    if(msg->type < 0x8000) {
+    // Events and variables are read in place, other messages are decoded
+    std::shared_ptr<Aseba::Message> decoded;
+    bool corrupted = false;
+    if(msg.type < 0x8000) {
         auto timestamp = std::chrono::system_clock::now();
-        auto event = [this, &msg] { return get_event(msg->type); }();
-        if(event) {
-            on_event(static_cast<const Aseba::UserMessage&>(*msg), event->first, timestamp);
+        auto event = get_event(msg.type);
+        auto data = msg.event_data();
+        corrupted = !data;
+        if(event && data) {
+            on_event(msg.source, *data, event->first, timestamp);
+        }
+    } else if(!node && (msg.type == ASEBA_MESSAGE_NODE_PRESENT || msg.type == ASEBA_MESSAGE_DESCRIPTION)) {
+        decoded = msg.message();
+        if(!decoded) {
+            mLogError("Error while reading aseba message {}", "Message corrupted");
+            read_aseba_message();
+            return;
+        }
+        const auto protocol_version = (msg.type == ASEBA_MESSAGE_NODE_PRESENT) ?
+            static_cast<Aseba::NodePresent*>(decoded.get())->version :
+            static_cast<Aseba::Description*>(decoded.get())->protocolVersion;
+        node = aseba_node::create(m_io_context, m_strand, node_id, protocol_version, shared_from_this());
+        {
+            std::lock_guard<std::mutex> _(m_nodes_mutex);
+            it = m_nodes.insert({node_id, {node, std::chrono::steady_clock::now()}}).first;
         }
-    } else if(!node && (msg->type == ASEBA_MESSAGE_NODE_PRESENT || msg->type == ASEBA_MESSAGE_DESCRIPTION)) {
-        const auto protocol_version = (msg->type == ASEBA_MESSAGE_NODE_PRESENT) ?
-            static_cast<Aseba::NodePresent*>(msg.get())->version :
-            static_cast<Aseba::Description*>(msg.get())->protocolVersion;
-        it = m_nodes
-                 .insert({node_id,
-                          {aseba_node::create(m_io_context, node_id, protocol_version, shared_from_this()),
-                           std::chrono::steady_clock::now()}})
-                 .first;
-        node = it->second.node;
-        if(msg->type == ASEBA_MESSAGE_NODE_PRESENT) {
+        if(msg.type == ASEBA_MESSAGE_NODE_PRESENT) {
             node->get_description();
             read_aseba_message();
             return;
         }
     }
-    if(node) {
-        node->on_message(*msg);
+    if(node && !corrupted) {
+        if(decoded)
+            node->on_message(*decoded);
+        else
+            corrupted = !node->on_message(msg);
         // Update node status
         it->second.last_seen = std::chrono::steady_clock::now();
     }
+    if(corrupted)
+        mLogError("Error while reading aseba message {}", "Message corrupted");
     if(is_rebooting())
         return;
     read_aseba_message();
 }
 
 void aseba_endpoint::remove_node(node_id n) {
-    for(auto it = m_nodes.begin(); it != m_nodes.end();) {
+    for(auto it = m_nodes.begin(); it != m_nodes.end(); ++it) {
         const auto& info = it->second;
         if(info.node && info.node->uuid() == n) {
             info.node->disconnect();
+            std::lock_guard<std::mutex> _(m_nodes_mutex);
             m_nodes.erase(it);
             return;
         }
     }
 }
 
-
-void aseba_endpoint::on_event(const Aseba::UserMessage& event, const Aseba::EventDescription& def,
+void aseba_endpoint::on_event(uint16_t source, aseba_message_view::words data, const Aseba::EventDescription& def,
                               const std::chrono::system_clock::time_point& timestamp) {
     group::properties_map events;
-    auto it = m_nodes.find(event.source);
+    auto it = m_nodes.find(source);
     if(it == std::end(m_nodes))
         return;
 
     // create event list
-    auto p = detail::aseba_variable_from_range(event.data);
+    auto p = detail::aseba_variable_from_range(data | ranges::view::transform([](int16_t v) { return v; }));
     if((p.is_integral() && def.value != 1) || p.size() != std::size_t(def.value))
         return;
     events.insert(std::pair{Aseba::WStringToUTF8(def.name), p});
 
     // broadcast to other endpoints
-    group()->on_event_received(shared_from_this(), it->second.node->uuid(), events, timestamp);
+    if(auto g = group()) {
+        boost::asio::post(g->strand(), [g, that = shared_from_this(), source = it->second.node->uuid(), events,
+                                        timestamp] { g->on_event_received(that, source, events, timestamp); });
+    }
 
     // let the node handle the event (send to connected apps)
     it->second.node->on_event_received(events, timestamp);
@@ -294,6 +312,7 @@ void aseba_endpoint::schedule_nodes_health_check(boost::posix_time::time_duratio
                 mLogTrace("Node {} has been unresponsive for too long, disconnecting it!",
                           it->second.node->native_id());
                 info.node->set_status(aseba_node::status::disconnected);
+                std::lock_guard<std::mutex> _(m_nodes_mutex);
                 it = m_nodes.erase(it);
 
                 if(!is_wireless())
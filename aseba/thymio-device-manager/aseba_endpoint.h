@@ -1,5 +1,8 @@
 #pragma once
+#include <algorithm>
+#include <deque>
 #include <functional>
+#include <atomic>
 #include <memory>
 #include <unordered_map>
 #include <queue>
@@ -18,11 +21,17 @@
 
 namespace mobsya {
 
+/*
+ * The strand of an endpoint serializes the reads and writes of its device, and the work of its nodes,
+ * whose messages are read in place: the nodes share it.
+ * Groups, the registery and applications post what they need done to strand().
+ */
 class aseba_endpoint : public std::enable_shared_from_this<aseba_endpoint> {
 
 
 public:
     enum class endpoint_type { unknown, thymio, simulated_thymio, simulated_dummy_node };
+    using strand_type = aseba_node::strand_type;
 
     ~aseba_endpoint();
     void destroy();
@@ -33,13 +42,19 @@ public:
     using write_callback = std::function<void(boost::system::error_code)>;
 
     void set_group(std::shared_ptr<mobsya::group> g) {
+        std::lock_guard<std::mutex> _(m_nodes_mutex);
         m_group = g;
     }
 
     std::shared_ptr<mobsya::group> group() const {
+        std::lock_guard<std::mutex> _(m_nodes_mutex);
         return m_group;
     }
 
+    const strand_type& strand() const {
+        return m_strand;
+    }
+
 #ifdef MOBSYA_TDM_ENABLE_USB
     const usb_device& usb() const {
         return m_endpoint.usb();
@@ -109,6 +124,7 @@ public:
                           firmware_update_options options = firmware_update_options::no_option);
 
     std::vector<std::shared_ptr<aseba_node>> nodes() const {
+        std::lock_guard<std::mutex> _(m_nodes_mutex);
         std::vector<std::shared_ptr<aseba_node>> nodes;
         std::transform(m_nodes.begin(), m_nodes.end(), std::back_inserter(nodes),
                        [](auto&& pair) { return pair.second.node; });
@@ -120,29 +136,33 @@ public:
     void stop();
     void cancel_all_ops();
 
+    // Queue messages, in order; cb is called on the strand once they have all been written.
+    // Polling messages are overtaken by the others.
     template <typename CB = write_callback>
     void write_messages(std::vector<std::shared_ptr<Aseba::Message>>&& messages, CB&& cb = {}) {
         if(messages.empty())
             return;
-        std::unique_lock<std::mutex> _(m_msg_queue_lock);
+        std::unique_lock<std::mutex> lock(m_msg_queue_lock);
 
-        auto it = m_msg_queue.end();
-        for(; it != m_msg_queue.begin(); --it) {
-            if(it == m_msg_queue.end())
-                break;
-            if(it->first->type != ASEBA_MESSAGE_LIST_NODES && it->first->type != ASEBA_MESSAGE_GET_EXECUTION_STATE &&
-               it->first->type != ASEBA_MESSAGE_GET_CHANGED_VARIABLES)
-                break;
-        }
+        const bool low_priority = std::all_of(messages.begin(), messages.end(),
+                                              [](const auto& m) { return is_low_priority(*m); });
+        auto& queue = low_priority ? m_low_priority_msg_queue : m_msg_queue;
         for(auto&& m : messages) {
-            it = m_msg_queue.insert(it, {std::move(m), write_callback{}});
-        }
-        if(cb) {
-            it->second = std::move(cb);
+            queue.push_back({std::move(m), write_callback{}});
         }
-        if(m_msg_queue.size() > messages.size())
+        queue.back().cb = std::move(cb);
+        if(!m_msg_in_flight.empty() || m_write_scheduled)
             return;
-        write_next();
+        m_write_scheduled = true;
+        lock.unlock();
+
+        // Writes are started from the strand, where reads are too, as the device is not thread safe
+        boost::asio::dispatch(m_strand, [that = shared_from_this()] {
+            std::unique_lock<std::mutex> _(that->m_msg_queue_lock);
+            that->m_write_scheduled = false;
+            if(that->m_msg_in_flight.empty())
+                that->write_next();
+        });
     }
 
     template <typename CB = write_callback>
@@ -151,7 +171,7 @@ public:
     }
 
     void read_aseba_message();
-    void handle_read(boost::system::error_code ec, std::shared_ptr<Aseba::Message> msg);
+    void handle_read(boost::system::error_code ec, const aseba_message_view& msg);
     void remove_node(node_id n);
 
     const aseba_device* device() const {
@@ -200,41 +220,77 @@ private:
         return needs_health_check();
     }
 
+    struct queued_message {
+        std::shared_ptr<Aseba::Message> message;
+        write_callback cb;
+    };
+
+    // Messages sent periodically to poll the nodes
+    static bool is_low_priority(const Aseba::Message& message) {
+        return message.type == ASEBA_MESSAGE_LIST_NODES || message.type == ASEBA_MESSAGE_GET_EXECUTION_STATE ||
+            message.type == ASEBA_MESSAGE_GET_CHANGED_VARIABLES || message.type == ASEBA_MESSAGE_SUBSCRIBE_VARIABLES;
+    }
+
+    // Maximum size of a write gathering several messages.
+    // The wireless dongle has little buffering, so writes to it are kept within the largest Aseba packet.
+    std::size_t max_batched_write_size() const {
+        if(m_endpoint.is_wireless())
+            return ASEBA_MAX_OUTER_PACKET_SIZE;
+        if(m_endpoint.is_tcp())
+            return 16 * 1024;
+        return 4 * 1024;
+    }
+
     void handle_write(boost::system::error_code ec) {
-        if(m_msg_queue.empty())
-            return;
         std::unique_lock<std::mutex> _(m_msg_queue_lock);
-        mLogDebug("Message '{}' sent : {}", m_msg_queue.front().first->message_name(), ec.message());
+        if(m_msg_in_flight.empty())
+            return;
+        mLogDebug("{} messages sent, '{}' first : {}", m_msg_in_flight.size(),
+                  m_msg_in_flight.front().message->message_name(), ec.message());
         if(ec) {
-            m_msg_queue = {};
+            m_msg_in_flight.clear();
+            m_msg_queue.clear();
+            m_low_priority_msg_queue.clear();
             return;
         }
 
-        auto cb = m_msg_queue.front().second;
-        if(cb) {
-            boost::asio::post(m_io_context.get_executor(), std::bind(std::move(cb), ec));
+        for(auto&& m : m_msg_in_flight) {
+            if(m.cb) {
+                boost::asio::post(m_strand, std::bind(std::move(m.cb), ec));
+            }
         }
-        m_msg_queue.erase(m_msg_queue.begin());
+        m_msg_in_flight.clear();
         write_next();
     }
 
+    // Write as many queued messages as fit in a single write, the others first
     void write_next() {
-        if(is_rebooting() && m_msg_queue.empty()) {
+        if(m_upgrading_firmware || (m_msg_queue.empty() && m_low_priority_msg_queue.empty()))
             return;
-        }
 
-        if(!m_msg_queue.empty() && !m_upgrading_firmware) {
-            auto that = shared_from_this();
-            auto cb =
-                boost::asio::bind_executor(m_strand, [that](boost::system::error_code ec) { that->handle_write(ec); });
-
-            auto& message = *(m_msg_queue.front().first);
-            variant_ns::visit(overloaded{[](variant_ns::monostate&) {},
-                                         [&cb, &message](auto& underlying) {
-                                             mobsya::async_write_aseba_message(underlying, message, std::move(cb));
-                                         }},
-                              m_endpoint.ep());
+        const auto max_size = max_batched_write_size();
+        m_write_buffer.rawData.clear();
+        while(!m_msg_queue.empty() || !m_low_priority_msg_queue.empty()) {
+            auto& queue = m_msg_queue.empty() ? m_low_priority_msg_queue : m_msg_queue;
+            const auto size = m_write_buffer.rawData.size();
+            append_aseba_message(m_write_buffer, *queue.front().message);
+            if(!m_msg_in_flight.empty() && m_write_buffer.rawData.size() > max_size) {
+                m_write_buffer.rawData.resize(size);
+                break;
+            }
+            m_msg_in_flight.push_back(std::move(queue.front()));
+            queue.pop_front();
         }
+
+        auto that = shared_from_this();
+        auto cb = boost::asio::bind_executor(
+            m_strand, [that](boost::system::error_code ec, std::size_t) { that->handle_write(ec); });
+        const auto buffer = boost::asio::buffer(m_write_buffer.rawData.data(), m_write_buffer.rawData.size());
+        variant_ns::visit(overloaded{[](variant_ns::monostate&) {},
+                                     [&cb, &buffer](auto& underlying) {
+                                         boost::asio::async_write(underlying, buffer, std::move(cb));
+                                     }},
+                          m_endpoint.ep());
     }
 
     aseba_endpoint(boost::asio::io_context& io_context, aseba_device&& e, endpoint_type type = endpoint_type::thymio);
@@ -256,23 +312,30 @@ private:
     boost::system::error_code set_events_table(const group::events_table& events);
     boost::system::error_code set_shared_variables(const variables_map& map);
     void emit_events(const group::properties_map& map, write_callback&& cb);
-    void on_event(const Aseba::UserMessage& event, const Aseba::EventDescription& def,
+    void on_event(uint16_t source, aseba_message_view::words data, const Aseba::EventDescription& def,
                   const std::chrono::system_clock::time_point& timestamp);
 
     aseba_device m_endpoint;
-    boost::asio::strand<boost::asio::io_context::executor_type> m_strand;
+    strand_type m_strand;
     boost::asio::io_service& m_io_context;
     endpoint_type m_endpoint_type;
     std::string m_endpoint_name;
     std::mutex m_msg_queue_lock;
+    // guards m_nodes, only modified on the strand, and m_group, both read from other strands
+    mutable std::mutex m_nodes_mutex;
     std::unordered_map<aseba_node::node_id_t, node_info> m_nodes;
     std::shared_ptr<mobsya::group> m_group;
-    std::vector<std::pair<std::shared_ptr<Aseba::Message>, write_callback>> m_msg_queue;
+    std::deque<queued_message> m_msg_queue;
+    std::deque<queued_message> m_low_priority_msg_queue;
+    std::vector<queued_message> m_msg_in_flight;
+    Aseba::Message::SerializationBuffer m_write_buffer;
+    aseba_message_buffer m_read_buffer;
     Aseba::CommonDefinitions m_defs;
 
     node_id m_uuid;
 
-    bool m_upgrading_firmware = false;
+    std::atomic<bool> m_upgrading_firmware{false};
+    bool m_write_scheduled = false;
     bool m_first_ping = true;
     bool m_rebooting = false;
 };
@@ -5,23 +5,97 @@
 #include <aseba/common/msg/msg.h>
 #include <boost/endian/arithmetic.hpp>
 #include <boost/endian/conversion.hpp>
+#include <algorithm>
 #include <iostream>
+#include <type_traits>
+#include <utility>
+#include "aseba_message_view.h"
+#ifdef MOBSYA_TDM_ENABLE_USB
+#    include "usbdevice.h"
+#endif
 
 namespace mobsya {
 
 template <class AsyncReadStream, class Handler>
 class read_aseba_message_op;
 
-using read_aseba_message_op_cb_t = void(boost::system::error_code, std::shared_ptr<Aseba::Message>);
+/*
+ * Storage of async_read_aseba_message, kept from one read to the next.
+ * A read may receive several messages: the ones past the first are returned
+ * by the next reads without reading the stream again.
+ * The memory is reused, so reading a message does not allocate.
+ */
+class aseba_message_buffer {
+public:
+    static constexpr std::size_t header_size = 6;
+
+private:
+    template <class, class>
+    friend class read_aseba_message_op;
+
+    static constexpr std::size_t read_size = 1024;
+
+    const uint8_t* data() const {
+        return static_cast<const uint8_t*>(m_data.data().data());
+    }
+
+    uint16_t header_word(std::size_t offset) const {
+        return boost::endian::little_to_native(*reinterpret_cast<const uint16_t*>(data() + offset));
+    }
+
+    // Size of the message at the front of the buffer, header included, or 0 if it is not complete
+    std::size_t buffered_message_size() const {
+        if(m_data.size() < header_size)
+            return 0;
+        const std::size_t size = header_size + header_word(0);
+        return m_data.size() >= size ? size : 0;
+    }
+
+    // Number of bytes to read to complete the header or the message at the front of the buffer
+    std::size_t missing_bytes() const {
+        if(m_data.size() < header_size)
+            return header_size - m_data.size();
+        return header_size + header_word(0) - m_data.size();
+    }
+
+    // Return the message at the front of the buffer, which is consumed by the next read
+    aseba_message_view front(std::size_t size) {
+        m_message_size = size;
+        return aseba_message_view(header_word(2), header_word(4),
+                                  ranges::span<const uint8_t>(data() + header_size, std::ptrdiff_t(size - header_size)),
+                                  m_decode_buffer);
+    }
+
+    void consume_front() {
+        m_data.consume(std::exchange(m_message_size, 0));
+    }
+
+    boost::beast::flat_buffer m_data;
+    std::size_t m_message_size = 0;
+    Aseba::Message::SerializationBuffer m_decode_buffer;
+};
+
+// Streams complete a read with the bytes available, so reading past the next message lets one read
+// return all the messages received since the last one. usb_device completes reads once the buffers are
+// full and already buffers the packets it receives: it is only asked for the bytes of the next message.
+template <class AsyncReadStream>
+struct reads_available_bytes : std::true_type {};
+#ifdef MOBSYA_TDM_ENABLE_USB
+template <>
+struct reads_available_bytes<usb_device> : std::false_type {};
+#endif
 
+using read_aseba_message_op_cb_t = void(boost::system::error_code, aseba_message_view);
+
+// The message passed to the handler is valid until the next read with the same buffer
 template <class AsyncReadStream, class CompletionToken>
 BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, read_aseba_message_op_cb_t)
-async_read_aseba_message(AsyncReadStream& stream, CompletionToken&& token) {
+async_read_aseba_message(AsyncReadStream& stream, aseba_message_buffer& buffer, CompletionToken&& token) {
     static_assert(boost::beast::is_async_read_stream<AsyncReadStream>::value, "AsyncReadStream requirements not met");
 
     boost::asio::async_completion<CompletionToken, read_aseba_message_op_cb_t> init{token};
     read_aseba_message_op<AsyncReadStream, BOOST_ASIO_HANDLER_TYPE(CompletionToken, read_aseba_message_op_cb_t)>{
-        stream, std::forward<CompletionToken>(init.completion_handler)}();
+        stream, buffer, std::forward<CompletionToken>(init.completion_handler)}();
 
     return init.result.get();
 }
@@ -31,13 +105,10 @@ template <class AsyncReadStream, class Handler>
 class read_aseba_message_op {
     struct state {
         AsyncReadStream& stream;
-        uint16_t size = 0;
-        uint16_t source = 0;
-        uint16_t type = 0;
-        char headerBuffer[6];
-        Aseba::Message::SerializationBuffer dataBuffer;
+        aseba_message_buffer& buffer;
 
-        explicit state(Handler const&, AsyncReadStream& stream) : stream(stream) {}
+        explicit state(Handler const&, AsyncReadStream& stream, aseba_message_buffer& buffer)
+            : stream(stream), buffer(buffer) {}
     };
     boost::beast::handler_ptr<state, Handler> m_p;
 
@@ -46,8 +117,8 @@ public:
     read_aseba_message_op(read_aseba_message_op const&) = default;
 
     template <class DeducedHandler, class... Args>
-    read_aseba_message_op(AsyncReadStream& stream, DeducedHandler&& handler)
-        : m_p(std::forward<DeducedHandler>(handler), stream) {}
+    read_aseba_message_op(AsyncReadStream& stream, aseba_message_buffer& buffer, DeducedHandler&& handler)
+        : m_p(std::forward<DeducedHandler>(handler), stream, buffer) {}
 
     using allocator_type = boost::asio::associated_allocator_t<Handler>;
 
@@ -64,38 +135,38 @@ public:
 
     void operator()() {
         auto& state = *m_p;
-        return boost::asio::async_read(state.stream, boost::asio::buffer(state.headerBuffer),
-                                       boost::asio::transfer_exactly(6), std::move(*this));
+        state.buffer.consume_front();
+        // The message was received by a previous read
+        if(state.buffer.buffered_message_size() != 0) {
+            const auto executor = get_executor();
+            return boost::asio::post(executor,
+                                     boost::beast::bind_handler(std::move(*this), boost::system::error_code{}, 0));
+        }
+        read_some();
     }
 
     void operator()(boost::system::error_code ec, std::size_t bytes_transferred) {
         auto& state = *m_p;
-        if(!ec && bytes_transferred == 0)
-            return state.size == 0 ?
-                boost::asio::async_read(state.stream, boost::asio::buffer(state.headerBuffer),
-                                        boost::asio::transfer_exactly(6), std::move(*this)) :
-                boost::asio::async_read(state.stream, boost::asio::buffer(state.dataBuffer.rawData),
-                                        boost::asio::transfer_exactly(state.size), std::move(*this));
-
-        if(!ec && state.size == 0) {
-            assert(bytes_transferred == 6);
-            state.size = boost::endian::little_to_native(*reinterpret_cast<uint16_t*>(state.headerBuffer));
-            state.source = boost::endian::little_to_native(*reinterpret_cast<uint16_t*>(state.headerBuffer + 2));
-            state.type = boost::endian::little_to_native(*reinterpret_cast<uint16_t*>(state.headerBuffer + 4));
-            state.dataBuffer.rawData.resize(state.size);
-            if(state.size != 0)
-                return boost::asio::async_read(state.stream, boost::asio::buffer(state.dataBuffer.rawData),
-                                               boost::asio::transfer_exactly(state.size), std::move(*this));
-            // support empty messages
-            bytes_transferred = 0;
-        }
-        if(!ec && bytes_transferred == state.size) {
-            auto msg =
-                std::shared_ptr<Aseba::Message>(Aseba::Message::create(state.source, state.type, state.dataBuffer));
-            m_p.invoke(ec, std::move(msg));
+        if(ec) {
+            m_p.invoke(ec, aseba_message_view{});
             return;
         }
-        m_p.invoke(ec, std::shared_ptr<Aseba::Message>{});
+        state.buffer.m_data.commit(bytes_transferred);
+        const auto size = state.buffer.buffered_message_size();
+        if(size == 0)
+            return read_some();
+        auto msg = state.buffer.front(size);
+        m_p.invoke(ec, msg);
+    }
+
+private:
+    void read_some() {
+        auto& state = *m_p;
+        const auto missing = state.buffer.missing_bytes();
+        const auto size = reads_available_bytes<AsyncReadStream>::value ?
+            std::max(missing, aseba_message_buffer::read_size) :
+            missing;
+        state.stream.async_read_some(boost::asio::buffer(state.buffer.m_data.prepare(size)), std::move(*this));
     }
 };
 }  // namespace mobsya
@@ -0,0 +1,105 @@
+#pragma once
+#include <aseba/common/msg/msg.h>
+#include <boost/endian/arithmetic.hpp>
+#include <range/v3/span.hpp>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace mobsya {
+
+/*
+ * An Aseba message as read by async_read_aseba_message.
+ *
+ * The payload is not copied: it points into the buffer of the reader, and is only valid
+ * until the next read. Events and variables, which make most of the traffic, are read
+ * from it in place; the other messages are decoded into an Aseba::Message by message().
+ */
+class aseba_message_view {
+public:
+    // Words are little-endian and may not be aligned
+    using word = boost::endian::little_int16_t;
+    using words = ranges::span<const word>;
+
+    struct variables_area {
+        uint16_t start;
+        words variables;
+    };
+
+    aseba_message_view() = default;
+    aseba_message_view(uint16_t source, uint16_t type, ranges::span<const uint8_t> payload,
+                       Aseba::Message::SerializationBuffer& decode_buffer)
+        : source(source), type(type), payload(payload), m_decode_buffer(&decode_buffer) {}
+
+    uint16_t source = 0;
+    uint16_t type = 0;
+    ranges::span<const uint8_t> payload;
+
+    // The payload of an event, or nothing if its size is odd
+    std::optional<words> event_data() const {
+        return words_at(0);
+    }
+
+    // The payload of ASEBA_MESSAGE_VARIABLES
+    std::optional<variables_area> variables() const {
+        if(payload.size() < 2)
+            return {};
+        auto data = words_at(2);
+        if(!data)
+            return {};
+        return variables_area{uint16_t(read_word(0)), *data};
+    }
+
+    // Call f for each area of ASEBA_MESSAGE_CHANGED_VARIABLES.
+    // Return false, without calling f, if the message is malformed.
+    template <typename F>
+    bool for_each_changed_variables(F&& f) const {
+        if(!visit_changed_variables([](const variables_area&) {}))
+            return false;
+        visit_changed_variables(f);
+        return true;
+    }
+
+    // Decode the message, or return null if it is malformed
+    std::shared_ptr<Aseba::Message> message() const {
+        auto& buffer = *m_decode_buffer;
+        buffer.rawData.assign(payload.begin(), payload.end());
+        buffer.readPos = 0;
+        return std::shared_ptr<Aseba::Message>(Aseba::Message::create(source, type, buffer));
+    }
+
+private:
+    uint16_t read_word(std::size_t offset) const {
+        return uint16_t(payload[offset] | (payload[offset + 1] << 8));
+    }
+
+    std::optional<words> words_at(std::size_t offset) const {
+        if((payload.size() - offset) % 2 != 0)
+            return {};
+        return words(reinterpret_cast<const word*>(payload.data() + offset),
+                     std::ptrdiff_t((payload.size() - offset) / 2));
+    }
+
+    // Same layout as Aseba::ChangedVariables: a sequence of start, size, size words
+    template <typename F>
+    bool visit_changed_variables(F&& f) const {
+        std::size_t offset = 0;
+        while(offset + 4 <= std::size_t(payload.size())) {
+            const auto start = read_word(offset);
+            const std::size_t size = read_word(offset + 2);
+            offset += 4;
+            // Like Aseba::ChangedVariables, ignore an area whose data is missing
+            if(std::size_t(payload.size()) - offset < size * 2)
+                return offset == std::size_t(payload.size());
+            if(size != 0)
+                f(variables_area{start, words(reinterpret_cast<const word*>(payload.data() + offset),
+                                              std::ptrdiff_t(size))});
+            offset += size * 2;
+        }
+        return offset == std::size_t(payload.size());
+    }
+
+    Aseba::Message::SerializationBuffer* m_decode_buffer = nullptr;
+};
+
+}  // namespace mobsya
@@ -4,11 +4,23 @@
 #include <boost/beast/core/handler_ptr.hpp>
 #include <aseba/common/msg/msg.h>
 #include <boost/endian/arithmetic.hpp>
+#include <cstring>
 #include <iostream>
 #include "log.h"
 
 namespace mobsya {
 
+// Append msg, preceded by its header, to buffer
+inline void append_aseba_message(Aseba::Message::SerializationBuffer& buffer, const Aseba::Message& msg) {
+    const auto start = buffer.rawData.size();
+    buffer.add(uint16_t{0});
+    buffer.add(msg.source);
+    buffer.add(msg.type);
+    msg.serializeSpecific(buffer);
+    const uint16_t size = boost::endian::native_to_little(static_cast<uint16_t>(buffer.rawData.size() - start - 6));
+    std::memcpy(buffer.rawData.data() + start, &size, sizeof(size));
+}
+
 template <class AsyncWriteStream, class Handler>
 class write_aseba_message_op;
 
@@ -36,12 +48,7 @@ class write_aseba_message_op {
         Aseba::Message::SerializationBuffer buffer;
 
         explicit state(Handler const&, AsyncWriteStream& stream, const Aseba::Message& msg) : stream(stream) {
-            buffer.add(uint16_t{0});
-            buffer.add(msg.source);
-            buffer.add(msg.type);
-            msg.serializeSpecific(buffer);
-            uint16_t& size = *(reinterpret_cast<uint16_t*>(buffer.rawData.data()));
-            size = boost::endian::native_to_little(static_cast<uint16_t>(buffer.rawData.size()) - 6);
+            append_aseba_message(buffer, msg);
         }
     };
     boost::beast::handler_ptr<state, Handler> m_p;
@@ -82,16 +89,12 @@ public:
 template <class WriteStream>
 void write_aseba_message(WriteStream& stream, const Aseba::Message& msg, boost::system::error_code& ec) {
     Aseba::Message::SerializationBuffer buffer;
-    buffer.add(uint16_t{0});
-    buffer.add(msg.source);
-    buffer.add(msg.type);
-    msg.serializeSpecific(buffer);
-    uint16_t& size = *(reinterpret_cast<uint16_t*>(buffer.rawData.data()));
-    size = boost::endian::native_to_little(static_cast<uint16_t>(buffer.rawData.size()) - 6);
-    auto s = ::write(stream.native_handle(), buffer.rawData.data(), buffer.rawData.size());
-    if(s != size + 6)
+    append_aseba_message(buffer, msg);
+    const auto size = buffer.rawData.size();
+    auto s = ::write(stream.native_handle(), buffer.rawData.data(), size);
+    if(s < 0 || std::size_t(s) != size)
         ec = boost::asio::error::basic_errors::in_progress;
-    mLogDebug("{} : {} {}", s, size, errno);
+    mLogDebug("{} : {} {}", s, size - 6, errno);
     // fdatasync(stream.native_handle());
 
 
@@ -7,11 +7,17 @@
 #include "aesl_parser.h"
 #include "group.h"
 #include "aseba_property.h"
+#include "serialized_message_cache.h"
+#include "compilation_service.h"
+#include "compilation_cache.h"
 
 namespace mobsya {
 
 static const uint32_t MAX_FRIENDLY_NAME_SIZE = 30;
 
+// minimum time between two pushes of changed variables by nodes supporting subscriptions
+static const uint16_t VARIABLES_PUSH_PERIOD_MS = 50;
+
 const std::string& aseba_node::status_to_string(aseba_node::status s) {
     static std::array<std::string, 6> strs = {"connected", "available", "busy", "ready", "disconnected", "upgrading"};
     int i = int(s) - 1;
@@ -21,9 +27,10 @@ const std::string& aseba_node::status_to_string(aseba_node::status s) {
 }
 
 
-aseba_node::aseba_node(boost::asio::io_context& ctx, node_id_t id, uint16_t protocol_version,
+aseba_node::aseba_node(boost::asio::io_context& ctx, strand_type strand, node_id_t id, uint16_t protocol_version,
                        std::weak_ptr<mobsya::aseba_endpoint> endpoint)
     : m_id(id)
+    , m_strand(std::move(strand))
     , m_uuid(boost::uuids::random_generator()())
     , m_status(status::disconnected)
     , m_firmware_version(0)
@@ -34,11 +41,14 @@ aseba_node::aseba_node(boost::asio::io_context& ctx, node_id_t id, uint16_t prot
     , m_io_ctx(ctx)
     , m_variables_timer(ctx)
     , m_status_timer(ctx)
-    , m_resend_timer(ctx) {}
+    , m_resend_timer(ctx) {
+    m_compiler.setIncrementalCompilationEnabled(true);
+}
 
-std::shared_ptr<aseba_node> aseba_node::create(boost::asio::io_context& ctx, node_id_t id, uint16_t protocol_version,
+std::shared_ptr<aseba_node> aseba_node::create(boost::asio::io_context& ctx, strand_type strand, node_id_t id,
+                                               uint16_t protocol_version,
                                                std::weak_ptr<mobsya::aseba_endpoint> endpoint) {
-    auto node = std::make_shared<aseba_node>(ctx, id, protocol_version, std::move(endpoint));
+    auto node = std::make_shared<aseba_node>(ctx, std::move(strand), id, protocol_version, std::move(endpoint));
     node->set_status(status::connected);
     return node;
 }
@@ -68,20 +78,29 @@ bool aseba_node::is_wirelessly_connected() const {
     return false;
 }
 
+// Variables are read in place, other messages are decoded.
+// Return false if the message is corrupted.
+bool aseba_node::on_message(const aseba_message_view& msg) {
+    switch(msg.type) {
+        case ASEBA_MESSAGE_VARIABLES: return on_variables_message(msg);
+        case ASEBA_MESSAGE_CHANGED_VARIABLES: return on_changed_variables_message(msg);
+    }
+    // Events are handled by the endpoint
+    if(msg.type < 0x8000)
+        return true;
+    auto decoded = msg.message();
+    if(!decoded)
+        return false;
+    on_message(*decoded);
+    return true;
+}
+
 void aseba_node::on_message(const Aseba::Message& msg) {
     switch(msg.type) {
         case ASEBA_MESSAGE_DEVICE_INFO: {
             on_device_info(static_cast<const Aseba::DeviceInfo&>(msg));
             break;
         }
-        case ASEBA_MESSAGE_VARIABLES: {
-            on_variables_message(static_cast<const Aseba::Variables&>(msg));
-            break;
-        }
-        case ASEBA_MESSAGE_CHANGED_VARIABLES: {
-            on_variables_message(static_cast<const Aseba::ChangedVariables&>(msg));
-            break;
-        }
         case ASEBA_MESSAGE_EXECUTION_STATE_CHANGED: {
             on_execution_state_message(static_cast<const Aseba::ExecutionStateChanged&>(msg));
             break;
@@ -93,6 +112,9 @@ void aseba_node::on_message(const Aseba::Message& msg) {
         case ASEBA_MESSAGE_BREAKPOINT_SET_RESULT:
             on_breakpoint_set_result(static_cast<const Aseba::BreakpointSetResult&>(msg));
             break;
+        case ASEBA_MESSAGE_VARIABLES_SUBSCRIBED:
+            on_variables_subscribed(static_cast<const Aseba::VariablesSubscribed&>(msg));
+            break;
 
         case ASEBA_MESSAGE_DESCRIPTION:
         case ASEBA_MESSAGE_NAMED_VARIABLE_DESCRIPTION:
@@ -117,13 +139,11 @@ void aseba_node::set_status(status s) {
         case status::disconnected: registery.remove_node(shared_from_this()); break;
         default: registery.set_node_status(shared_from_this(), s); break;
     }
-    // When the status of a node change, reassign the scratchpad of the associated group
-    // because set_status can be called while the endpoint is being destroyed,
-    // we need to postpone the call
-    boost::asio::post(m_io_ctx, [g = group()]() {
-        if(g)
-            g->assign_scratchpads();
-    });
+    // When the status of a node change, reassign the scratchpad of the associated group,
+    // on the strand of the group
+    if(auto g = group()) {
+        boost::asio::post(g->strand(), [g] { g->assign_scratchpads(); });
+    }
 }
 
 bool aseba_node::lock(void* app) {
@@ -160,23 +180,48 @@ void aseba_node::write_messages(std::vector<std::shared_ptr<Aseba::Message>>&& m
     endpoint->write_messages(std::move(messages), std::move(cb));
 }
 
-void aseba_node::compile_program(fb::ProgrammingLanguage language, const std::string& program,
-                                 compilation_callback&& cb) {
-    Aseba::CommonDefinitions defs = endpoint()->aseba_compiler_definitions();
-    Aseba::TargetDescription desc = m_description;
-
-    Aseba::Compiler compiler;
-    compiler.setTargetDescription(&desc);
-    compiler.setCommonDefinitions(&defs);
+// Compilations run on the threads of compilation_service, with copies of the description
+// and definitions. A new compilation of a node supersedes the pending one of the same kind;
+// as nodes are locked by a single application, this only cancels requests from that application.
+// The compiler of the node is kept between compilations, so that only the blocks of the program
+// which changed are compiled again.
+// done is called on the strand of the node.
+void aseba_node::compile(fb::ProgrammingLanguage language, const std::string& program, int kind,
+                         std::function<void(boost::system::error_code, compiled_program)>&& done) {
+    auto& service = boost::asio::use_service<compilation_service>(m_io_ctx);
+    auto& cache = boost::asio::use_service<compilation_cache>(m_io_ctx);
+    auto defs = endpoint()->aseba_compiler_definitions();
+    auto key = compilation_cache::make_key(language, program, m_description, defs);
+
+    if(auto cached = cache.find(key)) {
+        service.supersede({this, kind});
+        boost::asio::post(m_strand, [done = std::move(done), cached]() { done({}, *cached); });
+        return;
+    }
 
+    auto job = [that = shared_from_this(), &cache, key = std::move(key), defs = std::move(defs),
+                desc = m_description, language, program]() mutable {
+        std::lock_guard<std::mutex> lock(that->m_compiler_mutex);
+        Aseba::Compiler& compiler = that->m_compiler;
+        compiler.setTargetDescription(&desc);
+        compiler.setCommonDefinitions(&defs);
+        compiled_program compiled;
+        compiled.result = that->do_compile_program(compiler, defs, language, program, compiled.bytecode);
+        compiled.variables = *compiler.getVariablesMap();
+        if(compiled.result)
+            cache.insert(std::move(key), compiled);
+        return compiled;
+    };
+    service.compile({this, kind}, std::move(job), boost::asio::bind_executor(m_strand, std::move(done)));
+}
 
-    Aseba::BytecodeVector bytecode;
-    auto result = do_compile_program(compiler, defs, language, program, bytecode);
-    if(!result)
-        boost::asio::post(m_io_ctx.get_executor(), std::bind(std::move(cb), result.error(), compilation_result{}));
-    else
-        boost::asio::post(m_io_ctx.get_executor(),
-                          std::bind(std::move(cb), boost::system::error_code{}, result.value()));
+void aseba_node::compile_program(fb::ProgrammingLanguage language, const std::string& program,
+                                 compilation_callback&& cb) {
+    compile(language, program, 0, [cb = std::move(cb)](boost::system::error_code ec, compiled_program compiled) {
+        if(!ec && !compiled.result)
+            ec = compiled.result.error();
+        cb(ec, ec ? compilation_result{} : compiled.result.value());
+    });
 }
 
 void aseba_node::compile_and_send_program(fb::ProgrammingLanguage language, const std::string& program,
@@ -184,28 +229,32 @@ void aseba_node::compile_and_send_program(fb::ProgrammingLanguage language, cons
     m_breakpoints.clear();
     cancel_pending_step_request();
     cancel_pending_breakpoint_request();
-    Aseba::Compiler compiler;
-    Aseba::CommonDefinitions defs = endpoint()->aseba_compiler_definitions();
 
-    compiler.setTargetDescription(&m_description);
-    compiler.setCommonDefinitions(&defs);
-    auto result = do_compile_program(compiler, defs, language, program, m_bytecode);
-    if(!result) {
-        cb(result.error(), {});
-        return;
-    }
-    std::vector<std::shared_ptr<Aseba::Message>> messages;
-    Aseba::sendBytecode(messages, native_id(), std::vector<uint16_t>(m_bytecode.begin(), m_bytecode.end()));
-    reset_known_variables(*compiler.getVariablesMap());
-    write_messages(std::move(messages),
-                   [that = shared_from_this(), cb = std::move(cb), result](boost::system::error_code ec) {
-                       if(ec)
-                           cb(ec, result.value());
-                       else
-                           that->m_callbacks_pending_execution_state_change.push(std::bind(cb, ec, result.value()));
-                   });
+    compile(language, program, 1,
+            [that = shared_from_this(), cb = std::move(cb)](boost::system::error_code ec,
+                                                            compiled_program compiled) mutable {
+                if(!ec && !compiled.result)
+                    ec = compiled.result.error();
+                if(ec) {
+                    cb(ec, {});
+                    return;
+                }
+                that->send_compiled_program(std::move(compiled), std::move(cb));
+            });
+}
+
+void aseba_node::send_compiled_program(compiled_program&& compiled, compilation_callback&& cb) {
+    m_bytecode = std::move(compiled.bytecode);
+    reset_known_variables(compiled.variables);
+    write_bytecode([that = shared_from_this(), cb = std::move(cb),
+                    result = compiled.result.value()](boost::system::error_code ec) {
+        if(ec)
+            cb(ec, result);
+        else
+            that->m_callbacks_pending_execution_state_change.push(std::bind(cb, ec, result));
+    });
 
-    m_variables_changed_signal(shared_from_this(), this->variables(), std::chrono::system_clock::now());
+    signal_variables_changed(this->variables());
 }
 
 tl::expected<aseba_node::compilation_result, boost::system::error_code>
@@ -255,10 +304,24 @@ void aseba_node::compile_and_send_aseba_command(const std::string& program) {
 
     compiler.compile(is, m_bytecode, allocatedVariablesCount, error);
 
-    std::vector<std::shared_ptr<Aseba::Message>> messages;
-    Aseba::sendBytecode(messages, native_id(), std::vector<uint16_t>(m_bytecode.begin(), m_bytecode.end()));
+    write_bytecode();
+}
 
-    write_messages(std::move(messages));
+// Only the parts of the bytecode differing from the image loaded last are sent, each SetBytecode
+// resetting the node. The whole bytecode is sent if that image is unknown, or if it is the same:
+// uploading a program again then repairs the image, should a message have been lost.
+void aseba_node::write_bytecode(write_callback&& cb) {
+    std::vector<uint16_t> bytecode(m_bytecode.begin(), m_bytecode.end());
+    std::vector<std::shared_ptr<Aseba::Message>> messages;
+    if(!m_loaded_bytecode || !Aseba::sendBytecodeChanges(messages, native_id(), *m_loaded_bytecode, bytecode))
+        Aseba::sendBytecode(messages, native_id(), bytecode);
+    m_loaded_bytecode = std::move(bytecode);
+    write_messages(std::move(messages), [that = shared_from_this(), cb = std::move(cb)](boost::system::error_code ec) {
+        if(ec)
+            that->m_loaded_bytecode.reset();
+        if(cb)
+            cb(ec);
+    });
 }
 
 void aseba_node::set_vm_execution_state(vm_execution_state_command state, write_callback&& cb) {
@@ -284,9 +347,11 @@ void aseba_node::set_vm_execution_state(vm_execution_state_command state, write_
             write_message(std::make_shared<Aseba::Step>(native_id()), std::move(cb));
             break;
         case vm_execution_state_command::Suspend:
+            m_loaded_bytecode.reset();
             write_message(std::make_shared<Aseba::Sleep>(native_id()), std::move(cb));
             break;
         case vm_execution_state_command::Reboot:
+            m_loaded_bytecode.reset();
             write_message(std::make_shared<Aseba::Reboot>(native_id()), std::move(cb));
             break;
         case vm_execution_state_command::WriteProgramToDeviceMemory:
@@ -300,14 +365,14 @@ void aseba_node::schedule_execution_state_update() {
     request_execution_state();
     m_status_timer.expires_from_now(boost::posix_time::seconds(1));
     std::weak_ptr<aseba_node> ptr = shared_from_this();
-    m_status_timer.async_wait([ptr](boost::system::error_code ec) {
+    m_status_timer.async_wait(boost::asio::bind_executor(m_strand, [ptr](boost::system::error_code ec) {
         if(ec)
             return;
         auto that = ptr.lock();
         if(!that || that->get_status() == status::disconnected)
             return;
         that->schedule_execution_state_update();
-    });
+    }));
 }
 
 void aseba_node::request_execution_state() {
@@ -533,7 +598,7 @@ aseba_node::vm_execution_state aseba_node::execution_state() const {
 
 void aseba_node::on_event_received(const std::unordered_map<std::string, property>& events,
                                    const std::chrono::system_clock::time_point& timestamp) {
-    m_events_signal(shared_from_this(), events, timestamp);
+    m_events_signal(shared_from_this(), events, timestamp, serialized_message_cache::next_update());
 }
 
 
@@ -558,7 +623,7 @@ boost::system::error_code aseba_node::set_node_variables(const variables_map& ma
 
     write_messages(std::move(messages), std::move(cb));
     if(!modified.empty()) {
-        m_variables_changed_signal(shared_from_this(), modified, std::chrono::system_clock::now());
+        signal_variables_changed(modified);
     }
     return {};
 }
@@ -603,14 +668,15 @@ void aseba_node::request_device_info() {
     write_message(std::make_shared<Aseba::GetDeviceInfo>(native_id(), DEVICE_INFO_UUID));
 
     m_resend_timer.expires_from_now(boost::posix_time::seconds(1));
-    m_resend_timer.async_wait([ptr = weak_from_this()](boost::system::error_code ec) {
-        if(ec)
-            return;
-        auto that = ptr.lock();
-        if(!that)
-            return;
-        that->request_device_info();
-    });
+    m_resend_timer.async_wait(
+        boost::asio::bind_executor(m_strand, [ptr = weak_from_this()](boost::system::error_code ec) {
+            if(ec)
+                return;
+            auto that = ptr.lock();
+            if(!that)
+                return;
+            that->request_device_info();
+        }));
 }
 
 // ask the node to dump its memory.
@@ -620,7 +686,23 @@ void aseba_node::request_variables() {
     messages.reserve(3);
 
     {
-        if(!m_resend_all_variables && m_description.protocolVersion >= 7) {
+        if(!m_resend_all_variables && m_description.protocolVersion >= ASEBA_SUBSCRIBE_VARIABLES_PROTOCOL_VERSION) {
+            // subscribing again acts as a keep-alive in case the node rebooted or the message was dropped
+            std::vector<Aseba::SubscribeVariables::Range> ranges;
+            if(!m_variables.empty()) {
+                const uint16_t start = m_variables.front().start;
+                unsigned end = start;
+                for(const auto& var : m_variables)
+                    end = std::max(end, unsigned(var.start + var.size));
+                ranges.emplace_back(start, uint16_t(end - start));
+            }
+            messages.emplace_back(
+                std::make_shared<Aseba::SubscribeVariables>(native_id(), VARIABLES_PUSH_PERIOD_MS, std::move(ranges)));
+            // poll until the node acknowledges that it pushes its changes
+            if(!m_variables_pushed)
+                messages.emplace_back(std::make_shared<Aseba::GetChangedVariables>(native_id()));
+            m_variables_subscribed = true;
+        } else if(!m_resend_all_variables && m_description.protocolVersion >= 7) {
             messages.emplace_back(std::make_shared<Aseba::GetChangedVariables>(native_id()));
         } else {
             uint16_t start = 0;
@@ -641,6 +723,22 @@ void aseba_node::request_variables() {
     write_messages(std::move(messages));
 }
 
+void aseba_node::unsubscribe_variables() {
+    write_message(std::make_shared<Aseba::SubscribeVariables>(native_id(), 0,
+                                                              std::vector<Aseba::SubscribeVariables::Range>{}));
+    m_variables_subscribed = false;
+    m_variables_pushed = false;
+}
+
+void aseba_node::on_variables_subscribed(const Aseba::VariablesSubscribed& msg) {
+    // an acknowledgement of an unsubscription, or of ranges all outside the variables, pushes nothing
+    if(!m_variables_subscribed || msg.ranges.empty())
+        return;
+    if(!m_variables_pushed)
+        mLogTrace("Node {} pushes its variables every {} ms", native_id(), msg.period);
+    m_variables_pushed = true;
+}
+
 void aseba_node::reset_known_variables(const Aseba::VariablesMap& variables) {
 
     // Set all the variables to null
@@ -664,69 +762,106 @@ void aseba_node::reset_known_variables(const Aseba::VariablesMap& variables) {
         }
     }
 
+    m_changed_variables.clear();
+    m_changed_variables.reserve(m_variables.size());
+
     // Signal the removed variables to watching applications
-    m_variables_changed_signal(shared_from_this(), removed, std::chrono::system_clock::now());
+    signal_variables_changed(removed);
 
     // Ask the device for all variables
     // This will sync up the value of non-removed variables
     m_resend_all_variables = true;
 }
 
-void aseba_node::on_variables_message(const Aseba::Variables& msg) {
-    variables_map changed;
-    set_variables(msg.start, msg.variables, changed);
-    m_variables_changed_signal(shared_from_this(), changed, std::chrono::system_clock::now());
+bool aseba_node::on_variables_message(const aseba_message_view& msg) {
+    auto area = msg.variables();
+    if(!area)
+        return false;
+    set_variables(area->start, area->variables);
+    notify_changed_variables();
     schedule_variables_update();
+    return true;
 }
 
-void aseba_node::on_variables_message(const Aseba::ChangedVariables& msg) {
-    variables_map changed;
-    for(const auto& area : msg.variables) {
-        set_variables(area.start, area.variables, changed);
-    }
-    m_variables_changed_signal(shared_from_this(), changed, std::chrono::system_clock::now());
-    schedule_variables_update();
+bool aseba_node::on_changed_variables_message(const aseba_message_view& msg) {
+    if(!msg.for_each_changed_variables(
+           [this](const aseba_message_view::variables_area& area) { set_variables(area.start, area.variables); }))
+        return false;
+    notify_changed_variables();
+    // pushed changes do not need to be polled again
+    if(!m_variables_pushed)
+        schedule_variables_update();
+    return true;
 }
 
-void aseba_node::set_variables(uint16_t start, const std::vector<int16_t>& data, variables_map& vars) {
-
+// Copy data to the variables from address start, and record the variables whose value changed.
+// Words outside of any variable are ignored.
+void aseba_node::set_variables(uint16_t start, aseba_message_view::words data) {
     auto data_it = std::begin(data);
-    auto it = m_variables.begin();
-    while(data_it != std::end(data)) {
-        it = std::find_if(it, m_variables.end(), [start](const aseba_vm_variable& var) {
-            return start >= var.start && start < var.start + var.size;
-        });
-        if(it == std::end(m_variables))
-            return;
+    unsigned address = start;
+
+    // first variable ending after start
+    auto it = std::upper_bound(m_variables.begin(), m_variables.end(), address,
+                               [](unsigned address, const aseba_vm_variable& var) {
+                                   return address < unsigned(var.start) + var.size;
+                               });
+    for(; it != m_variables.end() && data_it != std::end(data); ++it) {
         auto& var = *it;
-        const auto var_start = start - var.start;
-        bool force_change = var.size != var.value.size();
-        var.value.resize(var.size, 0);
+        if(var.start > address) {
+            const auto gap = std::min(std::ptrdiff_t(var.start - address), std::distance(data_it, std::end(data)));
+            data_it += gap;
+            address += unsigned(gap);
+            if(data_it == std::end(data))
+                break;
+        }
+        const auto var_start = address - var.start;
         const auto count = std::min(std::ptrdiff_t(var.size - var_start), std::distance(data_it, std::end(data)));
-        if(count < 0)
-            break;
-        if(force_change ||
-           !std::equal(std::begin(var.value) + var_start, std::begin(var.value) + var_start + count, data_it,
-                       data_it + count)) {
-            std::copy(data_it, data_it + count, std::begin(var.value) + var_start);
-            vars.insert(std::pair{var.name, detail::aseba_variable_from_range(var.value)});
-            mLogTrace("Variable changed {} : {}", var.name, detail::aseba_variable_from_range(var.value));
-            if(var.name == "_fwversion" && m_firmware_version != var.value[0]) {
-                m_firmware_version = var.value[0];
-                set_status(m_status);
+        const auto value_it = std::begin(var.value) + var_start;
+        if(!var.received || !std::equal(data_it, data_it + count, value_it)) {
+            std::copy(data_it, data_it + count, value_it);
+            var.received = true;
+            if(!var.changed) {
+                var.changed = true;
+                m_changed_variables.push_back(std::size_t(std::distance(m_variables.begin(), it)));
             }
         }
-        data_it = data_it + count;
-        start += uint16_t(count);
+        data_it += count;
+        address += unsigned(count);
+    }
+}
+
+// Signal the variables changed by set_variables to watching applications
+void aseba_node::notify_changed_variables() {
+    if(m_changed_variables.empty())
+        return;
+
+    variables_map changed;
+    changed.reserve(m_changed_variables.size());
+    for(const auto index : m_changed_variables) {
+        auto& var = m_variables[index];
+        var.changed = false;
+        const auto& value = changed.emplace(var.name, detail::aseba_variable_from_range(var.value)).first->second;
+        mLogTrace("Variable changed {} : {}", var.name, value);
+        if(var.name == "_fwversion" && m_firmware_version != var.value[0]) {
+            m_firmware_version = var.value[0];
+            set_status(m_status);
+        }
     }
+    m_changed_variables.clear();
+    signal_variables_changed(changed);
 }
 
 
+void aseba_node::signal_variables_changed(const variables_map& variables) {
+    m_variables_changed_signal(shared_from_this(), variables, std::chrono::system_clock::now(),
+                               serialized_message_cache::next_update());
+}
+
 variables_map aseba_node::variables() const {
     variables_map map;
     map.reserve(m_variables.size());
     for(auto& var : m_variables) {
-        map.emplace(var.name, detail::aseba_variable_from_range(var.value));
+        map.emplace(var.name, var.received ? detail::aseba_variable_from_range(var.value) : property{});
     }
     return map;
 }
@@ -734,23 +869,25 @@ variables_map aseba_node::variables() const {
 void aseba_node::schedule_variables_update(boost::posix_time::time_duration delay) {
     m_variables_timer.expires_from_now(delay);
     std::weak_ptr<aseba_node> ptr = shared_from_this();
-    m_variables_timer.async_wait([ptr](boost::system::error_code ec) {
+    m_variables_timer.async_wait(boost::asio::bind_executor(m_strand, [ptr](boost::system::error_code ec) {
         if(ec)
             return;
         auto that = ptr.lock();
         if(!that || that->get_status() == status::disconnected)
             return;
 
-        // Only ask variables if we have at least 1 watcher
+        // Only ask variables if we have at least 1 watcher, and stop the pushes otherwise
         if(!that->m_variables_changed_signal.empty())
             that->request_variables();
+        else if(that->m_variables_subscribed)
+            that->unsubscribe_variables();
 
         // schedule_variables_update is called in on_variables_message
-        // every 100ms or so
+        // every 100ms or so, unless the node pushes its changes
         // However, the packet might be dropped, so this is a fail safe to make
-        // sure we ask for variables at least once every second
+        // sure we ask for variables (or renew the subscription) at least once every second
         that->schedule_variables_update(boost::posix_time::seconds(1));
-    });
+    }));
 }
 
 void aseba_node::on_device_info(const Aseba::DeviceInfo& info) {
@@ -759,27 +896,34 @@ void aseba_node::on_device_info(const Aseba::DeviceInfo& info) {
         // see request_device_info
         m_resend_timer.cancel();
 
-        if(info.data.size() == 16) {
-            std::copy(info.data.begin(), info.data.end(), m_uuid.begin());
-        }
-        bool save_uuid = m_uuid.is_nil() || info.data.size() != 16;
-        if(m_uuid.is_nil()) {
-            m_uuid = boost::uuids::random_generator()();
+        node_id uuid;
+        bool save_uuid;
+        {
+            std::lock_guard<std::mutex> _(m_info_mutex);
+            if(info.data.size() == 16) {
+                std::copy(info.data.begin(), info.data.end(), m_uuid.begin());
+            }
+            save_uuid = m_uuid.is_nil() || info.data.size() != 16;
+            if(m_uuid.is_nil()) {
+                m_uuid = boost::uuids::random_generator()();
+            }
+            uuid = m_uuid;
         }
         if(save_uuid) {
             std::vector<uint8_t> data;
-            std::copy(m_uuid.begin(), m_uuid.end(), std::back_inserter(data));
+            std::copy(uuid.begin(), uuid.end(), std::back_inserter(data));
             write_message(std::make_shared<Aseba::SetDeviceInfo>(native_id(), DEVICE_INFO_UUID, data));
         }
-        mLogInfo("Persistent uuid for {} is now {} ", native_id(), boost::uuids::to_string(m_uuid));
+        mLogInfo("Persistent uuid for {} is now {} ", native_id(), boost::uuids::to_string(uuid));
         auto& registery = boost::asio::use_service<aseba_node_registery>(m_io_ctx);
         registery.handle_node_uuid_change(shared_from_this());
         set_status(status::available);
 
     } else if(info.info == DEVICE_INFO_NAME) {
-        m_friendly_name.clear();
-        m_friendly_name.reserve(info.data.size());
-        std::copy(info.data.begin(), info.data.end(), std::back_inserter(m_friendly_name));
+        {
+            std::lock_guard<std::mutex> _(m_info_mutex);
+            m_friendly_name.assign(info.data.begin(), info.data.end());
+        }
         set_status(m_status);
         mLogInfo("Persistent name for {} is now \"{}\"", native_id(), friendly_name());
     } else if(info.info == DEVICE_INFO_THYMIO2_RF_SETTINGS) {
@@ -807,6 +951,7 @@ bool aseba_node::set_rf_settings(uint16_t network, uint16_t node, uint8_t channe
 
     write_message(std::make_shared<Aseba::SetDeviceInfo>(native_id(), DEVICE_INFO_THYMIO2_RF_SETTINGS, data));
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    m_loaded_bytecode.reset();
     write_message(std::make_shared<Aseba::Reboot>(native_id()));
     write_message(std::make_shared<Aseba::Reboot>(native_id()));
     return true;
@@ -829,13 +974,13 @@ aseba_node::node_type aseba_node::type() const {
 }
 
 std::string aseba_node::friendly_name() const {
-    if(m_friendly_name.empty()) {
-        auto ep = m_endpoint.lock();
-        if(ep) {
-            return ep->endpoint_name();
-        }
+    {
+        std::lock_guard<std::mutex> _(m_info_mutex);
+        if(!m_friendly_name.empty())
+            return m_friendly_name;
     }
-    return m_friendly_name;
+    auto ep = m_endpoint.lock();
+    return ep ? ep->endpoint_name() : std::string{};
 }
 
 void aseba_node::set_friendly_name(const std::string& str) {
@@ -845,6 +990,7 @@ void aseba_node::set_friendly_name(const std::string& str) {
     data.reserve(str.size());
     std::copy(str.begin(), str.end(), std::back_inserter(data));
     write_message(std::make_shared<Aseba::SetDeviceInfo>(native_id(), DEVICE_INFO_NAME, data));
+    std::lock_guard<std::mutex> _(m_info_mutex);
     m_friendly_name = str;
 }
 
@@ -871,7 +1017,8 @@ bool aseba_node::upgrade_firmware(
 
 bool aseba_node::can_be_renamed() const {
     auto ep = m_endpoint.lock();
-    return ep && ep->type() == aseba_endpoint::endpoint_type::thymio && m_description.protocolVersion >= 6;
+    // the version announced by the node rather than the one of its description, read on the strand only
+    return ep && ep->type() == aseba_endpoint::endpoint_type::thymio && m_protocol_version >= 6;
 }
 
 void aseba_node::get_description() {
@@ -940,14 +1087,15 @@ void aseba_node::request_next_description_fragment() {
 
     // retrigger a description fragment message in case it's dropped by the wireless key
     m_resend_timer.expires_from_now(boost::posix_time::seconds(1));
-    m_resend_timer.async_wait([ptr = weak_from_this()](boost::system::error_code ec) {
-        if(ec)
-            return;
-        auto that = ptr.lock();
-        if(!that)
-            return;
-        that->request_next_description_fragment();
-    });
+    m_resend_timer.async_wait(
+        boost::asio::bind_executor(m_strand, [ptr = weak_from_this()](boost::system::error_code ec) {
+            if(ec)
+                return;
+            auto that = ptr.lock();
+            if(!that)
+                return;
+            that->request_next_description_fragment();
+        }));
 }
 
 }  // namespace mobsya
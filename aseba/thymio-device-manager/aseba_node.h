@@ -3,6 +3,7 @@
 #include <mutex>
 #include <boost/asio/post.hpp>
 #include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
 #include <boost/asio/deadline_timer.hpp>
 #include <atomic>
 #include <aseba/flatbuffers/thymio_generated.h>
@@ -16,6 +17,7 @@
 #include "property.h"
 #include "events.h"
 #include "common_types.h"
+#include "aseba_message_view.h"
 
 namespace mobsya {
 class group;
@@ -44,6 +46,12 @@ struct hash<mobsya::breakpoint> {
 
 namespace mobsya {
 
+/*
+ * A node runs on the strand of its endpoint, where its messages are read: its methods are called,
+ * its timers and completions run and its signals are emitted there. Other strands post their
+ * requests to strand().
+ * The status, the identity, the name and the firmware versions can be read from any strand.
+ */
 class aseba_node : public std::enable_shared_from_this<aseba_node> {
 public:
     // aseba_node::status is exposed through zero conf & protocol : needs to be stable
@@ -51,6 +59,7 @@ public:
     using node_type = fb::NodeType;
 
     using node_id_t = uint16_t;
+    using strand_type = boost::asio::strand<boost::asio::io_context::executor_type>;
 
     struct vm_execution_state {
         fb::VMExecutionState state;
@@ -77,25 +86,34 @@ public:
     };
 
     using breakpoints = std::unordered_set<breakpoint>;
+    // The last argument identifies the update in serialized_message_cache
     using variables_watch_signal_t = boost::signals2::signal<void(std::shared_ptr<aseba_node>, variables_map,
-                                                                  std::chrono::system_clock::time_point)>;
+                                                                  std::chrono::system_clock::time_point, uint64_t)>;
 
     using events_watch_signal_t = boost::signals2::signal<void(std::shared_ptr<aseba_node>, variables_map,
-                                                               std::chrono::system_clock::time_point)>;
+                                                               std::chrono::system_clock::time_point, uint64_t)>;
 
     using vm_state_watch_signal_t = boost::signals2::signal<void(std::shared_ptr<aseba_node>, vm_execution_state)>;
     using vm_execution_state_command = fb::VMExecutionStateCommand;
 
 
-    aseba_node(boost::asio::io_context& ctx, node_id_t id, uint16_t protocol_version,
+    aseba_node(boost::asio::io_context& ctx, strand_type strand, node_id_t id, uint16_t protocol_version,
                std::weak_ptr<mobsya::aseba_endpoint> endpoint);
     using write_callback = std::function<void(boost::system::error_code)>;
     using breakpoints_callback = std::function<void(boost::system::error_code, breakpoints)>;
     using compilation_callback = std::function<void(boost::system::error_code, compilation_result)>;
 
+    // Outcome of a compilation, as stored by compilation_cache
+    struct compiled_program {
+        tl::expected<compilation_result, boost::system::error_code> result;
+        Aseba::BytecodeVector bytecode;
+        Aseba::VariablesMap variables;
+    };
+
     ~aseba_node();
 
-    static std::shared_ptr<aseba_node> create(boost::asio::io_context& ctx, node_id_t id, uint16_t protocol_version,
+    static std::shared_ptr<aseba_node> create(boost::asio::io_context& ctx, strand_type strand, node_id_t id,
+                                              uint16_t protocol_version,
                                               std::weak_ptr<mobsya::aseba_endpoint> endpoint);
 
     static const std::string& status_to_string(aseba_node::status);
@@ -108,9 +126,14 @@ public:
     }
 
     node_id uuid() const {
+        std::lock_guard<std::mutex> _(m_info_mutex);
         return m_uuid;
     }
 
+    const strand_type& strand() const {
+        return m_strand;
+    }
+
     node_type type() const;
 
     std::shared_ptr<mobsya::aseba_endpoint> endpoint() const;
@@ -177,12 +200,17 @@ private:
     friend class group;
 
     void set_status(status);
+
+    void compile(fb::ProgrammingLanguage language, const std::string& program, int kind,
+                 std::function<void(boost::system::error_code, compiled_program)>&& done);
+    void send_compiled_program(compiled_program&& compiled, compilation_callback&& cb);
     tl::expected<compilation_result, boost::system::error_code>
     do_compile_program(Aseba::Compiler& compiler, Aseba::CommonDefinitions& defs, fb::ProgrammingLanguage language,
                        const std::string& program, Aseba::BytecodeVector& bytecode);
 
     // Must be called before destructor !
     void disconnect();
+    bool on_message(const aseba_message_view& msg);
     void on_message(const Aseba::Message& msg);
     void get_description();
     void on_description_received();
@@ -191,9 +219,13 @@ private:
 
     void reset_known_variables(const Aseba::VariablesMap& variables);
     void request_variables();
-    void on_variables_message(const Aseba::Variables& msg);
-    void on_variables_message(const Aseba::ChangedVariables& msg);
-    void set_variables(uint16_t start, const std::vector<int16_t>& data, variables_map& vars);
+    void unsubscribe_variables();
+    bool on_variables_message(const aseba_message_view& msg);
+    bool on_changed_variables_message(const aseba_message_view& msg);
+    void on_variables_subscribed(const Aseba::VariablesSubscribed& msg);
+    void set_variables(uint16_t start, aseba_message_view::words data);
+    void notify_changed_variables();
+    void signal_variables_changed(const variables_map& variables);
     void schedule_variables_update(boost::posix_time::time_duration delay = boost::posix_time::milliseconds(100));
     void on_execution_state_message(const Aseba::ExecutionStateChanged&);
     void on_vm_runtime_error(const Aseba::Message&);
@@ -203,6 +235,7 @@ private:
     void on_breakpoint_set_result(const Aseba::BreakpointSetResult&);
     void cancel_pending_breakpoint_request();
     void compile_and_send_aseba_command(const std::string& program);
+    void write_bytecode(write_callback&& cb = {});
 
     void step_to_next_line(write_callback&& cb);
     void handle_step_request();
@@ -215,12 +248,15 @@ private:
 
 
     node_id_t m_id;
+    strand_type m_strand;
+    // guards m_uuid and m_friendly_name, which are written on the strand and read from anywhere
+    mutable std::mutex m_info_mutex;
     node_id m_uuid;
     bool m_uuid_received = false;
     std::string m_friendly_name;
     std::atomic<status> m_status;
-    int m_firmware_version;
-    int m_available_firmware_version;
+    std::atomic<int> m_firmware_version;
+    std::atomic<int> m_available_firmware_version;
     const uint16_t m_protocol_version;
     std::atomic<void*> m_connected_app;
     std::weak_ptr<mobsya::aseba_endpoint> m_endpoint;
@@ -229,6 +265,11 @@ private:
         uint16_t variables{0}, events{0}, functions{0};
     } m_description_message_counter;
     Aseba::BytecodeVector m_bytecode;
+    // Compiler of the programs of the node, incremental, used by one compilation at a time
+    std::mutex m_compiler_mutex;
+    Aseba::Compiler m_compiler;
+    // Bytecode on the node, as last sent to it, if known
+    std::optional<std::vector<uint16_t>> m_loaded_bytecode;
     breakpoints m_breakpoints;
     boost::asio::io_context& m_io_ctx;
 
@@ -250,17 +291,26 @@ private:
         uint16_t start;
         uint16_t size;
         std::vector<int16_t> value;
+        bool received = false;  // whether value was ever received from the node
+        bool changed = false;   // whether the variable is in m_changed_variables
 
         aseba_vm_variable(const std::string& name, uint16_t start, uint16_t size)
-            : name(name), start(start), size(size) {}
+            : name(name), start(start), size(size), value(size, 0) {}
     };
+    // sorted by address, variables do not overlap
     std::vector<aseba_vm_variable> m_variables;
+    // indices in m_variables of the variables changed since the last notification
+    std::vector<std::size_t> m_changed_variables;
     boost::asio::deadline_timer m_variables_timer;
     boost::asio::deadline_timer m_status_timer;
     variables_watch_signal_t m_variables_changed_signal;
     events_watch_signal_t m_events_signal;
     vm_state_watch_signal_t m_vm_state_watch_signal;
     std::atomic<bool> m_resend_all_variables = true;
+    std::atomic<bool> m_variables_subscribed = false;
+    // whether the node acknowledged the subscription with VariablesSubscribed, and thus pushes its
+    // changes; until then, and for nodes which only understand the subscription, variables are polled
+    std::atomic<bool> m_variables_pushed = false;
     boost::asio::deadline_timer m_resend_timer;
 
 
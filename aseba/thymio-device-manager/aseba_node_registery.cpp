@@ -13,6 +13,7 @@ namespace mobsya {
 aseba_node_registery::aseba_node_registery(boost::asio::execution_context& io_context)
     : boost::asio::detail::service_base<aseba_node_registery>(static_cast<boost::asio::io_context&>(io_context))
     , m_service_uid(boost::asio::use_service<uuid_generator>(io_context).generate())
+    , m_strand(static_cast<boost::asio::io_context&>(io_context).get_executor())
     , m_discovery_socket(static_cast<boost::asio::io_context&>(io_context))
     , m_nodes_service_desc("mobsya") {
     m_nodes_service_desc.name(fmt::format("Thymio Device Manager on {}", boost::asio::ip::host_name()));
@@ -21,42 +22,50 @@ aseba_node_registery::aseba_node_registery(boost::asio::execution_context& io_co
 }
 
 void aseba_node_registery::add_node(std::shared_ptr<aseba_node> node) {
+    std::unique_lock<std::mutex> lock(m_mutex);
     remove_duplicated_node(node);
     auto it = find(node);
-    if(it == std::end(m_aseba_nodes)) {
-        node_id id = node->uuid();
-        if(id.is_nil())
-            id = boost::asio::use_service<uuid_generator>(get_io_context()).generate();
-        it = m_aseba_nodes.insert({id, node}).first;
-
-        restore_group_affiliation(*node);
-        save_group_affiliation(*node);
+    if(it != std::end(m_aseba_nodes))
+        return;
+    node_id id = node->uuid();
+    if(id.is_nil())
+        id = boost::asio::use_service<uuid_generator>(get_io_context()).generate();
+    m_aseba_nodes.insert({id, node});
+    save_group_affiliation(*node, restore_group_affiliation(*node));
+    lock.unlock();
 
-        m_node_status_changed_signal(node, id, aseba_node::status::connected);
-        mLogInfo("Adding node id: {} - Real id: {}", id, node->native_id());
-    }
+    m_node_status_changed_signal(node, id, aseba_node::status::connected);
+    mLogInfo("Adding node id: {} - Real id: {}", id, node->native_id());
 }
 
 void aseba_node_registery::handle_node_uuid_change(const std::shared_ptr<aseba_node>& node) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::optional<node_id> previous_id;
     auto it = find(node);
     if(it != std::end(m_aseba_nodes)) {
-        m_node_status_changed_signal(node, it->first, aseba_node::status::disconnected);
+        previous_id = it->first;
         m_aseba_nodes.erase(it);
     }
     remove_duplicated_node(node);
     m_aseba_nodes.insert({node->uuid(), node});
-    restore_group_affiliation(*node);
-    save_group_affiliation(*node);
+    save_group_affiliation(*node, restore_group_affiliation(*node));
+    lock.unlock();
+
+    if(previous_id)
+        m_node_status_changed_signal(node, *previous_id, aseba_node::status::disconnected);
 }
 
 void aseba_node_registery::remove_node(const std::shared_ptr<aseba_node>& node) {
     mLogTrace("Removing node {}", node->friendly_name());
+    std::unique_lock<std::mutex> lock(m_mutex);
     auto it = find(node);
     if(it == std::end(m_aseba_nodes)) {
         return;
     }
     node_id id = it->first;
     m_aseba_nodes.erase(it);
+    lock.unlock();
+
     m_node_status_changed_signal(node, id, aseba_node::status::disconnected);
 }
 
@@ -71,49 +80,59 @@ void aseba_node_registery::remove_duplicated_node(const std::shared_ptr<aseba_no
     m_aseba_nodes.erase(it);
     if(old) {
         if(auto ep = old->endpoint()) {
-            ep->remove_node(node->uuid());
+            boost::asio::post(ep->strand(), [ep, id = node->uuid()] { ep->remove_node(id); });
         }
     }
 }
-void aseba_node_registery::save_group_affiliation(const aseba_node& node) {
-    auto group = node.group();
+void aseba_node_registery::save_group_affiliation(const aseba_node& node, std::shared_ptr<mobsya::group> group) {
     if(group) {
         m_ghost_groups.insert_or_assign(node.uuid(), last_known_node_group{group});
     }
 }
 
-void aseba_node_registery::restore_group_affiliation(const aseba_node& node) {
+std::shared_ptr<mobsya::group> aseba_node_registery::restore_group_affiliation(const aseba_node& node) {
+    auto ep = node.endpoint();
+    auto current = ep ? ep->group() : std::shared_ptr<mobsya::group>{};
     auto it = m_ghost_groups.find(node.uuid());
     if(it == std::end(m_ghost_groups))
-        return;
-    auto ep = node.endpoint();
-    if(ep && (ep->group() != it->second.group) && (!ep->group() || !ep->group()->has_state())) {
-        it->second.group->attach_to_endpoint(node.endpoint());
-    }
+        return current;
+    auto ghost = it->second.group;
     m_ghost_groups.erase(it);
+    if(!ep || current == ghost || (current && current->has_state()))
+        return current;
+    boost::asio::post(ghost->strand(), [ghost, ep] { ghost->attach_to_endpoint(ep); });
+    return ghost;
 }
 
 void aseba_node_registery::set_node_status(const std::shared_ptr<aseba_node>& node, aseba_node::status status) {
+    std::unique_lock<std::mutex> lock(m_mutex);
     auto it = find(node);
-    if(it != std::end(m_aseba_nodes)) {
-        node_id id = it->first;
-        mLogInfo("Changing node {} status to {} ", id, aseba_node::status_to_string(status));
-        m_node_status_changed_signal(node, id, status);
-    }
+    if(it == std::end(m_aseba_nodes))
+        return;
+    node_id id = it->first;
+    lock.unlock();
+
+    mLogInfo("Changing node {} status to {} ", id, aseba_node::status_to_string(status));
+    m_node_status_changed_signal(node, id, status);
 }
 
 aseba_node_registery::node_map aseba_node_registery::nodes() const {
+    std::lock_guard<std::mutex> _(m_mutex);
     return m_aseba_nodes;
 }
 
 void aseba_node_registery::set_tcp_endpoint(const boost::asio::ip::tcp::endpoint& endpoint) {
-    m_nodes_service_desc.endpoint(endpoint);
-    update_discovery();
+    boost::asio::post(m_strand, [this, endpoint] {
+        m_nodes_service_desc.endpoint(endpoint);
+        update_discovery();
+    });
 }
 
 void aseba_node_registery::set_ws_endpoint(const boost::asio::ip::tcp::endpoint& endpoint) {
-    m_ws_endpoint = endpoint;
-    update_discovery();
+    boost::asio::post(m_strand, [this, endpoint] {
+        m_ws_endpoint = endpoint;
+        update_discovery();
+    });
 }
 
 void aseba_node_registery::update_discovery() {
@@ -128,7 +147,8 @@ void aseba_node_registery::update_discovery() {
     m_updating_discovery = true;
     m_discovery_socket.async_announce(
         m_nodes_service_desc,
-        std::bind(&aseba_node_registery::on_update_discovery_complete, this, std::placeholders::_1));
+        boost::asio::bind_executor(
+            m_strand, std::bind(&aseba_node_registery::on_update_discovery_complete, this, std::placeholders::_1)));
 }
 
 void aseba_node_registery::on_update_discovery_complete(const boost::system::error_code& ec) {
@@ -139,8 +159,7 @@ void aseba_node_registery::on_update_discovery_complete(const boost::system::err
     }
     m_updating_discovery = false;
     if(m_discovery_needs_update) {
-        boost::asio::post(boost::asio::get_associated_executor(this),
-                          boost::bind(&aseba_node_registery::update_discovery, this));
+        boost::asio::post(m_strand, boost::bind(&aseba_node_registery::update_discovery, this));
     }
 }
 
@@ -172,6 +191,7 @@ auto aseba_node_registery::find_from_native_id(aseba_node::node_id_t id) const -
 }
 
 std::shared_ptr<aseba_node> aseba_node_registery::node_from_id(const aseba_node_registery::node_id& id) const {
+    std::lock_guard<std::mutex> _(m_mutex);
     const auto it = m_aseba_nodes.find(id);
     if(it == std::end(m_aseba_nodes))
         return {};
@@ -179,6 +199,7 @@ std::shared_ptr<aseba_node> aseba_node_registery::node_from_id(const aseba_node_
 }
 
 std::shared_ptr<mobsya::group> aseba_node_registery::group_from_id(const node_id& id) const {
+    std::lock_guard<std::mutex> _(m_mutex);
     for(auto it = std::begin(m_aseba_nodes); it != std::end(m_aseba_nodes); ++it) {
         const auto n = it->second.lock();
         if(n && (n->uuid() == id || (n->group() && n->group()->uuid() == id)))
@@ -188,6 +209,7 @@ std::shared_ptr<mobsya::group> aseba_node_registery::group_from_id(const node_id
 }
 
 void aseba_node_registery::register_endpoint(std::shared_ptr<aseba_endpoint> p) {
+    std::lock_guard<std::mutex> _(m_mutex);
     auto it = std::find_if(m_endpoints.begin(), m_endpoints.end(),
                            [p](std::weak_ptr<aseba_endpoint> o) { return o.lock() == p; });
     if(it == m_endpoints.end()) {
@@ -196,15 +218,17 @@ void aseba_node_registery::register_endpoint(std::shared_ptr<aseba_endpoint> p)
 }
 
 void aseba_node_registery::unregister_expired_endpoints() {
+    std::lock_guard<std::mutex> _(m_mutex);
     m_endpoints.erase(std::remove_if(m_endpoints.begin(), m_endpoints.end(), [](auto&& ep) { return ep.expired(); }),
                       m_endpoints.end());
 }
 
 void aseba_node_registery::disconnect_all_wireless_endpoints() {
+    std::lock_guard<std::mutex> _(m_mutex);
     for(auto w : m_endpoints) {
         const auto ep = w.lock();
         if(ep && ep->is_wireless()) {
-            ep->destroy();
+            boost::asio::post(ep->strand(), [ep] { ep->destroy(); });
         }
     }
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include <boost/asio/io_service.hpp>
+#include <mutex>
 #include <unordered_map>
 #include <random>
 #include <chrono>
@@ -15,6 +16,10 @@
 
 namespace mobsya {
 
+// Nodes are added, removed and changed from their strand, and looked up from any.
+// The maps are guarded by a mutex, never held while calling out: signals are emitted,
+// and what is done to endpoints and groups posted to their strand, once it is released.
+// Discovery runs on the strand of the registery.
 class aseba_node_registery : public boost::asio::detail::service_base<aseba_node_registery> {
 public:
     using node_id = mobsya::node_id;
@@ -44,8 +49,9 @@ public:
 private:
     void remove_duplicated_node(const std::shared_ptr<aseba_node>& node);
 
-    void save_group_affiliation(const aseba_node& node);
-    void restore_group_affiliation(const aseba_node& node);
+    void save_group_affiliation(const aseba_node& node, std::shared_ptr<mobsya::group> group);
+    // Return the group the node is in once its previous group, if any, is restored
+    std::shared_ptr<mobsya::group> restore_group_affiliation(const aseba_node& node);
 
     void update_discovery();
     void on_update_discovery_complete(const boost::system::error_code&);
@@ -54,7 +60,9 @@ private:
     node_map::const_iterator find(const std::shared_ptr<aseba_node>& node) const;
     node_map::const_iterator find_from_native_id(aseba_node::node_id_t id) const;
     boost::uuids::uuid m_service_uid;
+    aseba_node::strand_type m_strand;
 
+    mutable std::mutex m_mutex;
     node_map m_aseba_nodes;
     // Listing the endpoints is useful to be able to configure
     // Thymio 2 dongles
@@ -97,6 +105,16 @@ protected:
                         boost::placeholders::_3));
     }
 
+    // node_changed is called on the strand of the node: tracking the monitor keeps it alive while it runs
+    template <typename T>
+    void start_node_monitoring(aseba_node_registery& registery, const std::weak_ptr<T>& tracked) {
+        using slot_type = decltype(registery.m_node_status_changed_signal)::slot_type;
+        m_connection = registery.m_node_status_changed_signal.connect(
+            slot_type(&node_status_monitor::node_changed, this, boost::placeholders::_1, boost::placeholders::_2,
+                      boost::placeholders::_3)
+                .track_foreign(tracked));
+    }
+
 private:
     boost::signals2::scoped_connection m_connection;
 };
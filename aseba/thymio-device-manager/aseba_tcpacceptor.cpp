@@ -14,6 +14,7 @@ static const std::map<std::string, aseba_endpoint::endpoint_type> endpoint_type_
 aseba_tcp_acceptor::aseba_tcp_acceptor(boost::asio::io_context& io_context)
     : boost::asio::detail::service_base<aseba_tcp_acceptor>(io_context)
     , m_iocontext(io_context)
+    , m_strand(io_context.get_executor())
     , m_stopped(false)
     , m_contact("aseba")
     , m_monitor(m_monitor_ctx)
@@ -32,12 +33,14 @@ aseba_tcp_acceptor::~aseba_tcp_acceptor() {
 }
 
 void aseba_tcp_acceptor::free_endpoint(const aseba_device* ep) {
-    auto it = m_known_contacts.find(ep);
-    if(it != m_known_contacts.end()) {
-        m_disconnected_contacts.insert(it->second);
-        m_known_contacts.erase(it);
-        boost::asio::post(m_iocontext, boost::bind(&aseba_tcp_acceptor::do_accept, this));
-    }
+    boost::asio::post(m_strand, [this, ep] {
+        auto it = m_known_contacts.find(ep);
+        if(it != m_known_contacts.end()) {
+            m_disconnected_contacts.insert(it->second);
+            m_known_contacts.erase(it);
+            boost::asio::post(m_strand, boost::bind(&aseba_tcp_acceptor::do_accept, this));
+        }
+    });
 }
 
 void aseba_tcp_acceptor::monitor() {
@@ -53,7 +56,7 @@ void aseba_tcp_acceptor::monitor_next() {
         }
         mLogTrace("New contact {} : {}", m_contact.name(), m_contact.domain());
         this->push_contact(m_contact);
-        boost::asio::post(m_iocontext, boost::bind(&aseba_tcp_acceptor::do_accept, this));
+        boost::asio::post(m_strand, boost::bind(&aseba_tcp_acceptor::do_accept, this));
         if(!m_stopped.load())
             monitor_next();
     });
@@ -83,14 +86,14 @@ void aseba_tcp_acceptor::do_accept() {
 void aseba_tcp_acceptor::do_accept_contact(aware::contact contact) {
     auto session = aseba_endpoint::create_for_tcp(m_iocontext);
     if(contact.empty() || contact.type() != "aseba") {
-        boost::asio::post(m_iocontext, boost::bind(&aseba_tcp_acceptor::do_accept, this));
+        boost::asio::post(m_strand, boost::bind(&aseba_tcp_acceptor::do_accept, this));
         return;
     }
 
     if(!mobsya::endpoint_is_local(contact.endpoint()) && contact.name().find("Not A Thymio 3") != 0) {
         mLogTrace("Ignoring remote endoint {} ({}) (expected: {})", contact.name(),
                   contact.endpoint().address().to_string(), boost::asio::ip::host_name());
-        boost::asio::post(m_iocontext, boost::bind(&aseba_tcp_acceptor::do_accept, this));
+        boost::asio::post(m_strand, boost::bind(&aseba_tcp_acceptor::do_accept, this));
         return;
     }
 
@@ -100,14 +103,16 @@ void aseba_tcp_acceptor::do_accept_contact(aware::contact contact) {
         auto it = m_connected_endpoints.find(key);
         if(it != std::end(m_connected_endpoints) && !it->second.expired()) {
             mLogTrace("[tcp] {} already connected", contact.endpoint());
-            boost::asio::post(m_iocontext, boost::bind(&aseba_tcp_acceptor::do_accept, this));
+            boost::asio::post(m_strand, boost::bind(&aseba_tcp_acceptor::do_accept, this));
             return;
         }
     }
 
     m_known_contacts.emplace(session->device(), contact);
     session->tcp().async_connect(
-        contact.endpoint(), [this, contact = std::move(contact), session, key = key](boost::system::error_code ec) {
+        contact.endpoint(),
+        boost::asio::bind_executor(m_strand, [this, contact = std::move(contact), session,
+                                              key = key](boost::system::error_code ec) {
             const auto& properties = contact.properties();
             int protocol_version = 5;
             aseba_endpoint::endpoint_type type = aseba_endpoint::endpoint_type::unknown;
@@ -115,7 +120,7 @@ void aseba_tcp_acceptor::do_accept_contact(aware::contact contact) {
             if(ec) {
                 mLogWarn("[tcp] Fail to connect to aseba node {} {} : {}", contact.name(),
                          contact.endpoint().address().to_string(), ec.message());
-                boost::asio::post(m_iocontext, [this] { this->accept(); });
+                boost::asio::post(m_strand, [this] { this->accept(); });
                 return;
             }
 
@@ -133,7 +138,7 @@ void aseba_tcp_acceptor::do_accept_contact(aware::contact contact) {
                 auto it = m_connected_endpoints.find(key);
                 if(it != std::end(m_connected_endpoints) && !it->second.expired()) {
                     mLogTrace("[tcp] {} already connected", contact.endpoint());
-                    boost::asio::post(m_iocontext, [this] { this->accept(); });
+                    boost::asio::post(m_strand, [this] { this->accept(); });
                     return;
                 }
                 m_connected_endpoints[key] = session;
@@ -155,10 +160,42 @@ void aseba_tcp_acceptor::do_accept_contact(aware::contact contact) {
             session->set_endpoint_name(remove_host_from_name(contact.name()));
             session->set_endpoint_type(type);
             session->start();
-            boost::asio::post(m_iocontext, [this] { this->accept(); });
-        });
+            boost::asio::post(m_strand, [this] { this->accept(); });
+        }));
 }  // namespace mobsya
 
+void aseba_tcp_acceptor::connect(boost::asio::ip::tcp::endpoint endpoint, std::string name) {
+    boost::asio::post(m_strand, [this, endpoint, name = std::move(name)]() mutable {
+        do_accept_endpoint(endpoint, std::move(name));
+    });
+}
+
+void aseba_tcp_acceptor::do_accept_endpoint(boost::asio::ip::tcp::endpoint endpoint, std::string name) {
+    auto session = aseba_endpoint::create_for_tcp(m_iocontext);
+    const auto key = known_ep{endpoint.address().to_string(), endpoint.port()};
+    session->tcp().async_connect(
+        endpoint, boost::asio::bind_executor(m_strand, [this, endpoint, name = std::move(name), session,
+                                                        key](boost::system::error_code ec) {
+            if(ec) {
+                mLogWarn("[tcp] Fail to connect to aseba node {} {} : {}", name, endpoint, ec.message());
+                return;
+            }
+            {
+                std::unique_lock<std::mutex> _(m_endpoints_mutex);
+                auto it = m_connected_endpoints.find(key);
+                if(it != std::end(m_connected_endpoints) && !it->second.expired()) {
+                    mLogTrace("[tcp] {} already connected", endpoint);
+                    return;
+                }
+                m_connected_endpoints[key] = session;
+            }
+            mLogInfo("[tcp] New aseba node connected: {} on {}", name, endpoint);
+            session->set_endpoint_name(name);
+            session->set_endpoint_type(aseba_endpoint::endpoint_type::simulated_dummy_node);
+            session->start();
+        }));
+}
+
 void aseba_tcp_acceptor::push_contact(aware::contact contact) {
     std::unique_lock<std::mutex> _(m_queue_mutex);
     m_pending_contacts.push_back(std::move(contact));
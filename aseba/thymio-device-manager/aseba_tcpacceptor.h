@@ -4,9 +4,11 @@
 #include <memory>
 #include <mutex>
 #include <set>
+#include <string>
 #include <queue>
 #include <thread>
 #include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/strand.hpp>
 
 namespace mobsya {
 class aseba_endpoint;
@@ -18,13 +20,15 @@ public:
     ~aseba_tcp_acceptor();
     void accept();
     void free_endpoint(const aseba_device* ep);
+    // Connect to a node listening on a known endpoint, without waiting for it to be advertised
+    void connect(boost::asio::ip::tcp::endpoint endpoint, std::string name);
 
 private:
     void monitor();
     void monitor_next();
     void do_accept();
     void do_accept_contact(aware::contact contact);
-    void do_accept_endpoint(boost::asio::ip::tcp::endpoint endpoint);
+    void do_accept_endpoint(boost::asio::ip::tcp::endpoint endpoint, std::string name);
 
 
     void push_contact(aware::contact contact);
@@ -33,6 +37,8 @@ private:
     std::set<aware::contact> m_disconnected_contacts;
 
     boost::asio::io_context& m_iocontext;
+    // Serializes the accepting of contacts, the connections and the freeing of endpoints
+    boost::asio::strand<boost::asio::io_context::executor_type> m_strand;
     std::thread m_monitor_thread;
     std::atomic_bool m_stopped;
     aware::contact m_contact;
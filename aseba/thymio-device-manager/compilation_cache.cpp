@@ -0,0 +1,100 @@
+#include "compilation_cache.h"
+
+namespace mobsya {
+
+namespace {
+
+    // Append values with their size, so that different inputs never give the same key
+
+    void append(std::string& key, int32_t value) {
+        key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void append(std::string& key, const std::wstring& str) {
+        append(key, int32_t(str.size()));
+        key.append(reinterpret_cast<const char*>(str.data()), str.size() * sizeof(wchar_t));
+    }
+
+    void append(std::string& key, const std::string& str) {
+        append(key, int32_t(str.size()));
+        key.append(str);
+    }
+
+    void append(std::string& key, const Aseba::NamedValuesVector& values) {
+        append(key, int32_t(values.size()));
+        for(const auto& value : values) {
+            append(key, value.name);
+            append(key, int32_t(value.value));
+        }
+    }
+
+}  // namespace
+
+compilation_cache::compilation_cache(boost::asio::execution_context& ctx)
+    : boost::asio::detail::service_base<compilation_cache>(static_cast<boost::asio::io_context&>(ctx)) {}
+
+// The documentation of events and native functions is left out, the compiler does not use it
+std::string compilation_cache::make_key(fb::ProgrammingLanguage language, const std::string& source,
+                                        const Aseba::TargetDescription& description,
+                                        const Aseba::CommonDefinitions& definitions) {
+    std::string key;
+    key.reserve(source.size() + 4096);
+    append(key, int32_t(language));
+    append(key, source);
+
+    append(key, description.name);
+    append(key, int32_t(description.protocolVersion));
+    append(key, int32_t(description.bytecodeSize));
+    append(key, int32_t(description.variablesSize));
+    append(key, int32_t(description.stackSize));
+    append(key, int32_t(description.namedVariables.size()));
+    for(const auto& variable : description.namedVariables) {
+        append(key, variable.name);
+        append(key, int32_t(variable.size));
+    }
+    append(key, int32_t(description.localEvents.size()));
+    for(const auto& event : description.localEvents) {
+        append(key, event.name);
+    }
+    append(key, int32_t(description.nativeFunctions.size()));
+    for(const auto& function : description.nativeFunctions) {
+        append(key, function.name);
+        append(key, int32_t(function.parameters.size()));
+        for(const auto& parameter : function.parameters) {
+            append(key, parameter.name);
+            append(key, int32_t(parameter.size));
+        }
+    }
+
+    append(key, definitions.events);
+    append(key, definitions.constants);
+    return key;
+}
+
+std::shared_ptr<const compilation_cache::program> compilation_cache::find(const std::string& key) {
+    std::lock_guard<std::mutex> _(m_mutex);
+    auto it = m_index.find(key);
+    if(it == m_index.end())
+        return {};
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return it->second->second;
+}
+
+void compilation_cache::insert(std::string key, program compiled) {
+    auto value = std::make_shared<const program>(std::move(compiled));
+    std::lock_guard<std::mutex> _(m_mutex);
+    auto it = m_index.find(key);
+    if(it != m_index.end()) {
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        it->second->second = std::move(value);
+        return;
+    }
+    m_entries.emplace_front(std::move(key), std::move(value));
+    m_index.emplace(m_entries.front().first, m_entries.begin());
+    if(m_entries.size() > capacity) {
+        m_index.erase(m_entries.back().first);
+        m_entries.pop_back();
+    }
+}
+
+}  // namespace mobsya
@@ -0,0 +1,45 @@
+#pragma once
+#include <boost/asio/io_service.hpp>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "aseba_node.h"
+
+namespace mobsya {
+
+/*
+ * Results of the latest compilations, so that compiling the same program again
+ * (on each run of a program, or for each robot of a classroom) is a lookup.
+ *
+ * Entries are addressed by everything the compiler depends on: the language,
+ * the source, the target description and the common definitions.
+ * The least recently used entry is evicted once the cache is full.
+ */
+class compilation_cache : public boost::asio::detail::service_base<compilation_cache> {
+public:
+    using program = aseba_node::compiled_program;
+
+    compilation_cache(boost::asio::execution_context& ctx);
+
+    static std::string make_key(fb::ProgrammingLanguage language, const std::string& source,
+                                const Aseba::TargetDescription& description,
+                                const Aseba::CommonDefinitions& definitions);
+
+    std::shared_ptr<const program> find(const std::string& key);
+    void insert(std::string key, program compiled);
+
+private:
+    static constexpr std::size_t capacity = 64;
+
+    using entry = std::pair<const std::string, std::shared_ptr<const program>>;
+
+    std::mutex m_mutex;
+    // Most recently used first
+    std::list<entry> m_entries;
+    std::unordered_map<std::string_view, std::list<entry>::iterator> m_index;
+};
+
+}  // namespace mobsya
@@ -0,0 +1,70 @@
+#include "compilation_service.h"
+#include <algorithm>
+#include <thread>
+
+namespace mobsya {
+
+// Leave cores to the io_context and to the other programs of the computer
+static std::size_t compilation_threads() {
+    return std::clamp<std::size_t>(std::thread::hardware_concurrency() / 2, 1, 4);
+}
+
+compilation_service::compilation_service(boost::asio::execution_context& ctx)
+    : boost::asio::detail::service_base<compilation_service>(static_cast<boost::asio::io_context&>(ctx))
+    , m_ctx(static_cast<boost::asio::io_context&>(ctx))
+    , m_pool(compilation_threads()) {}
+
+compilation_service::~compilation_service() {
+    m_pool.join();
+}
+
+void compilation_service::shutdown() {
+    m_pool.stop();
+    m_pool.join();
+    const auto s = stats();
+    if(s.compilations == 0)
+        return;
+    mLogInfo("{} compilations, {} superseded, {} rejected, queue latency {}ms on average, {}ms at most",
+             s.compilations, s.superseded, s.rejected,
+             std::chrono::duration_cast<std::chrono::milliseconds>(s.total_queue_latency).count() / s.compilations,
+             std::chrono::duration_cast<std::chrono::milliseconds>(s.max_queue_latency).count());
+}
+
+compilation_service::statistics compilation_service::stats() const {
+    std::lock_guard<std::mutex> _(m_mutex);
+    return m_stats;
+}
+
+void compilation_service::supersede(const key& k) {
+    std::lock_guard<std::mutex> _(m_mutex);
+    auto it = m_latest.find(k);
+    if(it != m_latest.end())
+        it->second = ++m_last_ticket;
+}
+
+bool compilation_service::start(const key& k, uint64_t ticket, duration queue_latency) {
+    std::lock_guard<std::mutex> _(m_mutex);
+    --m_pending;
+    auto it = m_latest.find(k);
+    if(it == m_latest.end() || it->second != ticket) {
+        ++m_stats.superseded;
+        return false;
+    }
+    ++m_stats.compilations;
+    m_stats.total_queue_latency += queue_latency;
+    m_stats.max_queue_latency = std::max(m_stats.max_queue_latency, queue_latency);
+    return true;
+}
+
+bool compilation_service::finish(const key& k, uint64_t ticket) {
+    std::lock_guard<std::mutex> _(m_mutex);
+    auto it = m_latest.find(k);
+    if(it == m_latest.end() || it->second != ticket) {
+        ++m_stats.superseded;
+        return false;
+    }
+    m_latest.erase(it);
+    return true;
+}
+
+}  // namespace mobsya
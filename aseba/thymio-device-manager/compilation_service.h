@@ -0,0 +1,107 @@
+#pragma once
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <utility>
+#include "error.h"
+#include "log.h"
+
+namespace mobsya {
+
+/*
+ * Runs the compilation of programs on a small pool of threads, so that compiling a
+ * large program does not stall the io_context serving the robots and the applications.
+ *
+ * Each compilation has a key. Queueing a compilation supersedes the pending one
+ * with the same key: it is not run, or its result is discarded, and its completion
+ * handler gets operation_aborted. Completion handlers run on the io_context.
+ */
+class compilation_service : public boost::asio::detail::service_base<compilation_service> {
+public:
+    using key = std::pair<const void*, int>;
+    using duration = std::chrono::steady_clock::duration;
+
+    struct statistics {
+        uint64_t compilations = 0;
+        uint64_t superseded = 0;
+        uint64_t rejected = 0;
+        duration total_queue_latency{};
+        duration max_queue_latency{};
+    };
+
+    compilation_service(boost::asio::execution_context& ctx);
+    ~compilation_service() override;
+
+    // Run compile() on the pool, then done(error_code, result) on the io_context
+    template <typename Compile, typename Done>
+    void compile(key k, Compile&& compile, Done&& done) {
+        using result_t = decltype(compile());
+        uint64_t ticket;
+        {
+            std::lock_guard<std::mutex> _(m_mutex);
+            if(m_pending >= max_pending_compilations) {
+                ++m_stats.rejected;
+                boost::asio::post(m_ctx, [done = std::forward<Done>(done)]() mutable {
+                    done(make_error_code(error_code::too_many_compilations), result_t{});
+                });
+                return;
+            }
+            ticket = ++m_last_ticket;
+            m_latest[k] = ticket;
+            ++m_pending;
+        }
+
+        boost::asio::post(m_pool, [this, k, ticket, queued = std::chrono::steady_clock::now(),
+                                   compile = std::forward<Compile>(compile),
+                                   done = std::forward<Done>(done)]() mutable {
+            const auto started = std::chrono::steady_clock::now();
+            if(!start(k, ticket, started - queued)) {
+                boost::asio::post(m_ctx, [done = std::move(done)]() mutable {
+                    done(boost::asio::error::operation_aborted, result_t{});
+                });
+                return;
+            }
+            auto result = compile();
+            const bool superseded = !finish(k, ticket);
+            mLogDebug("Compilation waited {}ms, ran {}ms{}",
+                      std::chrono::duration_cast<std::chrono::milliseconds>(started - queued).count(),
+                      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started)
+                          .count(),
+                      superseded ? ", superseded" : "");
+            boost::asio::post(m_ctx, [done = std::move(done), result = std::move(result), superseded]() mutable {
+                boost::system::error_code ec;
+                if(superseded)
+                    ec = boost::asio::error::operation_aborted;
+                done(ec, std::move(result));
+            });
+        });
+    }
+
+    // Abort the pending compilation with the given key, if any
+    void supersede(const key& k);
+
+    statistics stats() const;
+
+private:
+    static constexpr std::size_t max_pending_compilations = 32;
+
+    void shutdown() override;
+
+    // Account for a compilation leaving the queue; return false if it was superseded
+    bool start(const key& k, uint64_t ticket, duration queue_latency);
+    // Return false if the compilation was superseded while running
+    bool finish(const key& k, uint64_t ticket);
+
+    boost::asio::io_context& m_ctx;
+    boost::asio::thread_pool m_pool;
+    mutable std::mutex m_mutex;
+    std::map<key, uint64_t> m_latest;
+    uint64_t m_last_ticket = 0;
+    std::size_t m_pending = 0;
+    statistics m_stats;
+};
+
+}  // namespace mobsya
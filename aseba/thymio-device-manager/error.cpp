@@ -19,6 +19,7 @@ std::string tdm_error_category::message(int ev) const {
         case error_code::incompatible_variable_type: return "incompatible variable type";
         case error_code::invalid_aesl: return "invalid aesl";
         case error_code::unsupported_language: return "unsupported language";
+        case error_code::too_many_compilations: return "too many compilations";
 
     }
     return {};
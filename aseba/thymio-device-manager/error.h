@@ -12,7 +12,8 @@ enum class error_code {
     no_such_variable,
     incompatible_variable_type,
     invalid_aesl,
-    unsupported_language
+    unsupported_language,
+    too_many_compilations
 };
 
 class tdm_error_category : public boost::system::error_category {
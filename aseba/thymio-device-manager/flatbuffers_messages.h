@@ -126,26 +126,37 @@ namespace detail {
     }
 }  // namespace detail
 
-inline tagged_detached_flatbuffer serialize_changed_variables(const mobsya::aseba_node& n,
+inline tagged_detached_flatbuffer serialize_changed_variables(const mobsya::node_id& id,
                                                               const mobsya::variables_map& vars,
                                                               const std::chrono::system_clock::time_point& timestamp) {
     flatbuffers::FlatBufferBuilder fb;
-    auto idOffset = n.uuid().fb(fb);
+    auto idOffset = id.fb(fb);
     auto varsOffset = detail::serialize_variables(fb, vars);
     const auto ms = std::chrono::time_point_cast<std::chrono::milliseconds>(timestamp).time_since_epoch().count();
     auto offset = fb::CreateVariablesChanged(fb, idOffset, varsOffset, ms);
     return wrap_fb(fb, offset);
 }
 
-inline tagged_detached_flatbuffer serialize_changed_variables(const mobsya::group& n,
+inline tagged_detached_flatbuffer serialize_changed_variables(const mobsya::aseba_node& n,
+                                                              const mobsya::variables_map& vars,
+                                                              const std::chrono::system_clock::time_point& timestamp) {
+    return serialize_changed_variables(n.uuid(), vars, timestamp);
+}
+
+inline tagged_detached_flatbuffer serialize_changed_variables(const mobsya::node_id& id,
                                                               const mobsya::variables_map& vars) {
     flatbuffers::FlatBufferBuilder fb;
-    auto idOffset = n.uuid().fb(fb);
+    auto idOffset = id.fb(fb);
     auto varsOffset = detail::serialize_variables(fb, vars);
     auto offset = fb::CreateVariablesChanged(fb, idOffset, varsOffset);
     return wrap_fb(fb, offset);
 }
 
+inline tagged_detached_flatbuffer serialize_changed_variables(const mobsya::group& n,
+                                                              const mobsya::variables_map& vars) {
+    return serialize_changed_variables(n.uuid(), vars);
+}
+
 inline tagged_detached_flatbuffer serialize_events(const mobsya::aseba_node& n, const mobsya::variables_map& vars,
                                                    const std::chrono::system_clock::time_point& timestamp) {
     flatbuffers::FlatBufferBuilder fb;
@@ -15,6 +15,7 @@ static constexpr const auto THYMIO2_CHECK_PATH = "/update/Thymio2-firmware-meta.
 firmware_update_service::firmware_update_service(boost::asio::execution_context& ctx)
     : boost::asio::detail::service_base<firmware_update_service>(static_cast<boost::asio::io_context&>(ctx))
     , m_ctx(ctx)
+    , m_strand(static_cast<boost::asio::io_context&>(ctx).get_executor())
     , m_http_client(std::make_unique<belle::Client>(UPDATE_SERVER, 443, true)) {
 
     start();
@@ -33,13 +34,15 @@ void firmware_update_service::node_changed(std::shared_ptr<aseba_node> node, con
     auto type = node->type();
     if(type == aseba_node::node_type::Thymio2Wireless)
         type = aseba_node::node_type::Thymio2;
-    auto it = m_versions.find(type);
-    if(it != m_versions.end()) {
-        update_nodes_versions(type);
-        return;
-    }
+    boost::asio::post(m_strand, [this, type] {
+        auto it = m_versions.find(type);
+        if(it != m_versions.end()) {
+            update_nodes_versions(type);
+            return;
+        }
 
-    download_firmare_info(type);
+        download_firmare_info(type);
+    });
 }
 
 void firmware_update_service::download_firmare_info(mobsya::aseba_node::node_type type) {
@@ -57,30 +60,33 @@ void firmware_update_service::download_thymio_2_firmware() {
 
     mLogInfo("Downloading https://{}/{}", UPDATE_SERVER, THYMIO2_CHECK_PATH);
     m_http_client->on_http(THYMIO2_CHECK_PATH, [this](auto& ctx) {
-        m_downloading.erase(aseba_node::node_type::Thymio2);
+        const bool ok = ctx.res.result() == belle::Status::ok;
+        boost::asio::post(m_strand, [this, ok, body = ok ? std::string(ctx.res.body()) : std::string{}] {
+            m_downloading.erase(aseba_node::node_type::Thymio2);
 
-        if(ctx.res.result() != belle::Status::ok) {
-            mLogWarn("Http request failed: https://{}/{}", UPDATE_SERVER, THYMIO2_CHECK_PATH);
-            return;
-        }
-        pugi::xml_document doc;
-        pugi::xml_parse_result result = doc.load_string(ctx.res.body().c_str());
-        if(result.status != pugi::xml_parse_status::status_ok) {
-            mLogError("The firmware update manifest might be corrupted");
-            return;
-        }
-        auto node = doc.child("firmware");
-        if(node) {
-            auto v = node.attribute("version").as_int(0);
-            if(v != 0) {
-                m_versions[aseba_node::node_type::Thymio2] = v;
-                auto str = node.attribute("url").as_string();
-                m_urls[aseba_node::node_type::Thymio2] = str;
-
-                update_nodes_versions(aseba_node::node_type::Thymio2);
-                mLogInfo("Last firmware available for Thymio 2: {}", v);
+            if(!ok) {
+                mLogWarn("Http request failed: https://{}/{}", UPDATE_SERVER, THYMIO2_CHECK_PATH);
+                return;
             }
-        }
+            pugi::xml_document doc;
+            pugi::xml_parse_result result = doc.load_string(body.c_str());
+            if(result.status != pugi::xml_parse_status::status_ok) {
+                mLogError("The firmware update manifest might be corrupted");
+                return;
+            }
+            auto node = doc.child("firmware");
+            if(node) {
+                auto v = node.attribute("version").as_int(0);
+                if(v != 0) {
+                    m_versions[aseba_node::node_type::Thymio2] = v;
+                    auto str = node.attribute("url").as_string();
+                    m_urls[aseba_node::node_type::Thymio2] = str;
+
+                    update_nodes_versions(aseba_node::node_type::Thymio2);
+                    mLogInfo("Last firmware available for Thymio 2: {}", v);
+                }
+            }
+        });
     });
     m_http_client->connect();
 }
@@ -100,7 +106,7 @@ void firmware_update_service::update_nodes_versions(mobsya::aseba_node::node_typ
             if(type != node_type)
                 continue;
             if(n->firwmware_version() != it->second)
-                boost::asio::post([n, v = it->second] { n->set_available_firmware_version(v); });
+                n->set_available_firmware_version(it->second);
         }
     }
     auto pit = m_waiting.find(type);
@@ -108,31 +114,33 @@ void firmware_update_service::update_nodes_versions(mobsya::aseba_node::node_typ
         download_firmare_data(type);
 }
 
+// Can be called from any strand, the request is handled on the strand of the service
 boost::unique_future<ranges::span<std::byte>>
 firmware_update_service::firmware_data(mobsya::aseba_node::node_type type) {
-    auto p = boost::promise<ranges::span<std::byte>>();
+    auto p = std::make_shared<boost::promise<ranges::span<std::byte>>>();
+    auto f = p->get_future();
 
     if(type == aseba_node::node_type::Thymio2Wireless)
         type = aseba_node::node_type::Thymio2;
 
-    auto it = m_firmwares_data.find(type);
-    if(it != m_firmwares_data.end()) {
-        p.set_value(it->second);
-        return p.get_future();
-    }
-
-    auto url_it = m_urls.find(type);
-    if(url_it == m_urls.end()) {
-        download_firmare_info(type);
-        return p.get_future();
-    }
+    boost::asio::post(m_strand, [this, type, p] {
+        auto it = m_firmwares_data.find(type);
+        if(it != m_firmwares_data.end()) {
+            p->set_value(it->second);
+            return;
+        }
 
-    auto f = p.get_future();
+        auto url_it = m_urls.find(type);
+        if(url_it == m_urls.end()) {
+            download_firmare_info(type);
+            return;
+        }
 
-    m_waiting[type].emplace_back(std::move(p));
+        m_waiting[type].emplace_back(std::move(*p));
 
-    if(m_waiting[type].size() == 1)
-        download_firmare_data(type);
+        if(m_waiting[type].size() == 1)
+            download_firmare_data(type);
+    });
 
     return f;
 }
@@ -145,10 +153,12 @@ void firmware_update_service::download_firmare_data(mobsya::aseba_node::node_typ
 
     auto cb = [type, this, url = url_it->second](auto& ctx) {
         mLogInfo("{} : {}", url, ctx.res.result());
-        if(ctx.res.result() == belle::Status::ok) {
-            std::vector<std::byte> v;
-            v.reserve(ctx.res.body().size());
-            ranges::transform(ctx.res.body(), ranges::back_inserter(v), [](char b) { return std::byte(b); });
+        if(ctx.res.result() != belle::Status::ok)
+            return;
+        std::vector<std::byte> v;
+        v.reserve(ctx.res.body().size());
+        ranges::transform(ctx.res.body(), ranges::back_inserter(v), [](char b) { return std::byte(b); });
+        boost::asio::post(m_strand, [this, type, v = std::move(v)] {
             m_firmwares_data.emplace(type, v);
 
             // Notify clients
@@ -156,7 +166,7 @@ void firmware_update_service::download_firmare_data(mobsya::aseba_node::node_typ
                 p.set_value(m_firmwares_data[type]);
             }
             m_waiting.clear();
-        }
+        });
     };
 
     m_http_client->on_http(url_it->second, std::move(cb));
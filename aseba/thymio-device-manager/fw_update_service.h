@@ -31,6 +31,8 @@ protected:
 
 private:
     boost::asio::execution_context& m_ctx;
+    // the versions, downloads and waiting requests are handled on that strand
+    aseba_node::strand_type m_strand;
     std::unique_ptr<OB::Belle::Client> m_http_client;
     void start();
     void download_thymio_2_firmware();
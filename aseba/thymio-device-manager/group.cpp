@@ -6,6 +6,7 @@
 #include "uuid_provider.h"
 #include "aseba_property.h"
 #include "aesl_parser.h"
+#include "serialized_message_cache.h"
 #include <range/v3/view/filter.hpp>
 #include <range/v3/view/transform.hpp>
 #include <range/v3/view/indirect.hpp>
@@ -14,7 +15,9 @@
 namespace mobsya {
 
 group::group(boost::asio::io_context& context)
-    : m_context(context), m_uuid(boost::asio::use_service<uuid_generator>(m_context).generate()) {}
+    : m_context(context)
+    , m_strand(context.get_executor())
+    , m_uuid(boost::asio::use_service<uuid_generator>(m_context).generate()) {}
 
 
 std::shared_ptr<group> group::make_group_for_endpoint(boost::asio::io_context& context,
@@ -25,7 +28,11 @@ std::shared_ptr<group> group::make_group_for_endpoint(boost::asio::io_context& c
 }
 
 bool group::has_state() const {
-    return m_endpoints.size() > 1 || !m_events_table.empty() || !m_shared_variables.empty();
+    return m_has_state;
+}
+
+void group::update_has_state() {
+    m_has_state = m_endpoints.size() > 1 || !m_events_table.empty() || !m_shared_variables.empty();
 }
 
 bool group::has_node(const node_id& node) const {
@@ -56,15 +63,16 @@ void group::attach_to_endpoint(std::shared_ptr<aseba_endpoint> ep) {
     auto it = std::find(eps.begin(), eps.end(), ep);
     if(it == eps.end()) {
         m_endpoints.push_back(ep);
+        update_has_state();
     }
 
     ep->set_group(this->shared_from_this());
-    ep->set_events_table(m_events_table);
+    boost::asio::post(ep->strand(), [ep, events = m_events_table] { ep->set_events_table(events); });
 
     for(auto&& node : ep->nodes()) {
-        node->set_status(node->get_status());
+        boost::asio::post(node->strand(), [node] { node->set_status(node->get_status()); });
     }
-    m_variables_changed_signal(shared_from_this(), m_shared_variables);
+    m_variables_changed_signal(shared_from_this(), m_shared_variables, serialized_message_cache::next_update());
     m_events_changed_signal(shared_from_this(), m_events_table);
     assign_scratchpads();
 }
@@ -91,12 +99,14 @@ void group::emit_events(const properties_map& map, write_callback&& cb) {
     const auto ptr = std::shared_ptr<write_callback>(new write_callback(std::move(cb)), deleter);
 
     for(const auto& ep : endpoints()) {
-        ep->emit_events(map, [cb = ptr](boost::system::error_code ec) mutable {
-            // If one endpoint fails, report the error of that endpoint ( and ignore further errors)
-            if(ec && cb && *cb) {
-                (*cb)(ec);
-                cb.reset();
-            }
+        boost::asio::post(ep->strand(), [ep, map, ptr] {
+            ep->emit_events(map, [cb = ptr](boost::system::error_code ec) mutable {
+                // If one endpoint fails, report the error of that endpoint ( and ignore further errors)
+                if(ec && cb && *cb) {
+                    (*cb)(ec);
+                    cb.reset();
+                }
+            });
         });
     }
 }
@@ -107,24 +117,26 @@ void group::on_event_received(std::shared_ptr<aseba_endpoint> source_ep, const n
     for(const auto& ep : endpoints()) {
         if(ep == source_ep)
             continue;
-        ep->emit_events(events, {});
+        boost::asio::post(ep->strand(), [ep, events] { ep->emit_events(events, {}); });
     }
 }
 
 boost::system::error_code group::set_shared_variables(const properties_map& map) {
     m_shared_variables = map;
+    update_has_state();
     for(auto&& ep : endpoints()) {
-        ep->set_shared_variables(map);
+        boost::asio::post(ep->strand(), [ep, map] { ep->set_shared_variables(map); });
     }
-    m_variables_changed_signal(shared_from_this(), m_shared_variables);
+    m_variables_changed_signal(shared_from_this(), m_shared_variables, serialized_message_cache::next_update());
     return {};
 }
 
 
 boost::system::error_code group::set_events_table(const events_table& events) {
     m_events_table = events;
+    update_has_state();
     for(auto&& ep : endpoints()) {
-        ep->set_events_table(events);
+        boost::asio::post(ep->strand(), [ep, events] { ep->set_events_table(events); });
     }
     send_events_table();
     return {};
@@ -2,12 +2,19 @@
 #include <boost/uuid/uuid.hpp>
 #include <aseba/compiler/compiler.h>
 #include <boost/system/error_code.hpp>
+#include <boost/asio/strand.hpp>
+#include <atomic>
 #include "property.h"
 #include "events.h"
 #include "aseba_node.h"
 
 namespace mobsya {
 class aseba_endpoint;
+
+/*
+ * A group runs on its own strand: its methods are called and its signals emitted there.
+ * What it changes on its endpoints and their nodes is posted to their strand.
+ */
 class group : public std::enable_shared_from_this<group> {
 public:
     using properties_map = mobsya::variables_map;
@@ -25,9 +32,19 @@ public:
         bool deleted = false;
     };
 
+    using events_signal_t = boost::signals2::signal<void(std::shared_ptr<group>, events_table)>;
+    // The last argument identifies the update in serialized_message_cache
+    using variables_signal_t = boost::signals2::signal<void(std::shared_ptr<group>, variables_map, uint64_t)>;
+    using scratchpad_signal_t = boost::signals2::signal<void(std::shared_ptr<group>, scratchpad)>;
+
 
     group(boost::asio::io_context& context);
 
+    const aseba_node::strand_type& strand() const {
+        return m_strand;
+    }
+
+    // Can be called from any strand
     bool has_state() const;
 
     bool has_node(const node_id& node) const;
@@ -80,8 +97,12 @@ private:
 
     friend class aseba_node;
 
+    void update_has_state();
+
     boost::asio::io_context& m_context;
+    aseba_node::strand_type m_strand;
     std::vector<std::weak_ptr<aseba_endpoint>> m_endpoints;
+    std::atomic<bool> m_has_state{false};
 
     // Because of compat with aseba, m_events_table needs to remain in insertion order
     events_table m_events_table;
@@ -89,14 +110,11 @@ private:
 
     boost::uuids::uuid m_uuid;
 
-    using events_signal_t = boost::signals2::signal<void(std::shared_ptr<group>, events_table)>;
     events_signal_t m_events_changed_signal;
-    using variables_signal_t = boost::signals2::signal<void(std::shared_ptr<group>, variables_map)>;
     variables_signal_t m_variables_changed_signal;
 
 
     std::vector<scratchpad> m_scratchpads;
-    using scratchpad_signal_t = boost::signals2::signal<void(std::shared_ptr<group>, scratchpad)>;
     scratchpad_signal_t m_scratchpad_changed_signal;
 
     scratchpad& create_scratchpad();
@@ -1,25 +1,53 @@
 #include "log.h"
+#include <spdlog/async.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
-#include <boost/utility/string_view.hpp>
 #include <fmt/format.h>
+#include <cstdlib>
 
+// Runtime level, set by the MOBSYA_TDM_LOG_LEVEL environment variable (trace, debug, info, warning, error,
+// critical or off). Defaults to info in release builds and trace otherwise.
+static spdlog::level::level_enum initial_log_level() {
+    if(const char* level = std::getenv("MOBSYA_TDM_LOG_LEVEL"))
+        return spdlog::level::from_str(level);
+#ifdef NDEBUG
+    return spdlog::level::info;
+#else
+    return spdlog::level::trace;
+#endif
+}
+
+static std::shared_ptr<spdlog::sinks::stdout_color_sink_mt> console_sink() {
+    static auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+    return sink;
+}
 
 auto get_logger() {
-    auto log = spdlog::stdout_color_mt("console");
-    log->set_level(spdlog::level::trace);
+    // Messages are written by a background thread, through a bounded queue, so that logging never
+    // blocks the io_context; when the queue is full, the oldest messages are dropped
+    spdlog::init_thread_pool(8192, 1);
+    auto log = std::make_shared<spdlog::async_logger>("console", console_sink(), spdlog::thread_pool(),
+                                                      spdlog::async_overflow_policy::overrun_oldest);
+    log->set_level(initial_log_level());
     log->flush_on(spdlog::level::trace);
     return log;
 }
 
+auto get_error_logger() {
+    // Warnings and errors are rare and must not be dropped with the flood of messages which filled
+    // the queue, so they are written at once, possibly ahead of older messages still queued
+    auto log = std::make_shared<spdlog::logger>("console-errors", console_sink());
+    log->set_level(initial_log_level());
+    log->flush_on(spdlog::level::warn);
+    return log;
+}
+
 std::shared_ptr<spdlog::logger> mobsya::logger = get_logger();
+std::shared_ptr<spdlog::logger> mobsya::error_logger = get_error_logger();
 
-std::string mobsya::log_filename(const char* path) {
-    auto sw = boost::string_view(path);
+std::string_view mobsya::log_filename(const char* path) {
+    auto sw = std::string_view(path);
     sw = sw.substr(sw.find_last_of("/\\") + 1);
-    sw = sw.substr(0, std::min(sw.size(), std::size_t(20)));
-    auto str = std::string(sw.data(), sw.size());
-    str.insert(str.begin(), 20 - str.size(), ' ');
-    return str;
+    return sw.substr(0, std::min(sw.size(), std::size_t(20)));
 }
 
 #if WIN32
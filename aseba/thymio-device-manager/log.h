@@ -3,6 +3,14 @@
 #include <fmt/printf.h>
 #include <fmt/ostream.h>
 #include <spdlog/spdlog.h>
+#include <iterator>
+#include <string_view>
+
+// Messages below this level are compiled out, their arguments are never evaluated.
+// Values are those of spdlog::level::level_enum: 0 for trace, 1 for debug, 2 for info, and so on.
+#ifndef MOBSYA_LOG_ACTIVE_LEVEL
+#    define MOBSYA_LOG_ACTIVE_LEVEL 0
+#endif
 
 namespace mobsya {
 
@@ -11,11 +19,22 @@ extern std::string get_last_win32_error_string();
 #endif
 
 extern std::shared_ptr<spdlog::logger> logger;
-extern std::string log_filename(const char* path);
+// Synchronous logger writing warnings and errors to the same console as logger, which may drop messages
+extern std::shared_ptr<spdlog::logger> error_logger;
+extern std::string_view log_filename(const char* path);
+
+// Whether a message of this level would be logged, checked before formatting its arguments
+inline bool log_enabled(spdlog::level::level_enum level) {
+    return level >= MOBSYA_LOG_ACTIVE_LEVEL && mobsya::logger->should_log(level);
+}
+
 template <typename... Args>
-void log(spdlog::level::level_enum level, const char* file, int line, const char* message, Args... args) {
-    mobsya::logger->log(
-        level, fmt::format("{}@L{}:\t{}", mobsya::log_filename(file), line, fmt::format(message, args...)).c_str());
+void log(spdlog::level::level_enum level, const char* file, int line, const char* message, const Args&... args) {
+    fmt::memory_buffer buffer;
+    fmt::format_to(std::back_inserter(buffer), "{:>20}@L{}:\t", mobsya::log_filename(file), line);
+    fmt::format_to(std::back_inserter(buffer), message, args...);
+    auto& target = level >= spdlog::level::warn ? mobsya::error_logger : mobsya::logger;
+    target->log(level, fmt::string_view(buffer.data(), buffer.size()));
 }
 
 }  // namespace mobsya
@@ -24,18 +43,15 @@ void log(spdlog::level::level_enum level, const char* file, int line, const char
 #define _mobsya_STR2(x) #x
 #define _mobsya_STR(x) _mobsya_STR2(x)
 
-#ifdef _MSC_VER
-#    define mLogTrace(...) mobsya::log(spdlog::level::trace, __FILE__, __LINE__, __VA_ARGS__)
-#    define mLogDebug(...) mobsya::log(spdlog::level::debug, __FILE__, __LINE__, __VA_ARGS__)
-#    define mLogInfo(...) mobsya::log(spdlog::level::info, __FILE__, __LINE__, __VA_ARGS__)
-#    define mLogWarn(...) mobsya::log(spdlog::level::warn, __FILE__, __LINE__, __VA_ARGS__)
-#    define mLogError(...) mobsya::log(spdlog::level::err, __FILE__, __LINE__, __VA_ARGS__)
-#    define mLogCritical(...) mobsya::log(spdlog::level::critical, __FILE__, __LINE__, __VA_ARGS__)
-#else
-#    define mLogTrace(...) mobsya::log(spdlog::level::trace, __FILE__, __LINE__, ##__VA_ARGS__)
-#    define mLogDebug(...) mobsya::log(spdlog::level::debug, __FILE__, __LINE__, ##__VA_ARGS__)
-#    define mLogInfo(...) mobsya::log(spdlog::level::info, __FILE__, __LINE__, ##__VA_ARGS__)
-#    define mLogWarn(...) mobsya::log(spdlog::level::warn, __FILE__, __LINE__, ##__VA_ARGS__)
-#    define mLogError(...) mobsya::log(spdlog::level::err, __FILE__, __LINE__, ##__VA_ARGS__)
-#    define mLogCritical(...) mobsya::log(spdlog::level::critical, __FILE__, __LINE__, ##__VA_ARGS__)
-#endif
+#define _mobsya_LOG(level, ...)                                       \
+    do {                                                              \
+        if(mobsya::log_enabled(level))                                \
+            mobsya::log(level, __FILE__, __LINE__, __VA_ARGS__);      \
+    } while(0)
+
+#define mLogTrace(...) _mobsya_LOG(spdlog::level::trace, __VA_ARGS__)
+#define mLogDebug(...) _mobsya_LOG(spdlog::level::debug, __VA_ARGS__)
+#define mLogInfo(...) _mobsya_LOG(spdlog::level::info, __VA_ARGS__)
+#define mLogWarn(...) _mobsya_LOG(spdlog::level::warn, __VA_ARGS__)
+#define mLogError(...) _mobsya_LOG(spdlog::level::err, __VA_ARGS__)
+#define mLogCritical(...) _mobsya_LOG(spdlog::level::critical, __VA_ARGS__)
@@ -4,6 +4,8 @@
 #include <boost/filesystem.hpp>
 #include <boost/thread.hpp>
 #include <boost/exception/diagnostic_information.hpp>
+#include <cstdlib>
+#include <thread>
 #include <errno.h>
 #include "log.h"
 #include "interfaces.h"
@@ -13,6 +15,8 @@
 #include "system_sleep_manager.h"
 #include "fw_update_service.h"
 #include "wireless_configurator_service.h"
+#include "compilation_service.h"
+#include "compilation_cache.h"
 #include "aseba_endpoint.h"
 #include "aseba_tcpacceptor.h"
 #include "uuid_provider.h"
@@ -27,6 +31,33 @@
 
 static const auto lock_file_path = boost::filesystem::temp_directory_path() / "mobsya-tdm-0accdcbf-eeb2";
 
+// Number of threads running the io_context, set by the MOBSYA_TDM_IO_THREADS environment variable.
+// Defaults to one until running on more has been validated under a thread sanitizer.
+static std::size_t io_threads() {
+    if(const char* threads = std::getenv("MOBSYA_TDM_IO_THREADS")) {
+        const int count = std::atoi(threads);
+        if(count > 0)
+            return std::size_t(count);
+        mLogWarn("Ignoring invalid MOBSYA_TDM_IO_THREADS \"{}\"", threads);
+    }
+    return 1;
+}
+
+// Run the io_context on io_threads() threads, the calling one included, until it is stopped
+static void run_io_context(boost::asio::io_context& ctx) {
+    const auto count = io_threads();
+    mLogInfo("Running on {} threads", count);
+    std::vector<std::thread> threads;
+    threads.reserve(count - 1);
+    for(std::size_t i = 1; i < count; i++) {
+        threads.emplace_back([&ctx] { ctx.run(); });
+    }
+    ctx.run();
+    for(auto& thread : threads) {
+        thread.join();
+    }
+}
+
 void run_service(boost::asio::io_context& ctx) {
 
     // Gather a list of local ips so that we can detect connections from
@@ -50,6 +81,11 @@ void run_service(boost::asio::io_context& ctx) {
 
     [[maybe_unused]] mobsya::wireless_configurator_service& ws =
         boost::asio::make_service<mobsya::wireless_configurator_service>(ctx);
+
+    [[maybe_unused]] mobsya::compilation_service& compilations =
+        boost::asio::make_service<mobsya::compilation_service>(ctx);
+    [[maybe_unused]] mobsya::compilation_cache& compilation_cache =
+        boost::asio::make_service<mobsya::compilation_cache>(ctx);
     // ws.enable();
 
     // Create a server for regular tcp connection
@@ -75,7 +111,7 @@ void run_service(boost::asio::io_context& ctx) {
 #endif
     aseba_tcp_acceptor.accept();
 
-    ctx.run();
+    run_io_context(ctx);
 }
 
 
@@ -103,14 +139,15 @@ int start() {
     sig.add(SIGINT);
     sig.add(SIGTERM);
     sig.add(SIGABRT);
-    sig.async_wait([&token_file](boost::system::error_code, int sig) {
+    sig.async_wait([&token_file, &ctx](boost::system::error_code, int sig) {
         mLogWarn("Exiting with signal {}", sig);
         boost::system::error_code ec;
         boost::filesystem::remove(token_file, ec);
         if(ec) {
             mLogWarn("{}", ec.message());
         }
-        std::exit(0);
+        // Let all the threads return from the io_context before exiting
+        ctx.stop();
     });
 
     run_service(ctx);
@@ -0,0 +1,162 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <queue>
+#include <utility>
+#include "serialized_message_cache.h"
+#include "common_types.h"
+
+namespace mobsya {
+
+/*
+ * Messages waiting to be written to an application.
+ *
+ * Responses and notifications an application cannot recover from missing are queued
+ * as is and always sent first. Telemetry (variables, events, execution states) is only
+ * sent when no such message is pending, and is bounded: pending variables or execution
+ * state updates of the same node are coalesced, the latest value winning, and the
+ * oldest telemetry is dropped when the pending messages exceed the byte budget.
+ */
+class outbound_message_queue {
+public:
+    using message_ptr = serialized_message_cache::message_ptr;
+    using variables_serializer = std::function<tagged_detached_flatbuffer(const variables_map&)>;
+
+    static constexpr std::size_t default_max_bytes = 4 * 1024 * 1024;
+
+    explicit outbound_message_queue(std::size_t max_bytes = default_max_bytes) : m_max_bytes(max_bytes) {}
+
+    bool empty() const {
+        return m_messages.empty() && m_telemetry.empty();
+    }
+
+    // Bytes of the messages waiting to be sent
+    std::size_t size_in_bytes() const {
+        return m_bytes;
+    }
+
+    uint64_t dropped() const {
+        return m_dropped;
+    }
+
+    uint64_t coalesced() const {
+        return m_coalesced;
+    }
+
+    // Queue a message which is neither coalesced nor dropped
+    void push(message_ptr message) {
+        m_bytes += size(message);
+        m_messages.push(std::move(message));
+        enforce_budget();
+    }
+
+    // Queue a telemetry message; if a message of the same type from source is pending, it is replaced.
+    // A null source is never coalesced.
+    void push_telemetry(message_ptr message, const void* source = nullptr) {
+        if(source) {
+            auto it = m_pending.find(key(source, message->tag));
+            if(it != m_pending.end()) {
+                replace(*it->second, std::move(message));
+                ++m_coalesced;
+                return;
+            }
+        }
+        append(source, std::move(message), {}, {});
+    }
+
+    // Queue the update of the given variables from source.
+    // If an update from source is pending, both are merged and serialized again.
+    void push_variables(const void* source, message_ptr message, const variables_map& variables,
+                        variables_serializer serialize) {
+        auto it = m_pending.find(key(source, message->tag));
+        if(it == m_pending.end()) {
+            append(source, std::move(message), variables, std::move(serialize));
+            return;
+        }
+        auto& entry = *it->second;
+        for(auto&& [name, value] : variables) {
+            entry.variables.insert_or_assign(name, value);
+        }
+        entry.serialize = std::move(serialize);
+        replace(entry, std::make_shared<const tagged_detached_flatbuffer>(entry.serialize(entry.variables)));
+        ++m_coalesced;
+    }
+
+    // Remove the next message to send, responses first
+    message_ptr pop() {
+        message_ptr message;
+        if(!m_messages.empty()) {
+            message = std::move(m_messages.front());
+            m_messages.pop();
+        } else if(!m_telemetry.empty()) {
+            message = std::move(m_telemetry.front().message);
+            forget(m_telemetry.begin());
+        } else {
+            return {};
+        }
+        m_bytes -= size(message);
+        return message;
+    }
+
+private:
+    using pending_key = std::pair<const void*, fb::AnyMessage>;
+    struct telemetry {
+        const void* source;
+        fb::AnyMessage type;
+        message_ptr message;
+        variables_map variables;
+        variables_serializer serialize;
+    };
+    using telemetry_list = std::list<telemetry>;
+
+    static pending_key key(const void* source, fb::AnyMessage type) {
+        return {source, type};
+    }
+
+    static std::size_t size(const message_ptr& message) {
+        return message->buffer.size();
+    }
+
+    void append(const void* source, message_ptr message, variables_map variables, variables_serializer serialize) {
+        m_bytes += size(message);
+        const auto type = message->tag;
+        m_telemetry.push_back({source, type, std::move(message), std::move(variables), std::move(serialize)});
+        if(source)
+            m_pending.emplace(key(source, type), std::prev(m_telemetry.end()));
+        enforce_budget();
+    }
+
+    void replace(telemetry& entry, message_ptr message) {
+        m_bytes -= size(entry.message);
+        m_bytes += size(message);
+        entry.message = std::move(message);
+        enforce_budget();
+    }
+
+    void forget(telemetry_list::iterator it) {
+        if(it->source)
+            m_pending.erase(key(it->source, it->type));
+        m_telemetry.erase(it);
+    }
+
+    // Drop the oldest telemetry until the pending messages fit in the budget
+    void enforce_budget() {
+        while(m_bytes > m_max_bytes && !m_telemetry.empty()) {
+            m_bytes -= size(m_telemetry.front().message);
+            forget(m_telemetry.begin());
+            ++m_dropped;
+        }
+    }
+
+    std::size_t m_max_bytes;
+    std::size_t m_bytes = 0;
+    uint64_t m_dropped = 0;
+    uint64_t m_coalesced = 0;
+    std::queue<message_ptr> m_messages;
+    telemetry_list m_telemetry;
+    std::map<pending_key, telemetry_list::iterator> m_pending;
+};
+
+}  // namespace mobsya
@@ -0,0 +1,84 @@
+#pragma once
+#include <boost/asio/io_service.hpp>
+#include <aseba/flatbuffers/fb_message_ptr.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace mobsya {
+
+/*
+ * Nodes and groups notify each update of their variables or events to all the application
+ * endpoints watching them. The first endpoint serializes the update, the others get the same
+ * immutable buffer, so that the message is built once whatever the number of applications.
+ *
+ * Updates are identified by the object they come from and a sequence number, unique for the
+ * whole process. Entries are dropped once no endpoint holds their buffer anymore.
+ */
+class serialized_message_cache : public boost::asio::detail::service_base<serialized_message_cache> {
+public:
+    using message_ptr = std::shared_ptr<const tagged_detached_flatbuffer>;
+
+    serialized_message_cache(boost::asio::execution_context& ctx)
+        : boost::asio::detail::service_base<serialized_message_cache>(static_cast<boost::asio::io_context&>(ctx)) {}
+
+    // Return a new update sequence number, never 0
+    static uint64_t next_update() {
+        static std::atomic<uint64_t> sequence{0};
+        return ++sequence;
+    }
+
+    // Return the message of the given update from source, calling serialize() to build it if it is
+    // not already available. Update 0 is never cached.
+    template <typename Serializer>
+    message_ptr get(const void* source, uint64_t update, Serializer&& serialize) {
+        if(update == 0)
+            return std::make_shared<const tagged_detached_flatbuffer>(serialize());
+
+        const key k{source, update};
+        {
+            std::lock_guard<std::mutex> _(m_mutex);
+            auto it = m_entries.find(k);
+            if(it != m_entries.end()) {
+                if(auto message = it->second.lock())
+                    return message;
+            }
+        }
+
+        // Serialize without holding the lock; if another endpoint did the same meanwhile, keep its message
+        auto message = std::make_shared<const tagged_detached_flatbuffer>(serialize());
+        std::lock_guard<std::mutex> _(m_mutex);
+        auto [it, inserted] = m_entries.try_emplace(k, message);
+        if(!inserted) {
+            if(auto existing = it->second.lock())
+                return existing;
+            it->second = message;
+        }
+        if(m_entries.size() >= m_purge_threshold)
+            purge();
+        return message;
+    }
+
+private:
+    using key = std::pair<const void*, uint64_t>;
+
+    // Remove the entries whose message was sent by all endpoints
+    void purge() {
+        for(auto it = m_entries.begin(); it != m_entries.end();) {
+            if(it->second.expired())
+                it = m_entries.erase(it);
+            else
+                ++it;
+        }
+        m_purge_threshold = std::max(std::size_t(64), m_entries.size() * 2);
+    }
+
+    std::mutex m_mutex;
+    std::map<key, std::weak_ptr<const tagged_detached_flatbuffer>> m_entries;
+    std::size_t m_purge_threshold = 64;
+};
+
+}  // namespace mobsya
@@ -4,6 +4,7 @@
 #include <vector>
 #include <boost/bind.hpp>
 #include <boost/chrono.hpp>
+#include <mutex>
 
 #ifdef __APPLE__
 #    include <IOKit/pwr_mgt/IOPMLIb.h>
@@ -26,6 +27,7 @@ public:
 
 
     void app_connected() {
+        std::lock_guard<std::mutex> _(m_mutex);
         m_app_count++;
 
         if(m_app_count == 1) {
@@ -34,6 +36,7 @@ public:
     }
 
     void app_disconnected() {
+        std::lock_guard<std::mutex> _(m_mutex);
         m_app_count--;
 
         if(m_app_count == 0) {
@@ -63,6 +66,7 @@ public:
 
 
 private:
+    std::mutex m_mutex;
     int m_app_count = 0;
 #ifdef __APPLE__
     IOPMAssertionID m_iokit_assertion_id;
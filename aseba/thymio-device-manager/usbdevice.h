@@ -56,8 +56,8 @@ public:
         void read(const boost::asio::mutable_buffer& b) {
             const auto n = std::min(b.size(), v.size());
             std::copy(v.data(), v.data() + n, static_cast<uint8_t*>(b.data()));
-            auto tmp = std::vector<uint8_t>(v.begin() + n, v.end());
-            v = std::move(tmp);
+            // Keep the storage for the next packets
+            v.erase(v.begin(), v.begin() + n);
             s -= n;
         }
 
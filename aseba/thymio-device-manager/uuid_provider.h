@@ -1,5 +1,6 @@
 #pragma once
 #include <boost/asio/io_service.hpp>
+#include <mutex>
 #include "node_id.h"
 
 namespace mobsya {
@@ -9,10 +10,12 @@ public:
     uuid_generator(boost::asio::execution_context& io_context)
         : boost::asio::detail::service_base<uuid_generator>(static_cast<boost::asio::io_context&>(io_context)) {}
     boost::uuids::uuid generate() {
+        std::lock_guard<std::mutex> _(m_mutex);
         return m_generator();
     }
 
 private:
+    std::mutex m_mutex;
     boost::uuids::random_generator m_generator{};
 };
 
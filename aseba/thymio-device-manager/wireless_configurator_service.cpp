@@ -14,7 +14,8 @@ namespace mobsya {
 
 wireless_configurator_service::wireless_configurator_service(boost::asio::execution_context& ctx)
     : boost::asio::detail::service_base<wireless_configurator_service>(static_cast<boost::asio::io_context&>(ctx))
-    , m_ctx(static_cast<boost::asio::io_context&>(ctx)) {}
+    , m_ctx(static_cast<boost::asio::io_context&>(ctx))
+    , m_strand(m_ctx.get_executor()) {}
 
 wireless_configurator_service::~wireless_configurator_service() {}
 
@@ -24,12 +25,16 @@ void wireless_configurator_service::enable() {
 
 #ifdef MOBSYA_TDM_ENABLE_SERIAL
     auto& service = boost::asio::use_service<serial_acceptor_service>(this->m_ctx);
-    service.device_unplugged.connect(boost::bind(&wireless_configurator_service::device_unplugged, this, _1));
+    service.device_unplugged.connect([this](auto key) {
+        boost::asio::post(m_strand, [this, key] { device_unplugged(key); });
+    });
 #endif
 
 #ifdef MOBSYA_TDM_ENABLE_USB
     auto& service = boost::asio::use_service<usb_acceptor_service>(this->m_ctx);
-    service.device_unplugged.connect(boost::bind(&wireless_configurator_service::device_unplugged, this, _1));
+    service.device_unplugged.connect([this](auto key) {
+        boost::asio::post(m_strand, [this, key] { device_unplugged(key); });
+    });
 #endif
 }
 
@@ -54,11 +59,13 @@ void wireless_configurator_service::register_configurable_dongle(aseba_device&&
     dongle dngle{std::move(d), boost::asio::use_service<uuid_generator>(m_ctx).generate()};
     if(!sync(dngle, false))
         return;
-    m_dongles.emplace(std::pair{id, std::move(dngle)});
-    if(is_enabled()) {
-        wireless_dongles_changed();
-        mLogInfo("Wireless Dongle ready for pairing");
-    }
+    boost::asio::post(m_strand, [this, id, dngle = std::move(dngle)]() mutable {
+        m_dongles.emplace(std::pair{id, std::move(dngle)});
+        if(is_enabled()) {
+            wireless_dongles_changed();
+            mLogInfo("Wireless Dongle ready for pairing");
+        }
+    });
 }
 
 void wireless_configurator_service::disconnect_all_nodes() {
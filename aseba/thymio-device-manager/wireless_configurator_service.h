@@ -1,5 +1,6 @@
 #pragma once
 #include <boost/asio/io_service.hpp>
+#include <atomic>
 #include <vector>
 #include <range/v3/span.hpp>
 
@@ -24,6 +25,11 @@ public:
     wireless_configurator_service(boost::asio::execution_context& ctx);
     ~wireless_configurator_service() override;
 
+    // The dongles are listed and configured on that strand
+    const aseba_node::strand_type& strand() const {
+        return m_strand;
+    }
+
     bool is_enabled() const {
         return m_enabled;
     }
@@ -53,9 +59,10 @@ public:
     configure_dongle(const node_id& n, uint16_t network_id, uint8_t channel);
 
 private:
-    bool m_enabled = false;
+    std::atomic<bool> m_enabled{false};
     void disconnect_all_nodes();
     boost::asio::io_context& m_ctx;
+    aseba_node::strand_type m_strand;
 
 
     bool sync(dongle& dongle, bool flash);
@@ -49,6 +49,11 @@ static void buffer_add_uint16(const uint16_t value) {
     buffer_add((const unsigned char*)&temp, 2);
 }
 
+static void buffer_set_uint16(const unsigned pos, const uint16_t value) {
+    const uint16_t temp = bswap16(value);
+    memcpy(buffer + pos, &temp, 2);
+}
+
 static void buffer_add_int16(const int16_t value) {
     const uint16_t temp = bswap16(value);
     buffer_add((const unsigned char*)&temp, 2);
@@ -120,7 +125,30 @@ void AsebaSendVariables(AsebaVMState* vm, uint16_t start, uint16_t length) {
 #endif
 }
 
-void AsebaSendChangedVariables(AsebaVMState* vm) {
+/* Return whether variable idx has changed since the last call, and forget the change */
+static int AsebaVariableChanged(AsebaVMState* vm, uint16_t idx) {
+#ifdef ASEBA_VM_DIRTY_TRACKING
+    if(vm->variablesDirty) {
+        const uint16_t mask = 1 << (idx & 0xf);
+        if(!(vm->variablesDirty[idx >> 4] & mask))
+            return 0;
+        vm->variablesDirty[idx >> 4] &= ~mask;
+        // without previous values, every written variable is sent
+        if(!vm->variablesOld)
+            return 1;
+    }
+#endif  // ASEBA_VM_DIRTY_TRACKING
+    if(vm->variablesOld[idx] == vm->variables[idx])
+        return 0;
+    vm->variablesOld[idx] = vm->variables[idx];
+    return 1;
+}
+
+/* Send the changed variables of ranges, given as pairs of start and length, in CHANGED_VARIABLES
+   messages holding runs of consecutive variables. If nothing changed, send an empty message only
+   if always is set. Return the number of messages sent. */
+static uint16_t AsebaSendChangedVariablesRanges(AsebaVMState* vm, const uint16_t* ranges, uint16_t count,
+                                                int always) {
 
    /*
     * The wirelesss dongle has a max outgoing packet size that isnt really documented
@@ -132,60 +160,105 @@ void AsebaSendChangedVariables(AsebaVMState* vm) {
     const uint16_t MAX_PACKET_SIZE = ASEBA_MAX_OUTER_PACKET_SIZE - 4;
 #endif
 
-    buffer_pos = 0;
-    int has_modified = 0;
-    unsigned size_pos = 0;
-    uint16_t first_idx = 0;
-    uint16_t idx = 0;
-    uint16_t size = 0;
-    unsigned old_pos = buffer_pos;
+    uint16_t sent = 0;
+    unsigned header_pos = 0;
+    uint16_t run_size = 0;
+    uint16_t r;
 
-    int has_header = 0;
-    for(idx = 0; vm->variablesOld && idx <= vm->variablesSize; idx++) {
+    int can_diff = vm->variablesOld != 0;
+#ifdef ASEBA_VM_DIRTY_TRACKING
+    can_diff = can_diff || vm->variablesDirty != 0;
+#endif  // ASEBA_VM_DIRTY_TRACKING
+    if(!can_diff)
+        return 0;
 
-        int at_end = idx == vm->variablesSize;
+    buffer_pos = 0;
+    for(r = 0; r < count; r++) {
+        uint32_t idx = ranges[2 * r];
+        uint32_t end = idx + ranges[2 * r + 1];
+        if(end > vm->variablesSize)
+            end = vm->variablesSize;
+
+        for(; idx < end; idx++) {
+#ifdef ASEBA_VM_DIRTY_TRACKING
+            // skip 16 variables at once when none of them was written, so that the time
+            // depends on the number of written variables rather than on variablesSize
+            if(vm->variablesDirty && run_size == 0 && (idx & 0xf) == 0 && idx + 16 <= end &&
+               vm->variablesDirty[idx >> 4] == 0) {
+                idx += 15;
+                continue;
+            }
+#endif  // ASEBA_VM_DIRTY_TRACKING
+
+            if(!AsebaVariableChanged(vm, (uint16_t)idx)) {
+                // close the current run
+                if(run_size) {
+                    buffer_set_uint16(header_pos + 2, run_size);
+                    run_size = 0;
+                }
+                continue;
+            }
 
-        if(!has_header) {
+            // a value, and the header of a new run if there is none, must fit in the packet
+            if(buffer_pos + (run_size ? 2 : 6) > MAX_PACKET_SIZE) {
+                if(run_size) {
+                    buffer_set_uint16(header_pos + 2, run_size);
+                    run_size = 0;
+                }
+                AsebaSendBuffer(vm, buffer, buffer_pos);
+                sent++;
+                buffer_pos = 0;
+            }
             if(buffer_pos == 0)
                 buffer_add_uint16(ASEBA_MESSAGE_CHANGED_VARIABLES);
-            size_pos = buffer_pos;
-            buffer_add_uint16(0);  //reserve  2 for start
-            buffer_add_uint16(0);  //reserve 2 for size
-            has_header = 1;
-        }
-
-        int modified = !at_end && vm->variablesOld[idx] != vm->variables[idx];
-        if(modified) {
-            if(!has_modified) {
-                has_modified = 1;
-                first_idx = idx;
+            if(run_size == 0) {
+                header_pos = buffer_pos;
+                buffer_add_uint16((uint16_t)idx);
+                buffer_add_uint16(0);  // size, written when the run is closed
             }
             buffer_add_int16(vm->variables[idx]);
-            size ++;
-            vm->variablesOld[idx] = vm->variables[idx];
+            run_size++;
         }
 
-        int need_to_send_packet = buffer_pos >= MAX_PACKET_SIZE || at_end;
-
-        if((!modified && has_modified) || need_to_send_packet) {
-            old_pos = buffer_pos; //save the buffer pos
-            buffer_pos = size_pos; //then place the cursor where to read the size
-            buffer_add_uint16(first_idx); //write start
-            buffer_add_uint16(size); //write size
-            buffer_pos = old_pos;
-            has_modified = 0;
-            size = 0;
-            first_idx = 0;
-            has_header = 0;
+        // runs do not cross ranges
+        if(run_size) {
+            buffer_set_uint16(header_pos + 2, run_size);
+            run_size = 0;
         }
+    }
 
-        if(need_to_send_packet) {
-            AsebaSendBuffer(vm, buffer, buffer_pos);
-            buffer_pos = 0;
-        }
+    if(buffer_pos == 0 && always && !sent)
+        buffer_add_uint16(ASEBA_MESSAGE_CHANGED_VARIABLES);
+    if(buffer_pos) {
+        AsebaSendBuffer(vm, buffer, buffer_pos);
+        sent++;
     }
     buffer_pos = 0;
+    return sent;
+}
+
+void AsebaSendChangedVariables(AsebaVMState* vm) {
+    uint16_t all[2];
+    all[0] = 0;
+    all[1] = vm->variablesSize;
+    AsebaSendChangedVariablesRanges(vm, all, 1, 1);
+}
+
+#ifdef ASEBA_VM_SUBSCRIPTIONS
+void AsebaPushSubscribedVariables(AsebaVMState* vm, uint16_t time) {
+    if(vm->subscribedRangesCount == 0)
+        return;
+    if(vm->subscriptionWaiting) {
+        if((uint16_t)(time - vm->subscriptionLastPush) < vm->subscriptionPeriod)
+            return;
+        vm->subscriptionWaiting = 0;
+    }
+    if(AsebaSendChangedVariablesRanges(vm, vm->subscribedRanges, vm->subscribedRangesCount, 0)) {
+        vm->subscriptionLastPush = time;
+        vm->subscriptionWaiting = 1;
+    }
 }
+#endif  // ASEBA_VM_SUBSCRIPTIONS
 
 static void AsebaSendDescriptionHead(AsebaVMState* vm) {
     const AsebaVMDescription* vmDescription = AsebaGetVMDescription(vm);
@@ -328,6 +401,7 @@ void AsebaProcessIncomingEvents(AsebaVMState* vm) {
                 vm->variables[argPos++] = source;
                 for(i = 0; (i < argsSize) && (i < payloadSize); i++)
                     vm->variables[argPos + i] = bswap16(payload[i]);
+                AsebaVMMarkVariablesDirty(vm, argPos - 1, i + 1);
                 AsebaVMSetupEvent(vm, type);
             }
         } else {
@@ -38,6 +38,7 @@ extern "C" {
 
     This helper provides to the glue code:
     * AsebaProcessIncomingEvents()
+    * AsebaPushSubscribedVariables(), if ASEBA_VM_SUBSCRIPTIONS is defined
 
     This helper requires from the lower level transport layer:
     * AsebaSendBuffer()
@@ -58,6 +59,13 @@ extern "C" {
 /*! Read messages and process messages from transport layer, if any */
 void AsebaProcessIncomingEvents(AsebaVMState* vm);
 
+#ifdef ASEBA_VM_SUBSCRIPTIONS
+/*! Send the changed variables subscribed with ASEBA_MESSAGE_SUBSCRIBE_VARIABLES, unless the
+    subscription period has not elapsed since the last push. Call it regularly, for instance after
+    running the VM, with a time in ms that may wrap around. */
+void AsebaPushSubscribedVariables(AsebaVMState* vm, uint16_t time);
+#endif  // ASEBA_VM_SUBSCRIPTIONS
+
 // functions this helper needs
 
 extern void AsebaSendBuffer(AsebaVMState* vm, const uint8_t* data, uint16_t length);
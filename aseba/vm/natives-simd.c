@@ -0,0 +1,447 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/types.h"
+#include "natives-simd.h"
+
+/**
+    \file natives-simd.c
+    SIMD kernels of the standard vector natives functions, for host builds.
+
+    SSE2 is part of x86-64 and NEON of AArch64, so they are used whenever the compiler
+    targets them. AVX2 kernels are compiled with a function attribute and selected at run
+    time if the processor supports them. Every kernel processes as many full registers as
+    possible, then finishes with the scalar loop. Sums are computed modulo 2^32, which
+    gives the same result as the scalar natives whatever the order of additions.
+*/
+
+/** \addtogroup vm */
+/*@{*/
+
+#ifdef ASEBA_VM_SIMD
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define ASEBA_SIMD_HAS_SSE2
+#    include <emmintrin.h>
+#    if(defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#        define ASEBA_SIMD_HAS_AVX2
+#        include <immintrin.h>
+#        define AVX2_FUNCTION __attribute__((target("avx2")))
+#    endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#    define ASEBA_SIMD_HAS_NEON
+#    include <arm_neon.h>
+#endif
+
+//! Instruction set in use, -1 if not detected yet
+static int simdLevel = -1;
+
+AsebaSimdLevel AsebaSimdDetectLevel(void) {
+#if defined(ASEBA_SIMD_HAS_AVX2)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return ASEBA_SIMD_AVX2;
+#endif
+#if defined(ASEBA_SIMD_HAS_SSE2)
+    return ASEBA_SIMD_SSE2;
+#elif defined(ASEBA_SIMD_HAS_NEON)
+    return ASEBA_SIMD_NEON;
+#else
+    return ASEBA_SIMD_SCALAR;
+#endif
+}
+
+AsebaSimdLevel AsebaSimdGetLevel(void) {
+    if(simdLevel < 0)
+        simdLevel = AsebaSimdDetectLevel();
+    return (AsebaSimdLevel)simdLevel;
+}
+
+int AsebaSimdSetLevel(AsebaSimdLevel level) {
+    const AsebaSimdLevel best = AsebaSimdDetectLevel();
+    switch(level) {
+        case ASEBA_SIMD_SCALAR: break;
+        case ASEBA_SIMD_SSE2:
+            if(best != ASEBA_SIMD_SSE2 && best != ASEBA_SIMD_AVX2)
+                return 0;
+            break;
+        case ASEBA_SIMD_AVX2:
+        case ASEBA_SIMD_NEON:
+            if(best != level)
+                return 0;
+            break;
+        default: return 0;
+    }
+    simdLevel = level;
+    return 1;
+}
+
+const char* AsebaSimdLevelName(AsebaSimdLevel level) {
+    switch(level) {
+        case ASEBA_SIMD_SCALAR: return "scalar";
+        case ASEBA_SIMD_SSE2: return "sse2";
+        case ASEBA_SIMD_AVX2: return "avx2";
+        case ASEBA_SIMD_NEON: return "neon";
+        default: return "unknown";
+    }
+}
+
+// scalar reference, identical to the loops of the natives
+
+static int16_t scalarAdd(int16_t a, int16_t b) {
+    return (int16_t)(a + b);
+}
+static int16_t scalarSub(int16_t a, int16_t b) {
+    return (int16_t)(a - b);
+}
+static int16_t scalarMul(int16_t a, int16_t b) {
+    return (int16_t)(a * b);
+}
+static int16_t scalarMin(int16_t a, int16_t b) {
+    return a < b ? a : b;
+}
+static int16_t scalarMax(int16_t a, int16_t b) {
+    return a > b ? a : b;
+}
+
+//! Apply op from index i to length, the tail of the kernels
+#define SCALAR_BINARY_LOOP(op)                 \
+    for(; i < length; i++)                     \
+        dest[i] = op(src1[i], src2[i]);
+
+// SSE2 kernels, 8 values per register
+
+#ifdef ASEBA_SIMD_HAS_SSE2
+
+//! Process full registers of dest = op(src1, src2) with SSE2
+#define SSE2_BINARY_LOOP(op)                                                  \
+    for(; i + 8 <= length; i += 8) {                                          \
+        const __m128i a = _mm_loadu_si128((const __m128i*)(src1 + i));        \
+        const __m128i b = _mm_loadu_si128((const __m128i*)(src2 + i));        \
+        _mm_storeu_si128((__m128i*)(dest + i), op(a, b));                     \
+    }
+
+static __m128i sse2Clamp(__m128i v, __m128i l, __m128i h) {
+    const __m128i mask = _mm_cmpgt_epi16(v, h);
+    return _mm_or_si128(_mm_and_si128(mask, h), _mm_andnot_si128(mask, _mm_max_epi16(v, l)));
+}
+
+static uint32_t sse2HorizontalSum(__m128i v) {
+    uint32_t lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+#endif  // ASEBA_SIMD_HAS_SSE2
+
+// AVX2 kernels, 16 values per register
+
+#ifdef ASEBA_SIMD_HAS_AVX2
+
+//! Process full registers of dest = op(src1, src2) with AVX2
+#define AVX2_BINARY_LOOP(op)                                                  \
+    for(; i + 16 <= length; i += 16) {                                        \
+        const __m256i a = _mm256_loadu_si256((const __m256i*)(src1 + i));     \
+        const __m256i b = _mm256_loadu_si256((const __m256i*)(src2 + i));     \
+        _mm256_storeu_si256((__m256i*)(dest + i), op(a, b));                  \
+    }
+
+//! Define an AVX2 element-wise kernel, finishing with SSE2 and scalar code
+#define AVX2_BINARY_KERNEL(name, avx2Op, sse2Op, scalarOp)                                            \
+    static AVX2_FUNCTION void name(int16_t* dest, const int16_t* src1, const int16_t* src2,           \
+                                   uint16_t length) {                                                 \
+        unsigned i = 0;                                                                               \
+        AVX2_BINARY_LOOP(avx2Op)                                                                      \
+        SSE2_BINARY_LOOP(sse2Op)                                                                      \
+        SCALAR_BINARY_LOOP(scalarOp)                                                                  \
+    }
+
+AVX2_BINARY_KERNEL(avx2VecAdd, _mm256_add_epi16, _mm_add_epi16, scalarAdd)
+AVX2_BINARY_KERNEL(avx2VecSub, _mm256_sub_epi16, _mm_sub_epi16, scalarSub)
+AVX2_BINARY_KERNEL(avx2VecMul, _mm256_mullo_epi16, _mm_mullo_epi16, scalarMul)
+AVX2_BINARY_KERNEL(avx2VecMin, _mm256_min_epi16, _mm_min_epi16, scalarMin)
+AVX2_BINARY_KERNEL(avx2VecMax, _mm256_max_epi16, _mm_max_epi16, scalarMax)
+
+static AVX2_FUNCTION void avx2VecClamp(int16_t* dest, const int16_t* src, const int16_t* low, const int16_t* high,
+                                       uint16_t length) {
+    unsigned i = 0;
+    for(; i + 16 <= length; i += 16) {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+        const __m256i l = _mm256_loadu_si256((const __m256i*)(low + i));
+        const __m256i h = _mm256_loadu_si256((const __m256i*)(high + i));
+        const __m256i mask = _mm256_cmpgt_epi16(v, h);
+        _mm256_storeu_si256((__m256i*)(dest + i), _mm256_blendv_epi8(_mm256_max_epi16(v, l), h, mask));
+    }
+    for(; i < length; i++)
+        dest[i] = src[i] > high[i] ? high[i] : (src[i] < low[i] ? low[i] : src[i]);
+}
+
+static AVX2_FUNCTION int32_t avx2VecDot(const int16_t* src1, const int16_t* src2, uint16_t length) {
+    __m256i acc = _mm256_setzero_si256();
+    uint32_t sum;
+    unsigned i = 0;
+    for(; i + 16 <= length; i += 16) {
+        const __m256i a = _mm256_loadu_si256((const __m256i*)(src1 + i));
+        const __m256i b = _mm256_loadu_si256((const __m256i*)(src2 + i));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(a, b));
+    }
+    sum = sse2HorizontalSum(_mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1)));
+    for(; i < length; i++)
+        sum += (uint32_t)((int32_t)src1[i] * (int32_t)src2[i]);
+    return (int32_t)sum;
+}
+
+static AVX2_FUNCTION void avx2VecStat(const int16_t* src, uint16_t length, int16_t* min, int16_t* max,
+                                      int32_t* sum) {
+    int16_t minLanes[16], maxLanes[16];
+    int16_t minValue = src[0], maxValue = src[0];
+    int32_t acc = 0;
+    unsigned i = 0;
+    int j;
+    if(length >= 16) {
+        __m256i vmin = _mm256_loadu_si256((const __m256i*)src);
+        __m256i vmax = vmin;
+        __m256i vsum = _mm256_setzero_si256();
+        const __m256i ones = _mm256_set1_epi16(1);
+        for(; i + 16 <= length; i += 16) {
+            const __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+            vmin = _mm256_min_epi16(vmin, v);
+            vmax = _mm256_max_epi16(vmax, v);
+            vsum = _mm256_add_epi32(vsum, _mm256_madd_epi16(v, ones));
+        }
+        _mm256_storeu_si256((__m256i*)minLanes, vmin);
+        _mm256_storeu_si256((__m256i*)maxLanes, vmax);
+        for(j = 0; j < 16; j++) {
+            minValue = scalarMin(minValue, minLanes[j]);
+            maxValue = scalarMax(maxValue, maxLanes[j]);
+        }
+        acc = (int32_t)sse2HorizontalSum(
+            _mm_add_epi32(_mm256_castsi256_si128(vsum), _mm256_extracti128_si256(vsum, 1)));
+    }
+    for(; i < length; i++) {
+        minValue = scalarMin(minValue, src[i]);
+        maxValue = scalarMax(maxValue, src[i]);
+        acc += src[i];
+    }
+    *min = minValue;
+    *max = maxValue;
+    *sum = acc;
+}
+
+#endif  // ASEBA_SIMD_HAS_AVX2
+
+// NEON kernels, 8 values per register
+
+#ifdef ASEBA_SIMD_HAS_NEON
+
+//! Process full registers of dest = op(src1, src2) with NEON
+#define NEON_BINARY_LOOP(op)                                                          \
+    for(; i + 8 <= length; i += 8)                                                    \
+        vst1q_s16(dest + i, op(vld1q_s16(src1 + i), vld1q_s16(src2 + i)));
+
+#endif  // ASEBA_SIMD_HAS_NEON
+
+//! Define a dispatching element-wise kernel
+#if defined(ASEBA_SIMD_HAS_AVX2)
+#    define BINARY_KERNEL(name, avx2Name, sse2Op, neonOp, scalarOp)                                   \
+        void name(int16_t* dest, const int16_t* src1, const int16_t* src2, uint16_t length) {         \
+            unsigned i = 0;                                                                           \
+            switch(AsebaSimdGetLevel()) {                                                             \
+                case ASEBA_SIMD_AVX2: avx2Name(dest, src1, src2, length); return;                     \
+                case ASEBA_SIMD_SSE2: SSE2_BINARY_LOOP(sse2Op) break;                                 \
+                default: break;                                                                       \
+            }                                                                                         \
+            SCALAR_BINARY_LOOP(scalarOp)                                                              \
+        }
+#elif defined(ASEBA_SIMD_HAS_SSE2)
+#    define BINARY_KERNEL(name, avx2Name, sse2Op, neonOp, scalarOp)                                   \
+        void name(int16_t* dest, const int16_t* src1, const int16_t* src2, uint16_t length) {         \
+            unsigned i = 0;                                                                           \
+            if(AsebaSimdGetLevel() == ASEBA_SIMD_SSE2)                                                \
+                SSE2_BINARY_LOOP(sse2Op)                                                              \
+            SCALAR_BINARY_LOOP(scalarOp)                                                              \
+        }
+#elif defined(ASEBA_SIMD_HAS_NEON)
+#    define BINARY_KERNEL(name, avx2Name, sse2Op, neonOp, scalarOp)                                   \
+        void name(int16_t* dest, const int16_t* src1, const int16_t* src2, uint16_t length) {         \
+            unsigned i = 0;                                                                           \
+            if(AsebaSimdGetLevel() == ASEBA_SIMD_NEON)                                                \
+                NEON_BINARY_LOOP(neonOp)                                                              \
+            SCALAR_BINARY_LOOP(scalarOp)                                                              \
+        }
+#else
+#    define BINARY_KERNEL(name, avx2Name, sse2Op, neonOp, scalarOp)                                   \
+        void name(int16_t* dest, const int16_t* src1, const int16_t* src2, uint16_t length) {         \
+            unsigned i = 0;                                                                           \
+            SCALAR_BINARY_LOOP(scalarOp)                                                              \
+        }
+#endif
+
+BINARY_KERNEL(AsebaSimdVecAdd, avx2VecAdd, _mm_add_epi16, vaddq_s16, scalarAdd)
+BINARY_KERNEL(AsebaSimdVecSub, avx2VecSub, _mm_sub_epi16, vsubq_s16, scalarSub)
+BINARY_KERNEL(AsebaSimdVecMul, avx2VecMul, _mm_mullo_epi16, vmulq_s16, scalarMul)
+BINARY_KERNEL(AsebaSimdVecMin, avx2VecMin, _mm_min_epi16, vminq_s16, scalarMin)
+BINARY_KERNEL(AsebaSimdVecMax, avx2VecMax, _mm_max_epi16, vmaxq_s16, scalarMax)
+
+void AsebaSimdVecClamp(int16_t* dest, const int16_t* src, const int16_t* low, const int16_t* high, uint16_t length) {
+    unsigned i = 0;
+    switch(AsebaSimdGetLevel()) {
+#ifdef ASEBA_SIMD_HAS_AVX2
+        case ASEBA_SIMD_AVX2: avx2VecClamp(dest, src, low, high, length); return;
+#endif
+#ifdef ASEBA_SIMD_HAS_SSE2
+        case ASEBA_SIMD_SSE2:
+            for(; i + 8 <= length; i += 8) {
+                const __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+                const __m128i l = _mm_loadu_si128((const __m128i*)(low + i));
+                const __m128i h = _mm_loadu_si128((const __m128i*)(high + i));
+                _mm_storeu_si128((__m128i*)(dest + i), sse2Clamp(v, l, h));
+            }
+            break;
+#endif
+#ifdef ASEBA_SIMD_HAS_NEON
+        case ASEBA_SIMD_NEON:
+            for(; i + 8 <= length; i += 8) {
+                const int16x8_t v = vld1q_s16(src + i);
+                const int16x8_t h = vld1q_s16(high + i);
+                vst1q_s16(dest + i, vbslq_s16(vcgtq_s16(v, h), h, vmaxq_s16(v, vld1q_s16(low + i))));
+            }
+            break;
+#endif
+        default: break;
+    }
+    for(; i < length; i++)
+        dest[i] = src[i] > high[i] ? high[i] : (src[i] < low[i] ? low[i] : src[i]);
+}
+
+int32_t AsebaSimdVecDot(const int16_t* src1, const int16_t* src2, uint16_t length) {
+    uint32_t sum = 0;
+    unsigned i = 0;
+    switch(AsebaSimdGetLevel()) {
+#ifdef ASEBA_SIMD_HAS_AVX2
+        case ASEBA_SIMD_AVX2: return avx2VecDot(src1, src2, length);
+#endif
+#ifdef ASEBA_SIMD_HAS_SSE2
+        case ASEBA_SIMD_SSE2: {
+            __m128i acc = _mm_setzero_si128();
+            for(; i + 8 <= length; i += 8) {
+                const __m128i a = _mm_loadu_si128((const __m128i*)(src1 + i));
+                const __m128i b = _mm_loadu_si128((const __m128i*)(src2 + i));
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(a, b));
+            }
+            sum = sse2HorizontalSum(acc);
+            break;
+        }
+#endif
+#ifdef ASEBA_SIMD_HAS_NEON
+        case ASEBA_SIMD_NEON: {
+            int32x4_t acc = vdupq_n_s32(0);
+            for(; i + 8 <= length; i += 8) {
+                const int16x8_t a = vld1q_s16(src1 + i);
+                const int16x8_t b = vld1q_s16(src2 + i);
+                acc = vmlal_s16(acc, vget_low_s16(a), vget_low_s16(b));
+                acc = vmlal_s16(acc, vget_high_s16(a), vget_high_s16(b));
+            }
+            sum = (uint32_t)vgetq_lane_s32(acc, 0) + (uint32_t)vgetq_lane_s32(acc, 1) +
+                (uint32_t)vgetq_lane_s32(acc, 2) + (uint32_t)vgetq_lane_s32(acc, 3);
+            break;
+        }
+#endif
+        default: break;
+    }
+    for(; i < length; i++)
+        sum += (uint32_t)((int32_t)src1[i] * (int32_t)src2[i]);
+    return (int32_t)sum;
+}
+
+void AsebaSimdVecStat(const int16_t* src, uint16_t length, int16_t* min, int16_t* max, int32_t* sum) {
+    int16_t minValue = src[0], maxValue = src[0];
+    int32_t acc = 0;
+    unsigned i = 0;
+    switch(AsebaSimdGetLevel()) {
+#ifdef ASEBA_SIMD_HAS_AVX2
+        case ASEBA_SIMD_AVX2: avx2VecStat(src, length, min, max, sum); return;
+#endif
+#ifdef ASEBA_SIMD_HAS_SSE2
+        case ASEBA_SIMD_SSE2:
+            if(length >= 8) {
+                int16_t minLanes[8], maxLanes[8];
+                int j;
+                __m128i vmin = _mm_loadu_si128((const __m128i*)src);
+                __m128i vmax = vmin;
+                __m128i vsum = _mm_setzero_si128();
+                const __m128i ones = _mm_set1_epi16(1);
+                for(; i + 8 <= length; i += 8) {
+                    const __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+                    vmin = _mm_min_epi16(vmin, v);
+                    vmax = _mm_max_epi16(vmax, v);
+                    vsum = _mm_add_epi32(vsum, _mm_madd_epi16(v, ones));
+                }
+                _mm_storeu_si128((__m128i*)minLanes, vmin);
+                _mm_storeu_si128((__m128i*)maxLanes, vmax);
+                for(j = 0; j < 8; j++) {
+                    minValue = scalarMin(minValue, minLanes[j]);
+                    maxValue = scalarMax(maxValue, maxLanes[j]);
+                }
+                acc = (int32_t)sse2HorizontalSum(vsum);
+            }
+            break;
+#endif
+#ifdef ASEBA_SIMD_HAS_NEON
+        case ASEBA_SIMD_NEON:
+            if(length >= 8) {
+                int16_t minLanes[8], maxLanes[8];
+                int j;
+                int16x8_t vmin = vld1q_s16(src);
+                int16x8_t vmax = vmin;
+                int32x4_t vsum = vdupq_n_s32(0);
+                for(; i + 8 <= length; i += 8) {
+                    const int16x8_t v = vld1q_s16(src + i);
+                    vmin = vminq_s16(vmin, v);
+                    vmax = vmaxq_s16(vmax, v);
+                    vsum = vpadalq_s16(vsum, v);
+                }
+                vst1q_s16(minLanes, vmin);
+                vst1q_s16(maxLanes, vmax);
+                for(j = 0; j < 8; j++) {
+                    minValue = scalarMin(minValue, minLanes[j]);
+                    maxValue = scalarMax(maxValue, maxLanes[j]);
+                }
+                acc = vgetq_lane_s32(vsum, 0) + vgetq_lane_s32(vsum, 1) + vgetq_lane_s32(vsum, 2) +
+                    vgetq_lane_s32(vsum, 3);
+            }
+            break;
+#endif
+        default: break;
+    }
+    for(; i < length; i++) {
+        minValue = scalarMin(minValue, src[i]);
+        maxValue = scalarMax(maxValue, src[i]);
+        acc += src[i];
+    }
+    *min = minValue;
+    *max = maxValue;
+    *sum = acc;
+}
+
+#endif  // ASEBA_VM_SIMD
+
+/*@}*/
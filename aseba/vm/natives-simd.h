@@ -0,0 +1,82 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ASEBA_NATIVES_SIMD_H
+#define __ASEBA_NATIVES_SIMD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common/types.h"
+
+/**
+    \file natives-simd.h
+    SIMD kernels of the standard vector natives functions, for host builds.
+
+    The kernels work on plain arrays of 16-bit values, with the wraparound semantics of
+    the scalar natives. The source and destination arrays must either be the same, or the
+    destination must start before the sources or not overlap them; the natives use their
+    scalar loop otherwise, as the result depends on the order of evaluation.
+*/
+
+/** \addtogroup vm */
+/*@{*/
+
+/*! Instruction sets usable by the kernels */
+typedef enum {
+    ASEBA_SIMD_SCALAR = 0, /*!< plain C loops, the reference implementation */
+    ASEBA_SIMD_SSE2,       /*!< x86 SSE2, 8 values at once */
+    ASEBA_SIMD_AVX2,       /*!< x86 AVX2, 16 values at once */
+    ASEBA_SIMD_NEON        /*!< ARM NEON, 8 values at once */
+} AsebaSimdLevel;
+
+/*! Return the best instruction set supported by the compiler and the processor */
+AsebaSimdLevel AsebaSimdDetectLevel(void);
+/*! Return the instruction set currently used by the kernels, detected at first use */
+AsebaSimdLevel AsebaSimdGetLevel(void);
+/*! Force the instruction set used by the kernels, for tests and benchmarks; return 0 if unsupported */
+int AsebaSimdSetLevel(AsebaSimdLevel level);
+/*! Return a printable name of an instruction set */
+const char* AsebaSimdLevelName(AsebaSimdLevel level);
+
+/*! dest = src1 + src2, element by element */
+void AsebaSimdVecAdd(int16_t* dest, const int16_t* src1, const int16_t* src2, uint16_t length);
+/*! dest = src1 - src2, element by element */
+void AsebaSimdVecSub(int16_t* dest, const int16_t* src1, const int16_t* src2, uint16_t length);
+/*! dest = src1 * src2, element by element */
+void AsebaSimdVecMul(int16_t* dest, const int16_t* src1, const int16_t* src2, uint16_t length);
+/*! dest = min(src1, src2), element by element */
+void AsebaSimdVecMin(int16_t* dest, const int16_t* src1, const int16_t* src2, uint16_t length);
+/*! dest = max(src1, src2), element by element */
+void AsebaSimdVecMax(int16_t* dest, const int16_t* src1, const int16_t* src2, uint16_t length);
+/*! dest = src > high ? high : (src < low ? low : src), element by element */
+void AsebaSimdVecClamp(int16_t* dest, const int16_t* src, const int16_t* low, const int16_t* high, uint16_t length);
+/*! Return the sum of src1 * src2, modulo 2^32 */
+int32_t AsebaSimdVecDot(const int16_t* src1, const int16_t* src2, uint16_t length);
+/*! Compute the minimum, maximum and sum of src, length must be at least 1 */
+void AsebaSimdVecStat(const int16_t* src, uint16_t length, int16_t* min, int16_t* max, int32_t* sum);
+
+/*@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -21,6 +21,9 @@
 #include "common/consts.h"
 #include "common/types.h"
 #include "natives.h"
+#ifdef ASEBA_VM_SIMD
+#    include "natives-simd.h"
+#endif
 #include <string.h>
 
 #include <assert.h>
@@ -256,37 +259,202 @@ int16_t aseba_sqrt(int16_t num) {
     return res;
 }
 
-// comb sort ( from Wikipedia )
-void aseba_comb_sort(int16_t* input, uint16_t size) {
-    uint16_t gap = size;
-    uint16_t swapped = 0;
+// sorting of math.sort and math.argsort, in place and without allocation
+
+//! Largest array sorted by a sorting network
+#define ASEBA_SORT_NETWORK_MAX 8
+//! Largest partition of the introsort finished by an insertion sort
+#define ASEBA_SORT_INSERTION_MAX 16
+
+// optimal sorting networks for 2 to 8 elements, as pairs of indices to compare and exchange
+static const uint8_t aseba_sort_network2[] = {0, 1};
+static const uint8_t aseba_sort_network3[] = {0, 1, 1, 2, 0, 1};
+static const uint8_t aseba_sort_network4[] = {0, 1, 2, 3, 0, 2, 1, 3, 1, 2};
+static const uint8_t aseba_sort_network5[] = {0, 1, 3, 4, 2, 4, 2, 3, 1, 4, 0, 3, 0, 2, 1, 3, 1, 2};
+static const uint8_t aseba_sort_network6[] = {1, 2, 4, 5, 0, 2, 3, 5, 0, 1, 3, 4, 2, 5, 0, 3, 1, 4, 2, 4, 1, 3, 2, 3};
+static const uint8_t aseba_sort_network7[] = {1, 2, 3, 4, 5, 6, 0, 2, 3, 5, 4, 6, 0, 1, 4, 5, 2, 6, 0, 4, 1, 5,
+                                              0, 3, 2, 5, 1, 3, 2, 4, 2, 3};
+static const uint8_t aseba_sort_network8[] = {0, 2, 1, 3, 4, 6, 5, 7, 0, 4, 1, 5, 2, 6, 3, 7, 0, 1, 2, 3,
+                                              4, 5, 6, 7, 2, 4, 3, 5, 1, 4, 3, 6, 1, 2, 3, 4, 5, 6};
+
+static const uint8_t* const aseba_sort_networks[ASEBA_SORT_NETWORK_MAX + 1] = {
+    0, 0, aseba_sort_network2, aseba_sort_network3, aseba_sort_network4, aseba_sort_network5, aseba_sort_network6,
+    aseba_sort_network7, aseba_sort_network8};
+static const uint8_t aseba_sort_network_sizes[ASEBA_SORT_NETWORK_MAX + 1] = {
+    0,
+    0,
+    sizeof(aseba_sort_network2) / 2,
+    sizeof(aseba_sort_network3) / 2,
+    sizeof(aseba_sort_network4) / 2,
+    sizeof(aseba_sort_network5) / 2,
+    sizeof(aseba_sort_network6) / 2,
+    sizeof(aseba_sort_network7) / 2,
+    sizeof(aseba_sort_network8) / 2};
+
+//! Return whether a must come before b. Without key, a and b are the values to sort; with key,
+//! they are indices in key, ordered by value and then by index so that the order is total and stable.
+static int aseba_sort_less(int16_t a, int16_t b, const int16_t* key) {
+    if(key == 0)
+        return a < b;
+    if(key[(uint16_t)a] != key[(uint16_t)b])
+        return key[(uint16_t)a] < key[(uint16_t)b];
+    return (uint16_t)a < (uint16_t)b;
+}
+
+static void aseba_sort_swap(int16_t* input, uint16_t i, uint16_t j) {
+    int16_t swap = input[i];
+    input[i] = input[j];
+    input[j] = swap;
+}
+
+//! Insertion sort of input[begin..end), giving up once more than limit elements have been moved;
+//! return whether the range is sorted
+static int aseba_sort_insertion(int16_t* input, uint16_t begin, uint16_t end, uint32_t limit, const int16_t* key) {
+    uint32_t moves = 0;
+    uint16_t i, j;
+
+    for(i = begin + 1; i < end; i++) {
+        int16_t value = input[i];
+        for(j = i; j > begin && aseba_sort_less(value, input[j - 1], key); j--)
+            input[j] = input[j - 1];
+        input[j] = value;
+        moves += i - j;
+        if(moves > limit && i + 1 < end)
+            return 0;
+    }
+    return 1;
+}
+
+//! Move input[begin + root] down the heap of input[begin..begin+size)
+static void aseba_sort_sift_down(int16_t* input, uint16_t begin, uint16_t root, uint16_t size, const int16_t* key) {
+    int16_t value = input[begin + root];
+    for(;;) {
+        uint32_t child = 2 * (uint32_t)root + 1;
+        if(child >= size)
+            break;
+        if(child + 1 < size && aseba_sort_less(input[begin + child], input[begin + child + 1], key))
+            child++;
+        if(!aseba_sort_less(value, input[begin + child], key))
+            break;
+        input[begin + root] = input[begin + child];
+        root = (uint16_t)child;
+    }
+    input[begin + root] = value;
+}
+
+//! Heap sort of input[begin..end)
+static void aseba_sort_heap(int16_t* input, uint16_t begin, uint16_t end, const int16_t* key) {
+    uint16_t size = end - begin;
     uint16_t i;
 
-    while((gap > 1) || swapped) {
-        if(gap > 1) {
-#ifdef __C30__
-            gap = __builtin_divud(__builtin_muluu(gap, 4), 5);
-#else
-            gap = (uint16_t)(((uint32_t)gap * 4) / 5);
-#endif
+    for(i = size / 2; i > 0; i--)
+        aseba_sort_sift_down(input, begin, i - 1, size, key);
+    for(i = size - 1; i > 0; i--) {
+        aseba_sort_swap(input, begin, begin + i);
+        aseba_sort_sift_down(input, begin, 0, i, key);
+    }
+}
+
+//! Introsort of input[begin..end): quicksort with a median of three pivot, falling back to heap sort
+//! after depth partitions; recursion only goes into the smaller part, so the stack stays logarithmic
+static void aseba_sort_intro(int16_t* input, uint16_t begin, uint16_t end, uint16_t depth, const int16_t* key) {
+    while(end - begin > ASEBA_SORT_INSERTION_MAX) {
+        uint16_t middle = begin + (end - begin - 1) / 2;
+        uint16_t last = end - 1;
+        int16_t pivot;
+        int32_t i, j;
+
+        if(depth == 0) {
+            aseba_sort_heap(input, begin, end, key);
+            return;
+        }
+        depth--;
+
+        // order the first, middle and last elements, which then bound the partition loops
+        if(aseba_sort_less(input[middle], input[begin], key))
+            aseba_sort_swap(input, begin, middle);
+        if(aseba_sort_less(input[last], input[middle], key))
+            aseba_sort_swap(input, middle, last);
+        if(aseba_sort_less(input[middle], input[begin], key))
+            aseba_sort_swap(input, begin, middle);
+        pivot = input[middle];
+
+        // Hoare partition into input[begin..j] and input[j+1..end)
+        i = (int32_t)begin - 1;
+        j = end;
+        for(;;) {
+            do
+                i++;
+            while(aseba_sort_less(input[i], pivot, key));
+            do
+                j--;
+            while(aseba_sort_less(pivot, input[j], key));
+            if(i >= j)
+                break;
+            aseba_sort_swap(input, (uint16_t)i, (uint16_t)j);
         }
 
-        swapped = 0;
+        if(j + 1 - begin < end - (j + 1)) {
+            aseba_sort_intro(input, begin, (uint16_t)(j + 1), depth, key);
+            begin = (uint16_t)(j + 1);
+        } else {
+            aseba_sort_intro(input, (uint16_t)(j + 1), end, depth, key);
+            end = (uint16_t)(j + 1);
+        }
+    }
+    aseba_sort_insertion(input, begin, end, 0xffffffff, key);
+}
 
-        for(i = 0; gap + i < size; i++) {
-            if(input[i] - input[i + gap] > 0) {
-                int16_t swap = input[i];
-                input[i] = input[i + gap];
-                input[i + gap] = swap;
-                swapped = 1;
-            }
+//! Sort size elements of input in place. If key is not null, input holds indices in key and is
+//! sorted by the values of key, keeping the order of indices with equal values.
+void aseba_sort(int16_t* input, uint16_t size, const int16_t* key) {
+    uint16_t descents = 0;
+    uint16_t depth = 0;
+    uint16_t i;
+
+    // small arrays, with a fixed sequence of comparisons
+    if(size <= ASEBA_SORT_NETWORK_MAX) {
+        const uint8_t* network = aseba_sort_networks[size];
+        for(i = 0; i < aseba_sort_network_sizes[size]; i++) {
+            if(aseba_sort_less(input[network[2 * i + 1]], input[network[2 * i]], key))
+                aseba_sort_swap(input, network[2 * i], network[2 * i + 1]);
         }
+        return;
+    }
+
+    // already sorted or strictly descending arrays
+    for(i = 1; i < size; i++) {
+        if(aseba_sort_less(input[i], input[i - 1], key))
+            descents++;
     }
+    if(descents == 0)
+        return;
+    if(descents == size - 1) {
+        for(i = 0; i < size / 2; i++)
+            aseba_sort_swap(input, i, size - 1 - i);
+        return;
+    }
+
+    // nearly sorted arrays, for which insertion sort moves few elements
+    if(aseba_sort_insertion(input, 0, size, size, key))
+        return;
+
+    for(i = size; i > 1; i >>= 1)
+        depth += 2;
+    aseba_sort_intro(input, 0, size, depth, key);
 }
 
 
 // standard natives functions
 
+#ifdef ASEBA_VM_SIMD
+//! Return true if SIMD kernels can write length values at dest while reading them at src,
+//! that is if the scalar loop would never read a value it has already written
+static int AsebaNativeIsSimdSafe(uint16_t dest, uint16_t src, uint16_t length) {
+    return dest <= src || dest >= (uint32_t)src + length;
+}
+#endif
+
 void AsebaNative_veccopy(AsebaVMState* vm) {
     // variable pos
     uint16_t dest = AsebaNativePopArg(vm);
@@ -297,6 +465,7 @@ void AsebaNative_veccopy(AsebaVMState* vm) {
 
     uint16_t i;
 
+    AsebaVMMarkVariablesDirty(vm, dest, length);
     for(i = 0; i < length; i++) {
         vm->variables[dest++] = vm->variables[src++];
     }
@@ -317,6 +486,7 @@ void AsebaNative_vecfill(AsebaVMState* vm) {
 
     uint16_t i;
 
+    AsebaVMMarkVariablesDirty(vm, dest, length);
     for(i = 0; i < length; i++) {
         vm->variables[dest++] = vm->variables[value];
     }
@@ -338,6 +508,7 @@ void AsebaNative_vecaddscalar(AsebaVMState* vm) {
 
     const int16_t scalarValue = vm->variables[scalar];
     uint16_t i;
+    AsebaVMMarkVariablesDirty(vm, dest, length);
     for(i = 0; i < length; i++) {
         vm->variables[dest++] = vm->variables[src++] + scalarValue;
     }
@@ -359,6 +530,13 @@ void AsebaNative_vecadd(AsebaVMState* vm) {
     uint16_t length = AsebaNativePopArg(vm);
 
     uint16_t i;
+    AsebaVMMarkVariablesDirty(vm, dest, length);
+#ifdef ASEBA_VM_SIMD
+    if(AsebaNativeIsSimdSafe(dest, src1, length) && AsebaNativeIsSimdSafe(dest, src2, length)) {
+        AsebaSimdVecAdd(vm->variables + dest, vm->variables + src1, vm->variables + src2, length);
+        return;
+    }
+#endif
     for(i = 0; i < length; i++) {
         vm->variables[dest++] = vm->variables[src1++] + vm->variables[src2++];
     }
@@ -380,6 +558,13 @@ void AsebaNative_vecsub(AsebaVMState* vm) {
     uint16_t length = AsebaNativePopArg(vm);
 
     uint16_t i;
+    AsebaVMMarkVariablesDirty(vm, dest, length);
+#ifdef ASEBA_VM_SIMD
+    if(AsebaNativeIsSimdSafe(dest, src1, length) && AsebaNativeIsSimdSafe(dest, src2, length)) {
+        AsebaSimdVecSub(vm->variables + dest, vm->variables + src1, vm->variables + src2, length);
+        return;
+    }
+#endif
     for(i = 0; i < length; i++) {
         vm->variables[dest++] = vm->variables[src1++] - vm->variables[src2++];
     }
@@ -401,6 +586,13 @@ void AsebaNative_vecmul(AsebaVMState* vm) {
     uint16_t length = AsebaNativePopArg(vm);
 
     uint16_t i;
+    AsebaVMMarkVariablesDirty(vm, dest, length);
+#ifdef ASEBA_VM_SIMD
+    if(AsebaNativeIsSimdSafe(dest, src1, length) && AsebaNativeIsSimdSafe(dest, src2, length)) {
+        AsebaSimdVecMul(vm->variables + dest, vm->variables + src1, vm->variables + src2, length);
+        return;
+    }
+#endif
     for(i = 0; i < length; i++) {
         vm->variables[dest++] = vm->variables[src1++] * vm->variables[src2++];
     }
@@ -422,6 +614,7 @@ void AsebaNative_vecdiv(AsebaVMState* vm) {
     uint16_t length = AsebaNativePopArg(vm);
 
     uint16_t i;
+    AsebaVMMarkVariablesDirty(vm, dest, length);
     for(i = 0; i < length; i++) {
         int32_t dividend = (int32_t)vm->variables[src1++];
         int32_t divisor = (int32_t)vm->variables[src2++];
@@ -452,6 +645,13 @@ void AsebaNative_vecmin(AsebaVMState* vm) {
     uint16_t length = AsebaNativePopArg(vm);
 
     uint16_t i;
+    AsebaVMMarkVariablesDirty(vm, dest, length);
+#ifdef ASEBA_VM_SIMD
+    if(AsebaNativeIsSimdSafe(dest, src1, length) && AsebaNativeIsSimdSafe(dest, src2, length)) {
+        AsebaSimdVecMin(vm->variables + dest, vm->variables + src1, vm->variables + src2, length);
+        return;
+    }
+#endif
     for(i = 0; i < length; i++) {
         int16_t v1 = vm->variables[src1++];
         int16_t v2 = vm->variables[src2++];
@@ -476,6 +676,13 @@ void AsebaNative_vecmax(AsebaVMState* vm) {
     uint16_t length = AsebaNativePopArg(vm);
 
     uint16_t i;
+    AsebaVMMarkVariablesDirty(vm, dest, length);
+#ifdef ASEBA_VM_SIMD
+    if(AsebaNativeIsSimdSafe(dest, src1, length) && AsebaNativeIsSimdSafe(dest, src2, length)) {
+        AsebaSimdVecMax(vm->variables + dest, vm->variables + src1, vm->variables + src2, length);
+        return;
+    }
+#endif
     for(i = 0; i < length; i++) {
         int16_t v1 = vm->variables[src1++];
         int16_t v2 = vm->variables[src2++];
@@ -500,6 +707,15 @@ void AsebaNative_vecclamp(AsebaVMState* vm) {
     uint16_t length = AsebaNativePopArg(vm);
 
     uint16_t i;
+    AsebaVMMarkVariablesDirty(vm, dest, length);
+#ifdef ASEBA_VM_SIMD
+    if(AsebaNativeIsSimdSafe(dest, src, length) && AsebaNativeIsSimdSafe(dest, low, length) &&
+       AsebaNativeIsSimdSafe(dest, high, length)) {
+        AsebaSimdVecClamp(vm->variables + dest, vm->variables + src, vm->variables + low, vm->variables + high,
+                          length);
+        return;
+    }
+#endif
     for(i = 0; i < length; i++) {
         int16_t v = vm->variables[src++];
         int16_t l = vm->variables[low++];
@@ -526,6 +742,7 @@ void AsebaNative_vecdot(AsebaVMState* vm) {
     int32_t res = 0;
     uint16_t i;
 
+    AsebaVMMarkVariableDirty(vm, dest);
     if(shift > 32) {
         vm->variables[dest] = 0;
         return;
@@ -564,6 +781,11 @@ void AsebaNative_vecdot(AsebaVMState* vm) {
         res += __builtin_mulss(vm->variables[src1++], vm->variables[src2++]);
     res >>= shift;
     vm->variables[dest] = (int16_t)res;
+#elif defined(ASEBA_VM_SIMD)
+    ASEBA_UNUSED(i);
+    res = AsebaSimdVecDot(vm->variables + src1, vm->variables + src2, length);
+    res >>= shift;
+    vm->variables[dest] = (int16_t)res;
 #else
     for(i = 0; i < length; i++) {
         res += (int32_t)vm->variables[src1++] * (int32_t)vm->variables[src2++];
@@ -592,7 +814,19 @@ void AsebaNative_vecstat(AsebaVMState* vm) {
     int32_t acc;
     uint16_t i;
 
+    AsebaVMMarkVariableDirty(vm, min);
+    AsebaVMMarkVariableDirty(vm, max);
+    AsebaVMMarkVariableDirty(vm, mean);
     if(length) {
+#ifdef ASEBA_VM_SIMD
+        // the scalar loop reads min and max back, so they must not alias each other or src
+        if(min != max && !(min >= src && min < (uint32_t)src + length) &&
+           !(max >= src && max < (uint32_t)src + length)) {
+            AsebaSimdVecStat(vm->variables + src, length, &vm->variables[min], &vm->variables[max], &acc);
+            vm->variables[mean] = (int16_t)(acc / (int32_t)length);
+            return;
+        }
+#endif
         val = vm->variables[src++];
         acc = val;
         vm->variables[min] = val;
@@ -630,6 +864,8 @@ void AsebaNative_vecargbounds(AsebaVMState* vm) {
     int16_t val;
     uint16_t i;
 
+    AsebaVMMarkVariableDirty(vm, argmin);
+    AsebaVMMarkVariableDirty(vm, argmax);
     if(length) {
         for(i = 0; i < length; i++) {
             val = vm->variables[src++];
@@ -658,7 +894,8 @@ void AsebaNative_vecsort(AsebaVMState* vm) {
     // variable size
     uint16_t length = AsebaNativePopArg(vm);
 
-    aseba_comb_sort(&vm->variables[src], length);
+    AsebaVMMarkVariablesDirty(vm, src, length);
+    aseba_sort(&vm->variables[src], length, 0);
 }
 
 const AsebaNativeFunctionDescription AsebaNativeDescription_vecsort = {"math.sort",
@@ -666,6 +903,35 @@ const AsebaNativeFunctionDescription AsebaNativeDescription_vecsort = {"math.sor
                                                                        {{-1, "array"}, {0, 0}}};
 
 
+void AsebaNative_vecargsort(AsebaVMState* vm) {
+    // variable pos
+    uint16_t dest = AsebaNativePopArg(vm);
+    uint16_t src = AsebaNativePopArg(vm);
+
+    // variable size
+    uint16_t length = AsebaNativePopArg(vm);
+
+    uint16_t i;
+
+    // src must stay unchanged while dest is sorted
+    if(dest < (uint32_t)src + length && src < (uint32_t)dest + length) {
+        vm->flags = ASEBA_VM_STEP_BY_STEP_MASK;
+        AsebaSendMessage(vm, ASEBA_MESSAGE_ARRAY_ACCESS_OUT_OF_BOUNDS, &(vm->pc), sizeof(vm->pc));
+        return;
+    }
+
+    AsebaVMMarkVariablesDirty(vm, dest, length);
+    for(i = 0; i < length; i++)
+        vm->variables[dest + i] = i;
+    aseba_sort(&vm->variables[dest], length, &vm->variables[src]);
+}
+
+const AsebaNativeFunctionDescription AsebaNativeDescription_vecargsort = {
+    "math.argsort",
+    "writes to dest the indices that sort src",
+    {{-1, "dest"}, {-1, "src"}, {0, 0}}};
+
+
 void AsebaNative_mathmuldiv(AsebaVMState* vm) {
     // variable pos
     uint16_t destIndex = AsebaNativePopArg(vm);
@@ -677,6 +943,7 @@ void AsebaNative_mathmuldiv(AsebaVMState* vm) {
     uint16_t length = AsebaNativePopArg(vm);
 
     uint16_t i;
+    AsebaVMMarkVariablesDirty(vm, destIndex, length);
     for(i = 0; i < length; i++) {
         int32_t a = (int32_t)vm->variables[aIndex++];
         int32_t b = (int32_t)vm->variables[bIndex++];
@@ -706,6 +973,7 @@ void AsebaNative_mathatan2(AsebaVMState* vm) {
     uint16_t length = AsebaNativePopArg(vm);
 
     uint16_t i;
+    AsebaVMMarkVariablesDirty(vm, destIndex, length);
     for(i = 0; i < length; i++) {
         int16_t y = vm->variables[yIndex++];
         int16_t x = vm->variables[xIndex++];
@@ -727,6 +995,7 @@ void AsebaNative_mathsin(AsebaVMState* vm) {
     uint16_t length = AsebaNativePopArg(vm);
 
     uint16_t i;
+    AsebaVMMarkVariablesDirty(vm, destIndex, length);
     for(i = 0; i < length; i++) {
         int16_t x = vm->variables[xIndex++];
         vm->variables[destIndex++] = aseba_sin(x);
@@ -746,6 +1015,7 @@ void AsebaNative_mathcos(AsebaVMState* vm) {
     uint16_t length = AsebaNativePopArg(vm);
 
     uint16_t i;
+    AsebaVMMarkVariablesDirty(vm, destIndex, length);
     for(i = 0; i < length; i++) {
         int16_t x = vm->variables[xIndex++];
         vm->variables[destIndex++] = aseba_cos(x);
@@ -775,6 +1045,7 @@ void AsebaNative_mathrot2(AsebaVMState* vm) {
 
     vm->variables[vectOutIndex] = xp;
     vm->variables[vectOutIndex + 1] = yp;
+    AsebaVMMarkVariablesDirty(vm, vectOutIndex, 2);
 }
 
 const AsebaNativeFunctionDescription AsebaNativeDescription_mathrot2 = {"math.rot2",
@@ -790,6 +1061,7 @@ void AsebaNative_mathsqrt(AsebaVMState* vm) {
     uint16_t length = AsebaNativePopArg(vm);
 
     uint16_t i;
+    AsebaVMMarkVariablesDirty(vm, destIndex, length);
     for(i = 0; i < length; i++) {
         int16_t x = vm->variables[xIndex++];
         if(x < 0) {
@@ -822,6 +1094,8 @@ void AsebaNative_vecnonzerosequence(AsebaVMState* vm) {
     int16_t bestSeqIndex;
     int16_t seqLength;
 
+    AsebaVMMarkVariableDirty(vm, dest);
+
     // search for a zero, then non-zero
     uint16_t nzFirstIndex = 0;
     while(vm->variables[src + nzFirstIndex] != 0) {
@@ -911,6 +1185,7 @@ void AsebaNative_rand(AsebaVMState* vm) {
     uint16_t length = AsebaNativePopArg(vm);
 
     uint16_t i;
+    AsebaVMMarkVariablesDirty(vm, destIndex, length);
     for(i = 0; i < length; i++) {
         vm->variables[destIndex++] = (int16_t)AsebaGetRandom();
     }
@@ -977,6 +1252,7 @@ void AsebaNative_deqsize(AsebaVMState* vm) {
     // variable size
     (void)/* uint16_t deque_length = */ AsebaNativePopArg(vm);
 
+    AsebaVMMarkVariableDirty(vm, size);
     vm->variables[size++] = vm->variables[deque++];
 }
 
@@ -1000,6 +1276,7 @@ static void _AsebaNative_deqget(AsebaVMState* vm, uint16_t dest, uint16_t deque,
     // copy elements from deque
     uint16_t i;
 
+    AsebaVMMarkVariablesDirty(vm, dest, dest_length);
     for(i = 0; i < dest_length; i++) {
         vm->variables[dest++] = vm->variables[deque + 2 + ((dq_start + index_val + i) % dq_capacity)];
     }
@@ -1056,6 +1333,7 @@ void AsebaNative_deqset(AsebaVMState* vm) {
     // Copy elements into deque
     uint16_t i;
 
+    AsebaVMMarkVariablesDirty(vm, deque, deque_length);
     for(i = 0; i < src_length; i++) {
         vm->variables[deque + 2 + ((dq_start + index_val + i) % dq_capacity)] = vm->variables[src++];
     }
@@ -1079,6 +1357,8 @@ static void _AsebaNative_deqinsert(AsebaVMState* vm, uint16_t deque, uint16_t sr
         return;
     }
 
+    AsebaVMMarkVariablesDirty(vm, deque, deque_length);
+
     // Insert src elements as a block
     // if in left half, shift prefix elements left
     if(index_val < dq_size / 2) {
@@ -1140,6 +1420,8 @@ static void _AsebaNative_deqerase(AsebaVMState* vm, uint16_t deque, uint16_t ind
         return;
     }
 
+    AsebaVMMarkVariablesDirty(vm, deque, deque_length);
+
     // Erase elements as a block
     // if in left half, shift prefix elements right
     if(index_val < dq_size / 2) {
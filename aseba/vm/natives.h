@@ -155,6 +155,11 @@ void AsebaNative_vecsort(AsebaVMState* vm);
 /*! Description of AsebaNative_vecsort */
 extern const AsebaNativeFunctionDescription AsebaNativeDescription_vecsort;
 
+/*! Function to get the indices that sort a vector */
+void AsebaNative_vecargsort(AsebaVMState* vm);
+/*! Description of AsebaNative_vecargsort */
+extern const AsebaNativeFunctionDescription AsebaNativeDescription_vecargsort;
+
 /*! Function to perform dest = (a*b)/c in 32 bits */
 void AsebaNative_mathmuldiv(AsebaVMState* vm);
 /*! Description of AsebaNative_mathmuldiv */
@@ -238,7 +243,7 @@ extern const AsebaNativeFunctionDescription AsebaNativeDescription_deqpopback;
 
 /*! Embedded targets must know the size of ASEBA_NATIVES_STD_FUNCTIONS without having to compute
  * them by hand, please update this when adding a new function */
-#define ASEBA_NATIVES_STD_COUNT 30
+#define ASEBA_NATIVES_STD_COUNT 31
 
 /*! snippet to include standard native functions */
 #define ASEBA_NATIVES_STD_FUNCTIONS                                                                                    \
@@ -248,7 +253,7 @@ extern const AsebaNativeFunctionDescription AsebaNativeDescription_deqpopback;
         AsebaNative_mathmuldiv, AsebaNative_mathatan2, AsebaNative_mathsin, AsebaNative_mathcos, AsebaNative_mathrot2, \
         AsebaNative_mathsqrt, AsebaNative_rand, AsebaNative_deqsize, AsebaNative_deqget, AsebaNative_deqset,           \
         AsebaNative_deqinsert, AsebaNative_deqerase, AsebaNative_deqpushfront, AsebaNative_deqpushback,                \
-        AsebaNative_deqpopfront, AsebaNative_deqpopback
+        AsebaNative_deqpopfront, AsebaNative_deqpopback, AsebaNative_vecargsort
 
 /*! snippet to include descriptions of standard native functions */
 #define ASEBA_NATIVES_STD_DESCRIPTIONS                                                                             \
@@ -261,7 +266,8 @@ extern const AsebaNativeFunctionDescription AsebaNativeDescription_deqpopback;
         &AsebaNativeDescription_mathrot2, &AsebaNativeDescription_mathsqrt, &AsebaNativeDescription_rand,          \
         &AsebaNativeDescription_deqsize, &AsebaNativeDescription_deqget, &AsebaNativeDescription_deqset,           \
         &AsebaNativeDescription_deqinsert, &AsebaNativeDescription_deqerase, &AsebaNativeDescription_deqpushfront, \
-        &AsebaNativeDescription_deqpushback, &AsebaNativeDescription_deqpopfront, &AsebaNativeDescription_deqpopback
+        &AsebaNativeDescription_deqpushback, &AsebaNativeDescription_deqpopfront,                                   \
+        &AsebaNativeDescription_deqpopback, &AsebaNativeDescription_vecargsort
 
 /*@}*/
 
@@ -0,0 +1,651 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/consts.h"
+#include "common/types.h"
+#include "vm.h"
+
+/**
+    \file vm-threaded.c
+    Pre-decoded execution engine of the Aseba Virtual Machine, for host builds.
+
+    The bytecode is decoded once into vm->threadedCode, one entry per bytecode word,
+    holding the address of the handler (computed goto on GCC and Clang, an index into
+    a switch elsewhere) and its operands. The operator of arithmetic and conditional
+    branch bytecodes is fused into the handler, so executing one bytecode costs a
+    single indirect jump instead of the two switches of AsebaVMStep.
+
+    Any bytecode which is rare, talks to the outside world (emit, native calls), or
+    would raise an error or an assertion is executed by AsebaVMStep itself. Hence
+    results, messages and error reports are identical to the switch interpreter.
+    This engine assumes that flags are only modified by the VM and its callbacks,
+    which holds on hosts but not on firmwares clearing ASEBA_VM_EVENT_RUNNING_MASK
+    from interrupts.
+*/
+
+/** \addtogroup vm */
+/*@{*/
+
+#ifdef ASEBA_VM_THREADED
+
+#if defined(__GNUC__) || defined(__clang__)
+#    define ASEBA_VM_COMPUTED_GOTO
+#endif
+
+//! Return true if bit b of v is 1
+#define GET_BIT(v, b) (((v) >> (b)) & 0x1)
+//! Set bit b of v to 1
+#define BIT_SET(v, b) ((v) |= (1 << (b)))
+//! Set bit b of v to 0
+#define BIT_CLR(v, b) ((v) &= (~(1 << (b))))
+
+void AsebaVMStep(AsebaVMState* vm);
+
+/*! List of handlers, binary operators and comparisons in the order of AsebaBinaryOperator */
+#define ASEBA_VM_THREADED_HANDLERS(H) \
+    H(FALLBACK)                       \
+    H(STOP)                           \
+    H(SMALL_IMMEDIATE)                \
+    H(LARGE_IMMEDIATE)                \
+    H(LOAD)                           \
+    H(STORE)                          \
+    H(LOAD_INDIRECT)                  \
+    H(STORE_INDIRECT)                 \
+    H(UNARY_SUB)                      \
+    H(UNARY_ABS)                      \
+    H(UNARY_BIT_NOT)                  \
+    H(SHIFT_LEFT)                     \
+    H(SHIFT_RIGHT)                    \
+    H(ADD)                            \
+    H(SUB)                            \
+    H(MULT)                           \
+    H(DIV)                            \
+    H(MOD)                            \
+    H(BIT_OR)                         \
+    H(BIT_XOR)                        \
+    H(BIT_AND)                        \
+    H(EQUAL)                          \
+    H(NOT_EQUAL)                      \
+    H(BIGGER_THAN)                    \
+    H(BIGGER_EQUAL_THAN)              \
+    H(SMALLER_THAN)                   \
+    H(SMALLER_EQUAL_THAN)             \
+    H(OR)                             \
+    H(AND)                            \
+    H(JUMP)                           \
+    H(BRANCH_EQUAL)                   \
+    H(BRANCH_NOT_EQUAL)               \
+    H(BRANCH_BIGGER_THAN)             \
+    H(BRANCH_BIGGER_EQUAL_THAN)       \
+    H(BRANCH_SMALLER_THAN)            \
+    H(BRANCH_SMALLER_EQUAL_THAN)      \
+    H(SUB_CALL)                       \
+    H(SUB_RET)                        \
+    H(LOAD_OP_STORE)                  \
+    H(IMMEDIATE_OP_IN_PLACE)          \
+    H(LOAD_BRANCH)                    \
+    H(IMMEDIATE_BRANCH)
+
+#define ASEBA_VM_THREADED_ENUM(name) THREADED_##name,
+typedef enum { ASEBA_VM_THREADED_HANDLERS(ASEBA_VM_THREADED_ENUM) THREADED_HANDLERS_COUNT } AsebaVMThreadedHandler;
+#undef ASEBA_VM_THREADED_ENUM
+
+/*! Reasons for leaving AsebaVMThreadedExecute */
+typedef enum {
+    THREADED_EXIT_STOPPED = 0,  //!< the thread is not active or running any more
+    THREADED_EXIT_STEPS_LIMIT,  //!< stepsLimit steps were executed
+    THREADED_EXIT_INVALIDATED   //!< the bytecode changed during execution
+} AsebaVMThreadedExit;
+
+/*! Return whether pc is a valid bytecode address */
+static int AsebaVMThreadedIsInBytecode(const AsebaVMState* vm, int32_t pc) {
+    return (pc >= 0) && (pc < vm->bytecodeSize);
+}
+
+/*! Return whether the operand word at address pc can be pre-decoded.
+    Conditional branches modify their own opcode during execution, so an operand
+    overlapping one of them must be read at run time by the fallback handler. */
+static int AsebaVMThreadedIsStableOperand(const AsebaVMState* vm, int32_t pc) {
+    const uint16_t bytecode = vm->bytecode[pc];
+    if((bytecode >> 12) == ASEBA_BYTECODE_SUPERINSTRUCTION)
+        return ((bytecode >> ASEBA_SUPERINSTRUCTION_SHIFT) & ASEBA_SUPERINSTRUCTION_MASK) <
+            ASEBA_SUPERINSTRUCTION_LOAD_BRANCH;
+    return (bytecode >> 12) != ASEBA_BYTECODE_CONDITIONAL_BRANCH;
+}
+
+/*! Return whether the operand words from pc to pc + count - 1 can be pre-decoded */
+static int AsebaVMThreadedAreStableOperands(const AsebaVMState* vm, int32_t pc, uint16_t count) {
+    uint16_t i;
+    for(i = 0; i < count; i++)
+        if(!AsebaVMThreadedIsStableOperand(vm, pc + i))
+            return 0;
+    return 1;
+}
+
+/*! Decode a superinstruction at address pc, see AsebaVMThreadedDecode.
+    The first operand goes to arg, the second one to arg2, and the third one,
+    a destination variable or a displacement, is validated here but read at run time. */
+static AsebaVMThreadedHandler AsebaVMThreadedDecodeSuperinstruction(const AsebaVMState* vm, uint16_t pc,
+                                                                  AsebaVMThreadedInstr* instr) {
+    const uint16_t bytecode = vm->bytecode[pc];
+    const uint16_t superinstruction = (bytecode >> ASEBA_SUPERINSTRUCTION_SHIFT) & ASEBA_SUPERINSTRUCTION_MASK;
+    const uint16_t length = superinstruction == ASEBA_SUPERINSTRUCTION_IMMEDIATE_OP_IN_PLACE ? 3 : 4;
+    const int32_t next = (int32_t)pc + 1;
+
+    if(!AsebaVMThreadedIsInBytecode(vm, (int32_t)pc + length) ||
+       !AsebaVMThreadedAreStableOperands(vm, next, length - 1) ||
+       (bytecode & ASEBA_BINARY_OPERATOR_MASK) > ASEBA_OP_AND)
+        return THREADED_FALLBACK;
+
+    instr->arg = vm->bytecode[next];
+    instr->arg2 = vm->bytecode[next + 1];
+    if(instr->arg >= vm->variablesSize)
+        return THREADED_FALLBACK;
+
+    switch(superinstruction) {
+        case ASEBA_SUPERINSTRUCTION_LOAD_OP_STORE:
+            if(instr->arg2 >= vm->variablesSize || vm->bytecode[next + 2] >= vm->variablesSize)
+                return THREADED_FALLBACK;
+            return THREADED_LOAD_OP_STORE;
+
+        case ASEBA_SUPERINSTRUCTION_IMMEDIATE_OP_IN_PLACE: return THREADED_IMMEDIATE_OP_IN_PLACE;
+
+        default:
+            if((superinstruction == ASEBA_SUPERINSTRUCTION_LOAD_BRANCH && instr->arg2 >= vm->variablesSize) ||
+               !AsebaVMThreadedIsInBytecode(vm, (int32_t)pc + (int16_t)vm->bytecode[next + 2]))
+                return THREADED_FALLBACK;
+            return superinstruction == ASEBA_SUPERINSTRUCTION_LOAD_BRANCH ? THREADED_LOAD_BRANCH
+                                                                          : THREADED_IMMEDIATE_BRANCH;
+    }
+}
+
+/*! Return the result of a binary operation which does not raise an error,
+    see AsebaVMDoBinaryOperation in vm.c */
+static int16_t AsebaVMThreadedBinaryOperation(int16_t valueOne, int16_t valueTwo, uint16_t op) {
+    switch(op) {
+        case ASEBA_OP_SHIFT_LEFT: return valueOne << valueTwo;
+        case ASEBA_OP_SHIFT_RIGHT: return valueOne >> valueTwo;
+        case ASEBA_OP_ADD: return valueOne + valueTwo;
+        case ASEBA_OP_SUB: return valueOne - valueTwo;
+        case ASEBA_OP_MULT: return valueOne * valueTwo;
+        case ASEBA_OP_DIV: return valueOne / valueTwo;
+        case ASEBA_OP_MOD: return valueOne % valueTwo;
+        case ASEBA_OP_BIT_OR: return valueOne | valueTwo;
+        case ASEBA_OP_BIT_XOR: return valueOne ^ valueTwo;
+        case ASEBA_OP_BIT_AND: return valueOne & valueTwo;
+        case ASEBA_OP_EQUAL: return valueOne == valueTwo;
+        case ASEBA_OP_NOT_EQUAL: return valueOne != valueTwo;
+        case ASEBA_OP_BIGGER_THAN: return valueOne > valueTwo;
+        case ASEBA_OP_BIGGER_EQUAL_THAN: return valueOne >= valueTwo;
+        case ASEBA_OP_SMALLER_THAN: return valueOne < valueTwo;
+        case ASEBA_OP_SMALLER_EQUAL_THAN: return valueOne <= valueTwo;
+        case ASEBA_OP_OR: return valueOne || valueTwo;
+        default: return valueOne && valueTwo;
+    }
+}
+
+/*! Return whether op applied to valueTwo would raise a division by zero */
+static int AsebaVMThreadedIsDivisionByZero(uint16_t op, int16_t valueTwo) {
+    return (op == ASEBA_OP_DIV || op == ASEBA_OP_MOD) && valueTwo == 0;
+}
+
+/*! Decode the bytecode at address pc, assuming that an instruction starts there.
+    Return the handler and fill the operands of instr.
+    Every case that AsebaVMStep would need to check at run time, except the stack
+    and dynamic array bounds, is resolved here by using the fallback handler. */
+static AsebaVMThreadedHandler AsebaVMThreadedDecode(const AsebaVMState* vm, uint16_t pc, AsebaVMThreadedInstr* instr) {
+    const uint16_t bytecode = vm->bytecode[pc];
+    const int32_t next = (int32_t)pc + 1;
+
+    instr->arg = 0;
+    instr->arg2 = 0;
+
+    switch(bytecode >> 12) {
+        case ASEBA_BYTECODE_STOP: return THREADED_STOP;
+
+        case ASEBA_BYTECODE_SMALL_IMMEDIATE:
+            if(!AsebaVMThreadedIsInBytecode(vm, next))
+                return THREADED_FALLBACK;
+            instr->arg = (uint16_t)(((int16_t)(bytecode << 4)) >> 4);
+            return THREADED_SMALL_IMMEDIATE;
+
+        case ASEBA_BYTECODE_LARGE_IMMEDIATE:
+            if(!AsebaVMThreadedIsInBytecode(vm, next + 1) || !AsebaVMThreadedIsStableOperand(vm, next))
+                return THREADED_FALLBACK;
+            instr->arg = vm->bytecode[next];
+            return THREADED_LARGE_IMMEDIATE;
+
+        case ASEBA_BYTECODE_LOAD:
+        case ASEBA_BYTECODE_STORE:
+            if(!AsebaVMThreadedIsInBytecode(vm, next) || (bytecode & 0x0fff) >= vm->variablesSize)
+                return THREADED_FALLBACK;
+            instr->arg = bytecode & 0x0fff;
+            return (bytecode >> 12) == ASEBA_BYTECODE_LOAD ? THREADED_LOAD : THREADED_STORE;
+
+        case ASEBA_BYTECODE_LOAD_INDIRECT:
+        case ASEBA_BYTECODE_STORE_INDIRECT:
+            if(!AsebaVMThreadedIsInBytecode(vm, next + 1) || !AsebaVMThreadedIsStableOperand(vm, next))
+                return THREADED_FALLBACK;
+            instr->arg = bytecode & 0x0fff;
+            instr->arg2 = vm->bytecode[next];
+            return (bytecode >> 12) == ASEBA_BYTECODE_LOAD_INDIRECT ? THREADED_LOAD_INDIRECT : THREADED_STORE_INDIRECT;
+
+        case ASEBA_BYTECODE_UNARY_ARITHMETIC:
+            if(!AsebaVMThreadedIsInBytecode(vm, next))
+                return THREADED_FALLBACK;
+            switch(bytecode & ASEBA_UNARY_OPERATOR_MASK) {
+                case ASEBA_UNARY_OP_SUB: return THREADED_UNARY_SUB;
+                case ASEBA_UNARY_OP_ABS: return THREADED_UNARY_ABS;
+                case ASEBA_UNARY_OP_BIT_NOT: return THREADED_UNARY_BIT_NOT;
+                default: return THREADED_FALLBACK;
+            }
+
+        case ASEBA_BYTECODE_BINARY_ARITHMETIC: {
+            const uint16_t op = bytecode & ASEBA_BINARY_OPERATOR_MASK;
+            if(!AsebaVMThreadedIsInBytecode(vm, next) || op > ASEBA_OP_AND)
+                return THREADED_FALLBACK;
+            return (AsebaVMThreadedHandler)(THREADED_SHIFT_LEFT + op);
+        }
+
+        case ASEBA_BYTECODE_JUMP: {
+            const int32_t dest = (int32_t)pc + (((int16_t)(bytecode << 4)) >> 4);
+            if(!AsebaVMThreadedIsInBytecode(vm, dest))
+                return THREADED_FALLBACK;
+            instr->arg = (uint16_t)dest;
+            return THREADED_JUMP;
+        }
+
+        case ASEBA_BYTECODE_CONDITIONAL_BRANCH: {
+            const uint16_t op = bytecode & ASEBA_BINARY_OPERATOR_MASK;
+            int32_t dest;
+            if(!AsebaVMThreadedIsInBytecode(vm, next + 1) || !AsebaVMThreadedIsStableOperand(vm, next) ||
+               op < ASEBA_OP_EQUAL || op > ASEBA_OP_SMALLER_EQUAL_THAN)
+                return THREADED_FALLBACK;
+            dest = (int32_t)pc + (int16_t)vm->bytecode[next];
+            if(!AsebaVMThreadedIsInBytecode(vm, dest))
+                return THREADED_FALLBACK;
+            instr->arg = (uint16_t)dest;
+            instr->arg2 = GET_BIT(bytecode, ASEBA_IF_IS_WHEN_BIT);
+            return (AsebaVMThreadedHandler)(THREADED_BRANCH_EQUAL + (op - ASEBA_OP_EQUAL));
+        }
+
+        case ASEBA_BYTECODE_SUB_CALL:
+            if(!AsebaVMThreadedIsInBytecode(vm, bytecode & 0x0fff))
+                return THREADED_FALLBACK;
+            instr->arg = bytecode & 0x0fff;
+            return THREADED_SUB_CALL;
+
+        case ASEBA_BYTECODE_SUB_RET: return THREADED_SUB_RET;
+
+        case ASEBA_BYTECODE_SUPERINSTRUCTION: return AsebaVMThreadedDecodeSuperinstruction(vm, pc, instr);
+
+        // emit, native calls and unknown bytecodes
+        default: return THREADED_FALLBACK;
+    }
+}
+
+#ifdef ASEBA_VM_COMPUTED_GOTO
+#    define HANDLER(name) L_##name:
+#    define HANDLER_ADDRESS(h) (handlers[h])
+#    define DISPATCH goto* code[pc].handler
+#    define DISPATCH_BEGIN DISPATCH;
+#    define DISPATCH_END
+#else  // ASEBA_VM_COMPUTED_GOTO
+#    define HANDLER(name) case THREADED_##name:
+#    define HANDLER_ADDRESS(h) ((const void*)(uintptr_t)(h))
+#    define DISPATCH goto dispatch
+#    define DISPATCH_BEGIN \
+    dispatch:              \
+        switch((uintptr_t)code[pc].handler) {
+#    define DISPATCH_END \
+    default: goto fallback; \
+    }
+#endif  // ASEBA_VM_COMPUTED_GOTO
+
+//! Write back the cached registers into vm
+#define SYNC_STATE      \
+    do {                \
+        vm->pc = pc;    \
+        vm->sp = sp;    \
+        *steps = count; \
+    } while(0)
+
+//! Account for one executed bytecode and jump to the next one
+#define NEXT                                            \
+    do {                                                \
+        if(stepsLimit && --count == 0) {                \
+            SYNC_STATE;                                 \
+            return THREADED_EXIT_STEPS_LIMIT;           \
+        }                                               \
+        DISPATCH;                                       \
+    } while(0)
+
+//! Handler of a binary operation without run-time error
+#define BINARY_HANDLER(name, expr)                    \
+    HANDLER(name) {                                   \
+        int16_t valueOne, valueTwo;                   \
+        if(sp < 1)                                    \
+            goto fallback;                            \
+        valueOne = stack[sp - 1];                     \
+        valueTwo = stack[sp];                         \
+        stack[--sp] = (int16_t)(expr);                \
+        pc++;                                         \
+        NEXT;                                         \
+    }
+
+//! Handler of a binary operation raising an error when its second operand is 0
+#define DIVISION_HANDLER(name, expr) \
+    HANDLER(name) {                  \
+        int16_t valueOne, valueTwo;  \
+        if(sp < 1 || stack[sp] == 0) \
+            goto fallback;           \
+        valueOne = stack[sp - 1];    \
+        valueTwo = stack[sp];        \
+        stack[--sp] = (int16_t)(expr); \
+        pc++;                        \
+        NEXT;                        \
+    }
+
+//! Handler of a conditional branch with a comparison operator
+#define BRANCH_HANDLER(name, expr)                                                                  \
+    HANDLER(name) {                                                                                 \
+        int16_t valueOne, valueTwo;                                                                 \
+        int16_t conditionResult;                                                                    \
+        if(sp < 1)                                                                                  \
+            goto fallback;                                                                          \
+        valueOne = stack[sp - 1];                                                                   \
+        valueTwo = stack[sp];                                                                       \
+        conditionResult = (expr);                                                                   \
+        sp -= 2;                                                                                    \
+        if(conditionResult) {                                                                       \
+            const uint16_t wasTrue = GET_BIT(vm->bytecode[pc], ASEBA_IF_WAS_TRUE_BIT);              \
+            BIT_SET(vm->bytecode[pc], ASEBA_IF_WAS_TRUE_BIT);                                       \
+            pc = (code[pc].arg2 && wasTrue) ? code[pc].arg : (uint16_t)(pc + 2);                    \
+        } else {                                                                                    \
+            BIT_CLR(vm->bytecode[pc], ASEBA_IF_WAS_TRUE_BIT);                                       \
+            pc = code[pc].arg;                                                                      \
+        }                                                                                           \
+        NEXT;                                                                                       \
+    }
+
+//! Handler of a superinstruction storing the result of a binary operation into a variable
+#define OP_STORE_HANDLER(name, valueTwoExpr, dest, length)                                         \
+    HANDLER(name) {                                                                                \
+        const uint16_t op = vm->bytecode[pc] & ASEBA_BINARY_OPERATOR_MASK;                         \
+        const int16_t valueTwo = (valueTwoExpr);                                                   \
+        if(AsebaVMThreadedIsDivisionByZero(op, valueTwo))                                          \
+            goto fallback;                                                                         \
+        variables[dest] = AsebaVMThreadedBinaryOperation(variables[code[pc].arg], valueTwo, op);   \
+        AsebaVMMarkVariableDirty(vm, dest);                                                        \
+        pc += length;                                                                              \
+        NEXT;                                                                                      \
+    }
+
+//! Handler of a superinstruction doing a conditional branch, see BRANCH_HANDLER
+#define SUPER_BRANCH_HANDLER(name, valueTwoExpr)                                                    \
+    HANDLER(name) {                                                                                 \
+        const uint16_t bytecode = vm->bytecode[pc];                                                 \
+        const uint16_t op = bytecode & ASEBA_BINARY_OPERATOR_MASK;                                  \
+        const int16_t valueTwo = (valueTwoExpr);                                                    \
+        if(AsebaVMThreadedIsDivisionByZero(op, valueTwo))                                           \
+            goto fallback;                                                                          \
+        if(AsebaVMThreadedBinaryOperation(variables[code[pc].arg], valueTwo, op)) {                 \
+            BIT_SET(vm->bytecode[pc], ASEBA_IF_WAS_TRUE_BIT);                                       \
+            if(GET_BIT(bytecode, ASEBA_IF_IS_WHEN_BIT) && GET_BIT(bytecode, ASEBA_IF_WAS_TRUE_BIT)) \
+                pc = (uint16_t)(pc + (int16_t)vm->bytecode[pc + 3]);                                \
+            else                                                                                    \
+                pc += 4;                                                                            \
+        } else {                                                                                    \
+            BIT_CLR(vm->bytecode[pc], ASEBA_IF_WAS_TRUE_BIT);                                       \
+            pc = (uint16_t)(pc + (int16_t)vm->bytecode[pc + 3]);                                    \
+        }                                                                                           \
+        NEXT;                                                                                       \
+    }
+
+/*! Execute the current thread until it stops, stepsLimit bytecodes are executed (if stepsLimit > 0)
+    or the bytecode is modified. steps holds the number of remaining steps. */
+static AsebaVMThreadedExit AsebaVMThreadedExecute(AsebaVMState* vm, uint16_t stepsLimit, uint16_t* steps) {
+#ifdef ASEBA_VM_COMPUTED_GOTO
+#    define ASEBA_VM_THREADED_LABEL(name) &&L_##name,
+    static const void* const handlers[THREADED_HANDLERS_COUNT] = {
+        ASEBA_VM_THREADED_HANDLERS(ASEBA_VM_THREADED_LABEL)};
+#    undef ASEBA_VM_THREADED_LABEL
+#endif  // ASEBA_VM_COMPUTED_GOTO
+
+    AsebaVMThreadedInstr* const code = vm->threadedCode;
+    int16_t* const stack = vm->stack;
+    int16_t* const variables = vm->variables;
+    uint16_t pc;
+    int16_t sp;
+    uint16_t count = *steps;
+
+    // decode the whole bytecode if it changed, each word as if an instruction started there
+    if(!vm->threadedCodeValid) {
+        uint16_t i;
+        for(i = 0; i < vm->bytecodeSize; i++)
+            code[i].handler = HANDLER_ADDRESS(AsebaVMThreadedDecode(vm, i, &code[i]));
+        vm->threadedCodeValid = 1;
+    }
+
+    pc = vm->pc;
+    sp = vm->sp;
+    if(pc >= vm->bytecodeSize)
+        goto fallback;
+
+    DISPATCH_BEGIN
+
+    HANDLER(FALLBACK)
+    fallback : {
+        // let the switch interpreter execute this bytecode, including its errors and assertions
+        vm->pc = pc;
+        vm->sp = sp;
+        AsebaVMStep(vm);
+        pc = vm->pc;
+        sp = vm->sp;
+        if(stepsLimit && --count == 0) {
+            *steps = count;
+            return THREADED_EXIT_STEPS_LIMIT;
+        }
+        if(AsebaMaskIsClear(vm->flags, ASEBA_VM_EVENT_ACTIVE_MASK) ||
+           AsebaMaskIsClear(vm->flags, ASEBA_VM_EVENT_RUNNING_MASK)) {
+            *steps = count;
+            return THREADED_EXIT_STOPPED;
+        }
+        if(!vm->threadedCodeValid) {
+            *steps = count;
+            return THREADED_EXIT_INVALIDATED;
+        }
+        if(pc >= vm->bytecodeSize)
+            goto fallback;
+        DISPATCH;
+    }
+
+    HANDLER(STOP) {
+        AsebaMaskClear(vm->flags, ASEBA_VM_EVENT_ACTIVE_MASK);
+        SYNC_STATE;
+        if(stepsLimit && --count == 0) {
+            *steps = count;
+            return THREADED_EXIT_STEPS_LIMIT;
+        }
+        return THREADED_EXIT_STOPPED;
+    }
+
+    HANDLER(SMALL_IMMEDIATE) {
+        if(sp + 1 >= vm->stackSize)
+            goto fallback;
+        stack[++sp] = (int16_t)code[pc].arg;
+        pc++;
+        NEXT;
+    }
+
+    HANDLER(LARGE_IMMEDIATE) {
+        if(sp + 1 >= vm->stackSize)
+            goto fallback;
+        stack[++sp] = (int16_t)code[pc].arg;
+        pc += 2;
+        NEXT;
+    }
+
+    HANDLER(LOAD) {
+        if(sp + 1 >= vm->stackSize)
+            goto fallback;
+        stack[++sp] = variables[code[pc].arg];
+        pc++;
+        NEXT;
+    }
+
+    HANDLER(STORE) {
+        if(sp < 0)
+            goto fallback;
+        variables[code[pc].arg] = stack[sp--];
+        AsebaVMMarkVariableDirty(vm, code[pc].arg);
+        pc++;
+        NEXT;
+    }
+
+    HANDLER(LOAD_INDIRECT) {
+        uint16_t variableIndex;
+        if(sp < 0)
+            goto fallback;
+        variableIndex = (uint16_t)stack[sp];
+        if(variableIndex >= code[pc].arg2)
+            goto fallback;
+        stack[sp] = variables[code[pc].arg + variableIndex];
+        pc += 2;
+        NEXT;
+    }
+
+    HANDLER(STORE_INDIRECT) {
+        uint16_t variableIndex;
+        if(sp < 1)
+            goto fallback;
+        variableIndex = (uint16_t)stack[sp];
+        if(variableIndex >= code[pc].arg2)
+            goto fallback;
+        variables[code[pc].arg + variableIndex] = stack[sp - 1];
+        AsebaVMMarkVariableDirty(vm, code[pc].arg + variableIndex);
+        sp -= 2;
+        pc += 2;
+        NEXT;
+    }
+
+    HANDLER(UNARY_SUB) {
+        if(sp < 0)
+            goto fallback;
+        stack[sp] = (int16_t)(-stack[sp]);
+        pc++;
+        NEXT;
+    }
+
+    HANDLER(UNARY_ABS) {
+        if(sp < 0)
+            goto fallback;
+        stack[sp] = (int16_t)(stack[sp] >= 0 ? stack[sp] : -stack[sp]);
+        pc++;
+        NEXT;
+    }
+
+    HANDLER(UNARY_BIT_NOT) {
+        if(sp < 0)
+            goto fallback;
+        stack[sp] = (int16_t)(~stack[sp]);
+        pc++;
+        NEXT;
+    }
+
+    BINARY_HANDLER(SHIFT_LEFT, valueOne << valueTwo)
+    BINARY_HANDLER(SHIFT_RIGHT, valueOne >> valueTwo)
+    BINARY_HANDLER(ADD, valueOne + valueTwo)
+    BINARY_HANDLER(SUB, valueOne - valueTwo)
+    BINARY_HANDLER(MULT, valueOne * valueTwo)
+    DIVISION_HANDLER(DIV, valueOne / valueTwo)
+    DIVISION_HANDLER(MOD, valueOne % valueTwo)
+    BINARY_HANDLER(BIT_OR, valueOne | valueTwo)
+    BINARY_HANDLER(BIT_XOR, valueOne ^ valueTwo)
+    BINARY_HANDLER(BIT_AND, valueOne & valueTwo)
+    BINARY_HANDLER(EQUAL, valueOne == valueTwo)
+    BINARY_HANDLER(NOT_EQUAL, valueOne != valueTwo)
+    BINARY_HANDLER(BIGGER_THAN, valueOne > valueTwo)
+    BINARY_HANDLER(BIGGER_EQUAL_THAN, valueOne >= valueTwo)
+    BINARY_HANDLER(SMALLER_THAN, valueOne < valueTwo)
+    BINARY_HANDLER(SMALLER_EQUAL_THAN, valueOne <= valueTwo)
+    BINARY_HANDLER(OR, valueOne || valueTwo)
+    BINARY_HANDLER(AND, valueOne && valueTwo)
+
+    HANDLER(JUMP) {
+        pc = code[pc].arg;
+        NEXT;
+    }
+
+    BRANCH_HANDLER(BRANCH_EQUAL, valueOne == valueTwo)
+    BRANCH_HANDLER(BRANCH_NOT_EQUAL, valueOne != valueTwo)
+    BRANCH_HANDLER(BRANCH_BIGGER_THAN, valueOne > valueTwo)
+    BRANCH_HANDLER(BRANCH_BIGGER_EQUAL_THAN, valueOne >= valueTwo)
+    BRANCH_HANDLER(BRANCH_SMALLER_THAN, valueOne < valueTwo)
+    BRANCH_HANDLER(BRANCH_SMALLER_EQUAL_THAN, valueOne <= valueTwo)
+
+    HANDLER(SUB_CALL) {
+        if(sp + 1 >= vm->stackSize)
+            goto fallback;
+        stack[++sp] = (int16_t)(pc + 1);
+        pc = code[pc].arg;
+        NEXT;
+    }
+
+    HANDLER(SUB_RET) {
+        if(sp < 0)
+            goto fallback;
+        pc = (uint16_t)stack[sp--];
+        if(pc >= vm->bytecodeSize) {
+            // let the switch interpreter deal with the invalid return address
+            if(stepsLimit && --count == 0) {
+                SYNC_STATE;
+                return THREADED_EXIT_STEPS_LIMIT;
+            }
+            goto fallback;
+        }
+        NEXT;
+    }
+
+    OP_STORE_HANDLER(LOAD_OP_STORE, variables[code[pc].arg2], vm->bytecode[pc + 3], 4)
+    OP_STORE_HANDLER(IMMEDIATE_OP_IN_PLACE, (int16_t)code[pc].arg2, code[pc].arg, 3)
+    SUPER_BRANCH_HANDLER(LOAD_BRANCH, variables[code[pc].arg2])
+    SUPER_BRANCH_HANDLER(IMMEDIATE_BRANCH, (int16_t)code[pc].arg2)
+
+    DISPATCH_END
+}
+
+/*! Run the current thread with the threaded engine, see AsebaDebugBareRun.
+    Return 1 if stepsLimit > 0 and was reached, 0 otherwise. */
+uint16_t AsebaVMThreadedRun(AsebaVMState* vm, uint16_t stepsLimit) {
+    uint16_t steps = stepsLimit;
+    while(AsebaMaskIsSet(vm->flags, ASEBA_VM_EVENT_ACTIVE_MASK) &&
+          AsebaMaskIsSet(vm->flags, ASEBA_VM_EVENT_RUNNING_MASK)) {
+        switch(AsebaVMThreadedExecute(vm, stepsLimit, &steps)) {
+            case THREADED_EXIT_STEPS_LIMIT: return 1;
+            case THREADED_EXIT_STOPPED: return 0;
+            default: break;  // bytecode changed, decode it again
+        }
+    }
+    return 0;
+}
+
+#endif  // ASEBA_VM_THREADED
+
+/*@}*/
@@ -41,21 +41,91 @@
 
 void AsebaVMSendExecutionStateChanged(AsebaVMState* vm);
 
+#ifdef ASEBA_VM_THREADED
+uint16_t AsebaVMThreadedRun(AsebaVMState* vm, uint16_t stepsLimit);
+#endif  // ASEBA_VM_THREADED
+
 void AsebaVMInit(AsebaVMState* vm) {
     vm->pc = 0;
     vm->flags = 0;
     vm->breakpointsCount = 0;
+#ifdef ASEBA_VM_SUBSCRIPTIONS
+    vm->subscribedRangesCount = 0;
+    vm->subscriptionWaiting = 0;
+#endif  // ASEBA_VM_SUBSCRIPTIONS
+#ifdef ASEBA_VM_THREADED
+    vm->threadedCodeValid = 0;
+#endif  // ASEBA_VM_THREADED
+#ifdef ASEBA_VM_EVENT_TABLE
+    vm->eventTableValid = 0;
+#endif  // ASEBA_VM_EVENT_TABLE
 
     // fill with no event
     vm->bytecode[0] = 0;
     memset(vm->variables, 0, vm->variablesSize * sizeof(int16_t));
-    memset(vm->variablesOld, 0, vm->variablesSize * sizeof(int16_t));
+    if(vm->variablesOld)
+        memset(vm->variablesOld, 0, vm->variablesSize * sizeof(int16_t));
+#ifdef ASEBA_VM_DIRTY_TRACKING
+    if(vm->variablesDirty)
+        memset(vm->variablesDirty, 0, ((vm->variablesSize + 15) / 16) * sizeof(uint16_t));
+#endif  // ASEBA_VM_DIRTY_TRACKING
+}
+
+#ifdef ASEBA_VM_EVENT_TABLE
+/*! Rebuild the event table from the event vector, sorted by event identifier.
+    The insertion is stable so that the first of duplicated events comes first. */
+static void AsebaVMBuildEventTable(AsebaVMState* vm) {
+    uint16_t eventVectorSize = vm->bytecode[0];
+    uint16_t i;
+
+    vm->eventTableCount = 0;
+    for(i = 1; i < eventVectorSize; i += 2) {
+        const uint16_t event = vm->bytecode[i];
+        uint16_t j = vm->eventTableCount;
+        while(j > 0 && vm->eventTable[j - 1].event > event) {
+            vm->eventTable[j] = vm->eventTable[j - 1];
+            j--;
+        }
+        vm->eventTable[j].event = event;
+        vm->eventTable[j].address = vm->bytecode[i + 1];
+        vm->eventTableCount++;
+    }
+    vm->eventTableValid = 1;
 }
 
+/*! Binary search of an event in the event table, rebuilt if bytecode changed */
+static uint16_t AsebaVMLookupEventTable(AsebaVMState* vm, uint16_t event) {
+    uint16_t first = 0;
+    uint16_t last;
+
+    if(!vm->eventTableValid)
+        AsebaVMBuildEventTable(vm);
+
+    // find the first entry not smaller than event
+    last = vm->eventTableCount;
+    while(first < last) {
+        const uint16_t middle = first + (last - first) / 2;
+        if(vm->eventTable[middle].event < event)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    if(first < vm->eventTableCount && vm->eventTable[first].event == event)
+        return vm->eventTable[first].address;
+    return 0;
+}
+#endif  // ASEBA_VM_EVENT_TABLE
+
 uint16_t AsebaVMGetEventAddress(AsebaVMState* vm, uint16_t event) {
     uint16_t eventVectorSize = vm->bytecode[0];
     uint16_t i;
 
+#ifdef ASEBA_VM_EVENT_TABLE
+    // use the lookup table if it can hold the whole event vector
+    if(vm->eventTable && eventVectorSize / 2 <= vm->eventTableSize)
+        return AsebaVMLookupEventTable(vm, event);
+#endif  // ASEBA_VM_EVENT_TABLE
+
     // look into event vectors and if event match execute corresponding bytecode
     for(i = 1; i < eventVectorSize; i += 2)
         if(vm->bytecode[i] == event)
@@ -231,6 +301,7 @@ void AsebaVMStep(AsebaVMState* vm) {
 
             // pop value from stack
             vm->variables[variableIndex] = vm->stack[vm->sp--];
+            AsebaVMMarkVariableDirty(vm, variableIndex);
 
             // increment PC
             vm->pc++;
@@ -307,6 +378,7 @@ void AsebaVMStep(AsebaVMState* vm) {
 
             // store variable and change sp
             vm->variables[arrayIndex + variableIndex] = variableValue;
+            AsebaVMMarkVariableDirty(vm, arrayIndex + variableIndex);
             vm->sp -= 2;
 
             // increment PC
@@ -473,6 +545,88 @@ void AsebaVMStep(AsebaVMState* vm) {
             vm->pc = vm->stack[vm->sp--];
         } break;
 
+        // Bytecode: Superinstruction
+        case ASEBA_BYTECODE_SUPERINSTRUCTION: {
+            const uint16_t superinstruction = (bytecode >> ASEBA_SUPERINSTRUCTION_SHIFT) & ASEBA_SUPERINSTRUCTION_MASK;
+            uint16_t variableIndex = vm->bytecode[vm->pc + 1];
+            int16_t valueOne, valueTwo, opResult;
+
+// check variable index
+#ifdef ASEBA_ASSERT
+            if(variableIndex >= vm->variablesSize)
+                AsebaAssert(vm, ASEBA_ASSERT_OUT_OF_VARIABLES_BOUNDS);
+#endif
+
+            // get operands, the second one being either a variable or an immediate
+            valueOne = vm->variables[variableIndex];
+            if(superinstruction == ASEBA_SUPERINSTRUCTION_LOAD_OP_STORE ||
+               superinstruction == ASEBA_SUPERINSTRUCTION_LOAD_BRANCH) {
+                uint16_t secondVariableIndex = vm->bytecode[vm->pc + 2];
+#ifdef ASEBA_ASSERT
+                if(secondVariableIndex >= vm->variablesSize)
+                    AsebaAssert(vm, ASEBA_ASSERT_OUT_OF_VARIABLES_BOUNDS);
+#endif
+                valueTwo = vm->variables[secondVariableIndex];
+            } else {
+                valueTwo = (int16_t)vm->bytecode[vm->pc + 2];
+            }
+
+            // do operation
+            opResult = AsebaVMDoBinaryOperation(vm, valueOne, valueTwo, bytecode & ASEBA_BINARY_OPERATOR_MASK);
+
+            switch(superinstruction) {
+                case ASEBA_SUPERINSTRUCTION_LOAD_OP_STORE:
+                case ASEBA_SUPERINSTRUCTION_IMMEDIATE_OP_IN_PLACE: {
+                    // on error, the thread is stopped before the store, as in the unfused sequence
+                    if(AsebaMaskIsClear(vm->flags, ASEBA_VM_EVENT_ACTIVE_MASK))
+                        break;
+
+                    if(superinstruction == ASEBA_SUPERINSTRUCTION_LOAD_OP_STORE) {
+                        variableIndex = vm->bytecode[vm->pc + 3];
+#ifdef ASEBA_ASSERT
+                        if(variableIndex >= vm->variablesSize)
+                            AsebaAssert(vm, ASEBA_ASSERT_OUT_OF_VARIABLES_BOUNDS);
+#endif
+                        vm->variables[variableIndex] = opResult;
+                        vm->pc += 4;
+                    } else {
+                        vm->variables[variableIndex] = opResult;
+                        vm->pc += 3;
+                    }
+                    AsebaVMMarkVariableDirty(vm, variableIndex);
+                } break;
+
+                default: {
+                    int16_t disp;
+
+                    // is the condition really true ?
+                    if(opResult &&
+                       !(GET_BIT(bytecode, ASEBA_IF_IS_WHEN_BIT) && GET_BIT(bytecode, ASEBA_IF_WAS_TRUE_BIT))) {
+                        // if true disp
+                        disp = 4;
+                    } else {
+                        // if false disp
+                        disp = (int16_t)vm->bytecode[vm->pc + 3];
+                    }
+
+                    // write back condition result
+                    if(opResult)
+                        BIT_SET(vm->bytecode[vm->pc], ASEBA_IF_WAS_TRUE_BIT);
+                    else
+                        BIT_CLR(vm->bytecode[vm->pc], ASEBA_IF_WAS_TRUE_BIT);
+
+// check pc
+#ifdef ASEBA_ASSERT
+                    if((vm->pc + disp < 0) || (vm->pc + disp >= vm->bytecodeSize))
+                        AsebaAssert(vm, ASEBA_ASSERT_OUT_OF_BYTECODE_BOUNDS);
+#endif
+
+                    // do branch
+                    vm->pc += disp;
+                } break;
+            }
+        } break;
+
         default:
 #ifdef ASEBA_ASSERT
             AsebaAssert(vm, ASEBA_ASSERT_UNKNOWN_BYTECODE);
@@ -528,6 +682,16 @@ static void killSlowEvent(AsebaVMState* vm) {
 void AsebaDebugBareRun(AsebaVMState* vm, uint16_t stepsLimit) {
     AsebaMaskSet(vm->flags, ASEBA_VM_EVENT_RUNNING_MASK);
 
+#ifdef ASEBA_VM_THREADED
+    // pre-decoded execution, same semantics as the loops below
+    if(vm->threadedCode) {
+        if(AsebaVMThreadedRun(vm, stepsLimit))
+            killSlowEvent(vm);
+        AsebaMaskClear(vm->flags, ASEBA_VM_EVENT_RUNNING_MASK);
+        return;
+    }
+#endif  // ASEBA_VM_THREADED
+
     if(stepsLimit > 0) {
         // no breakpoint, still poll the mask and check stepsLimit
         while(AsebaMaskIsSet(vm->flags, ASEBA_VM_EVENT_ACTIVE_MASK) &&
@@ -648,9 +812,8 @@ void AsebaVMSendExecutionStateChanged(AsebaVMState* vm) {
 
 /*! Reset all when flags in their default states in the bytecode */
 static void AsebaVMResetWhenFlags(AsebaVMState* vm) {
-    // start at the end of event vector table
-    const uint16_t eventVectSize = vm->bytecode[0];
-    uint16_t pc = eventVectSize * 2 + 1;
+    // start at the end of event vector table, whose size in words is its first word
+    uint16_t pc = vm->bytecode[0];
     while(pc < vm->bytecodeSize) {
         // Iterate through all bytecode, skipping multi-word instructions.
         // Single-word instructions are commented-out and handled by the
@@ -680,6 +843,17 @@ static void AsebaVMResetWhenFlags(AsebaVMState* vm) {
                 // case ASEBA_BYTECODE_NATIVE_CALL:        pc += 1; break;
                 // case ASEBA_BYTECODE_SUB_CALL:           pc += 1; break;
                 // case ASEBA_BYTECODE_SUB_RET:            pc += 1; break;
+            case ASEBA_BYTECODE_SUPERINSTRUCTION:
+                switch((vm->bytecode[pc] >> ASEBA_SUPERINSTRUCTION_SHIFT) & ASEBA_SUPERINSTRUCTION_MASK) {
+                    case ASEBA_SUPERINSTRUCTION_IMMEDIATE_OP_IN_PLACE: pc += 3; break;
+                    case ASEBA_SUPERINSTRUCTION_LOAD_BRANCH:
+                    case ASEBA_SUPERINSTRUCTION_IMMEDIATE_BRANCH:
+                        BIT_CLR(vm->bytecode[pc], ASEBA_IF_WAS_TRUE_BIT);
+                        pc += 4;
+                        break;
+                    default: pc += 4; break;
+                }
+                break;
             default: pc += 1; break;
         }
     }
@@ -726,12 +900,18 @@ void AsebaVMDebugMessage(AsebaVMState* vm, uint16_t id, uint16_t* data, uint16_t
 #endif
             for(i = 0; i < length; i++)
                 vm->bytecode[start + i] = bswap16(data[i + 1]);
+#ifdef ASEBA_VM_THREADED
+            vm->threadedCodeValid = 0;
+#endif  // ASEBA_VM_THREADED
         }
             // There is no break here because we want to do a reset after a set bytecode
             ASEBA_FALLTHROUGH;
 
         case ASEBA_MESSAGE_RESET:
             vm->flags = ASEBA_VM_STEP_BY_STEP_MASK;
+#ifdef ASEBA_VM_EVENT_TABLE
+            vm->eventTableValid = 0;
+#endif  // ASEBA_VM_EVENT_TABLE
             AsebaVMResetWhenFlags(vm);
             if(AsebaVMResetCB)
                 AsebaVMResetCB(vm);
@@ -802,8 +982,36 @@ void AsebaVMDebugMessage(AsebaVMState* vm, uint16_t id, uint16_t* data, uint16_t
 #endif
             for(i = 0; i < length; i++)
                 vm->variables[start + i] = bswap16(data[i + 1]);
+            AsebaVMMarkVariablesDirty(vm, start, length);
         } break;
 
+#ifdef ASEBA_VM_SUBSCRIPTIONS
+        case ASEBA_MESSAGE_SUBSCRIBE_VARIABLES: {
+            uint16_t ack[1 + ASEBA_MAX_SUBSCRIBED_RANGES * 2];
+            uint16_t i;
+            vm->subscriptionPeriod = bswap16(data[0]);
+            vm->subscribedRangesCount = 0;
+            for(i = 1; i + 1 < dataLength && vm->subscribedRangesCount < ASEBA_MAX_SUBSCRIBED_RANGES; i += 2) {
+                uint16_t start = bswap16(data[i]);
+                uint16_t length = bswap16(data[i + 1]);
+                // drop ranges outside the variables and clamp the ones crossing their end
+                if(start >= vm->variablesSize || length == 0)
+                    continue;
+                if(length > vm->variablesSize - start)
+                    length = vm->variablesSize - start;
+                vm->subscribedRanges[2 * vm->subscribedRangesCount] = start;
+                vm->subscribedRanges[2 * vm->subscribedRangesCount + 1] = length;
+                vm->subscribedRangesCount++;
+            }
+            // acknowledge with the period and the ranges kept, telling the sender that the glue pushes
+            // the changes, as it must when ASEBA_VM_SUBSCRIPTIONS is defined
+            ack[0] = vm->subscriptionPeriod;
+            for(i = 0; i < vm->subscribedRangesCount * 2; i++)
+                ack[1 + i] = vm->subscribedRanges[i];
+            AsebaSendMessageWords(vm, ASEBA_MESSAGE_VARIABLES_SUBSCRIBED, ack, 1 + vm->subscribedRangesCount * 2);
+        } break;
+#endif  // ASEBA_VM_SUBSCRIPTIONS
+
         case ASEBA_MESSAGE_WRITE_BYTECODE: AsebaWriteBytecode(vm); break;
 
         case ASEBA_MESSAGE_REBOOT: AsebaResetIntoBootloader(vm); break;
@@ -821,6 +1029,29 @@ void AsebaVMDebugMessage(AsebaVMState* vm, uint16_t id, uint16_t* data, uint16_t
     }
 }
 
+#ifdef ASEBA_VM_DIRTY_TRACKING
+void AsebaVMMarkVariablesDirty(AsebaVMState* vm, uint16_t start, uint16_t length) {
+    uint16_t* word;
+    uint32_t end = (uint32_t)start + length;
+    uint32_t i;
+
+    if(!vm->variablesDirty || length == 0)
+        return;
+
+    // partial first word, whole words, then partial last word
+    word = &vm->variablesDirty[start >> 4];
+    if((start >> 4) == ((end - 1) >> 4)) {
+        *word |= (uint16_t)((0xffffu >> (16 - length)) << (start & 0xf));
+        return;
+    }
+    *word++ |= (uint16_t)(0xffffu << (start & 0xf));
+    for(i = (uint32_t)(start | 0xf) + 1; i + 16 <= end; i += 16)
+        *word++ = 0xffff;
+    if(i < end)
+        *word |= (uint16_t)(0xffffu >> (16 - (end - i)));
+}
+#endif  // ASEBA_VM_DIRTY_TRACKING
+
 uint16_t AsebaVMShouldDropPacket(AsebaVMState* vm, uint16_t source, const uint8_t* data) {
     ASEBA_UNUSED(source);
     uint16_t type = bswap16(((const uint16_t*)data)[0]);
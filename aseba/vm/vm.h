@@ -51,9 +51,29 @@ else
 /*@{*/
 
 enum {
-    ASEBA_MAX_BREAKPOINTS = 16  //!< maximum number of simultaneous breakpoints the target supports
+    ASEBA_MAX_BREAKPOINTS = 16,      //!< maximum number of simultaneous breakpoints the target supports
+    ASEBA_MAX_SUBSCRIBED_RANGES = 8  //!< maximum number of variables ranges the target pushes, others are ignored
 };
 
+#ifdef ASEBA_VM_THREADED
+/*! One pre-decoded bytecode of the threaded execution engine, see vm-threaded.c.
+    Only available on host builds with ASEBA_VM_THREADED defined. */
+typedef struct {
+    const void* handler; /*!< address (computed goto) or index (switch) of the handler */
+    uint16_t arg;        /*!< first decoded operand */
+    uint16_t arg2;       /*!< second decoded operand */
+} AsebaVMThreadedInstr;
+#endif  // ASEBA_VM_THREADED
+
+#ifdef ASEBA_VM_EVENT_TABLE
+/*! One entry of the event lookup table, see AsebaVMGetEventAddress.
+    Only available on builds with ASEBA_VM_EVENT_TABLE defined. */
+typedef struct {
+    uint16_t event;   /*!< event identifier */
+    uint16_t address; /*!< starting address of the event in bytecode */
+} AsebaVMEventEntry;
+#endif  // ASEBA_VM_EVENT_TABLE
+
 /*! This structure contains the state of the Aseba VM.
     This is the required and the sufficient data for the VM to run.
     This is not sufficient for the compiler to build bytecode, as there is
@@ -72,10 +92,27 @@ typedef struct {
     uint16_t bytecodeSize; /*!< total amount of bytecode space */
     uint16_t* bytecode;    /*!< bytecode space of size bytecodeSize */
 
+#ifdef ASEBA_VM_THREADED
+    // pre-decoded bytecode
+    AsebaVMThreadedInstr* threadedCode; /*!< decoding space of size bytecodeSize, NULL to use the switch interpreter */
+    uint16_t threadedCodeValid;         /*!< whether threadedCode matches bytecode, cleared when bytecode changes */
+#endif  // ASEBA_VM_THREADED
+
+#ifdef ASEBA_VM_EVENT_TABLE
+    // event vector sorted by event identifier
+    AsebaVMEventEntry* eventTable; /*!< lookup table of size eventTableSize, NULL to scan the event vector */
+    uint16_t eventTableSize;       /*!< capacity of eventTable, bytecodeSize / 2 covers any event vector */
+    uint16_t eventTableCount;      /*!< number of events in eventTable */
+    uint16_t eventTableValid;      /*!< whether eventTable matches bytecode, cleared on reset */
+#endif  // ASEBA_VM_EVENT_TABLE
+
     // variables
     uint16_t variablesSize; /*!< total amount of variables space */
     int16_t* variables;     /*!< variables of size variableCount */
-    int16_t* variablesOld;
+    int16_t* variablesOld;  /*!< previous values for AsebaSendChangedVariables, NULL when only variablesDirty is used */
+#ifdef ASEBA_VM_DIRTY_TRACKING
+    uint16_t* variablesDirty; /*!< bitmap of written variables of size (variablesSize + 15) / 16, NULL to diff all */
+#endif                        // ASEBA_VM_DIRTY_TRACKING
 
     // execution stack
     uint16_t stackSize; /*!< depth of execution stack */
@@ -89,6 +126,15 @@ typedef struct {
     // breakpoint
     uint16_t breakpoints[ASEBA_MAX_BREAKPOINTS];
     uint16_t breakpointsCount;
+
+#ifdef ASEBA_VM_SUBSCRIPTIONS
+    // variables pushed by AsebaPushSubscribedVariables, set by ASEBA_MESSAGE_SUBSCRIBE_VARIABLES
+    uint16_t subscribedRanges[ASEBA_MAX_SUBSCRIBED_RANGES * 2]; /*!< start and length of each range */
+    uint16_t subscribedRangesCount; /*!< number of ranges, 0 when nothing is subscribed */
+    uint16_t subscriptionPeriod;    /*!< minimum time between two pushes, in ms */
+    uint16_t subscriptionLastPush;  /*!< time of the last push, in ms */
+    uint16_t subscriptionWaiting;   /*!< whether the period since the last push is still running */
+#endif  // ASEBA_VM_SUBSCRIPTIONS
 } AsebaVMState;
 
 // Macros to work with masks
@@ -106,6 +152,19 @@ typedef struct {
 // Functions provided by aseba-core
 
 
+#ifdef ASEBA_VM_DIRTY_TRACKING
+//! Mark variable index as written since the last AsebaSendChangedVariables, if the VM tracks written variables
+#    define AsebaVMMarkVariableDirty(vm, index)                                      \
+        do {                                                                         \
+            if((vm)->variablesDirty)                                                 \
+                (vm)->variablesDirty[(uint16_t)(index) >> 4] |= 1 << ((index)&0xf); \
+        } while(0)
+#else  // ASEBA_VM_DIRTY_TRACKING
+#    define AsebaVMMarkVariableDirty(vm, index)
+#    define AsebaVMMarkVariablesDirty(vm, start, length)
+#endif  // ASEBA_VM_DIRTY_TRACKING
+
+
 /*! Setup the execution status of the VM.
     This is not sufficient to have a working VM.
     nodeId and bytecode, variables, and stack along with their sizes must be set outside this
@@ -138,6 +197,13 @@ void AsebaVMEmitNodeSpecificError(AsebaVMState* vm, const char* message);
 /*! Return non-zero if VM will ignore the packet, 0 otherwise */
 uint16_t AsebaVMShouldDropPacket(AsebaVMState* vm, uint16_t source, const uint8_t* data);
 
+#ifdef ASEBA_VM_DIRTY_TRACKING
+/*! Mark length variables from start as written since the last AsebaSendChangedVariables.
+    When vm->variablesDirty is set, the VM and the standard natives mark the variables they write;
+    glue code and native functions of the target must mark theirs with this function. */
+void AsebaVMMarkVariablesDirty(AsebaVMState* vm, uint16_t start, uint16_t length);
+#endif  // ASEBA_VM_DIRTY_TRACKING
+
 // Functions implemented outside by the glue/transport layer
 
 /*! Called by AsebaStep if there is a message (not an user event) to send.
@@ -0,0 +1,232 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Check that incremental compilation gives the same results as compiling the whole program, on
+// the given programs and on variants of them with a line removed or a line added, compiled in
+// sequence as when editing. With --benchmark, time the compilation of a program made of many
+// subroutines after a change in one of them.
+
+#include "compiler/compiler.h"
+#include "vm/natives.h"
+#include "common/consts.h"
+#include "common/utils/utils.h"
+
+// C++
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Aseba;
+
+static const AsebaNativeFunctionDescription* nativeFunctionsDescriptions[] = {ASEBA_NATIVES_STD_DESCRIPTIONS, nullptr};
+
+// same target as asebatest
+static TargetDescription targetDescription() {
+    TargetDescription d;
+    d.name = L"testvm";
+    d.protocolVersion = ASEBA_PROTOCOL_VERSION;
+    d.bytecodeSize = 512;
+    d.variablesSize = 256;
+    d.stackSize = 64;
+    for(const AsebaNativeFunctionDescription* const* desc = nativeFunctionsDescriptions; *desc; ++desc) {
+        const std::string name((*desc)->name);
+        const std::string doc((*desc)->doc);
+        TargetDescription::NativeFunction native{std::wstring(name.begin(), name.end()),
+                                                 std::wstring(doc.begin(), doc.end()),
+                                                 {}};
+        for(const AsebaNativeFunctionArgumentDescription* param = (*desc)->arguments; param->size; ++param) {
+            const std::string paramName(param->name);
+            native.parameters.emplace_back(std::wstring(paramName.begin(), paramName.end()), param->size);
+        }
+        d.nativeFunctions.push_back(native);
+    }
+    TargetDescription::LocalEvent testLocalEvent;
+    testLocalEvent.name = L"test";
+    testLocalEvent.description = L"test local event";
+    d.localEvents.push_back(testLocalEvent);
+    return d;
+}
+
+static std::wstring readSource(const std::string& fileName) {
+    std::ifstream file(fileName);
+    std::stringstream content;
+    content << file.rdbuf();
+    const std::string utf8(content.str());
+    return UTF8ToWString(utf8);
+}
+
+struct Result {
+    std::vector<std::pair<unsigned short, unsigned short>> bytecode;
+    unsigned variablesCount = 0;
+    std::wstring error;
+    VariablesMap variables;
+    std::vector<std::wstring> subroutines;
+
+    bool operator==(const Result& other) const {
+        return bytecode == other.bytecode && variablesCount == other.variablesCount && error == other.error &&
+            variables == other.variables && subroutines == other.subroutines;
+    }
+};
+
+static Result compile(Compiler& compiler, const std::wstring& source) {
+    Result result;
+    BytecodeVector bytecode;
+    Error error;
+    std::wistringstream is(source);
+    if(compiler.compile(is, bytecode, result.variablesCount, error)) {
+        for(const auto& element : bytecode)
+            result.bytecode.emplace_back(element.bytecode, element.line);
+        result.variables = *compiler.getVariablesMap();
+        for(const auto& subroutine : *compiler.getSubroutineTable())
+            result.subroutines.push_back(subroutine.name + L"@" + std::to_wstring(subroutine.address) + L":" +
+                                         std::to_wstring(subroutine.line));
+    } else
+        result.error = error.toWString();
+    return result;
+}
+
+static std::vector<std::wstring> splitLines(const std::wstring& source) {
+    std::vector<std::wstring> lines;
+    std::wistringstream is(source);
+    std::wstring line;
+    while(std::getline(is, line))
+        lines.push_back(line);
+    return lines;
+}
+
+static std::wstring joinLines(const std::vector<std::wstring>& lines) {
+    std::wstring source;
+    for(const auto& line : lines)
+        source += line + L"\n";
+    return source;
+}
+
+struct Compilers {
+    Compiler whole;
+    Compiler incremental;
+    bool success = true;
+
+    Compilers(const TargetDescription* description, const CommonDefinitions* definitions) {
+        whole.setTargetDescription(description);
+        whole.setCommonDefinitions(definitions);
+        incremental.setTargetDescription(description);
+        incremental.setCommonDefinitions(definitions);
+        incremental.setIncrementalCompilationEnabled(true);
+    }
+
+    void setVectorLoweringThreshold(unsigned threshold) {
+        whole.setVectorLoweringThreshold(threshold);
+        incremental.setVectorLoweringThreshold(threshold);
+    }
+
+    void check(const std::string& fileName, const std::string& variant, const std::wstring& source) {
+        if(!(compile(incremental, source) == compile(whole, source))) {
+            std::cerr << fileName << ", " << variant << ": incremental compilation gives a different result"
+                      << std::endl;
+            success = false;
+        }
+    }
+};
+
+static bool check(const std::vector<std::string>& fileNames) {
+    const TargetDescription description(targetDescription());
+    CommonDefinitions definitions;
+    definitions.events.emplace_back(L"event1", 0);
+    definitions.events.emplace_back(L"event2", 3);
+    definitions.constants.emplace_back(L"FOO", 2);
+
+    Compilers compilers(&description, &definitions);
+    for(const auto& fileName : fileNames) {
+        const std::wstring source(readSource(fileName));
+        compilers.check(fileName, "first compilation", source);
+        compilers.check(fileName, "second compilation", source);
+        compilers.check(fileName, "moved down", L"\n\n" + source);
+
+        const std::vector<std::wstring> lines(splitLines(source));
+        for(size_t i = 0; i < lines.size(); ++i) {
+            std::vector<std::wstring> variant(lines);
+            variant.erase(variant.begin() + i);
+            compilers.check(fileName, "line " + std::to_string(i + 1) + " removed", joinLines(variant));
+            variant.insert(variant.begin() + i, lines[i]);
+            variant.insert(variant.begin() + i, lines[i]);
+            compilers.check(fileName, "line " + std::to_string(i + 1) + " doubled", joinLines(variant));
+            compilers.check(fileName, "original", source);
+        }
+
+        compilers.setVectorLoweringThreshold(0);
+        compilers.check(fileName, "vectors unrolled", source);
+        compilers.setVectorLoweringThreshold(8);
+        compilers.check(fileName, "vectors lowered", source);
+    }
+    return compilers.success;
+}
+
+// a program with many subroutines, the value in the last one depending on version
+static std::wstring largeProgram(unsigned subroutinesCount, int version) {
+    std::wostringstream os;
+    os << L"var a[10]\nvar b[10]\nvar i\nvar t\n";
+    for(unsigned s = 0; s < subroutinesCount; ++s) {
+        os << L"sub s" << s << L"\n";
+        os << L"    for i in 0:9 do\n        a[i] = b[i] * " << s + 1 << L" + i / 3\n    end\n";
+        os << L"    if a[0] > " << s << L" and b[1] != 0 then\n        t = abs(a[2] - b[3])\n    end\n";
+        os << L"    b = a + [1,2,3,4,5,6,7,8,9," << (s + 1 == subroutinesCount ? version : 10) << L"]\n";
+    }
+    os << L"onevent event1\n";
+    for(unsigned s = 0; s < subroutinesCount; ++s)
+        os << L"    callsub s" << s << L"\n";
+    return os.str();
+}
+
+static bool benchmark() {
+    TargetDescription description(targetDescription());
+    description.bytecodeSize = 16384;
+    CommonDefinitions definitions;
+    definitions.events.emplace_back(L"event1", 0);
+
+    const unsigned subroutinesCount = 30;
+    const int repetitions = 100;
+    for(const bool incremental : {false, true}) {
+        Compiler compiler;
+        compiler.setTargetDescription(&description);
+        compiler.setCommonDefinitions(&definitions);
+        compiler.setIncrementalCompilationEnabled(incremental);
+        const Result first(compile(compiler, largeProgram(subroutinesCount, 0)));
+        if(!first.error.empty()) {
+            std::wcerr << L"compilation failed: " << first.error << std::endl;
+            return false;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < repetitions; ++i)
+            compile(compiler, largeProgram(subroutinesCount, i + 1));
+        const double time =
+            std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repetitions;
+        std::cout << (incremental ? "incremental" : "whole") << " compilation after a change in one of "
+                  << subroutinesCount << " subroutines: " << time << " us" << std::endl;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if(argc > 1 && std::string(argv[1]) == "--benchmark")
+        return benchmark() ? 0 : 1;
+    return check(std::vector<std::string>(argv + 1, argv + argc)) ? 0 : 1;
+}
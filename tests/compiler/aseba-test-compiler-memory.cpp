@@ -0,0 +1,174 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Check that compiling a program again with the same compiler gives the same result as with a new
+// compiler, and with --benchmark report the time and the number of heap allocations of the
+// compilation of each program.
+
+#include "compiler/compiler.h"
+#include "vm/natives.h"
+#include "common/consts.h"
+#include "common/utils/utils.h"
+
+// C++
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Aseba;
+
+// number of heap allocations since the start of the program, in heapallocations.cpp
+size_t heapAllocations();
+
+static const AsebaNativeFunctionDescription* nativeFunctionsDescriptions[] = {ASEBA_NATIVES_STD_DESCRIPTIONS, nullptr};
+
+// same target as asebatest
+static TargetDescription targetDescription() {
+    TargetDescription d;
+    d.name = L"testvm";
+    d.protocolVersion = ASEBA_PROTOCOL_VERSION;
+    d.bytecodeSize = 512;
+    d.variablesSize = 256;
+    d.stackSize = 64;
+    for(const AsebaNativeFunctionDescription* const* desc = nativeFunctionsDescriptions; *desc; ++desc) {
+        const std::string name((*desc)->name);
+        const std::string doc((*desc)->doc);
+        TargetDescription::NativeFunction native{std::wstring(name.begin(), name.end()),
+                                                 std::wstring(doc.begin(), doc.end()),
+                                                 {}};
+        for(const AsebaNativeFunctionArgumentDescription* param = (*desc)->arguments; param->size; ++param) {
+            const std::string paramName(param->name);
+            native.parameters.emplace_back(std::wstring(paramName.begin(), paramName.end()), param->size);
+        }
+        d.nativeFunctions.push_back(native);
+    }
+    TargetDescription::LocalEvent testLocalEvent;
+    testLocalEvent.name = L"test";
+    testLocalEvent.description = L"test local event";
+    d.localEvents.push_back(testLocalEvent);
+    return d;
+}
+
+static std::wstring readSource(const std::string& fileName) {
+    std::ifstream file(fileName);
+    std::stringstream content;
+    content << file.rdbuf();
+    const std::string utf8(content.str());
+    return UTF8ToWString(utf8);
+}
+
+struct Result {
+    BytecodeVector bytecode;
+    unsigned variablesCount = 0;
+    std::wstring error;
+
+    bool operator==(const Result& other) const {
+        return bytecode.size() == other.bytecode.size() &&
+            std::equal(bytecode.begin(), bytecode.end(), other.bytecode.begin(),
+                       [](const BytecodeElement& a, const BytecodeElement& b) { return a.bytecode == b.bytecode; }) &&
+            variablesCount == other.variablesCount && error == other.error;
+    }
+};
+
+static Result compile(Compiler& compiler, const std::wstring& source) {
+    Result result;
+    Error error;
+    std::wistringstream is(source);
+    compiler.compile(is, result.bytecode, result.variablesCount, error);
+    result.error = error.toWString();
+    return result;
+}
+
+static bool check(const std::vector<std::string>& fileNames) {
+    const TargetDescription description(targetDescription());
+    CommonDefinitions definitions;
+    definitions.events.emplace_back(L"event1", 0);
+    definitions.events.emplace_back(L"event2", 3);
+    definitions.constants.emplace_back(L"FOO", 2);
+
+    bool success = true;
+    Compiler compiler;
+    compiler.setTargetDescription(&description);
+    compiler.setCommonDefinitions(&definitions);
+    for(const auto& fileName : fileNames) {
+        const std::wstring source(readSource(fileName));
+        Compiler fresh;
+        fresh.setTargetDescription(&description);
+        fresh.setCommonDefinitions(&definitions);
+        const Result expected(compile(fresh, source));
+        for(int i = 0; i < 2; ++i) {
+            if(!(compile(compiler, source) == expected)) {
+                std::cerr << fileName << ": compiling again with the same compiler gives a different result"
+                          << std::endl;
+                success = false;
+            }
+        }
+    }
+    return success;
+}
+
+static void benchmark(const std::vector<std::string>& fileNames) {
+    const TargetDescription description(targetDescription());
+    CommonDefinitions definitions;
+    definitions.events.emplace_back(L"event1", 0);
+    definitions.events.emplace_back(L"event2", 3);
+    definitions.constants.emplace_back(L"FOO", 2);
+    Compiler compiler;
+    compiler.setTargetDescription(&description);
+    compiler.setCommonDefinitions(&definitions);
+
+    const int repetitions = 200;
+    double totalTime = 0;
+    size_t totalAllocations = 0;
+    std::cout << std::setw(48) << std::left << "program" << std::right << std::setw(14) << "us/compile"
+              << std::setw(14) << "allocations" << std::endl;
+    for(const auto& fileName : fileNames) {
+        const std::wstring source(readSource(fileName));
+        compile(compiler, source);
+        const size_t allocationsBefore = heapAllocations();
+        const auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < repetitions; ++i)
+            compile(compiler, source);
+        const double time =
+            std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repetitions;
+        const size_t allocations = (heapAllocations() - allocationsBefore) / repetitions;
+        totalTime += time;
+        totalAllocations += allocations;
+        const auto slash = fileName.find_last_of('/');
+        std::cout << std::setw(48) << std::left << fileName.substr(slash == std::string::npos ? 0 : slash + 1)
+                  << std::right << std::setw(14) << std::fixed << std::setprecision(1) << time << std::setw(14)
+                  << allocations << std::endl;
+    }
+    std::cout << std::setw(48) << std::left << "total" << std::right << std::setw(14) << totalTime << std::setw(14)
+              << totalAllocations << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    const bool runBenchmark = argc > 1 && std::string(argv[1]) == "--benchmark";
+    const std::vector<std::string> fileNames(argv + (runBenchmark ? 2 : 1), argv + argc);
+    if(runBenchmark) {
+        benchmark(fileNames);
+        return 0;
+    }
+    return check(fileNames) ? 0 : 1;
+}
@@ -35,14 +35,17 @@ extern "C" const AsebaNativeFunctionDescription* const* AsebaGetNativeFunctionsD
 std::wstring read_source(const std::string& filename);
 void dump_source(const std::wstring& source);
 
-static const char short_options[] = "fcepnvsdumi:";
+static const char short_options[] = "fcepnvsdumi:bt:ora:w";
 static const struct option long_options[] = {
     {"fail", no_argument, nullptr, 'f'},        {"comp_fail", no_argument, nullptr, 'c'},
     {"exec_fail", no_argument, nullptr, 'e'},   {"post_fail", no_argument, nullptr, 'p'},
     {"memcmp_fail", no_argument, nullptr, 'n'}, {"event", no_argument, nullptr, 'v'},
     {"source", no_argument, nullptr, 's'},      {"dump", no_argument, nullptr, 'd'},
     {"memdump", no_argument, nullptr, 'u'},     {"memcmp", required_argument, nullptr, 'm'},
-    {"steps", required_argument, nullptr, 'i'}, {nullptr, 0, nullptr, 0}};
+    {"steps", required_argument, nullptr, 'i'}, {"no_superinstructions", no_argument, nullptr, 'b'},
+    {"vector_threshold", required_argument, nullptr, 't'}, {"no_dataflow", no_argument, nullptr, 'o'},
+    {"no_strength_reduction", no_argument, nullptr, 'r'}, {"varcount", required_argument, nullptr, 'a'},
+    {"no_threaded", no_argument, nullptr, 'w'},           {nullptr, 0, nullptr, 0}};
 
 static void usage(int, char** argv) {
     std::cerr << "Usage: " << argv[0] << " [options] source" << std::endl
@@ -58,7 +61,14 @@ static void usage(int, char** argv) {
               << "    -d | --dump         Dump the compilation result (tokens, tree, bytecode)" << std::endl
               << "    -u | --memdump      Dump the memory content at the end of the execution" << std::endl
               << "    -m | --memcmp file  Compare result of the VM execution with file" << std::endl
-              << "    -i | --steps        Number of VM execution steps (default: " << DEFAULT_STEPS << ")" << std::endl;
+              << "    -i | --steps        Number of VM execution steps (default: " << DEFAULT_STEPS << ")" << std::endl
+              << "    -b | --no_superinstructions  Do not fuse bytecodes into superinstructions" << std::endl
+              << "    -t | --vector_threshold n    Size from which vector assignments are not unrolled (0: never)"
+              << std::endl
+              << "    -o | --no_dataflow           Do not propagate values across statements" << std::endl
+              << "    -r | --no_strength_reduction Do not rewrite arithmetic into cheaper operations" << std::endl
+              << "    -a | --varcount n            Check that the program uses n words of variables" << std::endl
+              << "    -w | --no_threaded           Run the switch interpreter, scanning the event vector" << std::endl;
 }
 
 
@@ -66,18 +76,43 @@ struct AsebaNode {
     AsebaVMState vm;
     std::valarray<unsigned short> bytecode;
     std::valarray<signed short> stack;
+#ifdef ASEBA_VM_THREADED
+    std::valarray<AsebaVMThreadedInstr> threadedCode;
+#endif  // ASEBA_VM_THREADED
+#ifdef ASEBA_VM_EVENT_TABLE
+    std::valarray<AsebaVMEventEntry> eventTable;
+#endif  // ASEBA_VM_EVENT_TABLE
+#ifdef ASEBA_VM_DIRTY_TRACKING
+    std::valarray<uint16_t> variablesDirty;
+#endif  // ASEBA_VM_DIRTY_TRACKING
     TargetDescription d;
 
     struct Variables {
         int16_t user[256];
     } variables, variablesOld;
 
-    AsebaNode() {
+    AsebaNode(bool threaded) {
         // create VM
         vm.nodeId = 1;
         bytecode.resize(512);
         vm.bytecode = &bytecode[0];
         vm.bytecodeSize = bytecode.size();
+#ifdef ASEBA_VM_THREADED
+        vm.threadedCode = nullptr;
+        if(threaded) {
+            threadedCode.resize(bytecode.size());
+            vm.threadedCode = &threadedCode[0];
+        }
+#endif  // ASEBA_VM_THREADED
+#ifdef ASEBA_VM_EVENT_TABLE
+        vm.eventTable = nullptr;
+        vm.eventTableSize = 0;
+        if(threaded) {
+            eventTable.resize(bytecode.size() / 2);
+            vm.eventTable = &eventTable[0];
+            vm.eventTableSize = eventTable.size();
+        }
+#endif  // ASEBA_VM_EVENT_TABLE
 
         stack.resize(64);
         vm.stack = &stack[0];
@@ -86,6 +121,10 @@ struct AsebaNode {
         vm.variables = reinterpret_cast<int16_t*>(&variables);
         vm.variablesOld = reinterpret_cast<int16_t*>(&variablesOld);
         vm.variablesSize = sizeof(variables) / sizeof(int16_t);
+#ifdef ASEBA_VM_DIRTY_TRACKING
+        variablesDirty.resize((vm.variablesSize + 15) / 16);
+        vm.variablesDirty = &variablesDirty[0];
+#endif  // ASEBA_VM_DIRTY_TRACKING
 
         AsebaVMInit(&vm);
 
@@ -199,6 +238,12 @@ int main(int argc, char** argv) {
     bool dump = false;
     bool memDump = false;
     bool memCmp = false;
+    bool superinstructions = true;
+    bool dataflow = true;
+    bool strengthReduction = true;
+    int vectorThreshold = -1;
+    int expectedVarCount = -1;
+    bool threaded = true;
     int stepCount = DEFAULT_STEPS;
     std::string memCmpFileName;
 
@@ -236,6 +281,12 @@ int main(int argc, char** argv) {
                 memCmpFileName = optarg;
                 break;
             case 'i': stepCount = atoi(optarg); break;
+            case 'b': superinstructions = false; break;
+            case 't': vectorThreshold = atoi(optarg); break;
+            case 'o': dataflow = false; break;
+            case 'r': strengthReduction = false; break;
+            case 'a': expectedVarCount = atoi(optarg); break;
+            case 'w': threaded = false; break;
             default: usage(argc, argv); exit(EXIT_FAILURE);
         }
     }
@@ -266,7 +317,7 @@ int main(int argc, char** argv) {
     Compiler compiler;
 
     // fake target description
-    AsebaNode node;
+    AsebaNode node(threaded);
     CommonDefinitions definitions;
     definitions.events.push_back(NamedValue(L"event1", 0));
     definitions.events.push_back(NamedValue(L"event2", 3));
@@ -279,6 +330,11 @@ int main(int argc, char** argv) {
     // compile
     compiler.setTargetDescription(node.getTargetDescription());
     compiler.setCommonDefinitions(&definitions);
+    compiler.setSuperinstructionsEnabled(superinstructions);
+    compiler.setDataflowOptimizationEnabled(dataflow);
+    compiler.setStrengthReductionEnabled(strengthReduction);
+    if(vectorThreshold >= 0)
+        compiler.setVectorLoweringThreshold(vectorThreshold);
     if(dump)
         compiler.compile(ifs, bytecode, varCount, outError, &(std::wcout));
     else
@@ -287,6 +343,9 @@ int main(int argc, char** argv) {
     // ifs.close();
 
     checkForError("Compilation", should_compilation_fail, (outError.message != L"not defined"), outError.toWString());
+    if(expectedVarCount >= 0)
+        checkForError("Allocation", false, varCount != unsigned(expectedVarCount),
+                      WFormatableString(L"%0 words of variables used, %1 expected").arg(varCount).arg(expectedVarCount));
 
     // run
     if(!node.loadBytecode(bytecode)) {
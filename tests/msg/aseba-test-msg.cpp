@@ -20,6 +20,7 @@
 #include "common/msg/msg.h"
 #include <iostream>
 #include <functional>
+#include <random>
 
 using namespace Aseba;
 using namespace std;
@@ -101,7 +102,60 @@ void testMessageNoInitNoFunc(Args&&... args) {
     testMessage<T>([](T&) {}, {}, args...);
 }
 
+//! Apply the messages of sendBytecodeChanges to previous, and check that it gives bytecode
+void testBytecodeChanges(const vector<uint16_t>& previous, const vector<uint16_t>& bytecode,
+                         size_t maxMessages = 1000) {
+    vector<shared_ptr<Message>> messages;
+    const bool changed = sendBytecodeChanges(messages, 1, previous, bytecode);
+    vector<uint16_t> loaded(previous);
+    loaded.resize(max(previous.size(), bytecode.size()));
+    for(const auto& message : messages) {
+        const auto& setBytecode = dynamic_cast<const SetBytecode&>(*message);
+        if(setBytecode.bytecode.empty() || setBytecode.bytecode.size() > ASEBA_MAX_EVENT_ARG_COUNT - 2)
+            throw logic_error("sendBytecodeChanges sent a message of invalid size");
+        copy(setBytecode.bytecode.begin(), setBytecode.bytecode.end(), loaded.begin() + setBytecode.start);
+    }
+    if(!equal(bytecode.begin(), bytecode.end(), loaded.begin()))
+        throw logic_error("sendBytecodeChanges did not send all changes");
+    if(changed == messages.empty() || (changed && previous == bytecode))
+        throw logic_error("sendBytecodeChanges did not report changes properly");
+    if(messages.size() > maxMessages)
+        throw logic_error("sendBytecodeChanges sent too many messages");
+}
+
+void testBytecodeChanges() {
+    mt19937 gen(1);
+    uniform_int_distribution<uint16_t> word(0, 4);
+    vector<uint16_t> previous(1000);
+    for(auto& w : previous)
+        w = word(gen);
+
+    testBytecodeChanges(previous, previous, 0);
+    testBytecodeChanges({}, previous);
+    testBytecodeChanges(previous, {}, 0);
+    testBytecodeChanges(previous, vector<uint16_t>(previous.begin(), previous.begin() + 500), 0);
+
+    // a single change is a single message
+    auto bytecode(previous);
+    bytecode[600] += 1;
+    testBytecodeChanges(previous, bytecode, 1);
+    // as are close changes
+    bytecode[603] += 1;
+    testBytecodeChanges(previous, bytecode, 1);
+
+    for(unsigned i = 0; i < 1000; ++i) {
+        bytecode = previous;
+        bytecode.resize(uniform_int_distribution<size_t>(0, 1200)(gen), 1);
+        const auto changes = uniform_int_distribution<size_t>(0, 20)(gen);
+        for(size_t c = 0; c < changes && !bytecode.empty(); ++c)
+            bytecode[uniform_int_distribution<size_t>(0, bytecode.size() - 1)(gen)] = word(gen);
+        testBytecodeChanges(previous, bytecode);
+    }
+}
+
 int main() {
+    testBytecodeChanges();
+
     // Test the serialization and deserialization of all messages
 
     // The concept is that, for each message, we create and instance
@@ -196,6 +250,14 @@ int main() {
         {[](Variables& m) { m.start = 20; }, [](Variables& m) { m.variables[0] = 3; },
          [](Variables& m) { m.variables[1] = 4; }, [](Variables& m) { m.variables.push_back(5); }});
 
+    testMessage<VariablesSubscribed>(
+        [](VariablesSubscribed& m) {
+            m.period = 50;
+            m.ranges = {{0, 10}, {20, 5}};
+        },
+        {[](VariablesSubscribed& m) { m.period = 100; }, [](VariablesSubscribed& m) { m.ranges[0].first = 1; },
+         [](VariablesSubscribed& m) { m.ranges[1].second = 6; }, [](VariablesSubscribed& m) { m.ranges.clear(); }});
+
     testMessage<ArrayAccessOutOfBounds>(
         [](ArrayAccessOutOfBounds& m) {
             m.pc = 10;
@@ -303,6 +365,16 @@ int main() {
         {[](GetVariables& m) { m.dest = 3; }, [](GetVariables& m) { m.start = 20; },
          [](GetVariables& m) { m.length = 20; }});
 
+    testMessage<SubscribeVariables>(
+        [](SubscribeVariables& m) {
+            m.dest = 1;
+            m.period = 50;
+            m.ranges = {{0, 10}, {20, 5}};
+        },
+        {[](SubscribeVariables& m) { m.dest = 3; }, [](SubscribeVariables& m) { m.period = 100; },
+         [](SubscribeVariables& m) { m.ranges[0].first = 1; }, [](SubscribeVariables& m) { m.ranges[1].second = 6; },
+         [](SubscribeVariables& m) { m.ranges.clear(); }});
+
     testMessage<SetVariables>(
         [](SetVariables& m) {
             m.dest = 1;
@@ -0,0 +1,152 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Check that adding and getting arrays of words at once to a serialization buffer gives the
+// same result as one word at a time, and with --benchmark compare their speed.
+
+#include "common/msg/msg.h"
+
+// C++
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace Aseba;
+
+static std::vector<int16_t> randomWords(std::mt19937& gen, size_t count) {
+    std::uniform_int_distribution<int> dist(-32768, 32767);
+    std::vector<int16_t> words(count);
+    for(auto& word : words)
+        word = int16_t(dist(gen));
+    return words;
+}
+
+static bool check(std::mt19937& gen) {
+    bool success = true;
+    for(size_t count : {0, 1, 2, 7, 64, 255, 1000}) {
+        const auto words = randomWords(gen, count);
+
+        Message::SerializationBuffer one, bulk;
+        one.add(uint8_t(1));
+        bulk.add(uint8_t(1));
+        for(const auto word : words)
+            one.add(word);
+        bulk.add(words.data(), words.size());
+        if(one.rawData != bulk.rawData) {
+            std::cerr << "Adding " << count << " words at once gives different bytes" << std::endl;
+            success = false;
+        }
+
+        // read from an odd position
+        bulk.get<uint8_t>();
+        std::vector<int16_t> read(count);
+        bulk.get(read.data(), read.size());
+        if(read != words || bulk.readPos != bulk.rawData.size()) {
+            std::cerr << "Getting " << count << " words at once gives different words" << std::endl;
+            success = false;
+        }
+
+        // overreading throws without reading
+        const auto readPos = bulk.readPos = 1;
+        std::vector<uint16_t> tooMany(count + 1);
+        try {
+            bulk.get(tooMany.data(), tooMany.size());
+            std::cerr << "Getting " << count + 1 << " words out of " << count << " did not throw" << std::endl;
+            success = false;
+        } catch(const std::runtime_error&) {
+            if(bulk.readPos != readPos) {
+                std::cerr << "Overreading " << count + 1 << " words moved the read position" << std::endl;
+                success = false;
+            }
+        }
+    }
+    return success;
+}
+
+template <typename F>
+static double nsPerCall(unsigned iterations, F&& f) {
+    const auto start = std::chrono::steady_clock::now();
+    for(unsigned i = 0; i < iterations; ++i)
+        f();
+    const auto duration = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(duration).count() / iterations;
+}
+
+static void benchmark(std::mt19937& gen) {
+    const size_t lengths[] = {4, 16, 64, 256, 1024};
+
+    std::cout << std::setw(8) << "length" << std::setw(12) << "add" << std::setw(12) << "add bulk" << std::setw(12)
+              << "get" << std::setw(12) << "get bulk" << std::setw(12) << "Variables"
+              << "   (ns per array)" << std::endl;
+    for(auto length : lengths) {
+        const auto words = randomWords(gen, length);
+        std::vector<int16_t> read(length);
+        Message::SerializationBuffer buffer;
+        buffer.add(words.data(), words.size());
+        const unsigned iterations = 20000000 / (length + 16);
+        volatile int16_t sink = 0;
+
+        std::cout << std::setw(8) << length << std::fixed << std::setprecision(1);
+        std::cout << std::setw(12) << nsPerCall(iterations, [&] {
+            buffer.rawData.clear();
+            for(const auto word : words)
+                buffer.add(word);
+        });
+        std::cout << std::setw(12) << nsPerCall(iterations, [&] {
+            buffer.rawData.clear();
+            buffer.add(words.data(), words.size());
+        });
+        std::cout << std::setw(12) << nsPerCall(iterations, [&] {
+            buffer.readPos = 0;
+            for(auto& word : read)
+                word = buffer.get<int16_t>();
+            sink = read.back();
+        });
+        std::cout << std::setw(12) << nsPerCall(iterations, [&] {
+            buffer.readPos = 0;
+            buffer.get(read.data(), read.size());
+            sink = read.back();
+        });
+
+        // a whole message round trip, as done for each packet of variables
+        Variables variables;
+        variables.start = 0;
+        variables.variables = words;
+        std::cout << std::setw(12) << nsPerCall(iterations / 4, [&] {
+            Message::SerializationBuffer content;
+            static_cast<const Message&>(variables).serializeSpecific(content);
+            std::unique_ptr<Message> decoded(Message::create(0, ASEBA_MESSAGE_VARIABLES, content));
+            sink = static_cast<Variables&>(*decoded).variables.back();
+        });
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::mt19937 gen(1);
+    if(argc > 1 && std::string(argv[1]) == "--benchmark") {
+        benchmark(gen);
+        return 0;
+    }
+    return check(gen) ? 0 : 1;
+}
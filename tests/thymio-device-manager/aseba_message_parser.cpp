@@ -0,0 +1,147 @@
+#include <catch2/catch.hpp>
+#include <aseba/thymio-device-manager/aseba_message_parser.h>
+
+using mobsya::aseba_message_buffer;
+using mobsya::aseba_message_view;
+
+namespace {
+
+// A stream returning its data a few bytes at a time
+struct chunked_stream {
+    boost::asio::io_context& ctx;
+    std::vector<uint8_t> data;
+    std::size_t chunk_size;
+    std::size_t pos = 0;
+    int reads = 0;
+
+    using executor_type = boost::asio::io_context::executor_type;
+    executor_type get_executor() {
+        return ctx.get_executor();
+    }
+
+    template <typename MutableBufferSequence, typename ReadHandler>
+    void async_read_some(const MutableBufferSequence& buffers, ReadHandler&& handler) {
+        reads++;
+        const auto n = std::min({boost::asio::buffer_size(buffers), data.size() - pos, chunk_size});
+        boost::asio::buffer_copy(buffers, boost::asio::buffer(data.data() + pos, n));
+        pos += n;
+        const auto ec = n == 0 ? boost::asio::error::eof : boost::system::error_code{};
+        boost::asio::post(ctx, boost::beast::bind_handler(std::forward<ReadHandler>(handler), ec, n));
+    }
+};
+
+void append(std::vector<uint8_t>& data, const Aseba::Message& message) {
+    Aseba::Message::SerializationBuffer buffer;
+    message.serializeSpecific(buffer);
+    for(uint16_t word : {uint16_t(buffer.rawData.size()), message.source, message.type}) {
+        data.push_back(uint8_t(word));
+        data.push_back(uint8_t(word >> 8));
+    }
+    data.insert(data.end(), buffer.rawData.begin(), buffer.rawData.end());
+}
+
+std::vector<int16_t> to_vector(aseba_message_view::words words) {
+    return std::vector<int16_t>(words.begin(), words.end());
+}
+
+}  // namespace
+
+namespace boost {
+namespace beast {
+    template <>
+    struct is_async_read_stream<chunked_stream> : std::true_type {};
+}  // namespace beast
+}  // namespace boost
+
+TEST_CASE("aseba messages are read from a buffer", "[aseba_message_parser]") {
+    Aseba::UserMessage event(3, {1, -2, 3});
+    event.source = 1;
+    Aseba::Variables variables;
+    variables.source = 2;
+    variables.start = 10;
+    variables.variables = {-1, 0, 1, 1000};
+    Aseba::ExecutionStateChanged state;
+    state.source = 1;
+    state.pc = 5;
+    state.flags = 1;
+    Aseba::NodePresent present;
+    present.source = 2;
+    present.version = 8;
+
+    std::vector<uint8_t> data;
+    for(int i = 0; i < 10; i++) {
+        append(data, event);
+        append(data, variables);
+        append(data, state);
+        append(data, present);
+    }
+
+    const auto chunk_size = GENERATE(std::size_t(1), std::size_t(7), std::size_t(4096));
+    boost::asio::io_context ctx;
+    chunked_stream stream{ctx, data, chunk_size};
+    aseba_message_buffer buffer;
+    int count = 0;
+    std::function<void(boost::system::error_code, aseba_message_view)> handler =
+        [&](boost::system::error_code ec, aseba_message_view msg) {
+            if(ec) {
+                REQUIRE(ec == boost::asio::error::eof);
+                return;
+            }
+            switch(count++ % 4) {
+                case 0:
+                    REQUIRE(msg.source == 1);
+                    REQUIRE(msg.type == 3);
+                    REQUIRE(to_vector(*msg.event_data()) == event.data);
+                    break;
+                case 1: {
+                    REQUIRE(msg.type == ASEBA_MESSAGE_VARIABLES);
+                    auto area = msg.variables();
+                    REQUIRE(area);
+                    REQUIRE(area->start == 10);
+                    REQUIRE(to_vector(area->variables) == variables.variables);
+                    break;
+                }
+                case 2: {
+                    auto decoded = msg.message();
+                    REQUIRE(decoded);
+                    REQUIRE(decoded->type == ASEBA_MESSAGE_EXECUTION_STATE_CHANGED);
+                    REQUIRE(static_cast<Aseba::ExecutionStateChanged&>(*decoded).pc == 5);
+                    break;
+                }
+                case 3:
+                    REQUIRE(msg.source == 2);
+                    REQUIRE(msg.type == ASEBA_MESSAGE_NODE_PRESENT);
+                    break;
+            }
+            mobsya::async_read_aseba_message(stream, buffer, handler);
+        };
+    mobsya::async_read_aseba_message(stream, buffer, handler);
+    ctx.run();
+
+    REQUIRE(count == 40);
+    if(chunk_size == 4096)
+        // all the messages and the end of the stream
+        REQUIRE(stream.reads == 2);
+}
+
+TEST_CASE("changed variables are read in place", "[aseba_message_parser]") {
+    Aseba::Message::SerializationBuffer decode_buffer;
+    // areas [1: 5, 6], [9: ], [3: -1]
+    const std::vector<uint8_t> payload = {1, 0, 2, 0, 5, 0, 6, 0, 9, 0, 0, 0, 3, 0, 1, 0, 0xff, 0xff};
+    auto view = [&](std::size_t size) {
+        return aseba_message_view(1, ASEBA_MESSAGE_CHANGED_VARIABLES,
+                                  ranges::span<const uint8_t>(payload.data(), std::ptrdiff_t(size)), decode_buffer);
+    };
+
+    std::vector<std::pair<uint16_t, std::vector<int16_t>>> areas;
+    REQUIRE(view(payload.size()).for_each_changed_variables([&](const aseba_message_view::variables_area& area) {
+        areas.emplace_back(area.start, to_vector(area.variables));
+    }));
+    REQUIRE(areas == decltype(areas){{1, {5, 6}}, {3, {-1}}});
+
+    // malformed messages are rejected as Aseba::ChangedVariables does
+    for(std::size_t size = 0; size < payload.size(); size++) {
+        const bool valid = view(size).for_each_changed_variables([](const aseba_message_view::variables_area&) {});
+        REQUIRE(valid == bool(view(size).message()));
+    }
+}
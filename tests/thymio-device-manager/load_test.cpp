@@ -0,0 +1,779 @@
+// Load test of the device manager, without hardware: simulated Aseba nodes running vm.c are
+// connected through the aseba tcp acceptor, and applications connected to the tcp server lock them
+// and drive set-variables, emit and compile workloads while watching their variables and events.
+// Reports the throughput and latencies of the requests, the latency from a request to the
+// notification of its effect, and the memory used. Everything runs in this process.
+// Given several thread counts, e.g. --threads 1,2,4, the test is run once with the device manager
+// on each of them and the throughputs are compared.
+//
+// usage: thymio-device-manager-load-test [--nodes N] [--apps M] [--watch K] [--duration S]
+//                                        [--threads T[,T...]] [--workloads set,emit,compile]
+
+#include "transport/buffer/vm-buffer.h"
+#include "vm/vm.h"
+#include "vm/natives.h"
+#include "common/consts.h"
+
+#include <aseba/thymio-device-manager/aseba_message_parser.h>
+#include <aseba/thymio-device-manager/aseba_tcpacceptor.h>
+#include <aseba/thymio-device-manager/aseba_node_registery.h>
+#include <aseba/thymio-device-manager/app_server.h>
+#include <aseba/thymio-device-manager/app_token_manager.h>
+#include <aseba/thymio-device-manager/compilation_cache.h>
+#include <aseba/thymio-device-manager/compilation_service.h>
+#include <aseba/thymio-device-manager/flatbuffers_message_reader.h>
+#include <aseba/thymio-device-manager/flatbuffers_message_writer.h>
+#include <aseba/thymio-device-manager/flatbuffers_messages.h>
+#include <aseba/thymio-device-manager/tdm.h>
+#include <aseba/thymio-device-manager/uuid_provider.h>
+
+// C++
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using boost::asio::ip::tcp;
+using clock_type = std::chrono::steady_clock;
+namespace fb = mobsya::fb;
+
+class simulated_node;
+
+// The glue of vm-buffer.c finds the node of a VM here
+static std::map<const AsebaVMState*, simulated_node*> nodesByVM;
+
+static AsebaVMDescription nodeDescription = {
+    "load test node", {{1, "_id"}, {1, "event.source"}, {32, "event.args"}, {0, nullptr}}};
+
+static const AsebaLocalEventDescription localEvents[] = {{nullptr, nullptr}};
+
+static const AsebaNativeFunctionDescription* nativeFunctionsDescriptions[] = {ASEBA_NATIVES_STD_DESCRIPTIONS, nullptr};
+
+static AsebaNativeFunctionPointer nativeFunctions[] = {ASEBA_NATIVES_STD_FUNCTIONS};
+
+// An Aseba node listening on the loopback interface, as the simulator does.
+// All nodes must run on the same thread, vm-buffer.c sends and receives in a static buffer.
+class simulated_node {
+public:
+    simulated_node(boost::asio::io_context& ctx, uint16_t id)
+        : m_acceptor(ctx, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0))
+        , m_socket(ctx)
+        , m_timer(ctx)
+        , m_bytecode(1024)
+        , m_stack(64)
+        , m_variables(256)
+        , m_variablesDirty((m_variables.size() + 15) / 16) {
+        memset(&m_vm, 0, sizeof(m_vm));
+        m_vm.nodeId = id;
+        m_vm.bytecode = m_bytecode.data();
+        m_vm.bytecodeSize = uint16_t(m_bytecode.size());
+        m_vm.stack = m_stack.data();
+        m_vm.stackSize = uint16_t(m_stack.size());
+        m_vm.variables = m_variables.data();
+        m_vm.variablesSize = uint16_t(m_variables.size());
+#ifdef ASEBA_VM_DIRTY_TRACKING
+        m_vm.variablesDirty = m_variablesDirty.data();
+#endif  // ASEBA_VM_DIRTY_TRACKING
+#ifdef ASEBA_VM_THREADED
+        m_threadedCode.resize(m_bytecode.size());
+        m_vm.threadedCode = m_threadedCode.data();
+#endif  // ASEBA_VM_THREADED
+        nodesByVM[&m_vm] = this;
+        AsebaVMInit(&m_vm);
+    }
+
+    ~simulated_node() {
+        nodesByVM.erase(&m_vm);
+    }
+
+    tcp::endpoint endpoint() const {
+        return m_acceptor.local_endpoint();
+    }
+
+    // Wait for the device manager, then run the VM until the io_context is stopped
+    void start() {
+        m_acceptor.async_accept(m_socket, [this](boost::system::error_code ec) {
+            if(ec)
+                return;
+            m_socket.set_option(tcp::no_delay(true));
+            read();
+        });
+        tick();
+    }
+
+    void sendBuffer(const uint8_t* data, uint16_t length) {
+        // data is the type followed by the payload, prefix them with the size of the payload and the source
+        std::vector<uint8_t> message(4 + length);
+        const uint16_t size = uint16_t(length - 2);
+        message[0] = uint8_t(size);
+        message[1] = uint8_t(size >> 8);
+        message[2] = uint8_t(m_vm.nodeId);
+        message[3] = uint8_t(m_vm.nodeId >> 8);
+        std::copy(data, data + length, message.begin() + 4);
+        m_outgoing.push_back(std::move(message));
+        if(m_outgoing.size() == 1)
+            write();
+    }
+
+    uint16_t getBuffer(uint8_t* data, uint16_t maxLength, uint16_t* source) {
+        *source = m_incomingSource;
+        const auto size = uint16_t(std::min<std::size_t>(m_incoming.size(), maxLength));
+        std::copy_n(m_incoming.begin(), size, data);
+        m_incoming.clear();
+        return size;
+    }
+
+private:
+    void read() {
+        mobsya::async_read_aseba_message(
+            m_socket, m_readBuffer, [this](boost::system::error_code ec, mobsya::aseba_message_view msg) {
+                if(ec)
+                    return;
+                m_incomingSource = msg.source;
+                m_incoming.assign({uint8_t(msg.type), uint8_t(msg.type >> 8)});
+                m_incoming.insert(m_incoming.end(), msg.payload.begin(), msg.payload.end());
+                AsebaProcessIncomingEvents(&m_vm);
+                AsebaVMRun(&m_vm, 1000);
+                read();
+            });
+    }
+
+    void write() {
+        boost::asio::async_write(m_socket, boost::asio::buffer(m_outgoing.front()),
+                                 [this](boost::system::error_code ec, std::size_t) {
+                                     if(ec)
+                                         return;
+                                     m_outgoing.pop_front();
+                                     if(!m_outgoing.empty())
+                                         write();
+                                 });
+    }
+
+    // Let the VM run the events it has pending, and push the variables the device manager subscribed to
+    void tick() {
+        AsebaVMRun(&m_vm, 1000);
+#ifdef ASEBA_VM_SUBSCRIPTIONS
+        const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(clock_type::now().time_since_epoch());
+        AsebaPushSubscribedVariables(&m_vm, uint16_t(now.count()));
+#endif  // ASEBA_VM_SUBSCRIPTIONS
+        m_timer.expires_after(std::chrono::milliseconds(5));
+        m_timer.async_wait([this](boost::system::error_code ec) {
+            if(!ec)
+                tick();
+        });
+    }
+
+    AsebaVMState m_vm;
+    tcp::acceptor m_acceptor;
+    tcp::socket m_socket;
+    boost::asio::steady_timer m_timer;
+    mobsya::aseba_message_buffer m_readBuffer;
+    std::vector<uint8_t> m_incoming;
+    uint16_t m_incomingSource = 0;
+    std::deque<std::vector<uint8_t>> m_outgoing;
+    std::vector<uint16_t> m_bytecode;
+    std::vector<int16_t> m_stack;
+    std::vector<int16_t> m_variables;
+    std::vector<uint16_t> m_variablesDirty;
+#ifdef ASEBA_VM_THREADED
+    std::vector<AsebaVMThreadedInstr> m_threadedCode;
+#endif  // ASEBA_VM_THREADED
+};
+
+extern "C" void AsebaSendBuffer(AsebaVMState* vm, const uint8_t* data, uint16_t length) {
+    nodesByVM.at(vm)->sendBuffer(data, length);
+}
+
+extern "C" uint16_t AsebaGetBuffer(AsebaVMState* vm, uint8_t* data, uint16_t maxLength, uint16_t* source) {
+    return nodesByVM.at(vm)->getBuffer(data, maxLength, source);
+}
+
+extern "C" const AsebaVMDescription* AsebaGetVMDescription(AsebaVMState*) {
+    return &nodeDescription;
+}
+
+extern "C" const AsebaLocalEventDescription* AsebaGetLocalEventsDescriptions(AsebaVMState*) {
+    return localEvents;
+}
+
+extern "C" const AsebaNativeFunctionDescription* const* AsebaGetNativeFunctionsDescriptions(AsebaVMState*) {
+    return nativeFunctionsDescriptions;
+}
+
+extern "C" void AsebaNativeFunction(AsebaVMState* vm, uint16_t id) {
+    nativeFunctions[id](vm);
+}
+
+extern "C" void AsebaWriteBytecode(AsebaVMState*) {}
+
+extern "C" void AsebaResetIntoBootloader(AsebaVMState*) {}
+
+extern "C" void AsebaPutVmToSleep(AsebaVMState*) {}
+
+extern "C" void AsebaAssert(AsebaVMState* vm, AsebaAssertReason reason) {
+    std::cerr << "Internal VM exception " << reason << " at pc " << vm->pc << std::endl;
+    exit(1);
+}
+
+struct options {
+    unsigned nodes = 4;
+    unsigned apps = 4;
+    unsigned watch = 0;  // nodes watched by each application besides its own, all of them if 0
+    double duration = 5;
+    std::vector<unsigned> threads = {2};  // threads running the device manager, one run for each
+    std::vector<std::string> workloads = {"set", "emit", "compile"};
+};
+
+// Latencies in ms of one kind of request or notification
+struct series {
+    std::vector<double> latencies;
+    uint64_t errors = 0;
+
+    double percentile(double p) const {
+        if(latencies.empty())
+            return 0;
+        std::vector<double> sorted(latencies);
+        const auto n = std::size_t(p * double(sorted.size() - 1));
+        std::nth_element(sorted.begin(), sorted.begin() + n, sorted.end());
+        return sorted[n];
+    }
+};
+
+// Shared by the applications, which all run on the same thread
+struct statistics {
+    bool recording = false;
+    std::map<std::string, series> results;
+    uint64_t notifications = 0;
+    unsigned readyApps = 0;
+
+    void record(const std::string& name, clock_type::time_point sent) {
+        if(recording)
+            results[name].latencies.push_back(
+                std::chrono::duration<double, std::milli>(clock_type::now() - sent).count());
+    }
+    void error(const std::string& name) {
+        if(recording)
+            results[name].errors++;
+    }
+};
+
+static std::string program(unsigned generation) {
+    std::ostringstream program;
+    program << "var probe = 0\n"
+               "var echoed = 0\n"
+               "var generation = "
+            << generation % 30000
+            << "\n"
+               "var history[16]\n"
+               "var count = 0\n"
+               "\n"
+               "onevent ping\n"
+               "    echoed = event.args[0]\n"
+               "    history[count] = echoed\n"
+               "    count = (count + 1) % 16\n"
+               "    emit pong echoed\n";
+    return program.str();
+}
+
+// The first integer of a variable or event value, which is a list for Aseba nodes
+static int64_t first_value(const mobsya::property& p) {
+    if(p.is_array() && p.size() > 0 && p[0].is_integral())
+        return mobsya::property::integral_t(p[0]);
+    if(p.is_integral())
+        return mobsya::property::integral_t(p);
+    return -1;
+}
+
+// An application locking some of the nodes and watching some others.
+// Each locked node gets one request at a time, the workloads taking turns.
+class application {
+public:
+    application(boost::asio::io_context& ctx, tcp::endpoint server, unsigned index, const options& opts,
+                statistics& stats, std::function<void()> ready)
+        : m_socket(ctx), m_server(server), m_index(index), m_opts(opts), m_stats(stats), m_ready(std::move(ready)) {}
+
+    void start() {
+        m_socket.async_connect(m_server, [this](boost::system::error_code ec) {
+            if(ec) {
+                std::cerr << "Application " << m_index << " failed to connect: " << ec.message() << std::endl;
+                return;
+            }
+            m_socket.set_option(tcp::no_delay(true));
+            flatbuffers::FlatBufferBuilder builder;
+            write(mobsya::wrap_fb(builder, fb::CreateConnectionHandshake(builder, mobsya::tdm::minProtocolVersion,
+                                                                         mobsya::tdm::protocolVersion,
+                                                                         mobsya::tdm::maxAppEndPointMessageSize)));
+            read();
+        });
+    }
+
+private:
+    enum class step { lock, register_events, load, run, set, emit, compile, watch };
+
+    struct owned_node {
+        explicit owned_node(const mobsya::node_id& id) : id(id) {}
+        mobsya::node_id id;
+        unsigned turn = 0;
+        unsigned generation = 0;
+        int16_t probe = 0;
+        int16_t ping = 0;
+        // values set or emitted, and not notified yet
+        std::map<int16_t, clock_type::time_point> probesSent;
+        std::map<int16_t, clock_type::time_point> pingsSent;
+    };
+
+    struct pending_request {
+        step what;
+        std::size_t node;
+        clock_type::time_point sent;
+    };
+
+    void read() {
+        mobsya::async_read_flatbuffers_message(m_socket, [this](boost::system::error_code ec,
+                                                                mobsya::fb_message_ptr msg) {
+            if(ec)
+                return;
+            handle(msg);
+            read();
+        });
+    }
+
+    void write(mobsya::tagged_detached_flatbuffer&& msg) {
+        m_outgoing.push_back(std::move(msg.buffer));
+        if(m_outgoing.size() == 1)
+            do_write();
+    }
+
+    void do_write() {
+        mobsya::async_write_flatbuffer_message(m_socket, m_outgoing.front(), [this](boost::system::error_code ec) {
+            if(ec)
+                return;
+            m_outgoing.pop_front();
+            if(!m_outgoing.empty())
+                do_write();
+        });
+    }
+
+    void handle(const mobsya::fb_message_ptr& msg) {
+        switch(msg.message_type()) {
+            case fb::AnyMessage::NodesChanged: on_nodes_changed(*msg.as<fb::NodesChanged>()); break;
+            case fb::AnyMessage::RequestCompleted: complete(msg.as<fb::RequestCompleted>()->request_id(), true); break;
+            case fb::AnyMessage::CompilationResultSuccess:
+                complete(msg.as<fb::CompilationResultSuccess>()->request_id(), true);
+                break;
+            case fb::AnyMessage::CompilationResultFailure:
+                std::cerr << msg.as<fb::CompilationResultFailure>()->message()->str() << std::endl;
+                complete(msg.as<fb::CompilationResultFailure>()->request_id(), false);
+                break;
+            case fb::AnyMessage::Error: complete(msg.as<fb::Error>()->request_id(), false); break;
+            case fb::AnyMessage::VariablesChanged: on_variables_changed(*msg.as<fb::VariablesChanged>()); break;
+            case fb::AnyMessage::EventsEmitted: on_events_emitted(*msg.as<fb::EventsEmitted>()); break;
+            default: break;
+        }
+    }
+
+    void on_nodes_changed(const fb::NodesChanged& msg) {
+        if(!msg.nodes())
+            return;
+        for(const auto& node : *msg.nodes()) {
+            if(!node->node_id())
+                continue;
+            const auto status = node->status();
+            if(status == fb::NodeStatus::available || status == fb::NodeStatus::busy ||
+               status == fb::NodeStatus::ready)
+                m_nodes.insert(mobsya::node_id(node->node_id()));
+        }
+        if(!m_started && m_nodes.size() >= m_opts.nodes)
+            start_workloads();
+    }
+
+    // Every application sees the nodes in the same order, the k-th one is locked by the application k % apps
+    void start_workloads() {
+        m_started = true;
+        const std::vector<mobsya::node_id> nodes(m_nodes.begin(), m_nodes.end());
+        const std::size_t watched =
+            m_opts.watch == 0 ? nodes.size() : std::min<std::size_t>(m_opts.watch, nodes.size());
+        std::set<std::size_t> watch;
+        for(std::size_t k = 0; k < watched; k++)
+            watch.insert((m_index + k) % nodes.size());
+        for(std::size_t k = m_index; k < nodes.size(); k += m_opts.apps) {
+            watch.insert(k);
+            m_owned.emplace_back(nodes[k]);
+        }
+        for(auto k : watch) {
+            flatbuffers::FlatBufferBuilder builder;
+            send(step::watch, 0,
+                 mobsya::wrap_fb(builder, fb::CreateWatchNode(builder, m_next_request, nodes[k].fb(builder),
+                                                              uint32_t(fb::WatchableInfo::Variables) |
+                                                                  uint32_t(fb::WatchableInfo::Events))));
+        }
+        m_setting_up = m_owned.size();
+        if(m_setting_up == 0)
+            m_ready();
+        for(std::size_t i = 0; i < m_owned.size(); i++) {
+            flatbuffers::FlatBufferBuilder builder;
+            send(step::lock, i, mobsya::wrap_fb(builder, fb::CreateLockNode(builder, m_next_request,
+                                                                             m_owned[i].id.fb(builder))));
+        }
+    }
+
+    void send(step what, std::size_t node, mobsya::tagged_detached_flatbuffer&& msg) {
+        m_pending[m_next_request++] = pending_request{what, node, clock_type::now()};
+        write(std::move(msg));
+    }
+
+    void complete(uint32_t request_id, bool success) {
+        auto it = m_pending.find(request_id);
+        if(it == m_pending.end())
+            return;
+        const auto request = it->second;
+        m_pending.erase(it);
+
+        static const std::map<step, std::string> names = {
+            {step::set, "set-variables"}, {step::emit, "emit"}, {step::compile, "compile"}};
+        const auto name = names.find(request.what);
+        if(name != names.end()) {
+            if(success)
+                m_stats.record(name->second, request.sent);
+            else
+                m_stats.error(name->second);
+        } else if(!success && request.what != step::watch) {
+            std::cerr << "Application " << m_index << " failed to set up a node" << std::endl;
+            return;
+        }
+
+        switch(request.what) {
+            case step::watch: break;
+            case step::lock: register_events(request.node); break;
+            case step::register_events: load(request.node, step::load); break;
+            case step::load:
+            case step::compile: run(request.node); break;
+            case step::run:
+                if(m_owned[request.node].turn == 0 && m_setting_up > 0 && --m_setting_up == 0)
+                    m_ready();
+                next(request.node);
+                break;
+            case step::set:
+            case step::emit: next(request.node); break;
+        }
+    }
+
+    void register_events(std::size_t n) {
+        flatbuffers::FlatBufferBuilder builder;
+        std::vector<flatbuffers::Offset<fb::EventDescription>> events;
+        events.push_back(fb::CreateEventDescription(builder, builder.CreateString("ping"), 1, 0));
+        events.push_back(fb::CreateEventDescription(builder, builder.CreateString("pong"), 1, 1));
+        const auto id = m_owned[n].id.fb(builder);
+        send(step::register_events, n,
+             mobsya::wrap_fb(builder, fb::CreateRegisterEvents(builder, m_next_request, id,
+                                                                builder.CreateVector(events))));
+    }
+
+    // A new generation of the program each time, so that it is really compiled
+    void load(std::size_t n, step what) {
+        flatbuffers::FlatBufferBuilder builder;
+        const auto id = m_owned[n].id.fb(builder);
+        const auto code = builder.CreateString(program(m_owned[n].generation++));
+        send(what, n,
+             mobsya::wrap_fb(builder, fb::CreateCompileAndLoadCodeOnVM(builder, m_next_request, id,
+                                                                        fb::ProgrammingLanguage::Aseba, code,
+                                                                        fb::CompilationOptions::LoadOnTarget)));
+    }
+
+    void run(std::size_t n) {
+        flatbuffers::FlatBufferBuilder builder;
+        const auto id = m_owned[n].id.fb(builder);
+        send(step::run, n,
+             mobsya::wrap_fb(builder, fb::CreateSetVMExecutionState(builder, m_next_request, id,
+                                                                     fb::VMExecutionStateCommand::Run)));
+    }
+
+    void next(std::size_t n) {
+        auto& node = m_owned[n];
+        const auto& workload = m_opts.workloads[node.turn++ % m_opts.workloads.size()];
+        flatbuffers::FlatBufferBuilder builder;
+        if(workload == "set") {
+            node.probe = int16_t(node.probe % 30000 + 1);
+            node.probesSent[node.probe] = clock_type::now();
+            mobsya::variables_map values;
+            values.emplace("probe", mobsya::property(node.probe));
+            const auto id = node.id.fb(builder);
+            const auto vars = mobsya::detail::serialize_variables(builder, values);
+            send(step::set, n, mobsya::wrap_fb(builder, fb::CreateSetVariables(builder, m_next_request, id, vars)));
+        } else if(workload == "emit") {
+            node.ping = int16_t(node.ping % 30000 + 1);
+            node.pingsSent[node.ping] = clock_type::now();
+            mobsya::group::properties_map values;
+            values.emplace("ping", mobsya::property(node.ping));
+            const auto id = node.id.fb(builder);
+            const auto events = mobsya::detail::serialize_events(builder, values);
+            send(step::emit, n, mobsya::wrap_fb(builder, fb::CreateSendEvents(builder, m_next_request, id, events)));
+        } else {
+            load(n, step::compile);
+        }
+    }
+
+    owned_node* find_owned(const fb::NodeId* id) {
+        if(!id)
+            return nullptr;
+        const mobsya::node_id nid(id);
+        auto it = std::find_if(m_owned.begin(), m_owned.end(), [&nid](const owned_node& n) { return n.id == nid; });
+        return it == m_owned.end() ? nullptr : &*it;
+    }
+
+    void on_variables_changed(const fb::VariablesChanged& msg) {
+        if(m_stats.recording)
+            m_stats.notifications++;
+        auto node = find_owned(msg.node_id());
+        if(!node || !msg.vars())
+            return;
+        const auto vars = mobsya::detail::variables(*msg.vars());
+        auto it = vars.find("probe");
+        if(it != vars.end())
+            notified(node->probesSent, first_value(it->second), "set-variables -> notified");
+    }
+
+    void on_events_emitted(const fb::EventsEmitted& msg) {
+        if(m_stats.recording)
+            m_stats.notifications++;
+        auto node = find_owned(msg.node_id());
+        if(!node || !msg.events())
+            return;
+        const auto events = mobsya::detail::events(*msg.events());
+        auto it = events.find("pong");
+        if(it != events.end())
+            notified(node->pingsSent, first_value(it->second), "emit -> pong notified");
+    }
+
+    // Values are notified in order, those sent before the notified one are superseded
+    void notified(std::map<int16_t, clock_type::time_point>& sent, int64_t value, const char* name) {
+        auto it = sent.find(int16_t(value));
+        if(it == sent.end())
+            return;
+        m_stats.record(name, it->second);
+        sent.erase(sent.begin(), std::next(it));
+    }
+
+    tcp::socket m_socket;
+    tcp::endpoint m_server;
+    unsigned m_index;
+    const options& m_opts;
+    statistics& m_stats;
+    std::function<void()> m_ready;
+    std::deque<flatbuffers::DetachedBuffer> m_outgoing;
+    std::set<mobsya::node_id> m_nodes;
+    std::vector<owned_node> m_owned;
+    std::map<uint32_t, pending_request> m_pending;
+    uint32_t m_next_request = 1;
+    std::size_t m_setting_up = 0;
+    bool m_started = false;
+};
+
+// Resident memory of the process in kB, 0 if unknown
+static long residentMemory() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while(std::getline(status, line)) {
+        if(line.compare(0, 6, "VmRSS:") == 0)
+            return std::atol(line.c_str() + 6);
+    }
+    return 0;
+}
+
+static bool parse(int argc, char* argv[], options& opts) {
+    for(int i = 1; i < argc; i++) {
+        const std::string arg(argv[i]);
+        if(i + 1 == argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        const std::string value(argv[++i]);
+        if(arg == "--nodes")
+            opts.nodes = unsigned(std::stoul(value));
+        else if(arg == "--apps")
+            opts.apps = unsigned(std::stoul(value));
+        else if(arg == "--watch")
+            opts.watch = unsigned(std::stoul(value));
+        else if(arg == "--duration")
+            opts.duration = std::stod(value);
+        else if(arg == "--threads") {
+            opts.threads.clear();
+            std::istringstream list(value);
+            std::string threads;
+            while(std::getline(list, threads, ','))
+                opts.threads.push_back(std::max(1u, unsigned(std::stoul(threads))));
+        } else if(arg == "--workloads") {
+            opts.workloads.clear();
+            std::istringstream list(value);
+            std::string workload;
+            while(std::getline(list, workload, ',')) {
+                if(workload != "set" && workload != "emit" && workload != "compile") {
+                    std::cerr << "Unknown workload " << workload << std::endl;
+                    return false;
+                }
+                opts.workloads.push_back(workload);
+            }
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+    return opts.nodes > 0 && opts.apps > 0 && !opts.workloads.empty() && !opts.threads.empty();
+}
+
+// Run the device manager on threadCount threads for the duration of the test,
+// requestsPerSecond is set to the number of requests answered per second
+static int run(const options& opts, unsigned threadCount, double& requestsPerSecond) {
+    const long memoryAtStart = residentMemory();
+
+    // the device manager, set up as in main.cpp but without the websocket, usb and serial servers
+    boost::asio::io_context tdm;
+    boost::asio::make_service<mobsya::uuid_generator>(tdm);
+    auto& registery = boost::asio::make_service<mobsya::aseba_node_registery>(tdm);
+    boost::asio::make_service<mobsya::app_token_manager>(tdm);
+    boost::asio::make_service<mobsya::compilation_service>(tdm);
+    boost::asio::make_service<mobsya::compilation_cache>(tdm);
+    mobsya::application_server<mobsya::tcp::socket> server(tdm, 0);
+    registery.set_tcp_endpoint(server.endpoint());
+    server.accept();
+    auto& acceptor = boost::asio::make_service<mobsya::aseba_tcp_acceptor>(tdm);
+
+    boost::asio::io_context nodesContext;
+    std::vector<std::unique_ptr<simulated_node>> nodes;
+    for(unsigned i = 0; i < opts.nodes; i++) {
+        nodes.push_back(std::make_unique<simulated_node>(nodesContext, uint16_t(i + 1)));
+        nodes.back()->start();
+        acceptor.connect(nodes.back()->endpoint(), "Load test node " + std::to_string(i + 1));
+    }
+
+    boost::asio::io_context appsContext;
+    statistics stats;
+    clock_type::time_point started, stopped;
+    long memoryReady = 0;
+    boost::asio::steady_timer deadline(appsContext);
+    bool timedOut = false;
+    deadline.expires_after(std::chrono::seconds(30));
+    deadline.async_wait([&](boost::system::error_code ec) {
+        if(ec)
+            return;
+        timedOut = true;
+        appsContext.stop();
+    });
+    const auto ready = [&] {
+        if(++stats.readyApps != opts.apps)
+            return;
+        memoryReady = residentMemory();
+        stats.recording = true;
+        started = clock_type::now();
+        deadline.expires_after(std::chrono::duration_cast<clock_type::duration>(
+            std::chrono::duration<double>(opts.duration)));
+        deadline.async_wait([&](boost::system::error_code ec) {
+            if(ec)
+                return;
+            stats.recording = false;
+            stopped = clock_type::now();
+            appsContext.stop();
+        });
+    };
+    const tcp::endpoint serverEndpoint(boost::asio::ip::address_v4::loopback(), server.endpoint().port());
+    std::vector<std::unique_ptr<application>> apps;
+    for(unsigned i = 0; i < opts.apps; i++) {
+        apps.push_back(std::make_unique<application>(appsContext, serverEndpoint, i, opts, stats, ready));
+        apps.back()->start();
+    }
+
+    auto tdmWork = boost::asio::make_work_guard(tdm);
+    std::vector<std::thread> threads;
+    for(unsigned i = 0; i < threadCount; i++)
+        threads.emplace_back([&tdm] { tdm.run(); });
+    std::thread nodesThread([&nodesContext] { nodesContext.run(); });
+    appsContext.run();
+
+    const long memoryAtEnd = residentMemory();
+    nodesContext.stop();
+    nodesThread.join();
+    tdm.stop();
+    for(auto& thread : threads)
+        thread.join();
+
+    if(timedOut) {
+        std::cerr << "Timeout: " << stats.readyApps << " of " << opts.apps << " applications set up" << std::endl;
+        return 1;
+    }
+
+    const double seconds = std::chrono::duration<double>(stopped - started).count();
+    std::cout << opts.nodes << " nodes, " << opts.apps << " applications, " << threadCount << " threads, "
+              << std::fixed << std::setprecision(1) << seconds << "s" << std::endl;
+    std::cout << std::setw(28) << std::left << "" << std::right << std::setw(10) << "count" << std::setw(10)
+              << "errors" << std::setw(10) << "per s" << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms"
+              << std::endl;
+    bool success = true;
+    uint64_t requests = 0;
+    for(const auto& name : {"set-variables", "emit", "compile", "set-variables -> notified", "emit -> pong notified"}) {
+        const auto& s = stats.results[name];
+        std::cout << std::setw(28) << std::left << name << std::right << std::setw(10) << s.latencies.size()
+                  << std::setw(10) << s.errors << std::setw(10) << std::setprecision(0)
+                  << double(s.latencies.size()) / seconds << std::setw(10) << std::setprecision(2)
+                  << s.percentile(0.5) << std::setw(10) << s.percentile(0.99) << std::endl;
+        success = success && s.errors == 0;
+        if(std::strchr(name, '>') == nullptr)
+            requests += s.latencies.size();
+    }
+    requestsPerSecond = double(requests) / seconds;
+    for(const auto& workload : opts.workloads) {
+        const auto name = workload == "set" ? "set-variables" : workload;
+        success = success && !stats.results[name].latencies.empty();
+    }
+    std::cout << std::setw(28) << std::left << "notifications" << std::right << std::setw(10) << stats.notifications
+              << std::setw(20) << std::setprecision(0) << double(stats.notifications) / seconds << std::endl;
+    if(memoryAtStart != 0) {
+        std::cout << "memory: " << memoryReady / 1024 << " MB once set up, " << memoryAtEnd / 1024
+                  << " MB at the end, " << (memoryReady - memoryAtStart) / long(opts.nodes + opts.apps)
+                  << " kB per node or application" << std::endl;
+    }
+    return success ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    options opts;
+    try {
+        if(!parse(argc, argv, opts))
+            return 2;
+    } catch(const std::exception&) {
+        std::cerr << "Invalid option value" << std::endl;
+        return 2;
+    }
+
+    int result = 0;
+    std::vector<double> throughputs;
+    for(const auto threads : opts.threads) {
+        double requestsPerSecond = 0;
+        const int r = run(opts, threads, requestsPerSecond);
+        if(r != 0)
+            result = r;
+        throughputs.push_back(requestsPerSecond);
+        if(opts.threads.size() > 1)
+            std::cout << std::endl;
+    }
+    if(opts.threads.size() > 1) {
+        std::cout << std::setw(10) << "threads" << std::setw(16) << "requests per s" << std::setw(10) << "scaling"
+                  << std::endl;
+        for(std::size_t i = 0; i < opts.threads.size(); i++) {
+            std::cout << std::setw(10) << opts.threads[i] << std::setw(16) << std::fixed << std::setprecision(0)
+                      << throughputs[i] << std::setw(10) << std::setprecision(2)
+                      << (throughputs[0] > 0 ? throughputs[i] / throughputs[0] : 0) << std::endl;
+        }
+    }
+    return result;
+}
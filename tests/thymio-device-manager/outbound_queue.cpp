@@ -0,0 +1,99 @@
+#include <catch2/catch.hpp>
+#include <aseba/thymio-device-manager/outbound_message_queue.h>
+
+using mobsya::outbound_message_queue;
+using mobsya::fb::AnyMessage;
+
+namespace {
+
+// a message of the given type whose content is size bytes
+outbound_message_queue::message_ptr make_message(AnyMessage tag, std::size_t size) {
+    flatbuffers::FlatBufferBuilder fb;
+    fb.Finish(fb.CreateVector(std::vector<uint8_t>(size, 0)));
+    return std::make_shared<const mobsya::tagged_detached_flatbuffer>(
+        mobsya::tagged_detached_flatbuffer{fb.Release(), tag});
+}
+
+}  // namespace
+
+TEST_CASE("outbound messages", "[outbound_queue]") {
+    outbound_message_queue queue(1000);
+    const int node = 0, other_node = 0;
+
+    SECTION("responses are sent before telemetry") {
+        auto events = make_message(AnyMessage::EventsEmitted, 10);
+        auto ack = make_message(AnyMessage::RequestCompleted, 10);
+        queue.push_telemetry(events);
+        queue.push(ack);
+        REQUIRE(queue.pop() == ack);
+        REQUIRE(queue.pop() == events);
+        REQUIRE(queue.empty());
+        REQUIRE(queue.pop() == nullptr);
+        REQUIRE(queue.size_in_bytes() == 0);
+    }
+
+    SECTION("execution states of a node are coalesced") {
+        auto first = make_message(AnyMessage::VMExecutionStateChanged, 10);
+        auto second = make_message(AnyMessage::VMExecutionStateChanged, 10);
+        auto other = make_message(AnyMessage::VMExecutionStateChanged, 10);
+        queue.push_telemetry(first, &node);
+        queue.push_telemetry(other, &other_node);
+        queue.push_telemetry(second, &node);
+        REQUIRE(queue.coalesced() == 1);
+        REQUIRE(queue.pop() == second);
+        REQUIRE(queue.pop() == other);
+        REQUIRE(queue.empty());
+
+        // once sent, a state is not replaced anymore
+        queue.push_telemetry(first, &node);
+        REQUIRE(queue.pop() == first);
+        queue.push_telemetry(second, &node);
+        REQUIRE(queue.pop() == second);
+        REQUIRE(queue.coalesced() == 1);
+    }
+
+    SECTION("events are never coalesced") {
+        auto first = make_message(AnyMessage::EventsEmitted, 10);
+        auto second = make_message(AnyMessage::EventsEmitted, 10);
+        queue.push_telemetry(first);
+        queue.push_telemetry(second);
+        REQUIRE(queue.pop() == first);
+        REQUIRE(queue.pop() == second);
+        REQUIRE(queue.coalesced() == 0);
+    }
+
+    SECTION("pending variables are merged") {
+        std::vector<mobsya::variables_map> serialized;
+        auto serialize = [&serialized](const mobsya::variables_map& variables) {
+            serialized.push_back(variables);
+            return mobsya::tagged_detached_flatbuffer{flatbuffers::DetachedBuffer(), AnyMessage::VariablesChanged};
+        };
+        auto first = make_message(AnyMessage::VariablesChanged, 10);
+        queue.push_variables(&node, first, {{"a", mobsya::property(1)}, {"b", mobsya::property(2)}}, serialize);
+        queue.push_variables(&node, make_message(AnyMessage::VariablesChanged, 10), {{"b", mobsya::property(3)}},
+                             serialize);
+        REQUIRE(queue.coalesced() == 1);
+        REQUIRE(serialized.size() == 1);
+        REQUIRE(serialized[0].size() == 2);
+        REQUIRE(serialized[0].at("a") == mobsya::property(1));
+        REQUIRE(serialized[0].at("b") == mobsya::property(3));
+        auto merged = queue.pop();
+        REQUIRE(merged != first);
+        REQUIRE(queue.empty());
+    }
+
+    SECTION("the oldest telemetry is dropped past the budget") {
+        auto ack = make_message(AnyMessage::RequestCompleted, 600);
+        auto old_events = make_message(AnyMessage::EventsEmitted, 300);
+        auto new_events = make_message(AnyMessage::EventsEmitted, 300);
+        queue.push(ack);
+        queue.push_telemetry(old_events);
+        REQUIRE(queue.dropped() == 0);
+        queue.push_telemetry(new_events);
+        REQUIRE(queue.dropped() == 1);
+        REQUIRE(queue.size_in_bytes() <= 1000);
+        REQUIRE(queue.pop() == ack);
+        REQUIRE(queue.pop() == new_events);
+        REQUIRE(queue.empty());
+    }
+}
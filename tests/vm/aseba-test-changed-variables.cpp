@@ -0,0 +1,426 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Check that AsebaSendChangedVariables reports every written variable when the VM tracks
+// written variables in a bitmap, with or without variablesOld, that AsebaPushSubscribedVariables
+// pushes the changes of the subscribed ranges at the requested rate, and with --benchmark compare
+// the time of a poll with the diff of the whole variables array.
+
+#include "transport/buffer/vm-buffer.h"
+#include "vm/vm.h"
+#include "vm/natives.h"
+#include "common/consts.h"
+
+// C++
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static std::vector<std::vector<uint8_t>> sentMessages;
+
+extern "C" void AsebaSendBuffer(AsebaVMState*, const uint8_t* data, uint16_t length) {
+    sentMessages.emplace_back(data, data + length);
+}
+
+extern "C" uint16_t AsebaGetBuffer(AsebaVMState*, uint8_t*, uint16_t, uint16_t*) {
+    return 0;
+}
+
+extern "C" const AsebaVMDescription* AsebaGetVMDescription(AsebaVMState*) {
+    return nullptr;
+}
+
+extern "C" const AsebaLocalEventDescription* AsebaGetLocalEventsDescriptions(AsebaVMState*) {
+    return nullptr;
+}
+
+static const AsebaNativeFunctionDescription* nativeFunctionsDescriptions[] = {ASEBA_NATIVES_STD_DESCRIPTIONS, nullptr};
+
+extern "C" const AsebaNativeFunctionDescription* const* AsebaGetNativeFunctionsDescriptions(AsebaVMState*) {
+    return nativeFunctionsDescriptions;
+}
+
+static AsebaNativeFunctionPointer nativeFunctions[] = {ASEBA_NATIVES_STD_FUNCTIONS};
+
+extern "C" void AsebaNativeFunction(AsebaVMState* vm, uint16_t id) {
+    nativeFunctions[id](vm);
+}
+
+extern "C" void AsebaWriteBytecode(AsebaVMState*) {}
+
+extern "C" void AsebaResetIntoBootloader(AsebaVMState*) {}
+
+extern "C" void AsebaPutVmToSleep(AsebaVMState*) {}
+
+extern "C" void AsebaAssert(AsebaVMState* vm, AsebaAssertReason reason) {
+    std::cerr << "Internal VM exception " << reason << " at pc " << vm->pc << std::endl;
+    exit(1);
+}
+
+// a VM with a given way of finding changed variables, and the variables as seen by a client
+struct Node {
+    std::string name;
+    AsebaVMState vm;
+    std::vector<uint16_t> bytecode;
+    std::vector<int16_t> stack;
+    std::vector<int16_t> variables;
+    std::vector<int16_t> variablesOld;
+    std::vector<uint16_t> variablesDirty;
+#ifdef ASEBA_VM_THREADED
+    std::vector<AsebaVMThreadedInstr> threadedCode;
+#endif  // ASEBA_VM_THREADED
+    std::vector<int16_t> client;
+
+    Node(std::string name, uint16_t variablesSize, bool old, bool dirty, bool threaded)
+        : name(std::move(name)),
+          bytecode(512),
+          stack(32),
+          variables(variablesSize),
+          variablesOld(old ? variablesSize : 0),
+          variablesDirty(dirty ? (variablesSize + 15) / 16 : 0),
+          client(variablesSize) {
+        memset(&vm, 0, sizeof(vm));
+        vm.nodeId = 1;
+        vm.bytecode = bytecode.data();
+        vm.bytecodeSize = uint16_t(bytecode.size());
+        vm.stack = stack.data();
+        vm.stackSize = uint16_t(stack.size());
+        vm.variables = variables.data();
+        vm.variablesSize = variablesSize;
+        vm.variablesOld = old ? variablesOld.data() : nullptr;
+#ifdef ASEBA_VM_DIRTY_TRACKING
+        vm.variablesDirty = dirty ? variablesDirty.data() : nullptr;
+#endif  // ASEBA_VM_DIRTY_TRACKING
+#ifdef ASEBA_VM_THREADED
+        if(threaded) {
+            threadedCode.resize(bytecode.size());
+            vm.threadedCode = threadedCode.data();
+        }
+#endif  // ASEBA_VM_THREADED
+        AsebaVMInit(&vm);
+    }
+
+    // run code as the init event
+    void run(const std::vector<uint16_t>& code) {
+        bytecode[0] = 3;
+        bytecode[1] = ASEBA_EVENT_INIT;
+        bytecode[2] = 3;
+        std::copy(code.begin(), code.end(), bytecode.begin() + 3);
+#ifdef ASEBA_VM_THREADED
+        vm.threadedCodeValid = 0;
+#endif  // ASEBA_VM_THREADED
+        AsebaVMSetupEvent(&vm, ASEBA_EVENT_INIT);
+        AsebaVMRun(&vm, 0);
+    }
+
+    // call native with arguments given in order, followed by the template size
+    void call(AsebaNativeFunctionPointer native, const std::vector<uint16_t>& args) {
+        vm.sp = -1;
+        for(auto it = args.rbegin(); it != args.rend(); ++it)
+            stack[++vm.sp] = *it;
+        native(&vm);
+    }
+
+    // send a SET_VARIABLES message, as a client would
+    void setVariables(uint16_t start, const std::vector<int16_t>& values) {
+        std::vector<uint16_t> data{bswap16(vm.nodeId), bswap16(start)};
+        for(auto value : values)
+            data.push_back(bswap16(uint16_t(value)));
+        AsebaVMDebugMessage(&vm, ASEBA_MESSAGE_SET_VARIABLES, data.data(), uint16_t(data.size()));
+    }
+
+#ifdef ASEBA_VM_SUBSCRIPTIONS
+    // send a SUBSCRIBE_VARIABLES message, as the device manager would, and return the words of the
+    // VARIABLES_SUBSCRIBED acknowledgement, empty if none was sent
+    std::vector<uint16_t> subscribe(uint16_t period, const std::vector<std::pair<uint16_t, uint16_t>>& ranges) {
+        std::vector<uint16_t> data{bswap16(vm.nodeId), bswap16(period)};
+        for(const auto& range : ranges) {
+            data.push_back(bswap16(range.first));
+            data.push_back(bswap16(range.second));
+        }
+        sentMessages.clear();
+        AsebaVMDebugMessage(&vm, ASEBA_MESSAGE_SUBSCRIBE_VARIABLES, data.data(), uint16_t(data.size()));
+        std::vector<uint16_t> ack;
+        for(const auto& message : sentMessages) {
+            auto word = [&message](size_t i) { return uint16_t(message[2 * i] | (message[2 * i + 1] << 8)); };
+            if(word(0) != ASEBA_MESSAGE_VARIABLES_SUBSCRIBED)
+                continue;
+            for(size_t i = 1; 2 * i + 1 < message.size(); ++i)
+                ack.push_back(word(i));
+        }
+        return ack;
+    }
+
+#endif  // ASEBA_VM_SUBSCRIPTIONS
+
+    // poll changed variables, update the client copy, and return the raw messages
+    std::vector<std::vector<uint8_t>> poll() {
+        sentMessages.clear();
+        AsebaSendChangedVariables(&vm);
+        return receive();
+    }
+
+#ifdef ASEBA_VM_SUBSCRIPTIONS
+    // let the node push subscribed variables, update the client copy, and return the raw messages
+    std::vector<std::vector<uint8_t>> push(uint16_t time) {
+        sentMessages.clear();
+        AsebaPushSubscribedVariables(&vm, time);
+        return receive();
+    }
+#endif  // ASEBA_VM_SUBSCRIPTIONS
+
+    // update the client copy from sent messages, and return them
+    std::vector<std::vector<uint8_t>> receive() {
+        for(const auto& message : sentMessages) {
+            auto word = [&message](size_t i) { return uint16_t(message[2 * i] | (message[2 * i + 1] << 8)); };
+            if(word(0) != ASEBA_MESSAGE_CHANGED_VARIABLES)
+                continue;
+            for(size_t i = 1; 2 * (i + 2) <= message.size();) {
+                const uint16_t start = word(i);
+                const uint16_t size = word(i + 1);
+                i += 2;
+                for(uint16_t j = 0; j < size; ++j)
+                    client[start + j] = int16_t(word(i++));
+            }
+        }
+        return sentMessages;
+    }
+};
+
+// bytecode storing value at address, directly or through an array
+static void store(std::vector<uint16_t>& code, uint16_t address, int16_t value) {
+    code.push_back(AsebaBytecodeFromId(ASEBA_BYTECODE_LARGE_IMMEDIATE));
+    code.push_back(uint16_t(value));
+    code.push_back(AsebaBytecodeFromId(ASEBA_BYTECODE_STORE) | address);
+}
+
+static void storeIndirect(std::vector<uint16_t>& code, uint16_t array, uint16_t size, uint16_t index, int16_t value) {
+    code.push_back(AsebaBytecodeFromId(ASEBA_BYTECODE_LARGE_IMMEDIATE));
+    code.push_back(uint16_t(value));
+    code.push_back(AsebaBytecodeFromId(ASEBA_BYTECODE_LARGE_IMMEDIATE));
+    code.push_back(index);
+    code.push_back(AsebaBytecodeFromId(ASEBA_BYTECODE_STORE_INDIRECT) | array);
+    code.push_back(size);
+}
+
+static bool check(std::mt19937& gen) {
+    const uint16_t variablesSize = 1000;
+    std::vector<Node> nodes;
+    nodes.emplace_back("variablesOld", variablesSize, true, false, false);
+#ifdef ASEBA_VM_DIRTY_TRACKING
+    nodes.emplace_back("bitmap", variablesSize, false, true, false);
+    nodes.emplace_back("bitmap, threaded", variablesSize, false, true, true);
+    nodes.emplace_back("bitmap and variablesOld, threaded", variablesSize, true, true, true);
+#endif  // ASEBA_VM_DIRTY_TRACKING
+
+    std::uniform_int_distribution<int> address(0, variablesSize - 1);
+    std::uniform_int_distribution<int> arrayAddress(0, variablesSize - 64);
+    std::uniform_int_distribution<int> length(1, 64);
+    std::uniform_int_distribution<int> value(-32768, 32767);
+    std::uniform_int_distribution<int> kind(0, 4);
+    std::uniform_int_distribution<int> count(0, 20);
+
+    for(unsigned round = 0; round < 500; ++round) {
+        // write the same variables in every node, in several ways
+        const int writes = count(gen);
+        for(int w = 0; w < writes; ++w) {
+            std::vector<uint16_t> code;
+            const auto a = uint16_t(arrayAddress(gen));
+            const auto b = uint16_t(arrayAddress(gen));
+            const auto n = uint16_t(length(gen));
+            const auto v = int16_t(value(gen) % 4);
+            const auto k = kind(gen);
+            if(k == 0) {
+                store(code, uint16_t(address(gen)), v);
+                store(code, uint16_t(address(gen)), int16_t(value(gen)));
+            } else if(k == 1)
+                storeIndirect(code, a, n, uint16_t(address(gen) % n), v);
+            code.push_back(AsebaBytecodeFromId(ASEBA_BYTECODE_STOP));
+
+            std::vector<int16_t> values(n);
+            for(auto& x : values)
+                x = int16_t(value(gen));
+
+            for(auto& node : nodes) {
+                switch(k) {
+                    case 2: node.call(AsebaNative_vecadd, {a, b, a, n}); break;
+                    case 3: node.call(AsebaNative_vecsort, {a, n}); break;
+                    case 4: node.setVariables(a, values); break;
+                    default: node.run(code); break;
+                }
+            }
+        }
+
+        std::vector<std::vector<uint8_t>> reference;
+        for(auto& node : nodes) {
+            const auto messages = node.poll();
+            if(messages.empty()) {
+                std::cerr << node.name << ": no answer to the poll " << round << std::endl;
+                return false;
+            }
+            if(node.client != node.variables) {
+                std::cerr << node.name << ": client variables differ after poll " << round << std::endl;
+                return false;
+            }
+            if(node.variables != nodes[0].variables) {
+                std::cerr << node.name << ": variables differ from the first node after round " << round << std::endl;
+                return false;
+            }
+            // with previous values available, the bitmap must not change the messages
+            if(node.vm.variablesOld) {
+                if(reference.empty())
+                    reference = messages;
+                else if(messages != reference) {
+                    std::cerr << node.name << ": messages differ from the diff of variablesOld after poll "
+                              << round << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+#ifdef ASEBA_VM_SUBSCRIPTIONS
+static bool checkSubscription(std::mt19937& gen) {
+    const uint16_t variablesSize = 1000;
+    const uint16_t period = 50;
+    const std::vector<std::pair<uint16_t, uint16_t>> ranges{{10, 100}, {500, 37}, {990, 100}};
+    auto subscribed = [&ranges](unsigned i) {
+        for(const auto& range : ranges)
+            if(i >= range.first && i < unsigned(range.first) + range.second)
+                return true;
+        return false;
+    };
+
+    std::vector<Node> nodes;
+    nodes.emplace_back("variablesOld", variablesSize, true, false, false);
+#ifdef ASEBA_VM_DIRTY_TRACKING
+    nodes.emplace_back("bitmap", variablesSize, false, true, false);
+#endif  // ASEBA_VM_DIRTY_TRACKING
+
+    std::uniform_int_distribution<int> address(0, variablesSize - 1);
+    std::uniform_int_distribution<int> value(-32768, 32767);
+    std::uniform_int_distribution<int> count(0, 5);
+    std::uniform_int_distribution<int> step(1, 40);
+
+    for(auto& node : nodes) {
+        if(!node.push(0).empty()) {
+            std::cerr << node.name << ": push without subscription" << std::endl;
+            return false;
+        }
+        // the node acknowledges with the ranges within its variables
+        const std::vector<uint16_t> expectedAck{period, 10, 100, 500, 37, 990, 10};
+        if(node.subscribe(period, ranges) != expectedAck) {
+            std::cerr << node.name << ": wrong acknowledgement of the subscription" << std::endl;
+            return false;
+        }
+
+        // the time given to the node wraps around during the test
+        uint32_t now = 60000;
+        uint32_t lastPush = 0;
+        for(unsigned round = 0; round < 2000; ++round) {
+            const int writes = count(gen);
+            for(int w = 0; w < writes; ++w)
+                node.setVariables(uint16_t(address(gen)), {int16_t(value(gen))});
+
+            now += step(gen);
+            const uint32_t elapsed = now - lastPush;
+            if(!node.push(uint16_t(now)).empty()) {
+                if(elapsed < period) {
+                    std::cerr << node.name << ": push after " << elapsed << " ms in round " << round << std::endl;
+                    return false;
+                }
+                lastPush = now;
+            }
+            // once the period has elapsed, the client must be up to date in the subscribed ranges
+            for(unsigned i = 0; i < variablesSize; ++i) {
+                if(subscribed(i) && elapsed >= period && node.client[i] != node.variables[i]) {
+                    std::cerr << node.name << ": variable " << i << " not pushed in round " << round << std::endl;
+                    return false;
+                }
+                if(!subscribed(i) && node.client[i] != 0) {
+                    std::cerr << node.name << ": variable " << i << " pushed outside ranges" << std::endl;
+                    return false;
+                }
+            }
+        }
+
+        // after unsubscribing, nothing is pushed anymore
+        if(node.subscribe(period, {}) != std::vector<uint16_t>{period}) {
+            std::cerr << node.name << ": wrong acknowledgement of the unsubscription" << std::endl;
+            return false;
+        }
+        node.setVariables(ranges[0].first, {1, 2, 3});
+        if(!node.push(uint16_t(now + period)).empty()) {
+            std::cerr << node.name << ": push after unsubscribing" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+#endif  // ASEBA_VM_SUBSCRIPTIONS
+
+static void benchmark(std::mt19937& gen) {
+    const uint16_t sizes[] = {256, 1024, 4096, 16384};
+    std::uniform_int_distribution<int> value(-32768, 32767);
+
+    std::cout << std::setw(8) << "size" << std::setw(22) << "variablesOld" << std::setw(22) << "bitmap"
+              << "   (ns per poll, 8 variables written)" << std::endl;
+    for(auto size : sizes) {
+        std::uniform_int_distribution<int> address(0, size - 1);
+        std::cout << std::setw(8) << size;
+        for(bool dirty : {false, true}) {
+            Node node("", size, !dirty, dirty, false);
+            const unsigned iterations = 2000000 / size + 100;
+            std::chrono::steady_clock::duration duration(0);
+            for(unsigned i = 0; i < iterations; ++i) {
+                for(unsigned j = 0; j < 8; ++j)
+                    node.setVariables(uint16_t(address(gen)), {int16_t(value(gen))});
+                const auto start = std::chrono::steady_clock::now();
+                sentMessages.clear();
+                AsebaSendChangedVariables(&node.vm);
+                duration += std::chrono::steady_clock::now() - start;
+            }
+            std::cout << std::setw(22) << std::fixed << std::setprecision(1)
+                      << std::chrono::duration<double, std::nano>(duration).count() / iterations;
+        }
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::mt19937 gen(1);
+
+    if(argc > 1 && std::string(argv[1]) == "--benchmark") {
+        benchmark(gen);
+        return 0;
+    }
+    if(!check(gen))
+        return 1;
+#ifdef ASEBA_VM_SUBSCRIPTIONS
+    if(!checkSubscription(gen))
+        return 1;
+#endif  // ASEBA_VM_SUBSCRIPTIONS
+    return 0;
+}
@@ -0,0 +1,187 @@
+/*
+    Aseba - an event-based framework for distributed robot control
+    Created by Stéphane Magnenat <stephane at magnenat dot net> (http://stephane.magnenat.net)
+    with contributions from the community.
+    Copyright (C) 2007--2018 the authors, see authors.txt for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation, version 3 of the License.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Check that the SIMD kernels of the vector natives give the same results as the scalar
+// code, and with --benchmark compare their speed for several array lengths.
+
+#include "vm/natives.h"
+#include "vm/natives-simd.h"
+#include "common/consts.h"
+
+// C++
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static const AsebaSimdLevel levels[] = {ASEBA_SIMD_SCALAR, ASEBA_SIMD_SSE2, ASEBA_SIMD_AVX2, ASEBA_SIMD_NEON};
+
+static const unsigned variablesSize = 4096;
+
+// a VM just large enough to call natives
+struct NativeRunner {
+    AsebaVMState vm;
+    std::vector<int16_t> variables;
+    int16_t stack[8];
+
+    explicit NativeRunner(const std::vector<int16_t>& initial) : variables(initial) {
+        memset(&vm, 0, sizeof(vm));
+        vm.variables = variables.data();
+        vm.variablesSize = variables.size();
+        vm.stack = stack;
+        vm.stackSize = 8;
+    }
+
+    // call native with arguments given in order, followed by the template size
+    void call(AsebaNativeFunctionPointer native, const std::vector<uint16_t>& args) {
+        vm.sp = -1;
+        for(auto it = args.rbegin(); it != args.rend(); ++it)
+            stack[++vm.sp] = *it;
+        native(&vm);
+    }
+};
+
+// description of one call to a native, as the argument addresses and size
+struct NativeCall {
+    const char* name;
+    AsebaNativeFunctionPointer native;
+    std::vector<uint16_t> args;
+};
+
+static std::vector<int16_t> randomVariables(std::mt19937& gen) {
+    // favour extreme values, which exercise wraparound and comparisons
+    std::uniform_int_distribution<int> value(-32768, 32767);
+    std::uniform_int_distribution<int> kind(0, 7);
+    std::vector<int16_t> variables(variablesSize);
+    for(auto& v : variables) {
+        switch(kind(gen)) {
+            case 0: v = -32768; break;
+            case 1: v = 32767; break;
+            case 2: v = int16_t(value(gen) % 8); break;
+            default: v = int16_t(value(gen)); break;
+        }
+    }
+    return variables;
+}
+
+static std::vector<NativeCall> calls(uint16_t dest, uint16_t src1, uint16_t src2, uint16_t src3, uint16_t length,
+                                     uint16_t shiftAddr) {
+    return {
+        {"math.add", AsebaNative_vecadd, {dest, src1, src2, length}},
+        {"math.sub", AsebaNative_vecsub, {dest, src1, src2, length}},
+        {"math.mul", AsebaNative_vecmul, {dest, src1, src2, length}},
+        {"math.min", AsebaNative_vecmin, {dest, src1, src2, length}},
+        {"math.max", AsebaNative_vecmax, {dest, src1, src2, length}},
+        {"math.clamp", AsebaNative_vecclamp, {dest, src1, src2, src3, length}},
+        {"math.dot", AsebaNative_vecdot, {dest, src1, src2, shiftAddr, length}},
+        {"math.stat", AsebaNative_vecstat, {src1, dest, uint16_t(dest + 1), uint16_t(dest + 2), length}},
+    };
+}
+
+static bool check(std::mt19937& gen) {
+    std::uniform_int_distribution<int> address(0, 512);
+    std::uniform_int_distribution<int> offset(-20, 20);
+    bool success = true;
+
+    for(unsigned length = 0; length < 300; ++length) {
+        const std::vector<int16_t> initial = randomVariables(gen);
+        const auto base = uint16_t(address(gen));
+        // disjoint and aliased arrays, including overlaps which need the scalar loop
+        const uint16_t aliases[][3] = {
+            {uint16_t(base + 2000), base, uint16_t(base + 500)},
+            {base, base, base},
+            {base, uint16_t(base + offset(gen) + 20), uint16_t(base + 1000)},
+            {uint16_t(base + 20 + offset(gen)), uint16_t(base + 20), uint16_t(base + 20 + offset(gen))},
+        };
+        for(const auto& alias : aliases) {
+            for(const auto& call : calls(alias[0], alias[1], alias[2], uint16_t(base + 3000), length, 4095)) {
+                if(length == 0 && std::string(call.name) == "math.stat")
+                    continue;
+                AsebaSimdSetLevel(ASEBA_SIMD_SCALAR);
+                NativeRunner reference(initial);
+                reference.variables[4095] = int16_t(length % 20);
+                reference.call(call.native, call.args);
+
+                for(auto level : levels) {
+                    if(level == ASEBA_SIMD_SCALAR || !AsebaSimdSetLevel(level))
+                        continue;
+                    NativeRunner runner(initial);
+                    runner.variables[4095] = int16_t(length % 20);
+                    runner.call(call.native, call.args);
+                    if(runner.variables != reference.variables) {
+                        std::cerr << call.name << " with " << AsebaSimdLevelName(level) << " differs from scalar code"
+                                  << " for length " << length << ", dest " << alias[0] << ", src " << alias[1]
+                                  << std::endl;
+                        success = false;
+                    }
+                }
+            }
+        }
+    }
+    return success;
+}
+
+static void benchmark(std::mt19937& gen) {
+    const unsigned lengths[] = {4, 8, 16, 32, 64, 128, 256, 1024};
+    const std::vector<int16_t> initial = randomVariables(gen);
+
+    std::cout << std::setw(12) << "native" << std::setw(8) << "length";
+    for(auto level : levels)
+        if(AsebaSimdSetLevel(level))
+            std::cout << std::setw(10) << AsebaSimdLevelName(level);
+    std::cout << "   (ns per call)" << std::endl;
+
+    // arrays do not start at multiples of 4 kB from each other, to avoid aliasing in caches
+    for(const auto& model : calls(0, 1030, 2070, 3110, 0, 4095)) {
+        for(auto length : lengths) {
+            std::cout << std::setw(12) << model.name << std::setw(8) << length;
+            for(auto level : levels) {
+                if(!AsebaSimdSetLevel(level))
+                    continue;
+                NativeRunner runner(initial);
+                runner.variables[4095] = 4;
+                NativeCall call(model);
+                call.args.back() = uint16_t(length);
+                const unsigned iterations = 2000000 / (length + 16);
+                const auto start = std::chrono::steady_clock::now();
+                for(unsigned i = 0; i < iterations; ++i)
+                    runner.call(call.native, call.args);
+                const auto duration = std::chrono::steady_clock::now() - start;
+                const double ns = std::chrono::duration<double, std::nano>(duration).count() / iterations;
+                std::cout << std::setw(10) << std::fixed << std::setprecision(1) << ns;
+            }
+            std::cout << std::endl;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::mt19937 gen(1);
+    const AsebaSimdLevel detected = AsebaSimdGetLevel();
+    std::cout << "Detected instruction set: " << AsebaSimdLevelName(detected) << std::endl;
+
+    if(argc > 1 && std::string(argv[1]) == "--benchmark") {
+        benchmark(gen);
+        return 0;
+    }
+    return check(gen) ? 0 : 1;
+}